@@ -0,0 +1,166 @@
+#ifndef OD_BENCH_H
+#define OD_BENCH_H
+
+/**
+   The equivalence test and benchmark of the overdrives (test/test_clip.c
+   and test/bench_clip.c in each bundle), against `od_ref()`, the loop each
+   plugin ran before od_clip.h, in the bundle's test/od_ref.c.  The figures
+   in README.txt were measured with the programs built by
+
+     CFLAGS=-O2 ./waf configure --test && ./waf
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+
+#include "od_clip.h"
+
+/** Inputs of the test, evenly over [-1.25, 1.25], and of the benchmark. */
+#define OD_BENCH_N (1 << 21)
+
+/** Report a failed check and count it. */
+#define CHECK(cond, ...)                                  \
+   do {                                                   \
+      if (!(cond)) {                                      \
+         fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);  \
+         fprintf(stderr, __VA_ARGS__);                    \
+         fprintf(stderr, "\n");                           \
+         failures++;                                      \
+      }                                                   \
+   } while (0)
+
+/** The plugin, linked into each program. */
+const LV2_Descriptor* lv2_descriptor(uint32_t index);
+
+/**
+   The plugin's run() before od_clip.h, its control ports ("level", "th",
+   "th2") from ctl[2] on.
+*/
+void od_ref(const float* input, float* output, uint32_t n_samples,
+            const float* ctl);
+
+/**
+   Seconds of CPU used by the calling thread, which other processes on the
+   machine do not disturb as much as they do the clock.
+*/
+static inline double
+od_bench_cpu(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+   return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/** An instance with control ports 2 to `ports` - 1 connected to `ctl`. */
+static inline LV2_Handle
+od_bench_instance(float* ctl, int ports)
+{
+   const LV2_Descriptor* d = lv2_descriptor(0);
+   LV2_Handle h = d->instantiate(d, 48000, "", NULL);
+   int p;
+
+   if (h == NULL)
+      return NULL;
+   for (p = 2; p < ports; p++)
+      d->connect_port(h, p, &ctl[p]);
+   d->activate(h);
+   return h;
+}
+
+/**
+   Run `n` samples through `h` in `block`-frame blocks, or through od_ref()
+   with `ctl` if `h` is NULL.
+*/
+static inline void
+od_bench_render(LV2_Handle h, const float* ctl, const float* in, float* out,
+                int n, int block)
+{
+   const LV2_Descriptor* d = lv2_descriptor(0);
+   int pos, len;
+
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      if (h == NULL) {
+         od_ref(in + pos, out + pos, len, ctl);
+      }
+      else {
+         d->connect_port(h, 0, (void*)(in + pos));
+         d->connect_port(h, 1, out + pos);
+         d->run(h, len);
+      }
+   }
+}
+
+/**
+   Largest difference of the plugin from od_ref() with the ports at `ctl`,
+   over OD_BENCH_N inputs from -1.25 to 1.25 in blocks of 777 frames, or -1
+   if there is no instance.
+*/
+static inline double
+od_bench_diff(float* ctl, int ports)
+{
+   static float in[OD_BENCH_N], ref[OD_BENCH_N], out[OD_BENCH_N];
+   LV2_Handle h = od_bench_instance(ctl, ports);
+   double err = 0;
+   int i;
+
+   if (h == NULL)
+      return -1;
+   for (i = 0; i < OD_BENCH_N; i++)
+      in[i] = -1.25f + 2.5f*i/OD_BENCH_N;
+   od_bench_render(NULL, ctl, in, ref, OD_BENCH_N, 777);
+   od_bench_render(h, ctl, in, out, OD_BENCH_N, 777);
+   lv2_descriptor(0)->cleanup(h);
+
+   for (i = 0; i < OD_BENCH_N; i++)
+      err = fmax(err, fabs(out[i] - ref[i]));
+   return err;
+}
+
+/**
+   Print ns per sample of od_ref() ("old") and of the plugin ("new") at 64,
+   512 and 4096-frame blocks, ports at `ctl`, on OD_BENCH_N samples of a
+   swelling sine, best of 5.
+*/
+static inline int
+od_bench_table(const char* name, float* ctl, int ports)
+{
+   static const int blocks[] = {64, 512, 4096};
+   static float in[OD_BENCH_N], out[OD_BENCH_N];
+   LV2_Handle h = od_bench_instance(ctl, ports);
+   double t, best;
+   int v, b, r, i;
+
+   if (h == NULL) {
+      fprintf(stderr, "bench_clip: no instance\n");
+      return 1;
+   }
+   for (i = 0; i < OD_BENCH_N; i++)
+      in[i] = 0.9*sin(i*0.031)*sin(i*0.00011) + 0.02*sin(i*0.9);
+
+   printf("  ns/sample            64 frames   512 frames   4096 frames\n");
+   for (v = 0; v < 2; v++) {
+      printf("  %-18s %s", v ? "" : name, v ? "new" : "old");
+      for (b = 0; b < 3; b++) {
+         for (r = 0, best = -1; r < 5; r++) {
+            t = od_bench_cpu();
+            od_bench_render(v ? h : NULL, ctl, in, out, OD_BENCH_N,
+                            blocks[b]);
+            t = 1e9*(od_bench_cpu() - t)/OD_BENCH_N;
+            best = best < 0 || t < best ? t : best;
+         }
+         printf("    %5.1f    ", best);
+      }
+      printf("\n");
+   }
+   lv2_descriptor(0)->cleanup(h);
+   return 0;
+}
+
+#endif
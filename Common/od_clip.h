@@ -0,0 +1,137 @@
+#ifndef OD_CLIP_H
+#define OD_CLIP_H
+
+#include <math.h>
+#include <stdint.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+   The soft clipper shared by DafxOverdrive, MyOverdrive,
+   MyOverdrive2Params and MyMultibandOverdrive:
+
+              { a x                          |x| < th
+      f(x) =  { sign(x) (e + d |x| + c x^2)  th <= |x| <= th2
+              { sign(x)                      |x| > th2
+
+   times level.  The plugins differ only in th, th2 and how they derive a,
+   c, d and e, which they recompute when their ports change.  Each bundle
+   builds on its own, so the kernel lives in this header, included through
+   the wscripts.
+
+   All three pieces are computed for every sample and the right one is
+   selected with compare masks, so there are no branches to mispredict
+   where the signal crosses th and th2.  The linear and clipped pieces give
+   the same floats as the plugins' original loops; the quadratic, which
+   they evaluated partly in double with pow(), differs by rounding.
+*/
+typedef struct {
+   float th;      // below: linear
+   float th2;     // above: clipped
+   float a;       // coefficients, times level
+   float c;
+   float d;
+   float e;
+   float level;
+} OdClip;
+
+/** Set the curve, the coefficients given for a level of 1. */
+static inline void
+od_clip_set(OdClip* clip, float th, float th2, float a, float c, float d,
+            float e, float level)
+{
+   clip->th = th;
+   clip->th2 = th2;
+   clip->a = a*level;
+   clip->c = c*level;
+   clip->d = d*level;
+   clip->e = e*level;
+   clip->level = level;
+}
+
+/** f(x) for one sample, with the same operations as the SSE path. */
+static inline float
+od_clip_eval(const OdClip* clip, float x)
+{
+   const float ax = fabsf(x);
+   const float lin = clip->a*x;
+   const float quad = copysignf(1, x)*(clip->e + ax*(clip->d + ax*clip->c));
+   const float top = copysignf(clip->level, x);
+   const float y = ax < clip->th ? lin : quad;
+
+   return ax > clip->th2 ? top : y;
+}
+
+#if defined(__SSE2__)
+/**
+   Four curves side by side, one per lane, for four signals processed
+   together (the bands of MyMultibandOverdrive).  od_clip_process() puts
+   the same curve in every lane.
+*/
+typedef struct {
+   __m128 th;
+   __m128 th2;
+   __m128 a;
+   __m128 c;
+   __m128 d;
+   __m128 e;
+   __m128 level;
+} OdClip4;
+
+/** Put clip[0] - clip[3] in the lanes. */
+static inline void
+od_clip4_set(OdClip4* clip4, const OdClip* clip)
+{
+   clip4->th = _mm_setr_ps(clip[0].th, clip[1].th, clip[2].th, clip[3].th);
+   clip4->th2 = _mm_setr_ps(clip[0].th2, clip[1].th2, clip[2].th2,
+                            clip[3].th2);
+   clip4->a = _mm_setr_ps(clip[0].a, clip[1].a, clip[2].a, clip[3].a);
+   clip4->c = _mm_setr_ps(clip[0].c, clip[1].c, clip[2].c, clip[3].c);
+   clip4->d = _mm_setr_ps(clip[0].d, clip[1].d, clip[2].d, clip[3].d);
+   clip4->e = _mm_setr_ps(clip[0].e, clip[1].e, clip[2].e, clip[3].e);
+   clip4->level = _mm_setr_ps(clip[0].level, clip[1].level, clip[2].level,
+                              clip[3].level);
+}
+
+/** f(x) of each lane by the curve of that lane. */
+static inline __m128
+od_clip4_eval(const OdClip4* clip4, __m128 xv)
+{
+   const __m128 sign = _mm_set1_ps(-0.0f);
+   __m128 s = _mm_and_ps(sign, xv);
+   __m128 ax = _mm_andnot_ps(sign, xv);
+   __m128 lin = _mm_mul_ps(clip4->a, xv);
+   __m128 quad = _mm_add_ps(clip4->e, _mm_mul_ps(ax, _mm_add_ps(clip4->d,
+                                          _mm_mul_ps(ax, clip4->c))));
+   __m128 top = _mm_xor_ps(clip4->level, s);
+   __m128 lo = _mm_cmplt_ps(ax, clip4->th);
+   __m128 hi = _mm_cmpgt_ps(ax, clip4->th2);
+   __m128 yv;
+
+   quad = _mm_xor_ps(quad, s);
+   yv = _mm_or_ps(_mm_and_ps(lo, lin), _mm_andnot_ps(lo, quad));
+   return _mm_or_ps(_mm_and_ps(hi, top), _mm_andnot_ps(hi, yv));
+}
+#endif
+
+/** y[i] = f(x[i]), i < n; may run in place. */
+static inline void
+od_clip_process(const OdClip* clip, const float* x, float* y, uint32_t n)
+{
+   uint32_t i = 0;
+
+#if defined(__SSE2__)
+   const OdClip same[4] = { *clip, *clip, *clip, *clip };
+   OdClip4 clip4;
+
+   od_clip4_set(&clip4, same);
+   for (; i + 4 <= n; i += 4)
+      _mm_storeu_ps(y + i, od_clip4_eval(&clip4, _mm_loadu_ps(x + i)));
+#endif
+   for (; i < n; i++)
+      y[i] = od_clip_eval(clip, x[i]);
+}
+
+#endif
@@ -13,6 +13,13 @@
 */
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 
+#include "fuzz_adaa.h"
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+/** Samples shaped at a time into the scratch of `run()`. */
+#define FUZZ_CHUNK 64
+
 /**
    The URI is the identifier for a plugin, and how the host associates this
    implementation in code with its description in data. If this URI does not
@@ -29,7 +36,8 @@ typedef enum {
 	INPUT = 0,
 	OUTPUT = 1, 
    GAIN = 2,
-   MIX = 3
+   MIX = 3,
+   AA = 4
 } PortIndex;
 
 /**
@@ -42,6 +50,8 @@ typedef struct {
    float*       output;   // lv2 audio port;
    const float* gain;     // lv2 control port
    const float* mix;     // lv2 control port
+   const float* aa;       // lv2 control port
+   FuzzAdaa adaa;         // antialiasing of the curve
 } Fuzz;
 
 float sign(float n) {
@@ -82,6 +92,9 @@ connect_port(LV2_Handle instance,
    case MIX:
       fuzz->mix = (const float*)data;
       break;
+   case AA:
+      fuzz->aa = (const float*)data;
+      break;
 	}
 
 }
@@ -95,15 +108,17 @@ connect_port(LV2_Handle instance,
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
-	uint32_t pos;
-	const Fuzz* fuzz = (Fuzz*)instance;
+	uint32_t pos, j, len;
+	Fuzz* fuzz = (Fuzz*)instance;
 	const float* const input  = fuzz->input;
 	float* const       output = fuzz->output;
    float gain = *(fuzz->gain);
    float mix = *(fuzz->mix);
-   float q[5000];
-   float z[5000];
-   float maxX = 0, maxZ = 0, maxY = 0, y;
+   float q[FUZZ_CHUNK];
+   float z[FUZZ_CHUNK];
+   float xd[FUZZ_CHUNK];
+   float maxX = 0, maxZ, maxY, scale = 0, a = 0, b = 0, k = 0;
+   const float* x;
 
 	if (fuzz == NULL) {
 		fprintf(stderr, "DAFX_FUZZ: run() called with NULL instance parameter.\n");
@@ -115,44 +130,52 @@ run(LV2_Handle instance, uint32_t n_samples)
          maxX = fabs(input[pos]);
    }
 
-   for (pos = 0; pos < n_samples; pos++) {
-      if (maxX > 0) q[pos] = input[pos]*gain/maxX;
-      else q[pos] = 0;
-   }
-
-   for (pos = 0; pos < n_samples; pos++) {
-      z[pos] = sign(q[pos])*(1.0 - exp(sign(-q[pos]) * q[pos]));
-   }
-
-   //MAXZ
-   for (pos = 0; pos < n_samples; pos++) {
-      if (fabs(z[pos]) > maxZ)
-         maxZ = fabs(z[pos]);
-   }
-
-
-   for (pos = 0; pos < n_samples; pos++) {
-      if (maxX > 0 && maxZ > 0) y = mix*z[pos]*maxX/maxZ + (1-mix)*input[pos];
-      else y = 0;
-      q[pos] = y;
-   }
-
-   //MAXY
-   for (pos = 0; pos < n_samples; pos++) {
-      if (fabs(q[pos]) > maxY)
-         maxY = fabs(q[pos]);
-   }
-
-   for (pos = 0; pos < n_samples; pos++) {
-      if (maxX > 0 && maxY > 0) q[pos] = q[pos]*maxX/maxY;
-      else q[pos] = 0;
+   /*
+      q = gain x/maxX reaches +-gain at the peak sample, and the curve is
+      odd and never decreases, so maxZ = f(gain) with no pass over z.
+      y = mix z maxX/maxZ + (1 - mix) x never decreases with x either, so
+      maxY is |y| at the peak sample, which is maxX up to rounding.  The
+      output is k y with k = maxX/maxY, and k = 0 silences it when a peak
+      is zero, as the scans did.
+      With antialiasing z and the dry signal are means over the last samples
+      (fuzz_adaa.h), which never exceed these peaks; the factors are kept,
+      so the antialiasing does not raise the level of a block back up.
+   */
+   if (maxX > 0) {
+      scale = gain/maxX;
+      maxZ = 1.0 - exp(-fabs(gain));
+      if (maxZ > 0) {
+         a = mix*maxX/maxZ;
+         b = 1 - mix;
+         maxY = fabs(a*maxZ + b*maxX);
+         if (maxY > 0)
+            k = maxX/maxY;
+      }
    }
 
-   //OUT:
-   for (pos = 0; pos < n_samples; pos++) {
-      output[pos] = q[pos];
+   /*
+      The curve, mix and normalization run in one pass over chunks of
+      FUZZ_CHUNK samples.  Each input sample is read before its output is
+      written, so the host may run the plugin in place.
+   */
+   fuzz_adaa_set(&fuzz->adaa, fuzz->aa ? (int)*(fuzz->aa) : 0);
+   for (pos = 0; pos < n_samples; pos += len) {
+      len = MIN(n_samples - pos, FUZZ_CHUNK);
+      for (j = 0; j < len; j++)
+         q[j] = input[pos + j]*scale;
+      if (fuzz->adaa.order == FUZZ_ADAA_OFF) {
+         for (j = 0; j < len; j++)
+            z[j] = sign(q[j])*(1.0 - exp(sign(-q[j]) * q[j]));
+         x = input + pos;
+      }
+      else {
+         fuzz_adaa_process(&fuzz->adaa, q, z, len);
+         fuzz_adaa_align(&fuzz->adaa, input + pos, xd, len);
+         x = xd;
+      }
+      for (j = 0; j < len; j++)
+         output[pos + j] = k*(a*z[j] + b*x[j]);
    }
-
 }
 
 /**
@@ -174,14 +197,21 @@ instantiate(const LV2_Descriptor*     descriptor,
 {
 	Fuzz* fuzz = (Fuzz*)malloc(sizeof(Fuzz));
 
+   if (fuzz == NULL)
+      return NULL;
+
+   fuzz->aa = NULL;
+   fuzz->adaa.order = FUZZ_ADAA_OFF;
+   fuzz_adaa_reset(&fuzz->adaa);
+
 	return (LV2_Handle)fuzz;
 }
 
 /**
    The `activate()` method is called by the host to initialise and prepare the
    plugin instance for running.  The plugin must reset all internal state
-   except for buffer locations set by `connect_port()`.  Since this plugin has
-   no other internal state, this method does nothing.
+   except for buffer locations set by `connect_port()`.  Here the history of
+   the antialiasing is cleared.
 
    This method is in the ``instantiation'' threading class, so no other
    methods on this instance will be called concurrently with it.
@@ -189,6 +219,9 @@ instantiate(const LV2_Descriptor*     descriptor,
 static void
 activate(LV2_Handle instance)
 {
+   Fuzz* fuzz = (Fuzz*)instance;
+
+   fuzz_adaa_reset(&fuzz->adaa);
 }
 
 /**
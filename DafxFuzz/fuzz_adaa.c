@@ -0,0 +1,175 @@
+#include <math.h>
+
+#include "fuzz_adaa.h"
+
+#define EPS FUZZ_ADAA_EPS
+#define SIGN(x) copysign(1.0, (x))
+
+/** F1 and F2 at x, with e = exp(-|x|). */
+static inline double
+antider1(double x, double e)
+{
+   return fabs(x) + e - 1;
+}
+
+static inline double
+antider2(double x, double e)
+{
+   const double a = fabs(x);
+
+   return SIGN(x)*(a*a/2 - a + 1 - e);
+}
+
+/**
+   exp(-|c|) from eu = exp(-|u|) for c within EPS of u, the only case it is
+   used in: eu exp(-t) with t = |c| - |u| and |t| <= |c - u|, by its series
+   to t^3, within 5e-14 of it.
+*/
+static inline double
+exp_near(double c, double u, double eu)
+{
+   const double t = fabs(c) - fabs(u);
+
+   return eu*(1 - t*(1 - t*(0.5 - t/6)));
+}
+
+
+void fuzz_adaa_reset(FuzzAdaa* adaa) {
+   adaa->x1 = 0;
+   adaa->x2 = 0;
+   adaa->e1 = 1;
+   adaa->e2 = 1;
+   adaa->d1 = 0;
+   adaa->dry1 = 0;
+   adaa->dry2 = 0;
+}
+
+
+void fuzz_adaa_set(FuzzAdaa* adaa, int order) {
+   order = order >= FUZZ_ADAA_SECOND ? FUZZ_ADAA_SECOND :
+           order >= FUZZ_ADAA_FIRST ? FUZZ_ADAA_FIRST : FUZZ_ADAA_OFF;
+   if (order != adaa->order) {
+      adaa->order = order;
+      fuzz_adaa_reset(adaa);
+   }
+}
+
+
+/**
+   One chunk.  x and e hold the chunk from index 2, after q[n-2] and q[n-1].
+   The exp() calls are all in the first loop; the others only do
+   arithmetic, with selects instead of branches.  A compiler allowed to
+   ignore floating point traps (-fno-trapping-math) vectorizes them; an
+   SSE2 version was slower than the scalar one, which branches around the
+   fallbacks instead of computing them for every sample.
+*/
+static void
+process_chunk(FuzzAdaa* adaa, const float* q, float* z, uint32_t n)
+{
+   uint32_t i, k;
+   double x[FUZZ_ADAA_CHUNK + 2];
+   double e[FUZZ_ADAA_CHUNK + 2];
+   double d[FUZZ_ADAA_CHUNK + 2];
+   double m, em, dx, dxs, xb, eb, db, dbs, c, ec, quot, near, nearer;
+
+   x[0] = adaa->x2;
+   x[1] = adaa->x1;
+   e[0] = adaa->e2;
+   e[1] = adaa->e1;
+   for (i = 0; i < n; i++) {
+      x[i + 2] = q[i];
+      e[i + 2] = exp(-fabs(x[i + 2]));
+   }
+
+   if (adaa->order == FUZZ_ADAA_OFF) {
+      for (i = 0; i < n; i++)
+         z[i] = SIGN(x[i + 2])*(1 - e[i + 2]);
+   }
+   else if (adaa->order == FUZZ_ADAA_FIRST) {
+      for (k = 2; k < n + 2; k++) {
+         dx = x[k] - x[k - 1];
+         dxs = fabs(dx) < EPS ? 1 : dx;
+         m = (x[k] + x[k - 1])/2;
+         em = exp_near(m, x[k], e[k]);
+         quot = (antider1(x[k], e[k]) - antider1(x[k - 1], e[k - 1]))/dxs;
+         near = SIGN(m)*(1 - em);
+         z[k - 2] = fabs(dx) < EPS ? near : quot;
+      }
+   }
+   else {
+      /*
+         Inner quotients of F2, falling back to F1 at the midpoint plus
+         f'(m) dx^2/24, the next term of the mean: the outer quotient
+         divides their errors by as little as EPS again.
+      */
+      d[1] = adaa->d1;
+      for (k = 2; k < n + 2; k++) {
+         dx = x[k] - x[k - 1];
+         dxs = fabs(dx) < EPS ? 1 : dx;
+         m = (x[k] + x[k - 1])/2;
+         em = exp_near(m, x[k], e[k]);
+         quot = (antider2(x[k], e[k]) - antider2(x[k - 1], e[k - 1]))/dxs;
+         near = fabs(m) + em - 1 + em*dx*dx/24;
+         d[k] = fabs(dx) < EPS ? near : quot;
+      }
+      adaa->d1 = d[n + 1];
+
+      /*
+         Outer quotient.  When q[n] and q[n-2] are close its limit is taken
+         at their midpoint xb, 2/db (F1(xb) + (F2(q[n-1]) - F2(xb))/db) with
+         db = xb - q[n-1], and when q[n-1] is close too, f at the mean
+         of the three samples, where the quotient takes a straight line.
+      */
+      for (k = 2; k < n + 2; k++) {
+         dx = x[k] - x[k - 2];
+         dxs = fabs(dx) < EPS ? 1 : dx;
+         quot = 2*(d[k] - d[k - 1])/dxs;
+
+         xb = (x[k] + x[k - 2])/2;
+         eb = exp_near(xb, x[k], e[k]);
+         db = xb - x[k - 1];
+         dbs = fabs(db) < EPS ? 1 : db;
+         near = 2/dbs*(antider1(xb, eb) +
+                       (antider2(x[k - 1], e[k - 1]) - antider2(xb, eb))/dbs);
+
+         c = (2*xb + x[k - 1])/3;
+         ec = exp_near(c, x[k - 1], e[k - 1]);
+         nearer = SIGN(c)*(1 - ec);
+
+         z[k - 2] = fabs(dx) < EPS ? (fabs(db) < EPS ? nearer : near) : quot;
+      }
+   }
+
+   adaa->x2 = x[n];
+   adaa->x1 = x[n + 1];
+   adaa->e2 = e[n];
+   adaa->e1 = e[n + 1];
+}
+
+
+void fuzz_adaa_process(FuzzAdaa* adaa, const float* q, float* z, uint32_t n) {
+   uint32_t pos, len;
+
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < FUZZ_ADAA_CHUNK ? n - pos : FUZZ_ADAA_CHUNK;
+      process_chunk(adaa, q + pos, z + pos, len);
+   }
+}
+
+
+void fuzz_adaa_align(FuzzAdaa* adaa, const float* x, float* y, uint32_t n) {
+   uint32_t i;
+   float v;
+
+   for (i = 0; i < n; i++) {
+      v = x[i];
+      if (adaa->order == FUZZ_ADAA_FIRST)
+         y[i] = (v + adaa->dry1)/2;
+      else if (adaa->order == FUZZ_ADAA_SECOND)
+         y[i] = (v + adaa->dry1 + adaa->dry2)/3;
+      else
+         y[i] = v;
+      adaa->dry2 = adaa->dry1;
+      adaa->dry1 = v;
+   }
+}
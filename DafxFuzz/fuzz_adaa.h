@@ -0,0 +1,76 @@
+#ifndef FUZZ_ADAA_H
+#define FUZZ_ADAA_H
+
+#include <stdint.h>
+
+/**
+   Antiderivative antialiasing of the fuzz curve.
+
+      f(q)  = sign(q) (1 - exp(-|q|))
+      F1(q) = |q| + exp(-|q|) - 1
+      F2(q) = sign(q) (q^2/2 - |q| + 1 - exp(-|q|))
+
+   F1 and F2 are the first and second antiderivatives of f.  Instead of
+   f(q[n]), the first order outputs the mean of f over the segment from
+   q[n-1] to q[n],
+
+      (F1(q[n]) - F1(q[n-1]))/(q[n] - q[n-1]),
+
+   and the second order the same twice over, from F2 across q[n-2], q[n-1]
+   and q[n].  The mean is a low pass in q that attenuates the harmonics
+   above Nyquist before they fold back, at the cost of a slight roll-off
+   of the top octave and a delay of half a sample (first order) or one
+   sample (second order).
+
+   When consecutive samples are closer than FUZZ_ADAA_EPS the quotients
+   lose their precision, and their limits are used instead: f at the
+   midpoint, or at the mean of three samples for the second order.
+   exp(-|q|) there is taken from its value at a neighbouring sample by a
+   short series, so the fallbacks cost no exp() and the loops have no
+   branches.  Everything runs in double precision, since the gain reaches
+   100 and F2 then 5000.
+*/
+
+/** Orders. */
+typedef enum {
+   FUZZ_ADAA_OFF    = 0,
+   FUZZ_ADAA_FIRST  = 1,
+   FUZZ_ADAA_SECOND = 2
+} FuzzAdaaOrder;
+
+/** Closest consecutive samples taken as a quotient. */
+#define FUZZ_ADAA_EPS 1e-3
+
+/** Samples processed at a time on the stack. */
+#define FUZZ_ADAA_CHUNK 64
+
+typedef struct {
+   int    order;   // FuzzAdaaOrder
+   double x1;      // q[n-1] and q[n-2]
+   double x2;
+   double e1;      // exp(-|q|) at them
+   double e2;
+   double d1;      // last inner quotient of the second order
+   float  dry1;    // dry signal at n-1 and n-2
+   float  dry2;
+} FuzzAdaa;
+
+/** Set the order and clear the history when it changed. */
+void fuzz_adaa_set(FuzzAdaa* adaa, int order);
+
+/** Clear the history, as if the input had been 0. */
+void fuzz_adaa_reset(FuzzAdaa* adaa);
+
+/** z[i] for q[i], i < n, antialiased with the current order.  May run in
+    place. */
+void fuzz_adaa_process(FuzzAdaa* adaa, const float* q, float* z, uint32_t n);
+
+/**
+   The dry signal through the filter that the antialiasing applies to a
+   straight line, so that it stays aligned with z in the mix:
+   (x[n] + x[n-1])/2 for the first order, (x[n] + x[n-1] + x[n-2])/3 for the
+   second.  May run in place.
+*/
+void fuzz_adaa_align(FuzzAdaa* adaa, const float* x, float* y, uint32_t n);
+
+#endif
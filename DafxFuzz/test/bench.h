@@ -0,0 +1,110 @@
+#ifndef FUZZ_BENCH_H
+#define FUZZ_BENCH_H
+
+/**
+   Helpers shared by the tests and benchmarks of test/: a clock, the test
+   signal and the plugin driven as a host would.  The figures in
+   README.txt were measured with the programs built by
+
+     CFLAGS=-O2 ./waf configure --test && ./waf
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+
+#define PI 3.14159265358979323846
+
+/** Sample rate of the tests. */
+#define BENCH_RATE 48000
+
+/** Control ports of the plugin, 2 ("gain") to 4 ("aa"). */
+#define BENCH_PORTS 5
+
+/** Report a failed check and count it. */
+#define CHECK(cond, ...)                                  \
+   do {                                                   \
+      if (!(cond)) {                                      \
+         fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);  \
+         fprintf(stderr, __VA_ARGS__);                    \
+         fprintf(stderr, "\n");                           \
+         failures++;                                      \
+      }                                                   \
+   } while (0)
+
+/**
+   Seconds of CPU used by the calling thread, which other processes on the
+   machine do not disturb as much as they do the clock.
+*/
+static inline double
+bench_cpu(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+   return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/**
+   The test signal: two partials with a slow swell, so the block peaks
+   change, and a little noise.
+*/
+static inline void
+bench_signal(float* x, int n)
+{
+   uint32_t seed = 1;
+   int i;
+
+   for (i = 0; i < n; i++) {
+      seed = seed*1664525u + 1013904223u;
+      x[i] = (0.6*sin(i*0.05) + 0.3*sin(i*0.0123))*(0.55 + 0.45*sin(i*0.0002))
+             + 0.05*((seed >> 8)*(2.0/16777216.0) - 1);
+   }
+}
+
+/** The plugin (dafx_fuzz.c, linked into each program). */
+const LV2_Descriptor* lv2_descriptor(uint32_t index);
+
+/**
+   An instance with its control ports connected to `ctl` from "gain" on and
+   set to the defaults of dafx_fuzz.ttl.  Ports past `ports` are left
+   unconnected, as for a host that predates them.
+*/
+static inline LV2_Handle
+bench_instance(float* ctl, int ports)
+{
+   static const float defaults[BENCH_PORTS] = {0, 0, 0.5, 1, 0};
+   const LV2_Descriptor* d = lv2_descriptor(0);
+   LV2_Handle h = d->instantiate(d, BENCH_RATE, "", NULL);
+   int p;
+
+   if (h == NULL)
+      return NULL;
+   for (p = 2; p < ports; p++) {
+      ctl[p] = defaults[p];
+      d->connect_port(h, p, &ctl[p]);
+   }
+   d->activate(h);
+   return h;
+}
+
+/** Run `n` samples through `h` in `block`-frame blocks. */
+static inline void
+bench_render(LV2_Handle h, const float* in, float* out, int n, int block)
+{
+   const LV2_Descriptor* d = lv2_descriptor(0);
+   int pos, len;
+
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      d->connect_port(h, 0, (void*)(in + pos));
+      d->connect_port(h, 1, out + pos);
+      d->run(h, len);
+   }
+}
+
+#endif
@@ -0,0 +1,199 @@
+/**
+   Antialiasing of the curve against oversampling it.  Sines of gain 5, 20
+   and 100 at 2.9, 8.8 and 14.6 kHz (48 kHz) through the curve plain, with
+   the first and second order (fuzz_adaa.c) and oversampled 2x and 4x by
+   the half-band stages of DafxTube (tube_os.c); the energy on the
+   harmonics of the sine over that off them, in dB.  Then the cost of each
+   in ns per sample, on 256-sample blocks of a sine of gain 20, and of
+   run() (gain 10, mix 0.5, 256 frames, default signal) with each order.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "fuzz_adaa.h"
+
+/* interpolate() and decimate() are static, so the stages are included. */
+#include "tube_os.c"
+
+#define N     16384      // samples analysed, after 2 N to settle
+#define M     (3*N)
+#define CHUNK 64
+#define REPS  20
+
+static const int   bins[] = {1001, 3001, 5001};
+static const float gains[] = {5, 20, 100};
+static const char* methods[] = {"off", "1st", "2nd", "2x", "4x"};
+
+#define BINS    3
+#define GAINS   3
+#define METHODS 5
+
+static float u[M], z[M];
+
+static float
+curve(float q)
+{
+   return q > 0 ? 1 - exp(-q) : q < 0 ? exp(q) - 1 : 0;
+}
+
+/** z = f(u) at `factor` times the rate, for n a multiple of CHUNK. */
+static void
+oversampled(TubeOs* os, const float* u, float* z, int n)
+{
+   const int stages = os->factor == 2 ? 1 : 2;
+   const float* src;
+   float* dst;
+   int pos, s, j, len;
+
+   for (pos = 0; pos < n; pos += CHUNK) {
+      src = u + pos;
+      len = CHUNK;
+      for (s = 0; s < stages; s++) {
+         dst = os->buf[s & 1];
+         interpolate(&os->stage[s], src, dst, len);
+         src = dst;
+         len *= 2;
+      }
+      dst = os->buf[(stages - 1) & 1];
+      tube_delay_process(&os->pad, dst, dst, len);
+      for (j = 0; j < len; j++)
+         dst[j] = curve(dst[j]);
+      for (s = stages - 1; s >= 0; s--) {
+         len /= 2;
+         dst = s > 0 ? os->buf[s & 1] : z + pos;
+         decimate(&os->stage[s], src, dst, len);
+         src = dst;
+      }
+   }
+}
+
+/** u through method `m` into z, in blocks of `block`. */
+static void
+shape(FuzzAdaa* adaa, TubeOs* os, int m, int block)
+{
+   int pos;
+
+   if (m < 3) {
+      adaa->order = -1;
+      fuzz_adaa_set(adaa, m);
+      for (pos = 0; pos < M; pos += block)
+         fuzz_adaa_process(adaa, u + pos, z + pos, block);
+   }
+   else {
+      tube_os_set_factor(os, m == 3 ? 2 : 4);
+      oversampled(os, u, z, M);
+   }
+}
+
+/**
+   Power on the harmonics of bin `b` over the rest of (0, N/2), in dB.  The
+   total is the energy of x over N (Parseval), less the bins at 0 and N/2.
+*/
+static double
+harmonics_db(const float* x, int b)
+{
+   double total = 0, harm = 0, dc = 0, nyq = 0, re, im, ph;
+   int i, k;
+
+   for (i = 0; i < N; i++) {
+      total += (double)x[i]*x[i];
+      dc += x[i];
+      nyq += i & 1 ? -x[i] : x[i];
+   }
+   total = (N*total - dc*dc - nyq*nyq)/2;
+   for (k = b; k < N/2; k += b) {
+      for (i = 0, re = im = 0; i < N; i++) {
+         ph = 2*PI*(double)((long)k*i % N)/N;
+         re += x[i]*cos(ph);
+         im -= x[i]*sin(ph);
+      }
+      harm += re*re + im*im;
+   }
+   return 10*log10(harm/(total - harm));
+}
+
+static double
+best_ns(FuzzAdaa* adaa, TubeOs* os, int m)
+{
+   double t, best = -1;
+   int r;
+
+   for (r = 0; r < REPS; r++) {
+      t = bench_cpu();
+      shape(adaa, os, m, 256);
+      t = 1e9*(bench_cpu() - t)/M;
+      best = best < 0 || t < best ? t : best;
+   }
+   return best;
+}
+
+int main(void) {
+   const int n = 5*BENCH_RATE;
+   float* in = malloc(n*sizeof(float));
+   float* out = malloc(n*sizeof(float));
+   float ctl[BENCH_PORTS];
+   FuzzAdaa adaa;
+   TubeOs os;
+   LV2_Handle h;
+   double t, best;
+   uint32_t seed = 3;
+   int b, g, m, i, r;
+
+   if (in == NULL || out == NULL || tube_os_init(&os, CHUNK) != 0) {
+      fprintf(stderr, "bench_adaa: out of memory\n");
+      return 1;
+   }
+
+   printf("harmonics over the rest, dB\n  tone (48 kHz)   gain");
+   for (m = 0; m < METHODS; m++)
+      printf("   %3s", methods[m]);
+   printf("\n");
+   for (b = 0; b < BINS; b++) {
+      for (g = 0; g < GAINS; g++) {
+         printf("  %4.1f kHz       %4g ", bins[b]*48.0/N, gains[g]);
+         for (m = 0; m < METHODS; m++) {
+            for (i = 0; i < M; i++)
+               u[i] = gains[g]*sin(2*PI*bins[b]/N*i);
+            tube_os_reset(&os);
+            shape(&adaa, &os, m, 256);
+            printf("  %4.1f", harmonics_db(z + 2*N, bins[b]));
+         }
+         printf("\n");
+      }
+   }
+
+   for (i = 0; i < M; i++) {
+      seed = seed*1664525u + 1013904223u;
+      u[i] = 20*sin(2*PI*3001.0/N*i) + 0.01*((seed >> 8)*(2.0/16777216.0) - 1);
+   }
+   printf("\ncurve, ns/sample (256 samples)");
+   for (m = 0; m < METHODS; m++)
+      printf("  %4.1f", best_ns(&adaa, &os, m));
+
+   bench_signal(in, n);
+   printf("\nrun(), ns/sample (256 frames)  ");
+   for (m = 0; m < 3; m++) {
+      h = bench_instance(ctl, BENCH_PORTS);
+      if (h == NULL) {
+         fprintf(stderr, "bench_adaa: no instance\n");
+         return 1;
+      }
+      ctl[2] = 10;
+      ctl[3] = 0.5;
+      ctl[4] = m;
+      for (r = 0, best = -1; r < 5; r++) {
+         t = bench_cpu();
+         bench_render(h, in, out, n, 256);
+         t = 1e9*(bench_cpu() - t)/n;
+         best = best < 0 || t < best ? t : best;
+      }
+      printf("  %4.1f", best);
+      lv2_descriptor(0)->cleanup(h);
+   }
+   printf("\n");
+
+   tube_os_free(&os);
+   free(in);
+   free(out);
+   return 0;
+}
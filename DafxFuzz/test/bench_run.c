@@ -0,0 +1,76 @@
+/**
+   run() against the book's (fuzzBook() in test/fuzz_ref.c) at 64, 256 and
+   4096-frame blocks, in ns per sample: gain 10, mix 0.5, 20 s at 48 kHz,
+   best of 3, with each order of "aa".
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "fuzz_ref.h"
+
+#define SECONDS 20
+#define REPS    3
+
+static const int blocks[] = {64, 256, 4096};
+#define BLOCKS ((int)(sizeof(blocks)/sizeof(blocks[0])))
+
+/** Best ns per sample of the book's run() or the plugin's (`h`). */
+static double
+time_run(LV2_Handle h, const float* ctl, const float* in, float* out,
+         int n, int block)
+{
+   double t, best = -1;
+   int r, pos, len;
+
+   for (r = 0; r < REPS; r++) {
+      t = bench_cpu();
+      if (h == NULL) {
+         for (pos = 0; pos < n; pos += len) {
+            len = n - pos < block ? n - pos : block;
+            fuzzBook(in + pos, out + pos, len, ctl[2], ctl[3]);
+         }
+      }
+      else {
+         lv2_descriptor(0)->activate(h);
+         bench_render(h, in, out, n, block);
+      }
+      t = 1e9*(bench_cpu() - t)/n;
+      if (best < 0 || t < best)
+         best = t;
+   }
+   return best;
+}
+
+int main(void) {
+   static const char* names[] = {"book", "run(), aa off", "run(), aa 1st",
+                                 "run(), aa 2nd"};
+   const int n = SECONDS*BENCH_RATE;
+   float* in = malloc(n*sizeof(float));
+   float* out = malloc(n*sizeof(float));
+   float ctl[BENCH_PORTS];
+   LV2_Handle h = bench_instance(ctl, BENCH_PORTS);
+   int b, v;
+
+   if (in == NULL || out == NULL || h == NULL) {
+      fprintf(stderr, "bench_run: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, n);
+   ctl[2] = 10;
+   ctl[3] = 0.5;
+
+   printf("ns/sample         64 frames   256 frames   4096 frames\n");
+   for (v = 0; v < 4; v++) {
+      ctl[4] = v - 1;
+      printf("%-15s", names[v]);
+      for (b = 0; b < BLOCKS; b++)
+         printf("   %6.1f    ", time_run(v ? h : NULL, ctl, in, out, n,
+                                         blocks[b]));
+      printf("\n");
+   }
+
+   lv2_descriptor(0)->cleanup(h);
+   free(in);
+   free(out);
+   return 0;
+}
@@ -0,0 +1,61 @@
+#include <math.h>
+
+#include "fuzz_ref.h"
+
+static float sign(float n) {
+   if (n < 0) return -1.0;
+   else if (n > 0) return 1.0;
+   else return 0.0;
+}
+
+void fuzzBook(const float* input, float* output, uint32_t n_samples,
+              float gain, float mix) {
+	uint32_t pos;
+   float q[5000];
+   float z[5000];
+   float maxX = 0, maxZ = 0, maxY = 0, y;
+
+	for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(input[pos]) > maxX)
+         maxX = fabs(input[pos]);
+   }
+
+   for (pos = 0; pos < n_samples; pos++) {
+      if (maxX > 0) q[pos] = input[pos]*gain/maxX;
+      else q[pos] = 0;
+   }
+
+   for (pos = 0; pos < n_samples; pos++) {
+      z[pos] = sign(q[pos])*(1.0 - exp(sign(-q[pos]) * q[pos]));
+   }
+
+   //MAXZ
+   for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(z[pos]) > maxZ)
+         maxZ = fabs(z[pos]);
+   }
+
+
+   for (pos = 0; pos < n_samples; pos++) {
+      if (maxX > 0 && maxZ > 0) y = mix*z[pos]*maxX/maxZ + (1-mix)*input[pos];
+      else y = 0;
+      q[pos] = y;
+   }
+
+   //MAXY
+   for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(q[pos]) > maxY)
+         maxY = fabs(q[pos]);
+   }
+
+   for (pos = 0; pos < n_samples; pos++) {
+      if (maxX > 0 && maxY > 0) q[pos] = q[pos]*maxX/maxY;
+      else q[pos] = 0;
+   }
+
+   //OUT:
+   for (pos = 0; pos < n_samples; pos++) {
+      output[pos] = q[pos];
+   }
+
+}
@@ -0,0 +1,15 @@
+#ifndef FUZZ_REF_H
+#define FUZZ_REF_H
+
+#include <stdint.h>
+
+/**
+   The book's run(), kept as it was apart from the ports becoming
+   arguments, as the reference of the tests and benchmarks: scans for maxX,
+   maxZ and maxY through two float[5000] arrays on the stack, so
+   `n_samples` must not exceed 5000.
+*/
+void fuzzBook(const float* input, float* output, uint32_t n_samples,
+              float gain, float mix);
+
+#endif
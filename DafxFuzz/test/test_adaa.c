@@ -0,0 +1,156 @@
+/**
+   The antialiased curve (fuzz_adaa.c) against its definition in long
+   double: the mean of f between consecutive samples for the first order,
+   and the second order's quotient of quotients of F2.  The input walks at
+   steps from 0.1 down to 1e-6 of its range, 1 and the largest gain, 100,
+   so both sides of FUZZ_ADAA_EPS are taken, with runs of equal samples and
+   of tiny steps across 0.  Then the output must not depend on how the
+   input is split into blocks.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "fuzz_adaa.h"
+
+#define N      16384
+#define TRIALS 6
+
+/* Largest error against long double, first and second order */
+static const double max_error[] = {0, 5e-8, 2e-7};
+
+static int failures = 0;
+
+typedef long double ldouble;
+
+static ldouble
+f(ldouble x)
+{
+   return x > 0 ? 1 - expl(-x) : x < 0 ? expl(x) - 1 : 0;
+}
+
+static ldouble
+F1(ldouble x)
+{
+   return fabsl(x) + expl(-fabsl(x)) - 1;
+}
+
+static ldouble
+F2(ldouble x)
+{
+   const ldouble a = fabsl(x);
+
+   return (x < 0 ? -1 : 1)*(a*a/2 - a + 1 - expl(-a));
+}
+
+/** Mean of f from a to b. */
+static ldouble
+mean1(ldouble a, ldouble b)
+{
+   return fabsl(b - a) < 1e-7L ? f((a + b)/2) : (F1(b) - F1(a))/(b - a);
+}
+
+/** Mean of F1 from a to b. */
+static ldouble
+mean2(ldouble a, ldouble b)
+{
+   return fabsl(b - a) < 1e-7L ? F1((a + b)/2) : (F2(b) - F2(a))/(b - a);
+}
+
+/** The second order at x0 = q[n], x1 = q[n-1] and x2 = q[n-2]. */
+static ldouble
+second(ldouble x0, ldouble x1, ldouble x2)
+{
+   ldouble xb, db;
+
+   if (fabsl(x0 - x2) > 1e-5L)
+      return 2*(mean2(x1, x0) - mean2(x2, x1))/(x0 - x2);
+   xb = (x0 + x2)/2;
+   db = xb - x1;
+   if (fabsl(db) < 1e-6L)
+      return f((xb + x1)/2);
+   return 2/db*(F1(xb) + (F2(x1) - F2(xb))/db);
+}
+
+/** A random walk over [-amp, amp] in steps of up to `step` amp. */
+static void
+walk(float* q, double amp, double step, uint32_t seed)
+{
+   double v = 0;
+   int i;
+
+   for (i = 0; i < N; i++) {
+      seed = seed*1664525u + 1013904223u;
+      v += step*amp*((seed >> 8)*(2.0/16777216.0) - 1);
+      v = i % 997 == 0 ? 0 : v < -amp ? -amp : v > amp ? amp : v;
+      q[i] = v;
+   }
+   for (i = 300; i < 320; i++)
+      q[i] = q[299];
+   for (i = 400; i < 420; i++)
+      q[i] = i & 1 ? 1e-5 : -1e-5;
+}
+
+static void
+check_accuracy(void)
+{
+   static float q[N], z[N];
+   FuzzAdaa adaa;
+   ldouble r;
+   double amp, step, e, worst;
+   int order, t, i;
+
+   printf("largest error against long double\n");
+   for (order = FUZZ_ADAA_FIRST; order <= FUZZ_ADAA_SECOND; order++) {
+      worst = 0;
+      for (t = 0; t < TRIALS; t++) {
+         amp = t < TRIALS/2 ? 1 : 100;
+         step = pow(10, -1 - 2.5*(t % 3));
+         walk(q, amp, step, t + 1);
+         adaa.order = -1;
+         fuzz_adaa_set(&adaa, order);
+         fuzz_adaa_process(&adaa, q, z, N);
+         for (i = 2; i < N; i++) {
+            r = order == FUZZ_ADAA_FIRST ? mean1(q[i - 1], q[i]) :
+                second(q[i], q[i - 1], q[i - 2]);
+            e = fabsl(z[i] - r);
+            worst = e > worst ? e : worst;
+         }
+      }
+      printf("%s order  %.2g\n", order == FUZZ_ADAA_FIRST ? "first " : "second",
+             worst);
+      CHECK(worst <= max_error[order], "order %d: error %.2g", order, worst);
+   }
+}
+
+static void
+check_blocks(void)
+{
+   static const int blocks[] = {1, 37, 64, 777};
+   static float q[N], z[N], zb[N];
+   FuzzAdaa adaa;
+   int order, b, pos, len;
+
+   for (pos = 0; pos < N; pos++)
+      q[pos] = 5*sin(pos*0.05) + 0.1*sin(pos*1.3);
+   for (order = FUZZ_ADAA_OFF; order <= FUZZ_ADAA_SECOND; order++) {
+      adaa.order = -1;
+      fuzz_adaa_set(&adaa, order);
+      fuzz_adaa_process(&adaa, q, z, N);
+      for (b = 0; b < (int)(sizeof(blocks)/sizeof(blocks[0])); b++) {
+         fuzz_adaa_reset(&adaa);
+         for (pos = 0; pos < N; pos += len) {
+            len = N - pos < blocks[b] ? N - pos : blocks[b];
+            fuzz_adaa_process(&adaa, q + pos, zb + pos, len);
+         }
+         CHECK(memcmp(z, zb, sizeof(z)) == 0,
+               "order %d differs in %d-sample blocks", order, blocks[b]);
+      }
+   }
+}
+
+int main(void) {
+   check_accuracy();
+   check_blocks();
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+/**
+   run() against the book's (fuzzBook() in test/fuzz_ref.c), which scans
+   the block for maxX, maxZ and maxY: the same output within MAX_ERROR at
+   gains 0.01 - 100, mix 0 - 1 and blocks of 1 - 4096 frames, with a few
+   silent blocks, with "aa" off and unconnected, out of place and in place.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "fuzz_ref.h"
+
+#define N (5*BENCH_RATE)
+
+/* Largest difference from the book */
+#define MAX_ERROR 5e-7
+
+static int failures = 0;
+
+int main(void) {
+   static const float gains[] = {0.01, 0.5, 10, 100};
+   static const float mixes[] = {1, 0.5, 0};
+   static const int blocks[] = {1, 64, 256, 777, 4096};
+   const int G = sizeof(gains)/sizeof(gains[0]);
+   const int X = sizeof(mixes)/sizeof(mixes[0]);
+   const int B = sizeof(blocks)/sizeof(blocks[0]);
+   float* in = malloc(N*sizeof(float));
+   float* out = malloc(N*sizeof(float));
+   float* ref = malloc(N*sizeof(float));
+   float ctl[BENCH_PORTS];
+   double err, worst = 0;
+   LV2_Handle h;
+   int g, x, b, ports, inplace, pos, len, i;
+
+   if (in == NULL || out == NULL || ref == NULL) {
+      fprintf(stderr, "test_run: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, N);
+   for (i = 1000; i < 1300; i++)
+      in[i] = 0;
+
+   for (g = 0; g < G; g++)
+   for (x = 0; x < X; x++)
+   for (b = 0; b < B; b++) {
+      for (pos = 0; pos < N; pos += len) {
+         len = N - pos < blocks[b] ? N - pos : blocks[b];
+         fuzzBook(in + pos, ref + pos, len, gains[g], mixes[x]);
+      }
+      for (ports = BENCH_PORTS - 1; ports <= BENCH_PORTS; ports++)
+      for (inplace = 0; inplace < 2; inplace++) {
+         h = bench_instance(ctl, ports);
+         if (h == NULL) {
+            fprintf(stderr, "test_run: no instance\n");
+            return 1;
+         }
+         ctl[2] = gains[g];
+         ctl[3] = mixes[x];
+         if (inplace)
+            memcpy(out, in, N*sizeof(float));
+         bench_render(h, inplace ? out : in, out, N, blocks[b]);
+         lv2_descriptor(0)->cleanup(h);
+
+         for (i = 0, err = 0; i < N; i++)
+            err = fmax(err, fabs(out[i] - ref[i]));
+         worst = fmax(worst, err);
+         CHECK(err <= MAX_ERROR, "gain %g, mix %g, %d frames%s%s: %.2g",
+               gains[g], mixes[x], blocks[b], inplace ? ", in place" : "",
+               ports < BENCH_PORTS ? ", no aa port" : "", err);
+      }
+   }
+   printf("largest difference from the book %.2g\n", worst);
+
+   free(in);
+   free(out);
+   free(ref);
+   return failures ? 1 : 0;
+}
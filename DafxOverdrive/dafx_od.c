@@ -13,6 +13,8 @@
 */
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 
+#include "od_clip.h"
+
 /**
    The URI is the identifier for a plugin, and how the host associates this
    implementation in code with its description in data. If this URI does not
@@ -42,6 +44,8 @@ typedef struct {
    const float* input;    // lv2 audio port;
    float*       output;   // lv2 audio port;
    const float* level;     // lv2 control port
+   OdClip clip;            // curve for last_level
+   float last_level;
 } Od;
 
 // /**
@@ -85,9 +89,8 @@ connect_port(LV2_Handle instance,
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
-	uint32_t pos;
    float coef_gain;
-	const Od* od = (Od*)instance;
+	Od* od = (Od*)instance;
 	const float* const input  = od->input;
 	float* const       output = od->output;
 
@@ -100,28 +103,16 @@ run(LV2_Handle instance, uint32_t n_samples)
 
    coef_gain = *(od->level);
 
-	for (pos = 0; pos < n_samples; pos++) {
-		if (fabs(input[pos]) > 2*TH) {
-			if (input[pos] > 0) {
-				output[pos] = 1*coef_gain;
-         }
-			if (input[pos] < 0) {
-				output[pos] = -1*coef_gain;
-         }
-      }
-      else if (fabs(input[pos]) < TH) {
-         output[pos] = 2*input[pos]*coef_gain;
-      }
-      else /*(fabs(input[pos]) >= TH)*/ {
-         if (input[pos] > 0) {
-            output[pos] = ((3 - pow((2 - input[pos]*3), 2))/3.0)*coef_gain;
-         }
-         if (input[pos] < 0) {
-            output[pos] = (-1 * (((3 - pow((2 + input[pos]*3), 2))/3.0)))*coef_gain;
-         }
-      }
-	}
+   /*
+      |x| < TH: 2x; TH <= |x| <= 2 TH: (3 - (2 - 3|x|)^2)/3 = -1/3 + 4|x| - 3x^2;
+      above: 1.  Only the level changes.
+   */
+   if (coef_gain != od->last_level) {
+      od_clip_set(&od->clip, TH, 2*TH, 2, -3, 4, -1.0f/3, coef_gain);
+      od->last_level = coef_gain;
+   }
 
+   od_clip_process(&od->clip, input, output, n_samples);
 }
 
 /**
@@ -143,6 +134,11 @@ instantiate(const LV2_Descriptor*     descriptor,
 {
 	Od* od = (Od*)malloc(sizeof(Od));
 
+   if (od == NULL)
+      return NULL;
+
+   od->last_level = NAN;
+
 	return (LV2_Handle)od;
 }
 
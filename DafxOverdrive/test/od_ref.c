@@ -0,0 +1,39 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+
+#include "od_bench.h"
+
+#define TH ((float)1)/((float)3)
+
+/** run() before od_clip.h, "level" at ctl[2]. */
+void od_ref(const float* input, float* output, uint32_t n_samples,
+            const float* ctl) {
+	uint32_t pos;
+   float coef_gain;
+
+   coef_gain = ctl[2];
+
+	for (pos = 0; pos < n_samples; pos++) {
+		if (fabs(input[pos]) > 2*TH) {
+			if (input[pos] > 0) {
+				output[pos] = 1*coef_gain;
+         }
+			if (input[pos] < 0) {
+				output[pos] = -1*coef_gain;
+         }
+      }
+      else if (fabs(input[pos]) < TH) {
+         output[pos] = 2*input[pos]*coef_gain;
+      }
+      else /*(fabs(input[pos]) >= TH)*/ {
+         if (input[pos] > 0) {
+            output[pos] = ((3 - pow((2 - input[pos]*3), 2))/3.0)*coef_gain;
+         }
+         if (input[pos] < 0) {
+            output[pos] = (-1 * (((3 - pow((2 + input[pos]*3), 2))/3.0)))*coef_gain;
+         }
+      }
+	}
+
+}
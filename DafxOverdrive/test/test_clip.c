@@ -0,0 +1,29 @@
+/**
+   run() against the loop it replaced (od_ref() in test/od_ref.c) over
+   "level" 0 - 1: within MAX_ERROR of it on inputs from -1.25 to 1.25.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "od_bench.h"
+
+/* Largest difference from the old loop */
+#define MAX_ERROR 2.4e-7
+
+static int failures = 0;
+
+int main(void) {
+   static const float levels[] = {0, 0.1, 0.37, 0.5, 0.9, 1};
+   float ctl[3];
+   double err, worst = 0;
+   int l;
+
+   for (l = 0; l < (int)(sizeof(levels)/sizeof(levels[0])); l++) {
+      ctl[2] = levels[l];
+      err = od_bench_diff(ctl, 3);
+      CHECK(err >= 0 && err <= MAX_ERROR, "level %g: %.2g", ctl[2], err);
+      worst = fmax(worst, err);
+   }
+   printf("largest difference from the old loop %.2g\n", worst);
+
+   return failures ? 1 : 0;
+}
@@ -3,15 +3,21 @@
 #include <math.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 
 /**
    LV2 headers are based on the URI of the specification they come from, so a
    consistent convention can be used even for unofficial extensions.  The URI
    of the core LV2 specification is <http://lv2plug.in/ns/lv2core>, by
    replacing `http:/` with `lv2` any header in the specification bundle can be
-   included, in this case `lv2.h`.
+   included, in this case `lv2.h`.  The worker extension lets the plugin
+   start its helper thread outside `run()`.
 */
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+#include "lv2/lv2plug.in/ns/ext/worker/worker.h"
+
+#include "ps_engine.h"
+#include "ps_pitch.h"
 
 /**
    The URI is the identifier for a plugin, and how the host associates this
@@ -19,10 +25,20 @@
    match that used in the data files, the host will fail to load the plugin.
 */
 #define PS_URI "www.linux.ime.usp.br/~vitorsamora/mac0499/dafx-ps-sola.lv2"
+#define HARMONIZER_URI "www.linux.ime.usp.br/~vitorsamora/mac0499/dafx-ps-harmonizer.lv2"
+#define STEREO_URI "www.linux.ime.usp.br/~vitorsamora/mac0499/dafx-ps-stereo.lv2"
+
+/** Voices of the harmonizer. */
+#define MAX_VOICES PS_MAX_VOICES
+
+/** Channels of a linked instance; the stereo plugin uses two. */
+#define MAX_CHANNELS PS_MAX_CHANNELS
 
-#define PI 3.14159265358979323846
-#define MAX(x, y) (((x) > (y)) ? (x) : (y))
-#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+/** Pitch estimates per second when the port is not connected. */
+#define TRACK_RATE 50
+
+/** Confidence the tracker needs before alpha is snapped to a semitone. */
+#define SNAP_CONFIDENCE 0.8
 
 /**
    In the code, ports are referred to by index.  An enumeration of port indices
@@ -32,83 +48,76 @@
 typedef enum {
 	INPUT   = 0,
 	OUTPUT  = 1, 
-   ALPHA   = 2
+   ALPHA   = 2,
+   LATENCY_OUT = 3,
+   MODE    = 4,
+   QUALITY = 5,
+   FADE    = 6,
+   PITCH   = 7,
+   CONFIDENCE = 8,
+   SNAP    = 9,
+   TRACK   = 10,
+   PIPELINE = 11
 } PortIndex;
 
+/** Ports of the harmonizer. */
+typedef enum {
+   H_INPUT   = 0,
+   H_OUTPUT  = 1,
+   H_LATENCY = 2,
+   H_MODE    = 3,
+   H_QUALITY = 4,
+   H_DRY     = 5,
+   H_ALPHA   = 6,                  // H_ALPHA + v, v < MAX_VOICES
+   H_GAIN    = H_ALPHA + MAX_VOICES, // H_GAIN + v, v < MAX_VOICES
+   H_FADE    = H_GAIN + MAX_VOICES,
+   H_PIPELINE = H_FADE + 1
+} HarmonizerPortIndex;
+
+/** Ports of the stereo pitch shifter. */
+typedef enum {
+   S_INPUT_L  = 0,
+   S_INPUT_R  = 1,
+   S_OUTPUT_L = 2,
+   S_OUTPUT_R = 3,
+   S_ALPHA    = 4,
+   S_LATENCY  = 5,
+   S_MODE     = 6,
+   S_QUALITY  = 7,
+   S_FADE     = 8,
+   S_PIPELINE = 9
+} StereoPortIndex;
+
 /**
    Define a private structure for the plugin instance.  All data
    associated with a plugin instance is stored here, and is available to
    every instance method, being passed back through the 'instance' parameter.
+   The audio processing itself lives in the engine (ps_engine.c), which the
+   offline renderer shares.
 **/
 typedef struct {
 	// Port buffers
-   const float* input;    // lv2 audio port;
-   float*       output;   // lv2 audio port;
-   const float* alpha;    // lv2 control port
-   float* last_input;
-   float* last_L_out;
-   int* is_first;
-   int* last_n;
-   int* last_L;
+   const float* input[MAX_CHANNELS];  // lv2 audio ports;
+   float*       output[MAX_CHANNELS]; // lv2 audio ports;
+   const float* alpha[MAX_VOICES]; // lv2 control ports
+   const float* gain[MAX_VOICES];  // lv2 control ports (harmonizer)
+   const float* dry;      // lv2 control port (harmonizer)
+   float*       latency;  // lv2 control port (output)
+   const float* mode;     // lv2 control port
+   const float* quality;  // lv2 control port
+   const float* fade;     // lv2 control port
+   float*       pitch;    // lv2 control port (output, pitch shifter)
+   float*       confidence; // lv2 control port (output, pitch shifter)
+   const float* snap;     // lv2 control port (pitch shifter)
+   const float* track;    // lv2 control port (pitch shifter)
+   const float* pipeline; // lv2 control port
+   PsEngine engine;
+   int      tracking;     // the pitch tracker is allocated
+   PsPitch  tracker;
+   LV2_Worker_Schedule* schedule; // host feature, NULL if not provided
+   int      helper_asked; // the helper start has been scheduled
 } Ps;
 
-
-void copy(float *source, int ini, float *destination, int len) {
-   int i;
-
-   for (i = 0; i < len; i++) 
-      destination[i] = source[ini + i];
-}
-
-
-int maxSimIndex(float *u, int uLen, float *v, int vLen) {
-   int i, j, index;
-   float min, sum, term;
-
-   for (i = -uLen; i < vLen; i++) {
-      for (j = i, sum = 0; j < i + uLen; j++) {
-         if (j < 0) { 
-            term = fabs(u[j - i] - 0);
-         }
-         else if (j <= vLen) { 
-            term = fabs(u[j - i] - v[j]);
-         }
-         else {
-            term = fabs(u[j - i] - 0);
-         }
-
-         if (term == 0) sum += -1;
-         else sum += term;
-      }
-      if (i == -uLen || sum < min) {
-         min = sum;
-         index = i;
-      }
-   }
-
-   return index;
-}
-
-
-int maxSimIndex2(float *u, int uLen, float *v, int vLen) {
-   int i, j, index;
-   float min, sum;
-
-   for (i = 0; i < vLen; i++) {
-      for (j = i, sum = 0; j < i + uLen; j++) {
-         if (j < vLen) sum += fabs(u[j - i] - v[j]);
-         else sum += fabs(u[j - i] - 0);
-      }
-      if (i == 0 || sum < min) {
-         min = sum;
-         index = i;
-      }
-   }
-
-   return index;
-}
-
-
 // /**
 //    The `connect_port()` method is called by the host to connect a particular
 //    port to a buffer.  The plugin must store the data location, but data may not
@@ -130,13 +139,137 @@ connect_port(LV2_Handle instance,
 
 	switch ((PortIndex)port) {
    case INPUT:
-      ps->input = (const float*)data;
+      ps->input[0] = (const float*)data;
       break;
    case OUTPUT:
-      ps->output = (float*)data;
+      ps->output[0] = (float*)data;
       break;
    case ALPHA:
-      ps->alpha = (const float*)data;
+      ps->alpha[0] = (const float*)data;
+      break;
+   case LATENCY_OUT:
+      ps->latency = (float*)data;
+      break;
+   case MODE:
+      ps->mode = (const float*)data;
+      break;
+   case QUALITY:
+      ps->quality = (const float*)data;
+      break;
+   case FADE:
+      ps->fade = (const float*)data;
+      break;
+   case PITCH:
+      ps->pitch = (float*)data;
+      break;
+   case CONFIDENCE:
+      ps->confidence = (float*)data;
+      break;
+   case SNAP:
+      ps->snap = (const float*)data;
+      break;
+   case TRACK:
+      ps->track = (const float*)data;
+      break;
+   case PIPELINE:
+      ps->pipeline = (const float*)data;
+      break;
+	}
+}
+
+/** `connect_port()` of the harmonizer, which has its own port layout. */
+static void
+connect_port_harmonizer(LV2_Handle instance,
+                        uint32_t   port,
+                        void*      data)
+{
+	Ps* ps = (Ps*)instance;
+
+	if (ps == NULL ) {
+		return;
+	}
+
+   if (port >= H_ALPHA && port < H_ALPHA + MAX_VOICES) {
+      ps->alpha[port - H_ALPHA] = (const float*)data;
+      return;
+   }
+   if (port >= H_GAIN && port < H_GAIN + MAX_VOICES) {
+      ps->gain[port - H_GAIN] = (const float*)data;
+      return;
+   }
+
+	switch ((HarmonizerPortIndex)port) {
+   case H_INPUT:
+      ps->input[0] = (const float*)data;
+      break;
+   case H_OUTPUT:
+      ps->output[0] = (float*)data;
+      break;
+   case H_LATENCY:
+      ps->latency = (float*)data;
+      break;
+   case H_MODE:
+      ps->mode = (const float*)data;
+      break;
+   case H_QUALITY:
+      ps->quality = (const float*)data;
+      break;
+   case H_FADE:
+      ps->fade = (const float*)data;
+      break;
+   case H_DRY:
+      ps->dry = (const float*)data;
+      break;
+   case H_PIPELINE:
+      ps->pipeline = (const float*)data;
+      break;
+   default:
+      break;
+	}
+}
+
+/** `connect_port()` of the stereo pitch shifter. */
+static void
+connect_port_stereo(LV2_Handle instance,
+                    uint32_t   port,
+                    void*      data)
+{
+	Ps* ps = (Ps*)instance;
+
+	if (ps == NULL ) {
+		return;
+	}
+
+	switch ((StereoPortIndex)port) {
+   case S_INPUT_L:
+      ps->input[0] = (const float*)data;
+      break;
+   case S_INPUT_R:
+      ps->input[1] = (const float*)data;
+      break;
+   case S_OUTPUT_L:
+      ps->output[0] = (float*)data;
+      break;
+   case S_OUTPUT_R:
+      ps->output[1] = (float*)data;
+      break;
+   case S_ALPHA:
+      ps->alpha[0] = (const float*)data;
+      break;
+   case S_LATENCY:
+      ps->latency = (float*)data;
+      break;
+   case S_MODE:
+      ps->mode = (const float*)data;
+      break;
+   case S_QUALITY:
+      ps->quality = (const float*)data;
+      break;
+   case S_FADE:
+      ps->fade = (const float*)data;
+      break;
+   case S_PIPELINE:
+      ps->pipeline = (const float*)data;
       break;
 	}
 }
@@ -146,132 +279,76 @@ connect_port(LV2_Handle instance,
    a block of audio in the audio context.  Since this plugin is
    `lv2:hardRTCapable`, `run()` must be real-time safe, so blocking (e.g. with
    a mutex) or memory allocation are not allowed.
+
+   Any `n_samples` is accepted.  SOLA and the phase vocoder work on internal
+   frames, the delay line and PSOLA sample by sample; the delay of the
+   selected engine is reported on the latency port.  An engine is
+   reset when it is selected, so switching never plays stale audio.  The same
+   `run()` serves the pitch shifter (one voice, unit gain, no dry signal), the
+   stereo pitch shifter and the harmonizer.  The phase vocoder has no splice
+   points to share, so it runs one engine per channel.
+
+   With "pipeline" on, the SOLA splice searches of a frame run on a helper
+   thread while the next frame is queued, and `run()` only crossfades and
+   resamples.  That adds one frame of latency and takes the searches, the
+   peak of the work, off the audio thread.  The helper is woken with a
+   semaphore post; `run()` never waits for it, and a frame it has not
+   finished in time is analysed in `run()` instead.  The helper and its
+   buffers are only created the first time "pipeline" is on, by `work()` on
+   the host's worker thread; until it is running the frames are analysed in
+   `run()` as in the direct mode.  Without the worker feature the port has
+   no effect.
+
+   The pitch shifter also tracks the pitch of its input.  With "snap" on and
+   a confident estimate, alpha is corrected so the output lands on the
+   nearest semitone.
 */
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
-   
-   int lfen, lx;
-   int data_size;
-   float x[2048];
-
-   float alpha, M, term;
-   int Sa = 2048/16, N = 2048/4, Ss, i, j, maxIndex, fadeLen, resLen, L, cut;
-	const Ps* ps = (Ps*)instance;
-	const float* const input  = ps->input;
-	float* const       output = ps->output;
-   float grain[2048], overlap[256], grainL[256], result[2*4096], tail[4096], in[2*4096];
-	
+   int v;
+   PsParams params;
+	Ps* ps = (Ps*)instance;
+
 	if (ps == NULL) {
 		fprintf(stderr, "DAFX_PS: run() called with NULL instance parameter.\n");
 		return;
 	}
 
-   if (*(ps->is_first)) {
-      for (i = 0; i < n_samples; i++) {
-         ps->last_input[i] = input[i];
-      }
-      for (i = 0; i < 256; i++) {
-         ps->last_L_out[i] = 0.0;
-      }
-      *(ps->is_first) = 0;
-      *(ps->last_n) = n_samples;
-      *(ps->last_L) = round(Sa * alpha / (2.0));
-
-      for (i = 0; i < n_samples; i++) {
-         output[i] = 0.0;
-      }
+   for (v = 0; v < ps->engine.voices; v++) {
+      params.alpha[v] = ps->alpha[v] ? *(ps->alpha[v]) : 1.0;
+      params.gain[v] = ps->gain[v] ? *(ps->gain[v]) : 1.0;
    }
-
-   else {
-
-      data_size = n_samples + *(ps->last_n);
-      alpha = *(ps->alpha);
-      M = ceilf(data_size / (float)Sa);
-      Ss = round(Sa * alpha);
-      L = round(Sa * alpha / (2.0));
-      resLen = N;
-
-      for (i = 0; i < *(ps->last_n); i++) {
-         in[i] = ps->last_input[i];
-      }
-
-      for (i = 0; i < n_samples; i++) {
-         in[i + *(ps->last_n)] = input[i];
-      }
-
-
-   /*% **** Main TimeScaleSOLA loop*****/
-      copy(in, 0, result, data_size);
-
-      for (i = 1; i < M; i++) {
-         copy(in, i*Sa, grain, N);
-
-         copy(grain, 0, grainL, L);
-         copy(result, i*Ss, overlap, L);
-         maxIndex = maxSimIndex(grainL, L, overlap, L);
-         
-
-         cut = i*Ss + maxIndex;
-         copy(result, cut, tail, resLen - cut);
-         
-         for (j = cut; j < resLen; j++) {
-            term = (j - cut)/((float)(resLen - cut));
-            tail[j - cut] *= 1.0 - term;
-            tail[j - cut] += grain[j - cut] * term;
-         }
-         
-         fadeLen = resLen - cut;
-         
-         for (j = 0; j < fadeLen; j++) {
-            result[cut + j] = tail[j];
-         }
-         for (j = 0; j < N - fadeLen; j++) {
-            result[cut + fadeLen + j] = grain[fadeLen + j];
-         }
-         resLen = cut + N;
-      }
-   /*% **** end TimeScaleSOLA loop*****/
-
-      lfen = data_size;
-
-      lx = floor(lfen * alpha);
-
-      for (i = 0; i < lfen; i++) {
-         x[i] = i*lx/((float)lfen);
-      }
-
-      for (i = 0; i < lfen; i++) {
-         term = (x[i] - floor(x[i]));
-         tail[i] = result[(int)floor(x[i])] * (1.0 - term);
-         tail[i] += result[(int)floor(x[i]) + 1] * term;
-      }
-
-      copy(ps->last_L_out, 0, overlap, *(ps->last_L));
-      maxIndex = maxSimIndex2(overlap, *(ps->last_L), tail, N - L);
-
-      for (i = 0; i < *(ps->last_L); i++) {
-         term = (i)/((float)(*(ps->last_L) - 1));
-         tail[i + maxIndex] *= term;
-         tail[i + maxIndex] += ps->last_L_out[i] * (1.0 - term);
-      }
-
-      for (i = 0; i < n_samples; i++) {
-         ps->last_input[i] = in[i + *(ps->last_n)];
-      }
-
-      for (i = 0; i < L; i++)
-         ps->last_L_out[i] = tail[n_samples + maxIndex + i];
-
-      *(ps->last_n) = n_samples;
-      *(ps->last_L) = L;
-       
-      for (i = 0; i < n_samples; i++) {
-         output[i] = tail[i + maxIndex];
-      }
-
+   params.dry = ps->dry ? *(ps->dry) : 0.0;
+   params.mode = ps->mode ? (int)*(ps->mode) : PS_MODE_SOLA;
+   params.quality = ps->quality ? (int)*(ps->quality) : PS_RS_MEDIUM;
+   params.fade = ps->fade ? (int)*(ps->fade) : PS_FADE_LINEAR;
+   params.full_search = 0;
+   params.pipelined = ps->pipeline ? *(ps->pipeline) > 0.5 : 0;
+
+   if (params.pipelined && !ps->helper_asked && ps->schedule &&
+       ps->schedule->schedule_work(ps->schedule->handle, 0, NULL) ==
+       LV2_WORKER_SUCCESS)
+      ps->helper_asked = 1;
+
+   if (ps->tracking) {
+      PsPitch* pt = &ps->tracker;
+
+      ps_pitch_set_updates(pt, ps->track ? *(ps->track) : TRACK_RATE);
+      ps_pitch_process(pt, ps->input[0], n_samples);
+      if (ps->pitch)
+         *(ps->pitch) = pt->freq;
+      if (ps->confidence)
+         *(ps->confidence) = pt->confidence;
+      if (ps->snap && *(ps->snap) > 0.5 && pt->freq > 0 &&
+          pt->confidence >= SNAP_CONFIDENCE)
+         params.alpha[0] = ps_pitch_semitone(pt->freq*params.alpha[0])/pt->freq;
    }
 
+   ps_engine_process(&ps->engine, ps->input, ps->output, n_samples, &params);
+
+   if (ps->latency)
+      *(ps->latency) = ps_engine_latency(&ps->engine, &params);
 }
 
 /**
@@ -279,7 +356,7 @@ run(LV2_Handle instance, uint32_t n_samples)
    instance.  The host passes the plugin descriptor, sample rate, and bundle
    path for plugins that need to load additional resources (e.g. waveforms).
    The features parameter contains host-provided features defined in LV2
-   extensions, but this simple plugin does not use any.
+   extensions; the worker schedule is kept to start the helper thread later.
 
    This function is in the ``instantiation'' threading class, so no other
    methods on this instance will be called concurrently with it.
@@ -291,18 +368,35 @@ instantiate(const LV2_Descriptor*     descriptor,
             const LV2_Feature* const* features
 	    )
 {
+   int i, voices, channels;
+	Ps* ps = (Ps*)calloc(1, sizeof(Ps));
+
+   if (ps == NULL)
+      return NULL;
 
-	Ps* ps = (Ps*)malloc(sizeof(Ps));
+   voices = strcmp(descriptor->URI, HARMONIZER_URI) ? 1 : MAX_VOICES;
+   channels = strcmp(descriptor->URI, STEREO_URI) ? 1 : 2;
 
-   ps->last_L_out = malloc(256 * sizeof(float));
-   ps->last_input = malloc(4096 * sizeof(float));
-   ps->is_first = malloc(sizeof(int));
-   ps->last_n = malloc(sizeof(int));
-   ps->last_L = malloc(sizeof(int));
+   if (ps_engine_init(&ps->engine, rate, channels, voices) != 0) {
+      fprintf(stderr, "DAFX_PS: could not allocate the engine buffers.\n");
+      free(ps);
+      return NULL;
+   }
+
+   if (strcmp(descriptor->URI, PS_URI) == 0) {
+      if (ps_pitch_init(&ps->tracker, rate, TRACK_RATE) != 0) {
+         fprintf(stderr, "DAFX_PS: could not allocate the pitch tracker.\n");
+         ps_engine_free(&ps->engine);
+         free(ps);
+         return NULL;
+      }
+      ps->tracking = 1;
+   }
 
-   *(ps->is_first) = 1;
-   *(ps->last_n) = 0;
-   *(ps->last_L) = 0;
+   for (i = 0; features != NULL && features[i] != NULL; i++) {
+      if (strcmp(features[i]->URI, LV2_WORKER__schedule) == 0)
+         ps->schedule = (LV2_Worker_Schedule*)features[i]->data;
+   }
 
 	return (LV2_Handle)ps;
 }
@@ -310,8 +404,8 @@ instantiate(const LV2_Descriptor*     descriptor,
 /**
    The `activate()` method is called by the host to initialise and prepare the
    plugin instance for running.  The plugin must reset all internal state
-   except for buffer locations set by `connect_port()`.  Since this plugin has
-   no other internal state, this method does nothing.
+   except for buffer locations set by `connect_port()`.  Here the queues and
+   the memory of both engines are cleared.
 
    This method is in the ``instantiation'' threading class, so no other
    methods on this instance will be called concurrently with it.
@@ -319,6 +413,11 @@ instantiate(const LV2_Descriptor*     descriptor,
 static void
 activate(LV2_Handle instance)
 {
+   Ps* ps = (Ps*)instance;
+
+   ps_engine_reset(&ps->engine);
+   if (ps->tracking)
+      ps_pitch_reset(&ps->tracker);
 }
 
 /**
@@ -347,15 +446,50 @@ deactivate(LV2_Handle instance)
 static void
 cleanup(LV2_Handle instance)
 {
+   Ps* ps = (Ps*)instance;
+
+   ps_engine_free(&ps->engine);
+   if (ps->tracking)
+      ps_pitch_free(&ps->tracker);
 	free(instance);
 }
 
+/**
+   Start the helper thread, scheduled by `run()` the first time "pipeline" is
+   on.  The host calls this on its worker thread, possibly while `run()` is
+   running; the engine only uses the pipeline once it is complete.
+
+   This method is in the ``worker'' threading class.
+*/
+static LV2_Worker_Status
+work(LV2_Handle                  instance,
+     LV2_Worker_Respond_Function respond,
+     LV2_Worker_Respond_Handle   handle,
+     uint32_t                    size,
+     const void*                 data)
+{
+   Ps* ps = (Ps*)instance;
+
+   if (ps_engine_start_helper(&ps->engine) != 0) {
+      fprintf(stderr, "DAFX_PS: could not start the helper thread, "
+              "pipelining is off.\n");
+      return LV2_WORKER_ERR_UNKNOWN;
+   }
+   return LV2_WORKER_SUCCESS;
+}
+
+/** `work()` sends no response, so there is nothing to apply. */
+static LV2_Worker_Status
+work_response(LV2_Handle instance, uint32_t size, const void* body)
+{
+   return LV2_WORKER_SUCCESS;
+}
+
 /**
    The `extension_data()` function returns any extension data supported by the
    plugin.  Note that this is not an instance method, but a function on the
    plugin descriptor.  It is usually used by plugins to implement additional
-   interfaces.  This plugin does not have any extension data, so this function
-   returns NULL.
+   interfaces.  This plugin implements the worker interface.
 
    This method is in the ``discovery'' threading class, so no other functions
    or methods in this plugin library will be called concurrently with it.
@@ -363,6 +497,10 @@ cleanup(LV2_Handle instance)
 static const void*
 extension_data(const char* uri)
 {
+   static const LV2_Worker_Interface worker = { work, work_response, NULL };
+
+   if (strcmp(uri, LV2_WORKER__interface) == 0)
+      return &worker;
 	return NULL;
 }
 
@@ -382,6 +520,29 @@ static const LV2_Descriptor descriptor = {
 	extension_data
 };
 
+/** The harmonizer and the stereo pitch shifter share everything but ports. */
+static const LV2_Descriptor harmonizer_descriptor = {
+	HARMONIZER_URI,
+	instantiate,
+	connect_port_harmonizer,
+	activate,
+	run,
+	deactivate,
+	cleanup,
+	extension_data
+};
+
+static const LV2_Descriptor stereo_descriptor = {
+	STEREO_URI,
+	instantiate,
+	connect_port_stereo,
+	activate,
+	run,
+	deactivate,
+	cleanup,
+	extension_data
+};
+
 /**
    The `lv2_descriptor()` function is the entry point to the plugin library.  The
    host will load the library and call this function repeatedly with increasing
@@ -398,6 +559,8 @@ lv2_descriptor(uint32_t index)
 {
 	switch (index) {
 	case 0:  return &descriptor;
+	case 1:  return &harmonizer_descriptor;
+	case 2:  return &stereo_descriptor;
 	default: return NULL;
 	}
 }
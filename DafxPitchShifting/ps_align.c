@@ -0,0 +1,119 @@
+#include <stdlib.h>
+
+#include "ps_align.h"
+
+int ps_align_init(PsAlign* align, int max_len) {
+   int n = ps_fft_next_pow2(max_len);
+
+   align->max_len = max_len;
+   align->re = malloc(n * sizeof(float));
+   align->im = malloc(n * sizeof(float));
+   align->energy = malloc((max_len + 1) * sizeof(float));
+
+   if (ps_fft_init(&align->fft, n) != 0 ||
+       align->re == NULL || align->im == NULL || align->energy == NULL) {
+      ps_align_free(align);
+      return -1;
+   }
+
+   return 0;
+}
+
+
+void ps_align_free(PsAlign* align) {
+   ps_fft_free(&align->fft);
+   free(align->re);
+   free(align->im);
+   free(align->energy);
+   align->re = NULL;
+   align->im = NULL;
+   align->energy = NULL;
+}
+
+
+/**
+   Leave n times the circular cross-correlation c(k) = sum_j u[j] v[j + k] of
+   u and v, zero-extended to `n` points, in align->re[k mod n].
+*/
+static void
+correlate(PsAlign* align, const float* u, int uLen, const float* v, int vLen,
+          int n) {
+   int i, k;
+   float a, b, c, d, x1, y1, x2, y2;
+   float* const re = align->re;
+   float* const im = align->im;
+
+   /* Both real sequences go through one complex transform: z = v + i*u */
+   for (i = 0; i < n; i++) {
+      re[i] = (i < vLen) ? v[i] : 0;
+      im[i] = (i < uLen) ? u[i] : 0;
+   }
+   ps_fft_forward(&align->fft, re, im, n);
+
+   /*
+      Split Z into V and U (V = (Z[k] + Z*[n-k])/2, U = (Z[k] - Z*[n-k])/2i)
+      and form the cross spectrum V.conj(U).  It is Hermitian, so each pair
+      (k, n-k) is computed once.
+   */
+   for (k = 0; k <= n/2; k++) {
+      a = re[k];
+      b = im[k];
+      c = re[(n - k) & (n - 1)];
+      d = im[(n - k) & (n - 1)];
+
+      x1 = a + c;    y1 = b - d;     // 2V
+      x2 = b + d;    y2 = a - c;     // 2conj(U)
+
+      re[k] = 0.25 * (x1*x2 - y1*y2);
+      im[k] = 0.25 * (x1*y2 + y1*x2);
+      re[(n - k) & (n - 1)] = re[k];
+      im[(n - k) & (n - 1)] = -im[k];
+   }
+   ps_fft_inverse(&align->fft, re, im, n);
+}
+
+
+int ps_align_search(PsAlign* align, const float* u, int uLen,
+                    const float* v, int vLen, int min_lag, int max_lag) {
+   int i, k, n, lo, hi, index;
+   float dist, min;
+   float* const re = align->re;
+   float* const energy = align->energy;
+
+   if (uLen <= 0 || vLen <= 0 || uLen + vLen > align->max_len)
+      return min_lag;
+
+   n = ps_fft_next_pow2(uLen + vLen);
+   correlate(align, u, uLen, v, vLen, n);
+
+   energy[0] = 0;
+   for (i = 0; i < vLen; i++)
+      energy[i + 1] = energy[i] + v[i]*v[i];
+
+   /* c(k) = re[k mod n] / n; negative lags wrap to the end of the buffer */
+   for (k = min_lag, index = min_lag, min = 0; k < max_lag; k++) {
+      lo = (k > 0) ? k : 0;
+      hi = (k + uLen < vLen) ? k + uLen : vLen;
+
+      dist = -2 * re[k & (n - 1)] / n;
+      if (hi > lo)
+         dist += energy[hi] - energy[lo];
+
+      if (k == min_lag || dist < min) {
+         min = dist;
+         index = k;
+      }
+   }
+
+   return index;
+}
+
+
+void ps_align_correlate(PsAlign* align, const float* u, int uLen,
+                        const float* v, int vLen, float* c, int lags) {
+   int k, n = ps_fft_next_pow2(vLen);
+
+   correlate(align, u, uLen, v, vLen, n);
+   for (k = 0; k < lags; k++)
+      c[k] = align->re[k]/n;
+}
@@ -0,0 +1,117 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps_delay.h"
+
+#define PI 3.14159265358979323846
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define W    PS_DELAY_WINDOW   // power of two
+#define MASK (PS_DELAY_LEN - 1)
+
+int ps_delay_init(PsDelay* dl, int channels, int voices) {
+   int k;
+
+   memset(dl, 0, sizeof(PsDelay));
+   dl->channels = channels;
+   dl->voices = MIN(voices, PS_DELAY_MAX_VOICES);
+   dl->latency = W/2;
+   dl->line = calloc(PS_DELAY_LEN*channels, sizeof(float));
+   dl->window = malloc(W*sizeof(float));
+   if (dl->line == NULL || dl->window == NULL) {
+      ps_delay_free(dl);
+      return -1;
+   }
+
+   /* sin^2: window[k] + window[k + W/2] = 1 */
+   for (k = 0; k < W; k++)
+      dl->window[k] = sin(PI*k/W)*sin(PI*k/W);
+
+   ps_delay_reset(dl);
+
+   return 0;
+}
+
+void ps_delay_free(PsDelay* dl) {
+   free(dl->line);
+   free(dl->window);
+   memset(dl, 0, sizeof(PsDelay));
+}
+
+void ps_delay_reset(PsDelay* dl) {
+   int v;
+
+   memset(dl->line, 0, PS_DELAY_LEN*dl->channels*sizeof(float));
+   dl->write = 0;
+   /* First tap silent at delay 0, second one alone at the latency */
+   for (v = 0; v < PS_DELAY_MAX_VOICES; v++)
+      dl->phase[v] = 0;
+}
+
+int ps_delay_latency(const PsDelay* dl) {
+   return dl->latency;
+}
+
+/** Linear interpolation of the line of a channel `d` samples before `pos`. */
+static inline float
+tap(const float* line, int pos, float d) {
+   int i = (int)d;
+   float f = d - i;
+   float a = line[(pos - i) & MASK];
+   float b = line[(pos - i - 1) & MASK];
+
+   return a + f*(b - a);
+}
+
+void ps_delay_process(PsDelay* dl, const float* const* in, float* const* out,
+                      int n, const float* alpha, const float* gain,
+                      int voices, float dry) {
+   int i, v, c, k1, k2;
+   float x, d1, d2, w1, w2, step[PS_DELAY_MAX_VOICES];
+   const int C = dl->channels;
+   const int latency = dl->latency;
+
+   voices = MIN(voices, dl->voices);
+   for (v = 0; v < voices; v++)
+      step[v] = (1 - alpha[v])/W;
+
+   for (i = 0; i < n; i++) {
+      const int pos = dl->write;
+
+      for (c = 0; c < C; c++)
+         dl->line[c*PS_DELAY_LEN + pos] = in[c][i];
+
+      for (c = 0; c < C; c++)
+         out[c][i] = dry*dl->line[c*PS_DELAY_LEN + ((pos - latency) & MASK)];
+
+      for (v = 0; v < voices; v++) {
+         float p = dl->phase[v];
+
+         if (gain[v] != 0) {
+            d1 = p*W;
+            d2 = (p < 0.5f ? p + 0.5f : p - 0.5f)*W;
+            k1 = (int)d1 & (W - 1);   // the window is periodic
+            k2 = (int)d2 & (W - 1);
+            w1 = gain[v]*dl->window[k1];
+            w2 = gain[v]*dl->window[k2];
+            for (c = 0; c < C; c++) {
+               const float* line = dl->line + c*PS_DELAY_LEN;
+
+               x = w1*tap(line, pos, d1) + w2*tap(line, pos, d2);
+               out[c][i] += x;
+            }
+         }
+
+         /* Muted voices keep moving, so unmuting them is seamless */
+         p += step[v];
+         if (p >= 1)
+            p -= 1;
+         else if (p < 0 && (p += 1) >= 1)
+            p = 0;
+         dl->phase[v] = p;
+      }
+
+      dl->write = (pos + 1) & MASK;
+   }
+}
@@ -0,0 +1,58 @@
+#ifndef PS_DELAY_H
+#define PS_DELAY_H
+
+/**
+   Delay-line ("Doppler") pitch shifter for live monitoring.
+
+   The input is written into a short circular delay line and read back by two
+   taps whose delays sweep a window of PS_DELAY_WINDOW samples at the rate
+   1 - alpha: a delay that shrinks by (alpha - 1) samples per sample plays
+   the input alpha times faster.  When a tap runs off one end of the window
+   it jumps to the other; the two taps are half a window apart and weighted
+   by Hann windows that sum to one, so each jump happens while its tap is
+   silent.
+
+   The work per sample does not depend on alpha or on the block size: two
+   interpolated reads per voice and channel.  The price is the roughness of
+   the periodic splices, which SOLA and the phase vocoder avoid by searching
+   or by analysing, and a latency of half a window.
+*/
+#define PS_DELAY_WINDOW     512
+#define PS_DELAY_LEN        1024   // power of two, longer than the window
+#define PS_DELAY_MAX_VOICES 4
+
+typedef struct {
+   int    channels;
+   int    voices;
+   int    write;          // position of the next input sample
+   int    latency;        // delay of the dry signal, half a window
+   float* line;           // PS_DELAY_LEN samples per channel
+   float* window;         // Hann window, PS_DELAY_WINDOW samples
+   float  phase[PS_DELAY_MAX_VOICES]; // delay of the first tap / window
+} PsDelay;
+
+/**
+   Allocate a shifter for `channels` planar channels and up to `voices`
+   voices.  Returns 0 on success, -1 if allocation failed.
+*/
+int ps_delay_init(PsDelay* dl, int channels, int voices);
+
+void ps_delay_free(PsDelay* dl);
+
+/** Clear the delay line and put the taps where alpha = 1 is a pure delay. */
+void ps_delay_reset(PsDelay* dl);
+
+/** Delay between input and output, in samples: half a window. */
+int ps_delay_latency(const PsDelay* dl);
+
+/**
+   Write to `out` the sum of `voices` copies of `in` shifted by alpha[v] and
+   scaled by gain[v], plus `dry` times `in` delayed by the latency.  `in` and
+   `out` hold `channels` planar channels, which share the taps, and may be the
+   same buffers.
+*/
+void ps_delay_process(PsDelay* dl, const float* const* in, float* const* out,
+                      int n, const float* alpha, const float* gain,
+                      int voices, float dry);
+
+#endif
@@ -0,0 +1,678 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps_engine.h"
+
+#define PI 3.14159265358979323846
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+/**
+   Every frame is processed together with the previous one, exactly as the
+   original "previous block + current block" loop did.  The analysis hop
+   ps->sa and grain length ps->grain of the TimeScaleSOLA loop follow the
+   sample rate, and a frame is one grain long.
+*/
+#define ALPHA_MAX PS_ALPHA_MAX
+
+/**
+   Longest uLen + vLen handed to the splice search: the cuts of the loop
+   compare L (at most l_max) samples against a grain.
+*/
+#define SEARCH_MAX_LEN(ps) ((ps)->grain + (ps)->l_max)
+
+/**
+   Output splice window.  The output of a frame of a voice starts at a lag
+   in [at - SPLICE_SPAN/2, at + SPLICE_SPAN/2) of its tail, where `at` is
+   SPLICE_AT moved by `splice_shift` for the pitch ratio of the voice.  The
+   window is anchored, so a splice cannot carry the offset of the previous
+   one and the delay stays within SPLICE_SPAN/2 of LATENCY.  A span of one
+   hop is the reach of the cuts of the loop at alpha 1, and the window plus
+   a frame and l_max stays inside the part of the tail that the last grain
+   fills, from alpha 0.5 to ALPHA_MAX.
+*/
+#define SPLICE_AT(ps)   (3*(ps)->sa/2)
+#define SPLICE_SPAN(ps) ((ps)->sa)
+
+/**
+   Delay, in hops, of the resampled grains relative to alpha 1, at
+   alpha = 2^((i - 8)/8).  The cuts of the loop follow the signal until
+   their reach L runs out, so below alpha 1 the grains reach the tail late
+   and above it early.  Measured with test/test_latency.c on noise and on a
+   sawtooth at 44.1 to 96 kHz; the spread is about 0.1 hop.
+*/
+static const float splice_shift[17] = {
+   1.44,  1.26,  1.08,  0.86,  0.76,  0.60,  0.50,  0.31,  0.00,
+  -0.32, -0.44, -0.58, -0.72, -0.78, -0.84, -0.90, -0.90
+};
+
+/**
+   Buffer sizes.  `in` holds two frames plus a grain of zero padding for the
+   last grain of the loop, `result` the time-scaled frames (up to ALPHA_MAX
+   times longer plus one grain) and each `tail` of a voice the resampled
+   frames plus the room read by the output splice.  `result` is preceded
+   by RESULT_PAD zeros for the taps of the resampler that fall before its
+   first sample.
+*/
+#define IN_LEN(ps)     (3*(ps)->grain)
+#define RESULT_LEN(ps) \
+   ((int)(2*(ps)->grain*ALPHA_MAX) + (ps)->grain + PS_RS_MAX_TAPS)
+#define RESULT_PAD     (PS_RS_MAX_TAPS/2)
+#define TAIL_LEN(ps)   (3*(ps)->grain + (ps)->l_max)
+
+/**
+   Delay between input and output: one frame to fill the input queue and one
+   frame because the tail of a frame starts at the beginning of the previous
+   frame, less the lag at which the output splice is anchored.
+*/
+#define LATENCY(ps) (2*(ps)->grain - SPLICE_AT(ps))
+
+/** Phase-vocoder frame and hop (75% overlap). */
+#define PV_SIZE 2048
+#define PV_HOP  (PV_SIZE/4)
+
+static void
+copy(const float *source, int ini, float *destination, int len) {
+   int i;
+
+   for (i = 0; i < len; i++) 
+      destination[i] = source[ini + i];
+}
+
+
+/**
+   Brute-force output splice search, O(uLen * vLen).  It is kept as the
+   reference for `ps_align_search()` and is used instead of it when the
+   plugin is built with -DPS_BRUTE_FORCE_SEARCH.
+*/
+#ifdef PS_BRUTE_FORCE_SEARCH
+static int
+maxSimIndex2(float *u, int uLen, float *v, int vLen, int lags) {
+   int i, j, index;
+   float min, sum;
+
+   for (i = 0; i < lags; i++) {
+      for (j = i, sum = 0; j < i + uLen; j++) {
+         if (j < vLen) sum += fabs(u[j - i] - v[j]);
+         else sum += fabs(u[j - i] - 0);
+      }
+      if (i == 0 || sum < min) {
+         min = sum;
+         index = i;
+      }
+   }
+
+   return index;
+}
+#endif
+
+
+/** Middle of the output splice window of a voice at pitch ratio `alpha`. */
+static int
+splice_at(const PsEngine* ps, float alpha)
+{
+   float x = 8*log2f(alpha) + 8;
+   int i;
+
+   x = MIN(MAX(x, 0), 16);
+   i = MIN((int)x, 15);
+   x = splice_shift[i] + (x - i)*(splice_shift[i + 1] - splice_shift[i]);
+   return SPLICE_AT(ps) + lrintf(x*ps->sa);
+}
+
+/**
+   Output splice: the lag in the splice window of `tail` at which the end of
+   the previous frame of `voice` matches it best.
+*/
+static int
+output_cut(PsEngine* ps, const SolaVoice* voice, const float* tail,
+           float alpha, int dec)
+{
+   const float* u;
+   const float* v;
+   const int C = ps->channels;
+   const int last_L = voice->last_L;
+   const int at = splice_at(ps, alpha);
+   const int lo = at - SPLICE_SPAN(ps)/2;
+   const int lags = SPLICE_SPAN(ps);
+   const int vLen = lags + last_L;
+
+   if (last_L == 0)
+      return at;
+
+   if (dec > 1 && last_L >= PS_SOLA_DEC_MIN*dec) {
+      ps_sola_decimate(voice->last_L_out, 0, ps->overlap, last_L/dec, C, dec);
+      ps_sola_decimate(tail, lo, ps->tail_mid, vLen/dec, C, dec);
+      return lo + dec*ps_align_search(&ps->align, ps->overlap, last_L/dec,
+                                      ps->tail_mid, vLen/dec, 0, lags/dec);
+   }
+
+   if (C > 1) {
+      ps_sola_mix_down(voice->last_L_out, 0, ps->overlap, last_L, C);
+      ps_sola_mix_down(tail, lo, ps->tail_mid, vLen, C);
+      u = ps->overlap;
+      v = ps->tail_mid;
+   }
+   else {
+      u = voice->last_L_out;
+      v = tail + lo;
+   }
+#ifdef PS_BRUTE_FORCE_SEARCH
+   return lo + maxSimIndex2((float*)u, last_L, (float*)v, vLen, lags);
+#else
+   return lo + ps_align_search(&ps->align, u, last_L, v, vLen, 0, lags);
+#endif
+}
+
+/**
+   Pitch-shift the frame in in[N..2N) (with the previous frame in front of
+   it, N = ps->grain) for one voice and write N output frames to
+   voice->out.
+
+   All channels are linked: the splice searches run once on the average of
+   the channels and the same splice points are applied to every channel, so
+   the stereo image is kept and the search is paid once.  The buffers are
+   interleaved, so the crossfades and the resampler walk over the channels of
+   a frame contiguously.  The searches run on a copy decimated by `dec`
+   when it is above 1.
+
+   With `planned` set the searches are skipped and the splice points are
+   read from `plan`; otherwise they are written to it, if it is not NULL.
+*/
+static void
+process_frame(PsEngine* ps, SolaVoice* voice, const float* in, float alpha,
+              int quality, int shape, int dec, SolaPlan* plan, int planned)
+{
+   int i, M, Ss, L, lx, cut, maxIndex, resLen, last_L;
+   const int C = ps->channels;
+   const int SA = ps->sa;
+   const int GRAIN_LEN = ps->grain;
+   const int data_size = 2*GRAIN_LEN;
+   float* const result = ps->result;
+   float* const tail = voice->tail[voice->cur ^ 1];
+
+   M = ceilf(data_size / (float)SA);
+   Ss = round(SA * alpha);
+   L = round(SA * alpha / (2.0));
+   resLen = GRAIN_LEN;
+
+/*% **** Main TimeScaleSOLA loop*****/
+   copy(in, 0, result, data_size*C);
+
+   for (i = 1; i < M; i++) {
+      if (planned)
+         cut = plan->cut[i];
+      else
+         cut = ps_sola_cut(&ps->align, result, resLen, i*Ss, in + i*SA*C,
+                           GRAIN_LEN, L, C, dec, ps->grainL, ps->overlap);
+      if (plan && !planned)
+         plan->cut[i] = cut;
+      resLen = ps_sola_join(&ps->fade, shape, result, resLen, cut,
+                            in + i*SA*C, GRAIN_LEN, C);
+   }
+/*% **** end TimeScaleSOLA loop*****/
+
+   lx = floor(data_size * alpha);
+   ps_resample_process(&ps->rs, quality, result, tail, data_size,
+                       lx/(double)data_size, C);
+
+   maxIndex = planned ? plan->maxIndex
+                      : output_cut(ps, voice, tail, alpha, dec);
+   if (plan && !planned)
+      plan->maxIndex = maxIndex;
+
+   last_L = voice->last_L;
+   ps_fade_weights(&ps->fade, shape, last_L, last_L - 1);
+   ps_fade_mix(tail + maxIndex*C, voice->last_L_out, ps->fade.w_in,
+               ps->fade.w_out, last_L, C);
+
+   voice->last_L_out = tail + (GRAIN_LEN + maxIndex)*C;
+   voice->last_L = L;
+   voice->out = tail + maxIndex*C;
+   voice->cur ^= 1;
+}
+
+/** Silence a voice and forget its splice memory. */
+static void
+reset_voice(SolaVoice* voice, int frame, int channels)
+{
+   int i;
+
+   for (i = 0; i < frame*channels; i++)
+      voice->tail[0][i] = 0.0;
+   voice->cur = 0;
+   voice->out = voice->tail[0];
+   voice->last_L_out = voice->tail[0];
+   voice->last_L = 0;
+}
+
+/** Clear the SOLA frame queue, the previous frame and every voice. */
+static void
+reset_sola(PsEngine* ps)
+{
+   int i;
+
+   for (i = 0; i < IN_LEN(ps)*ps->channels; i++)
+      ps->in[i] = 0.0;
+   for (i = 0; i < ps->grain*ps->channels; i++)
+      ps->dry_out[i] = 0.0;
+   for (i = 0; i < ps->voices; i++)
+      reset_voice(&ps->voice[i], ps->grain, ps->channels);
+
+   /* A job still queued is reclaimed when the helper hands it back */
+   if (__atomic_load_n(&ps->pipe, __ATOMIC_ACQUIRE))
+      ps->pipe->pending = NULL;
+   ps->fill = 0;
+}
+
+
+/**
+   Pipelined frame boundary.  The frame queued at the previous boundary is
+   synthesized with the plan the helper made for it, or analysed here if the
+   plan is not ready, and the frame just completed is queued.  The dry
+   signal comes from the synthesized frame, so everything is one frame
+   later than in the direct mode.
+*/
+static void
+pipeline_frame(PsEngine* ps, const float* alpha, const float* gain,
+               int quality, int shape, int dec)
+{
+   int v, k, planned;
+   PsPipeline* pipe = ps->pipe;
+   PsJob* job = pipe->pending;
+   const int C = ps->channels;
+   const int n = ps->grain*C;
+
+   if (job) {
+      planned = job != &pipe->local &&
+                __atomic_load_n(&job->state, __ATOMIC_ACQUIRE) == PS_JOB_DONE;
+      if (!planned)
+         pipe->late++;
+      for (v = 0; v < ps->voices; v++) {
+         if (job->active[v])
+            process_frame(ps, &ps->voice[v], job->in, job->alpha[v],
+                          job->quality, job->shape, job->dec,
+                          planned ? &job->plan[v] : NULL, planned);
+         else
+            reset_voice(&ps->voice[v], ps->grain, C);
+      }
+      memcpy(ps->dry_out, job->in + SPLICE_AT(ps)*C, n*sizeof(float));
+      if (planned)
+         __atomic_store_n(&job->state, PS_JOB_FREE, __ATOMIC_RELAXED);
+   }
+   else {
+      for (v = 0; v < ps->voices; v++)
+         reset_voice(&ps->voice[v], ps->grain, C);
+      memset(ps->dry_out, 0, n*sizeof(float));
+   }
+
+   /* Jobs handed back after their frame was analysed here are stale */
+   for (k = 0, job = &pipe->local; k < PS_PIPE_JOBS; k++) {
+      if (__atomic_load_n(&pipe->job[k].state, __ATOMIC_ACQUIRE) ==
+          PS_JOB_DONE)
+         __atomic_store_n(&pipe->job[k].state, PS_JOB_FREE, __ATOMIC_RELAXED);
+      if (job == &pipe->local &&
+          __atomic_load_n(&pipe->job[k].state, __ATOMIC_RELAXED) ==
+          PS_JOB_FREE)
+         job = &pipe->job[k];
+   }
+
+   memcpy(job->in, ps->in, 2*n*sizeof(float));
+   for (v = 0; v < ps->voices; v++) {
+      job->alpha[v] = alpha[v];
+      job->active[v] = gain[v] != 0;
+      job->last_L[v] = ps->voice[v].last_L;
+      ps_sola_mix_down(ps->voice[v].last_L_out, 0, job->last + v*ps->l_max,
+                       ps->voice[v].last_L, C);
+   }
+   job->quality = quality;
+   job->shape = shape;
+   job->dec = dec;
+
+   if (job != &pipe->local) {
+      __atomic_store_n(&job->state, PS_JOB_QUEUED, __ATOMIC_RELEASE);
+      sem_post(&pipe->wake);
+   }
+   pipe->pending = job;
+}
+
+
+/**
+   Analyse a queued frame on the helper's mono engine: the same TimeScaleSOLA
+   loop and output splice on the average of the channels, recording the
+   splice points.
+*/
+static void
+analyse_job(PsEngine* mono, const PsJob* job, int channels, PsJob* out)
+{
+   int v;
+   SolaVoice* voice;
+
+   ps_sola_mix_down(job->in, 0, mono->in, 2*mono->grain, channels);
+   for (v = 0; v < mono->voices; v++) {
+      if (!job->active[v])
+         continue;
+      voice = &mono->voice[v];
+      voice->last_L_out = job->last + v*mono->l_max;
+      voice->last_L = job->last_L[v];
+      process_frame(mono, voice, mono->in, job->alpha[v], job->quality,
+                    job->shape, job->dec, &out->plan[v], 0);
+   }
+}
+
+
+static void*
+helper(void* arg)
+{
+   int k;
+   PsPipeline* pipe = (PsPipeline*)arg;
+   PsJob* job;
+
+   for (;;) {
+      while (sem_wait(&pipe->wake) != 0)
+         ;
+      if (__atomic_load_n(&pipe->quit, __ATOMIC_ACQUIRE))
+         break;
+      for (k = 0; k < PS_PIPE_JOBS; k++) {
+         job = &pipe->job[k];
+         if (__atomic_load_n(&job->state, __ATOMIC_ACQUIRE) != PS_JOB_QUEUED)
+            continue;
+         analyse_job(pipe->mono, job, pipe->channels, job);
+         __atomic_store_n(&job->state, PS_JOB_DONE, __ATOMIC_RELEASE);
+      }
+   }
+
+   return NULL;
+}
+
+/**
+   Feed `n_samples` through the SOLA frame queue.  The output, LATENCY samples
+   late, is the sum of the last processed frame of every voice scaled by its
+   gain plus the dry signal.  The queue and the frame are shared; voices with
+   a zero gain are not processed.
+*/
+static void
+run_sola(PsEngine* ps, const float* const* input, float* const* output,
+         uint32_t n_samples, const float* alpha, const float* gain,
+         float dry, int quality, int shape, int dec, int pipelined)
+{
+   uint32_t pos;
+   int i, c, v, k, len;
+   float y;
+   const int C = ps->channels;
+   const int FRAME_LEN = ps->grain;
+
+   for (pos = 0; pos < n_samples; pos += len) {
+      len = MIN(n_samples - pos, (uint32_t)(FRAME_LEN - ps->fill));
+
+      for (i = 0; i < len; i++) {
+         k = (ps->fill + i)*C;
+         for (c = 0; c < C; c++) {
+            ps->in[FRAME_LEN*C + k + c] = input[c][pos + i];
+            y = dry * ps->dry_out[k + c];
+            for (v = 0; v < ps->voices; v++)
+               y += gain[v] * ps->voice[v].out[k + c];
+            output[c][pos + i] = y;
+         }
+      }
+      ps->fill += len;
+
+      if (ps->fill == FRAME_LEN && pipelined) {
+         pipeline_frame(ps, alpha, gain, quality, shape, dec);
+         memcpy(ps->in, ps->in + FRAME_LEN*C, FRAME_LEN*C*sizeof(float));
+         ps->fill = 0;
+      }
+      else if (ps->fill == FRAME_LEN) {
+         for (v = 0; v < ps->voices; v++) {
+            if (gain[v] != 0)
+               process_frame(ps, &ps->voice[v], ps->in, alpha[v], quality,
+                             shape, dec, NULL, 0);
+            else
+               reset_voice(&ps->voice[v], FRAME_LEN, C);
+         }
+
+         /* The dry signal is delayed as much as the output splice; the
+            current frame becomes the previous one */
+         memcpy(ps->dry_out, ps->in + SPLICE_AT(ps)*C,
+                FRAME_LEN*C*sizeof(float));
+         memcpy(ps->in, ps->in + FRAME_LEN*C, FRAME_LEN*C*sizeof(float));
+         ps->fill = 0;
+      }
+   }
+}
+
+int ps_engine_frame(double rate) {
+   return 4*ps_sola_hop(rate);
+}
+
+/**
+   Allocate the SOLA part of an engine: the frame queue, the voices and the
+   search, crossfade and resampling scratch.  Returns 0 or -1.
+*/
+static int
+init_sola(PsEngine* ps, double rate, int channels, int voices)
+{
+   int v, C;
+
+   memset(ps, 0, sizeof(PsEngine));
+   ps->rate = rate;
+   ps->sa = ps_sola_hop(rate);
+   ps->grain = ps_engine_frame(rate);
+   ps->l_max = (int)(ps->sa*ALPHA_MAX/2);
+   ps->dec = MAX(1, (int)(rate/PS_SEARCH_RATE));
+   ps->voices = MIN(voices, PS_MAX_VOICES);
+   ps->channels = MIN(channels, PS_MAX_CHANNELS);
+   C = ps->channels;
+
+   ps->in = calloc(IN_LEN(ps)*C, sizeof(float));
+   ps->dry_out = calloc(ps->grain*C, sizeof(float));
+   for (v = 0; v < ps->voices; v++) {
+      ps->voice[v].tail[0] = calloc(TAIL_LEN(ps)*C, sizeof(float));
+      ps->voice[v].tail[1] = calloc(TAIL_LEN(ps)*C, sizeof(float));
+      if (ps->voice[v].tail[0] == NULL || ps->voice[v].tail[1] == NULL)
+         return -1;
+   }
+   ps->result_mem = calloc((RESULT_PAD + RESULT_LEN(ps))*C, sizeof(float));
+   ps->result = ps->result_mem + RESULT_PAD*C;
+   ps->grainL = calloc(ps->l_max, sizeof(float));
+   ps->overlap = calloc(ps->l_max, sizeof(float));
+   ps->tail_mid = calloc(ps->grain, sizeof(float));
+
+   if (ps->in == NULL || ps->dry_out == NULL ||
+       ps->result_mem == NULL ||
+       ps->grainL == NULL || ps->overlap == NULL ||
+       ps->tail_mid == NULL ||
+       ps_align_init(&ps->align, SEARCH_MAX_LEN(ps)) != 0 ||
+       ps_resample_init(&ps->rs) != 0 ||
+       ps_fade_init(&ps->fade, ps->grain) != 0)
+      return -1;
+
+   return 0;
+}
+
+int ps_engine_init(PsEngine* ps, double rate, int channels, int voices) {
+   int c;
+
+   if (init_sola(ps, rate, channels, voices) != 0) {
+      ps_engine_free(ps);
+      return -1;
+   }
+   for (c = 0; c < ps->channels; c++) {
+      if (ps_pvoc_init(&ps->pvoc[c], PV_SIZE, PV_HOP, ps->voices) != 0) {
+         ps_engine_free(ps);
+         return -1;
+      }
+   }
+   if (ps_delay_init(&ps->delay, ps->channels, ps->voices) != 0 ||
+       ps_psola_init(&ps->psola, ps->channels, ps->voices) != 0) {
+      ps_engine_free(ps);
+      return -1;
+   }
+
+   ps_engine_reset(ps);
+
+   return 0;
+}
+
+
+/** Stop the helper and free the pipeline. */
+static void
+free_pipeline(PsPipeline* pipe, int started)
+{
+   int k;
+
+   if (started) {
+      __atomic_store_n(&pipe->quit, 1, __ATOMIC_RELEASE);
+      sem_post(&pipe->wake);
+      pthread_join(pipe->thread, NULL);
+   }
+   sem_destroy(&pipe->wake);
+   for (k = 0; k < PS_PIPE_JOBS; k++) {
+      free(pipe->job[k].in);
+      free(pipe->job[k].last);
+   }
+   free(pipe->local.in);
+   free(pipe->local.last);
+   if (pipe->mono) {
+      ps_engine_free(pipe->mono);
+      free(pipe->mono);
+   }
+   free(pipe);
+}
+
+int ps_engine_start_helper(PsEngine* ps) {
+   int k, failed = 0;
+   PsPipeline* pipe;
+   PsJob* job;
+
+   if (__atomic_load_n(&ps->pipe, __ATOMIC_ACQUIRE))
+      return 0;
+   pipe = calloc(1, sizeof(PsPipeline));
+   if (pipe == NULL)
+      return -1;
+   if (sem_init(&pipe->wake, 0, 0) != 0) {
+      free(pipe);
+      return -1;
+   }
+   pipe->channels = ps->channels;
+
+   for (k = 0; k <= PS_PIPE_JOBS; k++) {
+      job = k < PS_PIPE_JOBS ? &pipe->job[k] : &pipe->local;
+      job->in = calloc(IN_LEN(ps)*ps->channels, sizeof(float));
+      job->last = calloc(ps->l_max*ps->voices, sizeof(float));
+      failed |= job->in == NULL || job->last == NULL;
+   }
+   pipe->mono = calloc(1, sizeof(PsEngine));
+   if (failed || pipe->mono == NULL ||
+       init_sola(pipe->mono, ps->rate, 1, ps->voices) != 0 ||
+       pthread_create(&pipe->thread, NULL, helper, pipe) != 0) {
+      free_pipeline(pipe, 0);
+      return -1;
+   }
+
+   /* run_sola() may be running: it sees the pipeline only once complete */
+   __atomic_store_n(&ps->pipe, pipe, __ATOMIC_RELEASE);
+   return 0;
+}
+
+
+void ps_engine_free(PsEngine* ps) {
+   int v, c;
+
+   if (ps->pipe)
+      free_pipeline(ps->pipe, 1);
+   ps_align_free(&ps->align);
+   for (c = 0; c < PS_MAX_CHANNELS; c++)
+      ps_pvoc_free(&ps->pvoc[c]);
+   free(ps->in);
+   free(ps->dry_out);
+   for (v = 0; v < PS_MAX_VOICES; v++) {
+      free(ps->voice[v].tail[0]);
+      free(ps->voice[v].tail[1]);
+   }
+   ps_resample_free(&ps->rs);
+   free(ps->result_mem);
+   ps_fade_free(&ps->fade);
+   ps_delay_free(&ps->delay);
+   ps_psola_free(&ps->psola);
+   free(ps->grainL);
+   free(ps->overlap);
+   free(ps->tail_mid);
+   memset(ps, 0, sizeof(PsEngine));
+}
+
+
+void ps_engine_reset(PsEngine* ps) {
+   int c;
+
+   reset_sola(ps);
+   for (c = 0; c < ps->channels; c++)
+      ps_pvoc_reset(&ps->pvoc[c]);
+   ps_delay_reset(&ps->delay);
+   ps_psola_reset(&ps->psola);
+   ps->last_mode = PS_MODE_SOLA;
+   ps->last_pipelined = 0;
+}
+
+
+int ps_engine_latency(const PsEngine* ps, const PsParams* params) {
+   if (params->mode == PS_MODE_PVOC)
+      return ps_pvoc_latency(&ps->pvoc[0]);
+   if (params->mode == PS_MODE_DELAY)
+      return ps_delay_latency(&ps->delay);
+   if (params->mode == PS_MODE_PSOLA)
+      return ps_psola_latency(&ps->psola);
+   if (params->pipelined && __atomic_load_n(&ps->pipe, __ATOMIC_ACQUIRE))
+      return LATENCY(ps) + ps->grain;
+
+   return LATENCY(ps);
+}
+
+
+void ps_engine_process(PsEngine* ps, const float* const* input,
+                       float* const* output, uint32_t n_samples,
+                       const PsParams* params) {
+   int v, c;
+   float alpha[PS_MAX_VOICES];
+   const int pipelined = params->pipelined &&
+                         __atomic_load_n(&ps->pipe, __ATOMIC_ACQUIRE) != NULL;
+
+   for (v = 0; v < ps->voices; v++)
+      alpha[v] = MAX(PS_ALPHA_MIN, MIN(params->alpha[v], ALPHA_MAX));
+
+   if (params->mode != ps->last_mode ||
+       (params->mode == PS_MODE_SOLA && pipelined != ps->last_pipelined)) {
+      if (params->mode == PS_MODE_PVOC)
+         for (c = 0; c < ps->channels; c++)
+            ps_pvoc_reset(&ps->pvoc[c]);
+      else if (params->mode == PS_MODE_DELAY)
+         ps_delay_reset(&ps->delay);
+      else if (params->mode == PS_MODE_PSOLA)
+         ps_psola_reset(&ps->psola);
+      else
+         reset_sola(ps);
+      ps->last_mode = params->mode;
+      ps->last_pipelined = pipelined;
+   }
+
+   /* The phase vocoder has no splice points to share: one per channel */
+   if (params->mode == PS_MODE_PVOC) {
+      for (c = 0; c < ps->channels; c++)
+         ps_pvoc_process_voices(&ps->pvoc[c], input[c], output[c], n_samples,
+                                alpha, params->gain, ps->voices, params->dry);
+   }
+   else if (params->mode == PS_MODE_DELAY) {
+      ps_delay_process(&ps->delay, input, output, n_samples, alpha,
+                       params->gain, ps->voices, params->dry);
+   }
+   else if (params->mode == PS_MODE_PSOLA) {
+      ps_psola_process(&ps->psola, input, output, n_samples, alpha,
+                       params->gain, ps->voices, params->dry);
+   }
+   else {
+      run_sola(ps, input, output, n_samples, alpha, params->gain,
+               params->dry, params->quality, params->fade,
+               params->full_search ? 1 : ps->dec, pipelined);
+   }
+}
@@ -0,0 +1,198 @@
+#ifndef PS_ENGINE_H
+#define PS_ENGINE_H
+
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdint.h>
+
+#include "ps_align.h"
+#include "ps_delay.h"
+#include "ps_psola.h"
+#include "ps_pvoc.h"
+#include "ps_resample.h"
+#include "ps_stretch.h"
+
+/**
+   The pitch-shifting engine behind the LV2 plugins, usable without an LV2
+   host.  It does not work on the caller's blocks: input is queued into
+   frames of `ps_engine_frame()` samples, so any block size can be processed
+   and the output does not depend on it.  Every buffer is allocated by
+   `ps_engine_init()`; `ps_engine_process()` neither allocates nor locks.
+*/
+#define PS_ALPHA_MIN    0.25
+#define PS_ALPHA_MAX    2.0
+#define PS_MAX_VOICES   PS_PVOC_MAX_VOICES
+#define PS_MAX_CHANNELS 8
+
+/**
+   The SOLA engine is sized in milliseconds, as the stretcher is
+   (PS_SOLA_SA_MS and PS_SEARCH_RATE in ps_stretch.h): the analysis hop is
+   `ps_sola_hop()` and the grain and frame are four hops.
+*/
+
+/** Grains in the TimeScaleSOLA loop of a frame: two frames of four hops. */
+#define PS_SOLA_GRAINS  8
+
+/** Frames the helper thread of the pipelined SOLA mode can have queued. */
+#define PS_PIPE_JOBS    3
+
+/** Engines. */
+typedef enum {
+   PS_MODE_SOLA  = 0,  // time-domain SOLA + resampling
+   PS_MODE_PVOC  = 1,  // phase vocoder
+   PS_MODE_DELAY = 2,  // modulated delay line, low latency
+   PS_MODE_PSOLA = 3   // pitch-synchronous overlap-add, monophonic sources
+} PsMode;
+
+/** Parameters read by `ps_engine_process()` for each block. */
+typedef struct {
+   int   mode;                    // PsMode
+   int   quality;                 // PsResampleQuality of the SOLA resampler
+   int   fade;                    // PsFadeShape of the SOLA splices
+   float alpha[PS_MAX_VOICES];    // pitch ratio of each voice
+   float gain[PS_MAX_VOICES];     // gain of each voice
+   float dry;                     // gain of the delayed input
+   int   full_search;             // run the SOLA splice searches undecimated
+   int   pipelined;               // SOLA searches on the helper thread
+} PsParams;
+
+/**
+   Per-voice state of the SOLA engine.  The frame queue, the grain buffers
+   and the search scratch do not depend on alpha and are shared by all
+   voices, which are processed one after the other.  Audio buffers hold
+   `channels` interleaved channels.
+
+   Each frame is resampled into the tail the previous frame did not use, so
+   the output of a frame and the end spliced into the next one are read in
+   place instead of being copied out.
+*/
+typedef struct {
+   float* tail[2];         // resampled frames, written alternately
+   int    cur;             // tail of the last processed frame
+   const float* out;      // output of the last processed frame, in tail[cur]
+   const float* last_L_out; // end of the last frame, spliced into the next one
+   int    last_L;
+} SolaVoice;
+
+/** Splice points of one frame of one voice. */
+typedef struct {
+   int cut[PS_SOLA_GRAINS];   // where grain i is cut into the result
+   int maxIndex;              // output splice
+} SolaPlan;
+
+/** Job states, see PsPipeline. */
+typedef enum {
+   PS_JOB_FREE   = 0,   // owned by the audio thread
+   PS_JOB_QUEUED = 1,   // owned by the helper
+   PS_JOB_DONE   = 2    // plan written, handed back
+} PsJobState;
+
+/** A frame queued for the helper: its input and the state it depends on. */
+typedef struct {
+   int    state;                  // PsJobState, accessed atomically
+   float* in;                     // previous and current frame, zero padding
+   float* last;                   // mono end of the last frame of each voice
+   int    last_L[PS_MAX_VOICES];
+   float  alpha[PS_MAX_VOICES];
+   int    active[PS_MAX_VOICES];  // gain is not zero
+   int    quality;
+   int    shape;
+   int    dec;
+   SolaPlan plan[PS_MAX_VOICES];
+} PsJob;
+
+struct PsEngine;
+
+/**
+   Pipelined SOLA mode.  The analysis of a frame (the splice searches) runs
+   on a helper thread while the next frame is queued, and `run_sola()`
+   applies the splices it found (crossfades and resampling) one frame later.
+   Jobs move between the threads through the `state` of each one: the audio
+   thread fills a free job and marks it queued, the helper marks it done.
+   Neither thread ever waits for the other; the audio thread only posts
+   `wake`.  A frame whose job is not done in time, or that found no free job,
+   is analysed on the audio thread as in the direct mode.
+*/
+typedef struct {
+   pthread_t thread;
+   sem_t     wake;
+   int       channels;            // channels of the engine
+   int       quit;                // accessed atomically
+   PsJob     job[PS_PIPE_JOBS];
+   PsJob     local;               // frame analysed on the audio thread
+   PsJob*    pending;             // frame to synthesize at the next boundary
+   struct PsEngine* mono;         // analysis engine of the helper
+   unsigned  late;                // frames analysed on the audio thread
+} PsPipeline;
+
+typedef struct PsEngine {
+   double rate;           // sample rate
+   int    sa;             // SOLA analysis hop
+   int    grain;          // SOLA grain, also the frame length
+   int    l_max;          // longest SOLA splice
+   int    dec;            // decimation of the splice searches
+   int    voices;         // voices allocated
+   int    channels;       // channels, linked by shared splice points
+   int    last_mode;      // engine that ran in the previous block
+   float* in;             // previous frame, current frame, zero padding
+   float* dry_out;        // previous frame, played as the dry signal
+   int    fill;           // samples queued in the current frame
+   SolaVoice voice[PS_MAX_VOICES];
+   float* result_mem;     // RESULT_PAD zeros followed by `result`
+   float* result;
+   float* grainL;         // mono (mid) copies handed to the splice search
+   float* overlap;
+   float* tail_mid;
+   PsAlign align;         // FFT splice search scratch
+   PsFade fade;           // crossfade tables and weights
+   PsPvoc pvoc[PS_MAX_CHANNELS]; // phase-vocoder engine of each channel
+   PsDelay delay;         // delay-line engine, all channels
+   PsPsola psola;         // PSOLA engine, all channels
+   PsResampler rs;        // resampling stage of the SOLA engine
+   int    last_pipelined; // pipelined SOLA ran in the previous block
+   PsPipeline* pipe;      // NULL until `ps_engine_start_helper()`, atomic
+} PsEngine;
+
+/**
+   Allocate an engine for `channels` linked channels and `voices` voices at
+   `rate` Hz.  Returns 0 on success, -1 if allocation failed (the engine is
+   then freed).
+*/
+int ps_engine_init(PsEngine* ps, double rate, int channels, int voices);
+
+/** Frame length of the SOLA engine at `rate` Hz. */
+int ps_engine_frame(double rate);
+
+/**
+   Start the helper thread of the pipelined SOLA mode (PsParams.pipelined),
+   which `ps_engine_free()` stops.  Until it is started `pipelined` is
+   ignored.  It allocates and creates a thread, so it must not run on the
+   audio thread, but it may run while `ps_engine_process()` does: the
+   pipeline is published once complete and used from the next block.
+   Returns 0 on success (or if already started), -1 if the thread or its
+   buffers could not be created.
+*/
+int ps_engine_start_helper(PsEngine* ps);
+
+void ps_engine_free(PsEngine* ps);
+
+/** Clear the queues and the memory of every engine. */
+void ps_engine_reset(PsEngine* ps);
+
+/**
+   Delay between input and output of the engine selected by `params`.  The
+   pipelined SOLA mode adds a frame.
+*/
+int ps_engine_latency(const PsEngine* ps, const PsParams* params);
+
+/**
+   Process `n_samples` frames of the planar channels `input` into `output`.
+   The output is the sum of the voices scaled by their gains plus the dry
+   signal, `ps_engine_latency()` samples late.  An engine is reset when it is
+   selected, so switching modes never plays stale audio.
+*/
+void ps_engine_process(PsEngine* ps, const float* const* input,
+                       float* const* output, uint32_t n_samples,
+                       const PsParams* params);
+
+#endif
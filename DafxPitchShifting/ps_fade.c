@@ -0,0 +1,130 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "ps_fade.h"
+
+#define PI 3.14159265358979323846
+
+#define T PS_FADE_TABLE
+
+int ps_fade_init(PsFade* fade, int max_len) {
+   int s, k;
+   double t;
+
+   memset(fade, 0, sizeof(PsFade));
+   fade->max_len = max_len;
+   fade->w_in = malloc((max_len + 1)*sizeof(float));
+   fade->w_out = malloc(max_len*sizeof(float));
+   if (fade->w_in == NULL || fade->w_out == NULL) {
+      ps_fade_free(fade);
+      return -1;
+   }
+
+   for (s = 0; s < PS_FADE_SHAPES; s++) {
+      fade->table[s] = malloc((T + 2)*sizeof(float));
+      if (fade->table[s] == NULL) {
+         ps_fade_free(fade);
+         return -1;
+      }
+      for (k = 0; k <= T; k++) {
+         t = k/(double)T;
+         switch (s) {
+         case PS_FADE_EQUAL_POWER:
+            fade->table[s][k] = sin(t*PI/2);
+            break;
+         case PS_FADE_HANN:
+            fade->table[s][k] = sin(t*PI/2)*sin(t*PI/2);
+            break;
+         default:
+            fade->table[s][k] = t;
+            break;
+         }
+      }
+      /* Guard point: position T reads [T] and [T + 1] */
+      fade->table[s][T + 1] = fade->table[s][T];
+   }
+
+   return 0;
+}
+
+
+void ps_fade_free(PsFade* fade) {
+   int s;
+
+   for (s = 0; s < PS_FADE_SHAPES; s++)
+      free(fade->table[s]);
+   free(fade->w_in);
+   free(fade->w_out);
+   memset(fade, 0, sizeof(PsFade));
+}
+
+
+void ps_fade_weights(PsFade* fade, int shape, int len, int den) {
+   int j, k;
+   uint32_t step, pos;
+   float frac;
+   const float* tab;
+   float* const w_in = fade->w_in;
+
+   if (shape < 0 || shape >= PS_FADE_SHAPES)
+      shape = PS_FADE_LINEAR;
+   tab = fade->table[shape];
+   if (den < 1)
+      den = 1;
+   step = ((uint32_t)T << 16)/den;
+
+   /* The curve at j/den for j = 0..den; fade-out(j) = fade-in(den - j) */
+   for (j = 0, pos = 0; j <= den; j++, pos += step) {
+      k = pos >> 16;
+      frac = (pos & 0xffff)*(1.0f/65536);
+      w_in[j] = tab[k] + frac*(tab[k + 1] - tab[k]);
+   }
+   for (j = 0; j < len; j++)
+      fade->w_out[j] = w_in[den - j];
+}
+
+
+void ps_fade_mix(float* y, const float* x, const float* wy, const float* wx,
+                 int len, int channels) {
+   int j, c;
+
+#if defined(__SSE__)
+   if (channels == 1) {
+      for (j = 0; j + 4 <= len; j += 4) {
+         __m128 a = _mm_mul_ps(_mm_loadu_ps(y + j), _mm_loadu_ps(wy + j));
+         a = _mm_add_ps(a, _mm_mul_ps(_mm_loadu_ps(x + j), _mm_loadu_ps(wx + j)));
+         _mm_storeu_ps(y + j, a);
+      }
+      for (; j < len; j++)
+         y[j] = y[j]*wy[j] + x[j]*wx[j];
+      return;
+   }
+   if (channels == 2) {
+      for (j = 0; j + 4 <= len; j += 4) {
+         __m128 ay = _mm_loadu_ps(wy + j), ax = _mm_loadu_ps(wx + j);
+         __m128 lo = _mm_add_ps(
+            _mm_mul_ps(_mm_loadu_ps(y + 2*j), _mm_unpacklo_ps(ay, ay)),
+            _mm_mul_ps(_mm_loadu_ps(x + 2*j), _mm_unpacklo_ps(ax, ax)));
+         __m128 hi = _mm_add_ps(
+            _mm_mul_ps(_mm_loadu_ps(y + 2*j + 4), _mm_unpackhi_ps(ay, ay)),
+            _mm_mul_ps(_mm_loadu_ps(x + 2*j + 4), _mm_unpackhi_ps(ax, ax)));
+         _mm_storeu_ps(y + 2*j, lo);
+         _mm_storeu_ps(y + 2*j + 4, hi);
+      }
+      for (; j < len; j++) {
+         y[2*j] = y[2*j]*wy[j] + x[2*j]*wx[j];
+         y[2*j + 1] = y[2*j + 1]*wy[j] + x[2*j + 1]*wx[j];
+      }
+      return;
+   }
+#endif
+   for (j = 0; j < len; j++)
+      for (c = 0; c < channels; c++)
+         y[j*channels + c] = y[j*channels + c]*wy[j] + x[j*channels + c]*wx[j];
+}
@@ -0,0 +1,56 @@
+#ifndef PS_FADE_H
+#define PS_FADE_H
+
+/**
+   Crossfades of the SOLA splices.
+
+   The fade-in curve of every shape is tabulated once at PS_FADE_TABLE + 1
+   points by `ps_fade_init()`.  A splice of any length reads it with a 16.16
+   fixed-point position and linear interpolation, so a fade costs one
+   division per splice instead of one per sample.  All shapes are symmetric
+   (fade-out(t) = fade-in(1 - t)), so the fade-out weights come from the same
+   table read backwards.  The weights are then applied by `ps_fade_mix()`,
+   which is vectorized for one and two interleaved channels.
+*/
+#define PS_FADE_TABLE 1024
+
+/** Crossfade shapes. */
+typedef enum {
+   PS_FADE_LINEAR      = 0,   // t, as in the book
+   PS_FADE_EQUAL_POWER = 1,   // sin(t pi/2): constant power on uncorrelated audio
+   PS_FADE_HANN        = 2    // sin^2(t pi/2): smooth at both ends
+} PsFadeShape;
+
+#define PS_FADE_SHAPES 3
+
+typedef struct {
+   float* table[PS_FADE_SHAPES];  // fade-in curves, PS_FADE_TABLE + 2 points
+   int    max_len;                // longest fade
+   float* w_in;                   // weights of the last `ps_fade_weights()`,
+                                  // max_len + 1
+   float* w_out;
+} PsFade;
+
+/**
+   Build the tables and the weight scratch for fades of up to `max_len`
+   frames.  Returns 0 on success, -1 if allocation failed.
+*/
+int ps_fade_init(PsFade* fade, int max_len);
+
+void ps_fade_free(PsFade* fade);
+
+/**
+   Fill fade->w_in[j] and fade->w_out[j], j < len, with the fade-in and
+   fade-out weights at t = j / den.  len must not exceed den + 1 and den must
+   not exceed max_len.
+*/
+void ps_fade_weights(PsFade* fade, int shape, int len, int den);
+
+/**
+   y[j] = y[j] * wy[j] + x[j] * wx[j] for `len` frames of `channels`
+   interleaved channels; the weights are per frame.
+*/
+void ps_fade_mix(float* y, const float* x, const float* wy, const float* wx,
+                 int len, int channels);
+
+#endif
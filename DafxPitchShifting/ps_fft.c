@@ -0,0 +1,100 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "ps_fft.h"
+
+#define PI 3.14159265358979323846
+
+int ps_fft_next_pow2(int n) {
+   int p = 1;
+
+   while (p < n)
+      p <<= 1;
+
+   return p;
+}
+
+
+int ps_fft_init(PsFFT* fft, int size) {
+   int k;
+
+   fft->size = ps_fft_next_pow2(size < 2 ? 2 : size);
+   fft->cos_tab = malloc((fft->size/2 + 1) * sizeof(float));
+   fft->sin_tab = malloc((fft->size/2 + 1) * sizeof(float));
+
+   if (fft->cos_tab == NULL || fft->sin_tab == NULL) {
+      ps_fft_free(fft);
+      return -1;
+   }
+
+   for (k = 0; k <= fft->size/2; k++) {
+      fft->cos_tab[k] = cos(2*PI*k/fft->size);
+      fft->sin_tab[k] = sin(2*PI*k/fft->size);
+   }
+
+   return 0;
+}
+
+
+void ps_fft_free(PsFFT* fft) {
+   free(fft->cos_tab);
+   free(fft->sin_tab);
+   fft->cos_tab = NULL;
+   fft->sin_tab = NULL;
+}
+
+
+/**
+   Shared butterfly network.  `sign` is -1 for the forward transform and +1
+   for the inverse one; the twiddle for a stage of length `len` is read from
+   the table with stride size/len.
+*/
+static void
+transform(const PsFFT* fft, float* re, float* im, int n, float sign) {
+   int i, j, k, len, half, step;
+   float tr, ti, wr, wi;
+
+   /* Bit-reversal permutation */
+   for (i = 1, j = 0; i < n; i++) {
+      int bit = n >> 1;
+
+      for (; j & bit; bit >>= 1)
+         j ^= bit;
+      j ^= bit;
+
+      if (i < j) {
+         tr = re[i]; re[i] = re[j]; re[j] = tr;
+         ti = im[i]; im[i] = im[j]; im[j] = ti;
+      }
+   }
+
+   for (len = 2; len <= n; len <<= 1) {
+      half = len >> 1;
+      step = fft->size / len;
+
+      for (i = 0; i < n; i += len) {
+         for (k = 0; k < half; k++) {
+            wr = fft->cos_tab[k*step];
+            wi = sign * fft->sin_tab[k*step];
+
+            tr = wr*re[i + k + half] - wi*im[i + k + half];
+            ti = wr*im[i + k + half] + wi*re[i + k + half];
+
+            re[i + k + half] = re[i + k] - tr;
+            im[i + k + half] = im[i + k] - ti;
+            re[i + k] += tr;
+            im[i + k] += ti;
+         }
+      }
+   }
+}
+
+
+void ps_fft_forward(const PsFFT* fft, float* re, float* im, int n) {
+   transform(fft, re, im, n, -1.0);
+}
+
+
+void ps_fft_inverse(const PsFFT* fft, float* re, float* im, int n) {
+   transform(fft, re, im, n, 1.0);
+}
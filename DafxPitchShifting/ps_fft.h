@@ -0,0 +1,35 @@
+#ifndef PS_FFT_H
+#define PS_FFT_H
+
+/**
+   In-place radix-2 complex FFT on split real/imaginary arrays.
+
+   All trigonometry is tabulated by `ps_fft_init()` for the largest transform
+   the caller will need, so the transforms themselves neither allocate nor
+   call `sin()`/`cos()` and are safe to use from `run()`.  Any power of two up
+   to the size given at initialisation can be transformed with the same table.
+*/
+typedef struct {
+   int    size;      // largest transform length (power of two)
+   float* cos_tab;   // cos(2*pi*k/size), k < size/2
+   float* sin_tab;   // sin(2*pi*k/size), k < size/2
+} PsFFT;
+
+/** Smallest power of two greater than or equal to `n`. */
+int ps_fft_next_pow2(int n);
+
+/**
+   Allocate the twiddle tables for transforms of up to `size` points (rounded
+   up to a power of two).  Returns 0 on success, -1 if allocation failed.
+*/
+int ps_fft_init(PsFFT* fft, int size);
+
+void ps_fft_free(PsFFT* fft);
+
+/** Forward transform of `n` points, `n` a power of two not above fft->size. */
+void ps_fft_forward(const PsFFT* fft, float* re, float* im, int n);
+
+/** Inverse transform of `n` points.  The result is NOT divided by `n`. */
+void ps_fft_inverse(const PsFFT* fft, float* re, float* im, int n);
+
+#endif
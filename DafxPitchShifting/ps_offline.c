@@ -0,0 +1,278 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "ps_offline.h"
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+/** State shared by the workers. */
+typedef struct {
+   const float* const* input;
+   float* const* output;
+   size_t frames;
+   double rate;
+   int    block;          // frames handed to the engine per call, one frame
+   size_t segment;        // PS_OFFLINE_* sizes in samples
+   size_t preroll;
+   int    X;              // overlap
+   int    K;              // search
+   int    head_len;       // frames kept from every segment for the stitch
+   int    channels;
+   int    voices;
+   const PsParams* params;
+   size_t segments;
+   size_t next;           // next segment to render, guarded by `lock`
+   float* heads;          // first head_len frames of every segment
+   int    failed;
+   pthread_mutex_t lock;
+} Job;
+
+/**
+   Render segment s: output frames [a - K, b + X) where a = s*segment and
+   b is the start of the next segment (the first segment starts at 0).  The
+   engine starts `preroll` frames before that and runs until the output
+   reaches b + X.  Frames [a + X, b + X) are written to the output; the
+   first head_len frames, which overlap the previous segment, are kept in
+   `heads` for the stitch.
+*/
+static void
+render_segment(Job* job, PsEngine* ps, size_t s,
+               float* const* in, float* const* out)
+{
+   int c;
+   size_t i, t, n, y, lo, hi;
+   const size_t X = job->X;
+   const size_t HEAD_LEN = job->head_len;
+   const size_t a = s*job->segment;
+   const size_t from = s > 0 ? a - job->K : 0;
+   const size_t end = MIN(a + job->segment + X, job->frames);
+   const size_t start = from > job->preroll ? from - job->preroll : 0;
+   const size_t latency = ps_engine_latency(ps, job->params);
+   float* head = job->heads + s*HEAD_LEN*job->channels;
+
+   ps_engine_reset(ps);
+
+   /* t is the input frame fed next; output frame t - latency comes back */
+   for (t = start; t < end + latency; t += n) {
+      n = MIN((size_t)job->block, end + latency - t);
+      for (c = 0; c < job->channels; c++) {
+         for (i = 0; i < n; i++)
+            in[c][i] = t + i < job->frames ? job->input[c][t + i] : 0;
+      }
+
+      ps_engine_process(ps, (const float* const*)in, out, n, job->params);
+
+      /* Keep the output frames in [from, end) */
+      lo = t >= from + latency ? 0 : MIN(from + latency - t, n);
+      hi = MIN(n, end + latency - t);
+      for (c = 0; c < job->channels; c++) {
+         for (i = lo; i < hi; i++) {
+            y = t + i - latency;
+            if (s > 0 && y < a + X)
+               head[c*HEAD_LEN + y - from] = out[c][i];
+            else
+               job->output[c][y] = out[c][i];
+         }
+      }
+   }
+}
+
+
+static void*
+worker(void* arg)
+{
+   int c;
+   size_t s;
+   Job* job = (Job*)arg;
+   PsEngine ps;
+   const int BLOCK = job->block;
+   float* mem = malloc(2*BLOCK*job->channels*sizeof(float));
+   float* in[PS_MAX_CHANNELS];
+   float* out[PS_MAX_CHANNELS];
+
+   if (mem == NULL ||
+       ps_engine_init(&ps, job->rate, job->channels, job->voices) != 0) {
+      pthread_mutex_lock(&job->lock);
+      job->failed = 1;
+      pthread_mutex_unlock(&job->lock);
+      free(mem);
+      return NULL;
+   }
+   for (c = 0; c < job->channels; c++) {
+      in[c] = mem + 2*c*BLOCK;
+      out[c] = in[c] + BLOCK;
+   }
+
+   for (;;) {
+      pthread_mutex_lock(&job->lock);
+      s = job->next++;
+      pthread_mutex_unlock(&job->lock);
+      if (s >= job->segments)
+         break;
+      render_segment(job, &ps, s, in, out);
+   }
+
+   ps_engine_free(&ps);
+   free(mem);
+   return NULL;
+}
+
+
+/** Sum of squared differences of `len` frames. */
+static double
+distance(const float* u, const float* v, int len)
+{
+   int j;
+   double sum = 0;
+
+   for (j = 0; j < len; j++)
+      sum += (u[j] - v[j])*(u[j] - v[j]);
+
+   return sum;
+}
+
+
+/**
+   Join segment s to the one before it.  The segment is shifted later by the
+   d frames that line its head up best with the end of the previous segment
+   (the search runs on the average of the channels, as in the engine), then
+   the two are crossfaded over X frames.  Segments are stitched in order, so
+   the previous one has already been moved.
+*/
+static void
+stitch(Job* job, PsAlign* align, PsFade* fade, float* u, float* v, size_t s)
+{
+   int c, k;
+   size_t j, d, n;
+   const int C = job->channels;
+   const size_t X = job->X;
+   const size_t K = job->K;
+   const size_t HEAD_LEN = job->head_len;
+   const size_t a = s*job->segment;
+   const size_t end = MIN(a + job->segment + X, job->frames);
+   const size_t len = MIN((size_t)X, job->frames - a);
+   const float* head = job->heads + s*HEAD_LEN*C;
+
+   for (j = 0; j < X; j++) {
+      for (c = 0, u[j] = 0; c < C; c++)
+         u[j] += j < len ? job->output[c][a + j] : 0;
+   }
+   for (j = 0; j < HEAD_LEN; j++) {
+      for (c = 0, v[j] = 0; c < C; c++)
+         v[j] += head[c*HEAD_LEN + j];
+   }
+   k = ps_align_search(align, u, X, v, HEAD_LEN, 0, K + 1);
+
+   /* Segments that have settled on the streaming splices are not moved */
+   if (distance(u, v + K, X) <= 1.1*distance(u, v + k, X))
+      k = K;
+   d = K - k;
+
+   /* Shifted segment: output[y] = rendered[y - d] */
+   n = end > a + X ? end - a - X : 0;
+   for (c = 0; c < C; c++) {
+      float* y = job->output[c] + a + X;
+
+      if (n > d)
+         memmove(y + d, y, (n - d)*sizeof(float));
+      for (j = 0; j < MIN(d, n); j++)
+         y[j] = head[c*HEAD_LEN + HEAD_LEN - d + j];
+   }
+
+   /* The book's linear fade over X frames, t = j/X */
+   ps_fade_weights(fade, PS_FADE_LINEAR, (int)len, (int)X);
+   for (c = 0; c < C; c++)
+      ps_fade_mix(job->output[c] + a, head + c*HEAD_LEN + k, fade->w_out,
+                  fade->w_in, (int)len, 1);
+}
+
+
+int ps_render_offline(const float* const* input, float* const* output,
+                      size_t frames, double rate, int channels, int voices,
+                      const PsParams* params, int threads) {
+   int k, started;
+   const int frame = ps_engine_frame(rate);
+   size_t s;
+   pthread_t* tid;
+   float* scratch;
+   PsAlign align;
+   PsFade fade;
+   Job job;
+
+   if (frames == 0)
+      return 0;
+   if (channels < 1 || channels > PS_MAX_CHANNELS)
+      return -1;
+
+   job.input = input;
+   job.output = output;
+   job.frames = frames;
+   job.rate = rate;
+   job.block = frame;
+   job.segment = (size_t)PS_OFFLINE_SEGMENT*frame;
+   job.preroll = (size_t)PS_OFFLINE_PREROLL*frame;
+   job.X = PS_OFFLINE_OVERLAP*frame;
+   job.K = PS_OFFLINE_SEARCH*frame;
+   job.head_len = job.K + job.X;
+   job.channels = channels;
+   job.voices = voices;
+   job.params = params;
+   job.segments = (frames + job.segment - 1)/job.segment;
+   job.next = 0;
+   job.failed = 0;
+   job.heads = calloc(job.segments*job.head_len*channels, sizeof(float));
+
+   if (threads <= 0)
+      threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+   if (threads <= 0)
+      threads = 1;
+   if ((size_t)threads > job.segments)
+      threads = (int)job.segments;
+   tid = malloc(threads*sizeof(pthread_t));
+   scratch = malloc((job.X + job.head_len)*sizeof(float));
+
+   if (job.heads == NULL || tid == NULL || scratch == NULL ||
+       ps_fade_init(&fade, job.X) != 0) {
+      free(job.heads);
+      free(tid);
+      free(scratch);
+      return -1;
+   }
+   if (ps_align_init(&align, job.X + job.head_len) != 0) {
+      ps_fade_free(&fade);
+      free(job.heads);
+      free(tid);
+      free(scratch);
+      return -1;
+   }
+   pthread_mutex_init(&job.lock, NULL);
+
+   for (started = 0; started < threads; started++)
+      if (pthread_create(&tid[started], NULL, worker, &job) != 0)
+         break;
+   for (k = 0; k < started; k++)
+      pthread_join(tid[k], NULL);
+
+   pthread_mutex_destroy(&job.lock);
+   free(tid);
+
+   if (started == 0 || job.failed) {
+      fprintf(stderr, "PS_OFFLINE: could not start the render engines.\n");
+   }
+   else {
+      for (s = 1; s < job.segments; s++)
+         stitch(&job, &align, &fade, scratch, scratch + job.X, s);
+   }
+
+   ps_align_free(&align);
+   ps_fade_free(&fade);
+   free(scratch);
+   free(job.heads);
+
+   return started == 0 || job.failed ? -1 : 0;
+}
@@ -0,0 +1,49 @@
+#ifndef PS_OFFLINE_H
+#define PS_OFFLINE_H
+
+#include <stddef.h>
+
+#include "ps_engine.h"
+
+/**
+   Sizes of the offline renderer, in frames of the engine
+   (`ps_engine_frame()`).  Segments do not depend on the number of threads,
+   so the rendered file does not either.
+*/
+#define PS_OFFLINE_SEGMENT 128
+
+/**
+   Input rendered before each segment (and thrown away) so that the engine
+   state has settled when the segment starts.  Whole frames, so every
+   segment sees the same frame grid as the streaming path.
+*/
+#define PS_OFFLINE_PREROLL 8
+
+/** Crossfade between the end of a segment and the start of the next one. */
+#define PS_OFFLINE_OVERLAP 1
+
+/**
+   Largest shift applied to a segment to line it up with the previous one.
+   The splice points of the SOLA engine depend on all the previous frames, so
+   a segment started from silence settles on different splices than the
+   streaming path would have and its waveform is offset by up to about a
+   grain.  Like a grain in the TimeScaleSOLA loop, each segment is moved to
+   the best match before it is crossfaded in.
+*/
+#define PS_OFFLINE_SEARCH 1
+
+/**
+   Pitch-shift `frames` frames of the planar channels `input`, sampled at
+   `rate` Hz, into `output` with `threads` threads (0 for one per online core).  The file is cut into
+   segments that are rendered independently, each by an engine of its own,
+   and stitched like the grains of the TimeScaleSOLA loop: aligned with the
+   splice search, then linearly crossfaded.  The output is latency
+   compensated: output[c][t] lines up with input[c][t].
+
+   Returns 0 on success, -1 if allocation or thread creation failed.
+*/
+int ps_render_offline(const float* const* input, float* const* output,
+                      size_t frames, double rate, int channels, int voices,
+                      const PsParams* params, int threads);
+
+#endif
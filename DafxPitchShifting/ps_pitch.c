@@ -0,0 +1,180 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps_pitch.h"
+
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define WIN  PS_PITCH_WIN
+#define LAGS PS_PITCH_LAGS
+
+/** Decimated samples analysed: the window and the lags after it. */
+#define X_LEN (WIN + LAGS - 1)
+
+/** Lags on each side and shortest window of the full-rate refinement. */
+#define REFINE     2
+#define REFINE_WIN 256
+
+int ps_pitch_init(PsPitch* pt, double rate, float updates) {
+   memset(pt, 0, sizeof(PsPitch));
+   pt->rate = rate;
+   pt->dec = MAX(1, (int)(rate/PS_PITCH_DEC_RATE));
+   pt->len = ps_fft_next_pow2(pt->dec*(X_LEN + 2));
+
+   pt->ring = calloc(pt->len, sizeof(float));
+   pt->lin = calloc(pt->len, sizeof(float));
+   pt->x = calloc(X_LEN, sizeof(float));
+   pt->r = calloc(LAGS, sizeof(float));
+   pt->energy = calloc(X_LEN + 1, sizeof(float));
+
+   if (pt->ring == NULL || pt->lin == NULL || pt->x == NULL ||
+       pt->r == NULL || pt->energy == NULL ||
+       ps_align_init(&pt->align, X_LEN) != 0) {
+      ps_pitch_free(pt);
+      return -1;
+   }
+
+   ps_pitch_set_updates(pt, updates);
+   ps_pitch_reset(pt);
+
+   return 0;
+}
+
+void ps_pitch_free(PsPitch* pt) {
+   free(pt->ring);
+   free(pt->lin);
+   free(pt->x);
+   free(pt->r);
+   free(pt->energy);
+   ps_align_free(&pt->align);
+   memset(pt, 0, sizeof(PsPitch));
+}
+
+void ps_pitch_reset(PsPitch* pt) {
+   memset(pt->ring, 0, pt->len*sizeof(float));
+   pt->pos = 0;
+   pt->fill = 0;
+   pt->freq = 0;
+   pt->confidence = 0;
+}
+
+void ps_pitch_set_updates(PsPitch* pt, float updates) {
+   updates = MAX(1, MIN(updates, 1000));
+   pt->hop = MAX(1, (int)lround(pt->rate/updates));
+}
+
+/** Sum of (x[j] - x[j + lag])^2 over the last `len` samples of `lin`. */
+static float
+difference(const float* lin, int end, int len, int lag) {
+   int j;
+   float d, sum = 0;
+
+   for (j = end - len; j < end; j++) {
+      d = lin[j - lag] - lin[j];
+      sum += d*d;
+   }
+   return sum;
+}
+
+/** Parabolic offset of the minimum of (a, b, c) from b. */
+static float
+vertex(float a, float b, float c) {
+   return (a - 2*b + c > 0) ? 0.5f*(a - c)/(a - 2*b + c) : 0;
+}
+
+static void
+estimate(PsPitch* pt) {
+   int i, j, k, tau, lo, lag, len;
+   float x, sum, lag_f, d[2*REFINE + 3];
+   const int dec = pt->dec;
+   const int n = dec*X_LEN;
+   const int mask = pt->len - 1;
+   float* const r = pt->r;
+   float* const e = pt->energy;
+
+   /* Oldest sample first, the window at the start */
+   for (i = 0; i < pt->len; i++)
+      pt->lin[i] = pt->ring[(pt->pos + i) & mask];
+
+   for (j = 0, e[0] = 0; j < X_LEN; j++) {
+      const float* s = pt->lin + pt->len - n + j*dec;
+
+      for (k = 0, x = 0; k < dec; k++)
+         x += s[k];
+      pt->x[j] = x/dec;
+      e[j + 1] = e[j] + pt->x[j]*pt->x[j];
+   }
+   if (e[WIN] < 1e-8f*WIN) {
+      pt->freq = 0;
+      pt->confidence = 0;
+      return;
+   }
+
+   ps_align_correlate(&pt->align, pt->x, WIN, pt->x, X_LEN, r, LAGS);
+
+   /* d(tau), then d'(tau) = d(tau) tau / sum_{k<=tau} d(k), in place */
+   r[0] = 1;
+   for (tau = 1, sum = 0; tau < LAGS; tau++) {
+      x = e[WIN] + e[tau + WIN] - e[tau] - 2*r[tau];
+      x = MAX(x, 0);
+      sum += x;
+      r[tau] = (sum > 0) ? x*tau/sum : 1;
+   }
+
+   lo = MAX(2, (int)(pt->rate/dec/PS_PITCH_FMAX));
+   for (tau = lo; tau < LAGS - 1; tau++)
+      if (r[tau] < PS_PITCH_THRESHOLD)
+         break;
+   if (tau < LAGS - 1) {
+      while (tau + 2 < LAGS && r[tau + 1] < r[tau])
+         tau++;
+   }
+   else {
+      for (tau = k = lo; k < LAGS - 1; k++)
+         if (r[k] < r[tau])
+            tau = k;
+   }
+   pt->confidence = MAX(0, MIN(1 - r[tau], 1));
+   lag_f = dec*(tau + vertex(r[tau - 1], r[tau], r[tau + 1]));
+
+   /*
+      Full-rate refinement: the decimated vertex is within a couple of
+      samples, so five lags are compared over two periods (at least
+      REFINE_WIN and at most the decimated window).
+   */
+   if (dec > 1) {
+      lag = (int)lroundf(lag_f);
+      lag = MAX(REFINE + 1, MIN(lag, dec*(LAGS - 1) - REFINE - 1));
+      len = MIN(dec*WIN, MAX(2*lag, REFINE_WIN));
+      for (k = 0; k < 2*REFINE + 3; k++)
+         d[k] = difference(pt->lin, pt->len, len, lag - REFINE - 1 + k);
+      for (k = 1, j = 1; k < 2*REFINE + 2; k++)
+         if (d[k] < d[j])
+            j = k;
+      lag_f = lag - REFINE - 1 + j + vertex(d[j - 1], d[j], d[j + 1]);
+   }
+
+   pt->freq = pt->rate/lag_f;
+}
+
+void ps_pitch_process(PsPitch* pt, const float* in, int n) {
+   int i;
+   const int mask = pt->len - 1;
+
+   for (i = 0; i < n; i++) {
+      pt->ring[pt->pos] = in[i];
+      pt->pos = (pt->pos + 1) & mask;
+      if (++pt->fill >= pt->hop) {
+         estimate(pt);
+         pt->fill = 0;
+      }
+   }
+}
+
+float ps_pitch_semitone(float freq) {
+   if (freq <= 0)
+      return freq;
+   return 440*powf(2, roundf(12*log2f(freq/440))/12);
+}
@@ -0,0 +1,69 @@
+#ifndef PS_PITCH_H
+#define PS_PITCH_H
+
+#include "ps_align.h"
+
+/**
+   YIN pitch tracker.
+
+   Every `hop` samples the recent input is decimated to about
+   PS_PITCH_DEC_RATE Hz (box averages of `dec` samples) and the YIN
+   difference function of a PS_PITCH_WIN-sample window is computed over
+   PS_PITCH_LAGS lags:
+
+      d(tau) = sum_j (x[j] - x[j + tau])^2 = E(0) + E(tau) - 2 r(tau)
+
+   The energies E come from a running sum of x^2 and the autocorrelation
+   r from one FFT cross-correlation (`ps_align_correlate()`), instead of the
+   O(WIN * LAGS) direct sum.  The first dip of the cumulative-mean-normalized
+   d under PS_PITCH_THRESHOLD (else the deepest one) gives the period, which
+   is then refined on the full-rate input over +-dec lags and by a parabola.
+
+   The confidence is 1 - d'(tau): near 1 on clean periodic input, low on
+   noise and chords.  Frequencies from rate / (dec * PS_PITCH_LAGS) (about
+   45 Hz) to PS_PITCH_FMAX are tracked.
+*/
+#define PS_PITCH_DEC_RATE  11025
+#define PS_PITCH_WIN       256
+#define PS_PITCH_LAGS      256
+#define PS_PITCH_FMAX      1500
+#define PS_PITCH_THRESHOLD 0.15f
+
+typedef struct {
+   double rate;          // sample rate
+   int    dec;           // decimation factor
+   int    hop;           // samples between estimates
+   int    fill;          // samples since the last estimate
+   int    len;           // input history, power of two
+   int    pos;           // next write position in `ring`
+   float* ring;          // last `len` input samples
+   float* lin;           // the history in order
+   float* x;             // decimated window + lags
+   float* r;             // autocorrelation, then normalized difference
+   float* energy;        // running sum of x^2
+   PsAlign align;
+   float  freq;          // last estimate, Hz (0 on silence)
+   float  confidence;    // 0 to 1
+} PsPitch;
+
+/**
+   Allocate a tracker for input at `rate` Hz making `updates` estimates per
+   second.  Returns 0 on success, -1 if allocation failed.
+*/
+int ps_pitch_init(PsPitch* pt, double rate, float updates);
+
+void ps_pitch_free(PsPitch* pt);
+
+/** Clear the history and the last estimate. */
+void ps_pitch_reset(PsPitch* pt);
+
+/** Make `updates` estimates per second (1 to 1000). */
+void ps_pitch_set_updates(PsPitch* pt, float updates);
+
+/** Feed `n` samples; pt->freq and pt->confidence follow the input. */
+void ps_pitch_process(PsPitch* pt, const float* in, int n);
+
+/** Nearest equal-tempered semitone of `freq` (A4 = 440 Hz). */
+float ps_pitch_semitone(float freq);
+
+#endif
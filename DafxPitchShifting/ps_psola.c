@@ -0,0 +1,384 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps_psola.h"
+
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+#define PMIN     PS_PSOLA_PMIN
+#define PMAX     PS_PSOLA_PMAX
+#define UNVOICED PS_PSOLA_UNVOICED
+#define BUF      PS_PSOLA_BUF
+#define MASK     (BUF - 1)
+#define MARKS    PS_PSOLA_MARKS
+
+/** Longest correlation window of the mark search. */
+#define WIN_MAX  256
+
+/** Largest lag of the mark search around one period. */
+#define REACH(p) MAX(2, (p)/16)
+
+/** Decimation, window and lags of the full period search. */
+#define DEC      4
+#define DEC_WIN  (PMAX/DEC)
+#define DEC_LEN  (2*PMAX/DEC)
+
+/** Correlation a tracked mark needs, threshold of the full search. */
+#define TRACK_MIN  0.5f
+#define SEARCH_DIP 0.2f
+#define SEARCH_MAX 0.35f
+
+/**
+   Delay between input and output.  A grain is placed PMAX samples before
+   its synthesis mark is played and needs the marks up to half a period after
+   it, and the last mark lags the input by up to a period, a search reach and
+   half a window.
+*/
+#define LATENCY  (PMAX + PMAX/2 + PMAX + REACH(PMAX) + WIN_MAX/2)
+
+/** Signed distance from b to a on the wrapping sample clock. */
+#define DIFF(a, b) ((int32_t)((uint32_t)(a) - (uint32_t)(b)))
+
+int ps_psola_init(PsPsola* ps, int channels, int voices) {
+   memset(ps, 0, sizeof(PsPsola));
+   ps->channels = channels;
+   ps->voices = MIN(voices, PS_PSOLA_MAX_VOICES);
+   ps->latency = LATENCY;
+
+   ps->in = calloc(BUF*channels, sizeof(float));
+   ps->mix = (channels > 1) ? calloc(BUF, sizeof(float)) : ps->in;
+   ps->acc = calloc(BUF*channels*ps->voices, sizeof(float));
+   ps->norm = calloc(BUF*ps->voices, sizeof(float));
+   ps->ref = calloc(WIN_MAX, sizeof(float));
+   ps->span = calloc(WIN_MAX + 2*REACH(PMAX) + 1, sizeof(float));
+   ps->dec = calloc(DEC_LEN, sizeof(float));
+   ps->diff = calloc(DEC_WIN + 1, sizeof(float));
+
+   if (ps->in == NULL || ps->mix == NULL || ps->acc == NULL ||
+       ps->norm == NULL || ps->ref == NULL || ps->span == NULL ||
+       ps->dec == NULL || ps->diff == NULL ||
+       ps_fade_init(&ps->fade, PMAX) != 0) {
+      ps_psola_free(ps);
+      return -1;
+   }
+
+   ps_psola_reset(ps);
+
+   return 0;
+}
+
+void ps_psola_free(PsPsola* ps) {
+   if (ps->mix != ps->in)
+      free(ps->mix);
+   free(ps->in);
+   free(ps->acc);
+   free(ps->norm);
+   free(ps->ref);
+   free(ps->span);
+   free(ps->dec);
+   free(ps->diff);
+   ps_fade_free(&ps->fade);
+   memset(ps, 0, sizeof(PsPsola));
+}
+
+void ps_psola_reset(PsPsola* ps) {
+   int v;
+
+   memset(ps->in, 0, BUF*ps->channels*sizeof(float));
+   if (ps->mix != ps->in)
+      memset(ps->mix, 0, BUF*sizeof(float));
+   memset(ps->acc, 0, BUF*ps->channels*ps->voices*sizeof(float));
+   memset(ps->norm, 0, BUF*ps->voices*sizeof(float));
+
+   /*
+      The clock starts `latency` samples before the first output, on an
+      unvoiced mark; the first grains are placed PMAX samples ahead.
+   */
+   ps->t = 0;
+   ps->head = 0;
+   ps->mark[0].pos = (uint32_t)-ps->latency;
+   ps->mark[0].period = 0;
+   ps->period = 0;
+   ps->voiced = 0;
+   ps->next_search = 2*PMAX;
+   for (v = 0; v < PS_PSOLA_MAX_VOICES; v++) {
+      ps->syn[v] = (uint32_t)(PMAX - ps->latency);
+      ps->syn_frac[v] = 0;
+      ps->near[v] = 0;
+   }
+}
+
+int ps_psola_latency(const PsPsola* ps) {
+   return ps->latency;
+}
+
+static void
+push_mark(PsPsola* ps, uint32_t pos, int period) {
+   ps->head++;
+   ps->mark[ps->head & (MARKS - 1)].pos = pos;
+   ps->mark[ps->head & (MARKS - 1)].period = period;
+}
+
+/**
+   The shortest period among tau / 4, tau / 3 and tau / 2 whose dip in
+   `diff` is under SEARCH_MAX too, or tau.  A window that spans a note
+   change can make a multiple of the new period the deepest dip, and the
+   tracker would then keep the octave error until the note ends.
+*/
+static int
+submultiple(const float* diff, int tau, int lo) {
+   int k, j, c, best;
+
+   for (k = 4; k >= 2; k--) {
+      c = (tau + k/2)/k;
+      if (c - 2 < lo)
+         continue;
+      for (j = c - 2, best = c; j <= c + 2; j++)
+         if (diff[j] < diff[best])
+            best = j;
+      if (diff[best] < SEARCH_MAX)
+         return best;
+   }
+   return tau;
+}
+
+/**
+   Period of the last 2 * PMAX input samples, or 0 if they are not voiced.
+   The cumulative-mean-normalized difference function is computed on a copy
+   decimated by DEC.  The first dip under SEARCH_DIP (or else the deepest
+   one, if it is under SEARCH_MAX), or its shortest submultiple under
+   SEARCH_MAX, is refined by a parabola.
+*/
+static int
+search_period(PsPsola* ps) {
+   int j, k, tau, lo;
+   float x, d, sum, energy, a, b, c, shift;
+   const uint32_t start = ps->t - 2*PMAX;
+
+   for (j = 0, energy = 0; j < DEC_LEN; j++) {
+      for (k = 0, x = 0; k < DEC; k++)
+         x += ps->mix[(start + DEC*j + k) & MASK];
+      ps->dec[j] = x/DEC;
+      energy += ps->dec[j]*ps->dec[j];
+   }
+   if (energy < 1e-8f*DEC_LEN)
+      return 0;
+
+   ps->diff[0] = 1;
+   for (tau = 1, sum = 0; tau <= DEC_WIN; tau++) {
+      for (j = 0, d = 0; j < DEC_WIN; j++) {
+         x = ps->dec[j] - ps->dec[j + tau];
+         d += x*x;
+      }
+      sum += d;
+      ps->diff[tau] = (sum > 0) ? d*tau/sum : 1;
+   }
+
+   lo = PMIN/DEC;
+   for (tau = lo; tau < DEC_WIN; tau++)
+      if (ps->diff[tau] < SEARCH_DIP)
+         break;
+   if (tau < DEC_WIN) {
+      while (tau + 1 < DEC_WIN && ps->diff[tau + 1] < ps->diff[tau])
+         tau++;
+   }
+   else {
+      for (tau = k = lo; k < DEC_WIN; k++)
+         if (ps->diff[k] < ps->diff[tau])
+            tau = k;
+      if (ps->diff[tau] > SEARCH_MAX)
+         return 0;
+   }
+   tau = submultiple(ps->diff, tau, lo);
+
+   a = ps->diff[tau - 1];
+   b = ps->diff[tau];
+   c = ps->diff[tau + 1];
+   shift = (a - 2*b + c > 0) ? 0.5f*(a - c)/(a - 2*b + c) : 0;
+
+   return MAX(PMIN, MIN((int)lroundf(DEC*(tau + shift)), PMAX));
+}
+
+/**
+   Look for the mark one period after the last one: the window around the
+   last mark is correlated with the input over +-REACH(period) lags.  Returns
+   0 and pushes the mark if the best normalized correlation reaches
+   TRACK_MIN, -1 otherwise.
+*/
+static int
+track_mark(PsPsola* ps) {
+   int i, k, best;
+   float num, e_ref, e_span, ncc, max;
+   const uint32_t last = ps->mark[ps->head & (MARKS - 1)].pos;
+   const int p = ps->period;
+   const int reach = REACH(p);
+   const int half = MIN(p, WIN_MAX)/2;
+   const int span_len = 2*half + 2*reach;
+   const uint32_t span_start = last + p - reach - half;
+
+   for (i = 0, e_ref = 0; i < 2*half; i++) {
+      ps->ref[i] = ps->mix[(last - half + i) & MASK];
+      e_ref += ps->ref[i]*ps->ref[i];
+   }
+   if (e_ref < 1e-9f*2*half)
+      return -1;
+
+   for (i = 0; i <= span_len; i++)
+      ps->span[i] = ps->mix[(span_start + i) & MASK];
+   for (i = 0, e_span = 0; i < 2*half; i++)
+      e_span += ps->span[i]*ps->span[i];
+
+   for (k = 0, best = 0, max = -1; k <= 2*reach; k++) {
+      for (i = 0, num = 0; i < 2*half; i++)
+         num += ps->ref[i]*ps->span[k + i];
+      ncc = num/sqrtf(e_ref*e_span + 1e-20f);
+      if (ncc > max) {
+         max = ncc;
+         best = k;
+      }
+      e_span += ps->span[k + 2*half]*ps->span[k + 2*half] -
+                ps->span[k]*ps->span[k];
+   }
+   if (max < TRACK_MIN)
+      return -1;
+
+   ps->period = MAX(PMIN, MIN(p - reach + best, PMAX));
+   push_mark(ps, last + p - reach + best, ps->period);
+
+   return 0;
+}
+
+/** Place every mark the input written so far allows. */
+static void
+analyse(PsPsola* ps) {
+   int p;
+   uint32_t last;
+
+   for (;;) {
+      last = ps->mark[ps->head & (MARKS - 1)].pos;
+
+      if (ps->voiced) {
+         p = ps->period;
+         if (DIFF(ps->t, last + p + REACH(p) + MIN(p, WIN_MAX)/2) <= 0)
+            break;
+         if (track_mark(ps) == 0)
+            continue;
+         ps->voiced = 0;
+         ps->next_search = ps->t;
+      }
+
+      if (DIFF(ps->t, last + UNVOICED) < 0)
+         break;
+      if (DIFF(ps->t, ps->next_search) >= 0) {
+         ps->next_search = ps->t + PMAX/2;
+         p = search_period(ps);
+         if (p > 0) {
+            ps->voiced = 1;
+            ps->period = p;
+            push_mark(ps, last + MIN(p, UNVOICED), p);
+            continue;
+         }
+      }
+      push_mark(ps, last + UNVOICED, 0);
+   }
+}
+
+/**
+   Overlap-add the grain of the next synthesis mark of voice `v`, taken
+   around the nearest pitch mark, and move to the following synthesis mark.
+*/
+static void
+place_grain(PsPsola* ps, int v, float alpha, int audible) {
+   int j, c, k, len, period;
+   float step, f;
+   const float* w_in;
+   const float* w_out;
+   uint32_t a, s = ps->syn[v];
+   const int C = ps->channels;
+
+   k = MAX(ps->near[v], ps->head - MARKS + 2);
+   while (k < ps->head &&
+          abs(DIFF(ps->mark[(k + 1) & (MARKS - 1)].pos, s)) <=
+          abs(DIFF(ps->mark[k & (MARKS - 1)].pos, s)))
+      k++;
+   ps->near[v] = k;
+   a = ps->mark[k & (MARKS - 1)].pos;
+   period = ps->mark[k & (MARKS - 1)].period;
+
+   if (period > 0) {
+      step = period/alpha;
+      len = MIN(MAX(period, (int)step), PMAX);
+   }
+   else {
+      step = UNVOICED;
+      len = UNVOICED;
+   }
+
+   if (audible) {
+      ps_fade_weights(&ps->fade, PS_FADE_HANN, len, len);
+      w_in = ps->fade.w_in;
+      w_out = ps->fade.w_out;
+
+      for (c = 0; c < C; c++) {
+         const float* x = ps->in + c*BUF;
+         float* y = ps->acc + (v*C + c)*BUF;
+
+         for (j = 0; j < len; j++) {
+            y[(s - len + j) & MASK] += w_in[j]*x[(a - len + j) & MASK];
+            y[(s + j) & MASK] += w_out[j]*x[(a + j) & MASK];
+         }
+      }
+      for (j = 0; j < len; j++) {
+         ps->norm[v*BUF + ((s - len + j) & MASK)] += w_in[j];
+         ps->norm[v*BUF + ((s + j) & MASK)] += w_out[j];
+      }
+   }
+
+   f = ps->syn_frac[v] + step;
+   ps->syn[v] = s + (int)f;
+   ps->syn_frac[v] = f - (int)f;
+}
+
+void ps_psola_process(PsPsola* ps, const float* const* in, float* const* out,
+                      int n, const float* alpha, const float* gain,
+                      int voices, float dry) {
+   int i, v, c, idx;
+   float x, w;
+   uint32_t o;
+   const int C = ps->channels;
+
+   voices = MIN(voices, ps->voices);
+
+   for (i = 0; i < n; i++) {
+      idx = ps->t & MASK;
+      for (c = 0, x = 0; c < C; c++) {
+         ps->in[c*BUF + idx] = in[c][i];
+         x += in[c][i];
+      }
+      if (ps->mix != ps->in)
+         ps->mix[idx] = x/C;
+      ps->t++;
+
+      analyse(ps);
+
+      /* Sample played now, and grains that must be placed before it */
+      o = ps->t - 1 - ps->latency;
+      for (v = 0; v < voices; v++)
+         while (DIFF(ps->syn[v], o) <= PMAX)
+            place_grain(ps, v, alpha[v], gain[v] != 0);
+
+      idx = o & MASK;
+      for (c = 0; c < C; c++)
+         out[c][i] = dry*ps->in[c*BUF + idx];
+      for (v = 0; v < voices; v++) {
+         w = gain[v]/MAX(ps->norm[v*BUF + idx], 1.0f);
+         for (c = 0; c < C; c++) {
+            out[c][i] += w*ps->acc[(v*C + c)*BUF + idx];
+            ps->acc[(v*C + c)*BUF + idx] = 0;
+         }
+         ps->norm[v*BUF + idx] = 0;
+      }
+   }
+}
@@ -0,0 +1,99 @@
+#ifndef PS_PSOLA_H
+#define PS_PSOLA_H
+
+#include <stdint.h>
+
+#include "ps_fade.h"
+
+/**
+   Pitch-synchronous overlap-add (PSOLA) pitch shifter for monophonic
+   sources such as voice and bass.
+
+   Pitch marks are placed one period apart on the input.  Each mark is found
+   from the previous one by a local search: a window around the last mark is
+   correlated with the input one period later, over +-period/16 lags, and the
+   best lag gives both the new mark and the new period.  The period estimate
+   therefore carries over from block to block and a mark costs
+   O(window * period / 8).  Only when the correlation drops (onsets, pitch
+   jumps, unvoiced sounds) is the period searched from scratch, with a
+   difference function on a 4:1 decimated copy of the input; while the input
+   stays unvoiced that search is retried every PS_PSOLA_PMAX / 2 samples and
+   marks are placed PS_PSOLA_UNVOICED samples apart.
+
+   The output is built from Hann grains of about two periods, taken around
+   the mark nearest to each synthesis mark and overlap-added period / alpha
+   apart, or PS_PSOLA_UNVOICED apart (unshifted) on unvoiced marks.  The sum
+   of the windows is accumulated with the grains and divides the output
+   where grains pile up.
+
+   Sizes are in samples and cover periods of PS_PSOLA_PMIN to PS_PSOLA_PMAX
+   (47 Hz to 1.5 kHz at 48 kHz).  Grains are at most PS_PSOLA_PMAX long on
+   each side of their mark, so shifting a low note far down leaves gaps
+   between them.  Channels share the marks, which are searched on their
+   average.
+*/
+#define PS_PSOLA_PMIN       32
+#define PS_PSOLA_PMAX       1024
+#define PS_PSOLA_UNVOICED   256
+#define PS_PSOLA_BUF        8192   // power of two, longer than the latency
+#define PS_PSOLA_MARKS      256    // power of two
+#define PS_PSOLA_MAX_VOICES 4
+
+/** A pitch mark and the period measured there (0 when unvoiced). */
+typedef struct {
+   uint32_t pos;
+   int      period;
+} PsMark;
+
+typedef struct {
+   int      channels;
+   int      voices;
+   uint32_t t;            // input samples written
+   int      latency;      // delay between input and output
+   float*   in;           // input ring, PS_PSOLA_BUF per channel
+   float*   mix;          // average of the channels (`in` when mono)
+   float*   acc;          // overlap-add ring, PS_PSOLA_BUF per voice and channel
+   float*   norm;         // sum of the windows, PS_PSOLA_BUF per voice
+   float*   ref;          // search scratch
+   float*   span;
+   float*   dec;
+   float*   diff;
+   PsFade   fade;         // Hann grain weights
+   PsMark   mark[PS_PSOLA_MARKS];
+   int      head;         // index of the last mark
+   int      period;       // period being tracked
+   int      voiced;
+   uint32_t next_search;  // earliest full search while unvoiced
+   uint32_t syn[PS_PSOLA_MAX_VOICES];      // next synthesis mark of each voice
+   float    syn_frac[PS_PSOLA_MAX_VOICES];
+   int      near[PS_PSOLA_MAX_VOICES];     // mark used by the last grain
+} PsPsola;
+
+/**
+   Allocate a shifter for `channels` planar channels and up to `voices`
+   voices.  Returns 0 on success, -1 if allocation failed.
+*/
+int ps_psola_init(PsPsola* ps, int channels, int voices);
+
+void ps_psola_free(PsPsola* ps);
+
+/** Clear the rings and forget the pitch. */
+void ps_psola_reset(PsPsola* ps);
+
+/**
+   Delay between input and output, in samples.  Grains are taken from the
+   nearest mark, so at alpha = 1 the output may be up to half a period away
+   from it.
+*/
+int ps_psola_latency(const PsPsola* ps);
+
+/**
+   Write to `out` the sum of `voices` copies of `in` shifted by alpha[v] and
+   scaled by gain[v], plus `dry` times `in` delayed by the latency.  `in` and
+   `out` hold `channels` planar channels and may be the same buffers.
+*/
+void ps_psola_process(PsPsola* ps, const float* const* in, float* const* out,
+                      int n, const float* alpha, const float* gain,
+                      int voices, float dry);
+
+#endif
@@ -0,0 +1,229 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "ps_pvoc.h"
+
+#define PI 3.14159265358979323846
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+int ps_pvoc_init(PsPvoc* pv, int size, int hop, int voices) {
+   int k, v, bins = size/2 + 1;
+
+   pv->size = size;
+   pv->hop = hop;
+   pv->voices = MIN(voices, PS_PVOC_MAX_VOICES);
+   pv->window = malloc(size * sizeof(float));
+   pv->expected = malloc(bins * sizeof(float));
+   pv->in_fifo = malloc(size * sizeof(float));
+   pv->out_fifo = malloc(hop * sizeof(float));
+   pv->dry_fifo = malloc(hop * sizeof(float));
+   pv->accum = malloc(size * sizeof(float));
+   pv->re = malloc(size * sizeof(float));
+   pv->im = malloc(size * sizeof(float));
+   pv->last_phase = malloc(bins * sizeof(float));
+   for (v = 0; v < PS_PVOC_MAX_VOICES; v++)
+      pv->sum_phase[v] = (v < pv->voices) ? malloc(bins * sizeof(float)) : NULL;
+   pv->ana_mag = malloc(bins * sizeof(float));
+   pv->ana_freq = malloc(bins * sizeof(float));
+   pv->syn_mag = malloc(bins * sizeof(float));
+   pv->syn_freq = malloc(bins * sizeof(float));
+
+   if (ps_fft_init(&pv->fft, size) != 0 ||
+       pv->window == NULL || pv->expected == NULL || pv->in_fifo == NULL ||
+       pv->out_fifo == NULL || pv->dry_fifo == NULL || pv->accum == NULL ||
+       pv->re == NULL || pv->im == NULL || pv->last_phase == NULL ||
+       pv->ana_mag == NULL || pv->ana_freq == NULL || pv->syn_mag == NULL ||
+       pv->syn_freq == NULL) {
+      ps_pvoc_free(pv);
+      return -1;
+   }
+   for (v = 0; v < pv->voices; v++) {
+      if (pv->sum_phase[v] == NULL) {
+         ps_pvoc_free(pv);
+         return -1;
+      }
+   }
+
+   for (k = 0; k < size; k++)
+      pv->window[k] = 0.5 - 0.5*cos(2*PI*k/size);
+
+   for (k = 0; k < bins; k++)
+      pv->expected[k] = 2*PI*k*hop/(float)size;
+
+   ps_pvoc_reset(pv);
+
+   return 0;
+}
+
+
+void ps_pvoc_free(PsPvoc* pv) {
+   int v;
+
+   ps_fft_free(&pv->fft);
+   for (v = 0; v < PS_PVOC_MAX_VOICES; v++)
+      free(pv->sum_phase[v]);
+   free(pv->window);
+   free(pv->expected);
+   free(pv->in_fifo);
+   free(pv->out_fifo);
+   free(pv->dry_fifo);
+   free(pv->accum);
+   free(pv->re);
+   free(pv->im);
+   free(pv->last_phase);
+   free(pv->ana_mag);
+   free(pv->ana_freq);
+   free(pv->syn_mag);
+   free(pv->syn_freq);
+}
+
+
+void ps_pvoc_reset(PsPvoc* pv) {
+   int k, v;
+
+   for (k = 0; k < pv->size; k++) {
+      pv->in_fifo[k] = 0;
+      pv->accum[k] = 0;
+   }
+   for (k = 0; k < pv->hop; k++) {
+      pv->out_fifo[k] = 0;
+      pv->dry_fifo[k] = 0;
+   }
+   for (k = 0; k <= pv->size/2; k++)
+      pv->last_phase[k] = 0;
+   for (v = 0; v < pv->voices; v++)
+      for (k = 0; k <= pv->size/2; k++)
+         pv->sum_phase[v][k] = 0;
+   pv->fill = 0;
+}
+
+
+int ps_pvoc_latency(const PsPvoc* pv) {
+   return pv->size;
+}
+
+
+/** Wrap a phase to [-pi, pi). */
+static float
+wrap(float phase) {
+   return phase - 2*PI*floorf((phase + PI)/(2*PI));
+}
+
+
+/**
+   Analyse in_fifo, move the bins of every voice, sum the voices and
+   overlap-add one frame.
+*/
+static void
+process_frame(PsPvoc* pv, const float* alpha, const float* gain, int voices) {
+   int k, v, index;
+   const int size = pv->size, bins = size/2 + 1;
+   const float osamp = size/(float)pv->hop;
+   /* Hann^2 windows overlapped every size/osamp samples add up to 3*osamp/8 */
+   const float norm = 1.0/(size * 3*osamp/8);
+   float* const re = pv->re;
+   float* const im = pv->im;
+   float* sum_phase;
+   float mag, phase, delta;
+
+   for (k = 0; k < size; k++) {
+      re[k] = pv->in_fifo[k] * pv->window[k];
+      im[k] = 0;
+   }
+   ps_fft_forward(&pv->fft, re, im, size);
+
+   /* Analysis: magnitude and true frequency of every bin, shared by voices */
+   for (k = 0; k < bins; k++) {
+      mag = sqrtf(re[k]*re[k] + im[k]*im[k]);
+      phase = atan2f(im[k], re[k]);
+
+      delta = wrap(phase - pv->last_phase[k] - pv->expected[k]);
+      pv->last_phase[k] = phase;
+
+      pv->ana_mag[k] = mag;
+      pv->ana_freq[k] = k + delta*osamp/(2*PI);
+      re[k] = 0;
+      im[k] = 0;
+   }
+
+   for (v = 0; v < voices; v++) {
+      if (gain[v] == 0)
+         continue;
+      sum_phase = pv->sum_phase[v];
+
+      /* Shift */
+      for (k = 0; k < bins; k++) {
+         pv->syn_mag[k] = 0;
+         pv->syn_freq[k] = 0;
+      }
+      for (k = 0; k < bins; k++) {
+         index = (int)(k*alpha[v] + 0.5);
+         if (index >= bins)
+            break;
+         pv->syn_mag[index] += pv->ana_mag[k];
+         pv->syn_freq[index] = pv->ana_freq[k] * alpha[v];
+      }
+
+      /* Synthesis: propagate the phases and add the voice to the spectrum */
+      for (k = 0; k < bins; k++) {
+         sum_phase[k] = wrap(sum_phase[k] + 2*PI*pv->syn_freq[k]/osamp);
+         if (pv->syn_mag[k] == 0)
+            continue;
+         mag = gain[v] * pv->syn_mag[k];
+         re[k] += mag * cosf(sum_phase[k]);
+         im[k] += mag * sinf(sum_phase[k]);
+      }
+   }
+
+   /* Rebuild a Hermitian spectrum */
+   im[0] = 0;
+   im[bins - 1] = 0;
+   for (k = bins; k < size; k++) {
+      re[k] = re[size - k];
+      im[k] = -im[size - k];
+   }
+   ps_fft_inverse(&pv->fft, re, im, size);
+
+   for (k = 0; k < size; k++)
+      pv->accum[k] += re[k] * pv->window[k] * norm;
+
+   /* The first hop is finished; shift the accumulator and the input */
+   for (k = 0; k < pv->hop; k++) {
+      pv->out_fifo[k] = pv->accum[k];
+      pv->dry_fifo[k] = pv->in_fifo[k];
+   }
+   for (k = 0; k < size - pv->hop; k++) {
+      pv->accum[k] = pv->accum[k + pv->hop];
+      pv->in_fifo[k] = pv->in_fifo[k + pv->hop];
+   }
+   for (; k < size; k++)
+      pv->accum[k] = 0;
+}
+
+
+void ps_pvoc_process(PsPvoc* pv, const float* in, float* out, int n,
+                     float alpha) {
+   const float gain = 1.0;
+
+   ps_pvoc_process_voices(pv, in, out, n, &alpha, &gain, 1, 0.0);
+}
+
+
+void ps_pvoc_process_voices(PsPvoc* pv, const float* in, float* out, int n,
+                            const float* alpha, const float* gain, int voices,
+                            float dry) {
+   int i;
+   const int offset = pv->size - pv->hop;
+
+   voices = MIN(voices, pv->voices);
+
+   for (i = 0; i < n; i++) {
+      pv->in_fifo[offset + pv->fill] = in[i];
+      out[i] = pv->out_fifo[pv->fill] + dry * pv->dry_fifo[pv->fill];
+
+      if (++pv->fill == pv->hop) {
+         process_frame(pv, alpha, gain, voices);
+         pv->fill = 0;
+      }
+   }
+}
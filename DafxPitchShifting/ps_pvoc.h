@@ -0,0 +1,77 @@
+#ifndef PS_PVOC_H
+#define PS_PVOC_H
+
+#include "ps_fft.h"
+
+/**
+   Phase-vocoder pitch shifter.
+
+   Every `hop` samples the last `size` input samples are windowed and
+   transformed.  The true frequency of each bin is estimated from its phase
+   advance since the previous frame, the bins are moved to k * alpha with
+   their frequency scaled by alpha, and the synthesis phases are propagated
+   from those frequencies before the inverse transform and the overlap-add.
+
+   Several voices can be produced from the same input.  The analysis does not
+   depend on alpha, so it is done once per frame; each voice only moves the
+   bins and propagates its own synthesis phases, and the voices are summed in
+   the frequency domain so a single inverse transform and overlap-add serves
+   all of them.
+
+   The window, the FFT twiddles and the expected phase advance of every bin
+   are tabulated by `ps_pvoc_init()`, and every buffer lives in this struct, so
+   `ps_pvoc_process()` does not allocate.
+*/
+#define PS_PVOC_MAX_VOICES 4
+
+typedef struct {
+   int    size;        // frame length (power of two)
+   int    hop;         // analysis and synthesis hop
+   int    fill;        // samples queued since the last frame
+   int    voices;      // voices allocated
+   PsFFT  fft;
+   float* window;      // Hann window, size
+   float* expected;    // expected phase advance of bin k over one hop
+   float* in_fifo;     // last `size` input samples
+   float* out_fifo;    // `hop` finished output samples
+   float* dry_fifo;    // `hop` input samples delayed by the latency
+   float* accum;       // overlap-add accumulator, size
+   float* re;          // FFT buffers, size
+   float* im;
+   float* last_phase;  // analysis phase of the previous frame, size/2 + 1
+   float* sum_phase[PS_PVOC_MAX_VOICES]; // running synthesis phase per voice
+   float* ana_mag;     // analysis magnitude and true frequency (in bins)
+   float* ana_freq;
+   float* syn_mag;     // synthesis magnitude and frequency (in bins)
+   float* syn_freq;
+} PsPvoc;
+
+/**
+   Allocate a vocoder with frames of `size` samples (a power of two), a hop of
+   `hop` samples (size/4 or smaller) and up to `voices` voices.  Returns 0 on
+   success, -1 if allocation failed.
+*/
+int ps_pvoc_init(PsPvoc* pv, int size, int hop, int voices);
+
+void ps_pvoc_free(PsPvoc* pv);
+
+/** Clear the queues and the phase memory. */
+void ps_pvoc_reset(PsPvoc* pv);
+
+/** Delay between input and output, in samples: one frame. */
+int ps_pvoc_latency(const PsPvoc* pv);
+
+/** Shift `n` samples from `in` into `out` by the ratio `alpha`. */
+void ps_pvoc_process(PsPvoc* pv, const float* in, float* out, int n,
+                     float alpha);
+
+/**
+   Write to `out` the sum of `voices` copies of `in` shifted by alpha[v] and
+   scaled by gain[v], plus `dry` times `in` delayed by the latency.  Voices
+   with a zero gain cost nothing.
+*/
+void ps_pvoc_process_voices(PsPvoc* pv, const float* in, float* out, int n,
+                            const float* alpha, const float* gain, int voices,
+                            float dry);
+
+#endif
@@ -0,0 +1,163 @@
+/**
+   ps-render: offline pitch shifting of raw audio with the engine of the
+   dafx-ps-sola plugins, rendered in parallel segments.
+
+   Input and output are headerless interleaved 32-bit float files (as written
+   by `sox ... -t f32` or `ffmpeg -f f32le`); "-" is stdin/stdout.  The output
+   has as many frames as the input and is latency compensated.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "ps_offline.h"
+
+static void
+usage(void)
+{
+   fprintf(stderr,
+           "usage: ps-render [-a alpha] [-m mode] [-q quality] [-f fade]\n"
+           "                 [-c channels] [-r rate] [-s] [-j threads] [-v]\n"
+           "                 input.f32 output.f32\n"
+           "  -a  pitch ratio, 0.25 to 2 (default 1)\n"
+           "  -m  0 = SOLA, 1 = phase vocoder, 2 = delay line, 3 = PSOLA\n"
+           "      (default 0)\n"
+           "  -q  SOLA resampler, 0 = linear to 3 = sinc 32 taps (default 2)\n"
+           "  -f  SOLA crossfade, 0 = linear, 1 = equal power, 2 = Hann\n"
+           "  -c  interleaved channels, linked (default 1)\n"
+           "  -r  sample rate in Hz (default 44100)\n"
+           "  -s  SOLA splice searches at the full rate above 88.2 kHz\n"
+           "  -j  threads, 0 = one per core (default 0)\n"
+           "  -v  print the render time\n");
+}
+
+
+/** Read all of `f` into a growing buffer; returns the number of floats. */
+static size_t
+read_all(FILE* f, float** data)
+{
+   size_t size = 1 << 16, len = 0, n;
+   float* buf = malloc(size*sizeof(float));
+
+   while (buf != NULL && (n = fread(buf + len, sizeof(float), size - len, f)) > 0) {
+      len += n;
+      if (len == size) {
+         float* bigger = realloc(buf, 2*size*sizeof(float));
+
+         if (bigger == NULL) {
+            free(buf);
+            buf = NULL;
+            break;
+         }
+         buf = bigger;
+         size *= 2;
+      }
+   }
+   *data = buf;
+
+   return buf ? len : 0;
+}
+
+
+int main(int argc, char** argv) {
+   int opt, c, channels = 1, threads = 0, verbose = 0;
+   double rate = 44100;
+   size_t i, frames, len;
+   float* data;
+   float* mem;
+   float* input[PS_MAX_CHANNELS];
+   float* output[PS_MAX_CHANNELS];
+   PsParams params;
+   FILE* in;
+   FILE* out;
+   struct timespec t0, t1;
+
+   memset(&params, 0, sizeof(params));
+   params.mode = PS_MODE_SOLA;
+   params.quality = PS_RS_MEDIUM;
+   params.alpha[0] = 1.0;
+   params.gain[0] = 1.0;
+
+   while ((opt = getopt(argc, argv, "a:m:q:f:c:r:sj:v")) != -1) {
+      switch (opt) {
+      case 'a': params.alpha[0] = atof(optarg); break;
+      case 'm': params.mode = atoi(optarg); break;
+      case 'q': params.quality = atoi(optarg); break;
+      case 'f': params.fade = atoi(optarg); break;
+      case 'c': channels = atoi(optarg); break;
+      case 'r': rate = atof(optarg); break;
+      case 's': params.full_search = 1; break;
+      case 'j': threads = atoi(optarg); break;
+      case 'v': verbose = 1; break;
+      default:
+         usage();
+         return 1;
+      }
+   }
+   if (argc - optind != 2 || channels < 1 || channels > PS_MAX_CHANNELS ||
+       rate < 8000) {
+      usage();
+      return 1;
+   }
+
+   in = strcmp(argv[optind], "-") ? fopen(argv[optind], "rb") : stdin;
+   if (in == NULL) {
+      perror(argv[optind]);
+      return 1;
+   }
+   len = read_all(in, &data);
+   if (in != stdin)
+      fclose(in);
+   if (data == NULL) {
+      fprintf(stderr, "PS_RENDER: could not read the input.\n");
+      return 1;
+   }
+   frames = len/channels;
+
+   /* The engine works on planar channels */
+   mem = malloc(2*frames*channels*sizeof(float) + 1);
+   if (mem == NULL) {
+      fprintf(stderr, "PS_RENDER: could not allocate %zu frames.\n", frames);
+      return 1;
+   }
+   for (c = 0; c < channels; c++) {
+      input[c] = mem + 2*c*frames;
+      output[c] = input[c] + frames;
+      for (i = 0; i < frames; i++)
+         input[c][i] = data[i*channels + c];
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &t0);
+   if (ps_render_offline((const float* const*)input, output, frames, rate,
+                         channels, 1, &params, threads) != 0)
+      return 1;
+   clock_gettime(CLOCK_MONOTONIC, &t1);
+
+   if (verbose)
+      fprintf(stderr, "%zu frames in %.3f s\n", frames,
+              (t1.tv_sec - t0.tv_sec) + 1e-9*(t1.tv_nsec - t0.tv_nsec));
+
+   for (c = 0; c < channels; c++)
+      for (i = 0; i < frames; i++)
+         data[i*channels + c] = output[c][i];
+
+   out = strcmp(argv[optind + 1], "-") ? fopen(argv[optind + 1], "wb") : stdout;
+   if (out == NULL) {
+      perror(argv[optind + 1]);
+      return 1;
+   }
+   if (fwrite(data, sizeof(float), frames*channels, out) != frames*channels) {
+      perror(argv[optind + 1]);
+      return 1;
+   }
+   if (out != stdout)
+      fclose(out);
+
+   free(mem);
+   free(data);
+   return 0;
+}
@@ -0,0 +1,224 @@
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "ps_resample.h"
+
+#define PI 3.14159265358979323846
+
+/** Fraction bits of the read position and bits selecting the phase. */
+#define FRAC_BITS  32
+#define PHASE_BITS 7       // log2(PS_RS_PHASES)
+
+/** Ratio covered by each band: band b is designed for ratio 1 + b/8. */
+#define BAND_STEP 0.125
+
+/** Passband edge relative to the Nyquist frequency of the output. */
+#define CUTOFF 0.92
+
+static const int tier_taps[PS_RS_TIERS] = { 2, 8, 16, 32 };
+
+
+int ps_resample_taps(int quality) {
+   return tier_taps[quality];
+}
+
+
+/** Blackman-windowed sinc with cutoff `fc` (1 = Nyquist). */
+static double
+kernel(double x, double fc, int half) {
+   double w, s;
+
+   if (fabs(x) >= half)
+      return 0;
+
+   w = 0.42 + 0.5*cos(PI*x/half) + 0.08*cos(2*PI*x/half);
+   s = (x == 0) ? 1 : sin(PI*fc*x)/(PI*fc*x);
+
+   return fc * s * w;
+}
+
+
+static void
+build_table(float* table, int taps) {
+   int b, p, t;
+   const int half = taps/2;
+   double fc, frac, sum;
+   float* row;
+
+   for (b = 0; b < PS_RS_BANDS; b++) {
+      fc = CUTOFF / (1 + b*BAND_STEP);
+
+      for (p = 0; p < PS_RS_PHASES; p++) {
+         row = table + (b*PS_RS_PHASES + p)*taps;
+         frac = p / (double)PS_RS_PHASES;
+
+         /* Tap t multiplies in[base - half + 1 + t] */
+         for (t = 0, sum = 0; t < taps; t++) {
+            row[t] = kernel(t - (half - 1) - frac, fc, half);
+            sum += row[t];
+         }
+         /* Unity gain at DC for every phase */
+         for (t = 0; t < taps; t++)
+            row[t] /= sum;
+      }
+   }
+}
+
+
+int ps_resample_init(PsResampler* rs) {
+   int q;
+
+   rs->tables[PS_RS_LINEAR] = NULL;
+
+   for (q = PS_RS_LOW; q < PS_RS_TIERS; q++) {
+      rs->tables[q] = malloc(PS_RS_BANDS * PS_RS_PHASES * tier_taps[q] *
+                             sizeof(float));
+      if (rs->tables[q] == NULL) {
+         ps_resample_free(rs);
+         return -1;
+      }
+      build_table(rs->tables[q], tier_taps[q]);
+   }
+
+   return 0;
+}
+
+
+void ps_resample_free(PsResampler* rs) {
+   int q;
+
+   for (q = 0; q < PS_RS_TIERS; q++) {
+      free(rs->tables[q]);
+      rs->tables[q] = NULL;
+   }
+}
+
+
+/** Inner product of `taps` (a multiple of 4) samples with a table row. */
+static inline float
+dot(const float* x, const float* h, int taps) {
+#if defined(__SSE__)
+   int t;
+   float r[4];
+   __m128 acc = _mm_mul_ps(_mm_loadu_ps(x), _mm_loadu_ps(h));
+
+   for (t = 4; t < taps; t += 4)
+      acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(x + t),
+                                       _mm_loadu_ps(h + t)));
+   _mm_storeu_ps(r, acc);
+
+   return (r[0] + r[1]) + (r[2] + r[3]);
+#else
+   int t;
+   float a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+
+   for (t = 0; t < taps; t += 4) {
+      a0 += x[t]*h[t];
+      a1 += x[t + 1]*h[t + 1];
+      a2 += x[t + 2]*h[t + 2];
+      a3 += x[t + 3]*h[t + 3];
+   }
+
+   return (a0 + a1) + (a2 + a3);
+#endif
+}
+
+
+/**
+   Inner products of two interleaved channels with a table row.  Four input
+   floats hold two taps of both channels, so they are multiplied by the row
+   with every coefficient duplicated.  Each channel is summed over the taps
+   in the order of `dot()`, so equal channels give the mono output exactly.
+*/
+static inline void
+dot2(const float* x, const float* h, int taps, float* y) {
+#if defined(__SSE__)
+   int t;
+   float lo[4], hi[4];
+   __m128 hq = _mm_loadu_ps(h);
+   __m128 acc_lo = _mm_mul_ps(_mm_loadu_ps(x), _mm_unpacklo_ps(hq, hq));
+   __m128 acc_hi = _mm_mul_ps(_mm_loadu_ps(x + 4), _mm_unpackhi_ps(hq, hq));
+
+   for (t = 4; t < taps; t += 4) {
+      hq = _mm_loadu_ps(h + t);
+      acc_lo = _mm_add_ps(acc_lo, _mm_mul_ps(_mm_loadu_ps(x + 2*t),
+                                             _mm_unpacklo_ps(hq, hq)));
+      acc_hi = _mm_add_ps(acc_hi, _mm_mul_ps(_mm_loadu_ps(x + 2*t + 4),
+                                             _mm_unpackhi_ps(hq, hq)));
+   }
+   _mm_storeu_ps(lo, acc_lo);
+   _mm_storeu_ps(hi, acc_hi);
+
+   y[0] = (lo[0] + lo[2]) + (hi[0] + hi[2]);
+   y[1] = (lo[1] + lo[3]) + (hi[1] + hi[3]);
+#else
+   int t, c;
+   float a0, a1, a2, a3;
+
+   for (c = 0; c < 2; c++) {
+      for (t = 0, a0 = a1 = a2 = a3 = 0; t < taps; t += 4) {
+         a0 += x[2*t + c]*h[t];
+         a1 += x[2*t + 2 + c]*h[t + 1];
+         a2 += x[2*t + 4 + c]*h[t + 2];
+         a3 += x[2*t + 6 + c]*h[t + 3];
+      }
+      y[c] = (a0 + a1) + (a2 + a3);
+   }
+#endif
+}
+
+
+void ps_resample_process(const PsResampler* rs, int quality, const float* in,
+                         float* out, int n, double ratio, int channels) {
+   int i, c, t, band, taps, half;
+   uint64_t pos = 0;
+   const uint64_t step = (uint64_t)(ratio * 4294967296.0);
+   const float* table;
+   const float* x;
+   const float* h;
+   float term, acc;
+
+   if (quality <= PS_RS_LINEAR || quality >= PS_RS_TIERS) {
+      for (i = 0; i < n; i++, pos += step) {
+         term = (uint32_t)pos * (1.0f/4294967296.0f);
+         x = in + (pos >> FRAC_BITS)*channels;
+         for (c = 0; c < channels; c++) {
+            out[i*channels + c] = x[c] * (1.0f - term);
+            out[i*channels + c] += x[channels + c] * term;
+         }
+      }
+      return;
+   }
+
+   band = (ratio <= 1) ? 0 : (int)ceil((ratio - 1)/BAND_STEP);
+   if (band >= PS_RS_BANDS)
+      band = PS_RS_BANDS - 1;
+
+   taps = tier_taps[quality];
+   half = taps/2;
+   table = rs->tables[quality] + band*PS_RS_PHASES*taps;
+
+   for (i = 0; i < n; i++, pos += step) {
+      x = in + ((int64_t)(pos >> FRAC_BITS) - half + 1)*channels;
+      h = table + ((uint32_t)pos >> (FRAC_BITS - PHASE_BITS))*taps;
+
+      if (channels == 1) {
+         out[i] = dot(x, h, taps);
+      }
+      else if (channels == 2) {
+         dot2(x, h, taps, out + 2*i);
+      }
+      else {
+         for (c = 0; c < channels; c++) {
+            for (t = 0, acc = 0; t < taps; t++)
+               acc += x[t*channels + c]*h[t];
+            out[i*channels + c] = acc;
+         }
+      }
+   }
+}
@@ -0,0 +1,54 @@
+#ifndef PS_RESAMPLE_H
+#define PS_RESAMPLE_H
+
+/**
+   Polyphase windowed-sinc resampler for the output of the TimeScaleSOLA loop.
+
+   The read position is a 32.32 fixed-point accumulator, so stepping costs an
+   integer add and the integer part and the filter phase are read with shifts
+   (no division or `floor()` per sample).  Each output sample is the inner
+   product of `taps` input samples with the row of the table selected by the
+   top bits of the fraction.
+
+   When reading faster than the input (ratio > 1, shifting up) the cutoff must
+   follow 1/ratio or the shifted signal aliases, so the tables are built for
+   PS_RS_BANDS cutoffs covering ratios 1 to 2 and the band with the next lower
+   cutoff is used.  All tables of all tiers are built by `ps_resample_init()`.
+*/
+#define PS_RS_PHASES 128
+#define PS_RS_BANDS  9
+#define PS_RS_MAX_TAPS 32
+
+/** Quality tiers: more taps, less aliasing and more CPU. */
+typedef enum {
+   PS_RS_LINEAR = 0,   // two-point linear interpolation (the original one)
+   PS_RS_LOW    = 1,   // 8 taps
+   PS_RS_MEDIUM = 2,   // 16 taps
+   PS_RS_HIGH   = 3    // 32 taps
+} PsResampleQuality;
+
+#define PS_RS_TIERS 4
+
+typedef struct {
+   // tables[q][(band*PS_RS_PHASES + phase)*taps + t], NULL for PS_RS_LINEAR
+   float* tables[PS_RS_TIERS];
+} PsResampler;
+
+/** Taps of a tier. */
+int ps_resample_taps(int quality);
+
+/** Build the tables of every tier.  Returns 0 on success, -1 otherwise. */
+int ps_resample_init(PsResampler* rs);
+
+void ps_resample_free(PsResampler* rs);
+
+/**
+   out[i] = in(i * ratio) for i < n, on `channels` interleaved channels (the
+   indices above count frames).  `in` must be readable from frame
+   -PS_RS_MAX_TAPS/2 up to frame (n - 1) * ratio + PS_RS_MAX_TAPS/2.  The
+   filter phase is computed once per frame and shared by the channels.
+*/
+void ps_resample_process(const PsResampler* rs, int quality, const float* in,
+                         float* out, int n, double ratio, int channels);
+
+#endif
@@ -0,0 +1,308 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ps_stretch.h"
+
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+int ps_sola_hop(double rate) {
+   return MAX(16, (int)lround(rate*PS_SOLA_SA_MS/1000));
+}
+
+
+void ps_sola_mix_down(const float* source, int ini, float* destination,
+                      int len, int channels) {
+   int i, c;
+   float sum;
+   const float scale = 1.0/channels;
+
+   for (i = 0; i < len; i++) {
+      for (c = 0, sum = 0; c < channels; c++)
+         sum += source[(ini + i)*channels + c];
+      destination[i] = sum * scale;
+   }
+}
+
+
+void ps_sola_decimate(const float* source, int ini, float* destination,
+                      int len, int channels, int dec) {
+   int i, k, c;
+   float sum, part;
+   const float scale = 1.0/(channels*dec);
+   const float* x = source + ini*channels;
+
+   /* Channel by channel, so equal channels give the mono copy exactly */
+   for (i = 0; i < len; i++) {
+      for (c = 0, sum = 0; c < channels; c++) {
+         for (k = 0, part = 0; k < dec; k++)
+            part += x[k*channels + c];
+         sum += part;
+      }
+      destination[i] = sum * scale;
+      x += dec*channels;
+   }
+}
+
+
+/**
+   Brute-force splice search, O(uLen * vLen).  It is kept as the reference
+   for `ps_align_search()` and is used instead of it when built with
+   -DPS_BRUTE_FORCE_SEARCH.
+*/
+#ifdef PS_BRUTE_FORCE_SEARCH
+static int
+maxSimIndex(float *u, int uLen, float *v, int vLen) {
+   int i, j, index;
+   float min, sum, term;
+
+   for (i = -uLen; i < vLen; i++) {
+      for (j = i, sum = 0; j < i + uLen; j++) {
+         if (j < 0) { 
+            term = fabs(u[j - i] - 0);
+         }
+         else if (j <= vLen) { 
+            term = fabs(u[j - i] - v[j]);
+         }
+         else {
+            term = fabs(u[j - i] - 0);
+         }
+
+         if (term == 0) sum += -1;
+         else sum += term;
+      }
+      if (i == -uLen || sum < min) {
+         min = sum;
+         index = i;
+      }
+   }
+
+   return index;
+}
+#endif
+
+
+int ps_sola_cut(PsAlign* align, const float* result, int res_len, int pos,
+                const float* grain, int grain_len, int L, int channels,
+                int dec, float* u, float* v) {
+   int maxIndex, cut;
+   const int C = channels;
+
+   /* The search sees mono audio; a single channel is searched in place */
+   if (dec > 1 && L >= PS_SOLA_DEC_MIN*dec) {
+      ps_sola_decimate(grain, 0, u, L/dec, C, dec);
+      ps_sola_decimate(result, pos, v, L/dec, C, dec);
+      maxIndex = dec*ps_align_search(align, u, L/dec, v, L/dec,
+                                     -L/dec, L/dec);
+   }
+   else {
+      if (C > 1) {
+         ps_sola_mix_down(grain, 0, u, L, C);
+         ps_sola_mix_down(result, pos, v, L, C);
+      }
+      else {
+         u = (float*)grain;
+         v = (float*)result + pos;
+      }
+#ifdef PS_BRUTE_FORCE_SEARCH
+      maxIndex = maxSimIndex(u, L, v, L);
+#else
+      maxIndex = ps_align_search(align, u, L, v, L, -L, L);
+#endif
+   }
+
+   /* The new grain must cover the old one (only a ratio jump gets here) */
+   cut = MIN(pos + maxIndex, res_len);
+   return MAX(cut, res_len - grain_len);
+}
+
+
+int ps_sola_join(PsFade* fade, int shape, float* result, int res_len,
+                 int cut, const float* grain, int grain_len, int channels) {
+   const int C = channels;
+   const int fadeLen = res_len - cut;
+
+   ps_fade_weights(fade, shape, fadeLen, fadeLen);
+   ps_fade_mix(result + cut*C, grain, fade->w_out, fade->w_in, fadeLen, C);
+
+   memcpy(result + res_len*C, grain + fadeLen*C,
+          (grain_len - fadeLen)*C*sizeof(float));
+
+   return cut + grain_len;
+}
+
+
+int ps_sola_splice(PsAlign* align, PsFade* fade, int shape, float* result,
+                   int res_len, int pos, const float* grain, int grain_len,
+                   int L, int channels, int dec, float* u, float* v) {
+   int cut = ps_sola_cut(align, result, res_len, pos, grain, grain_len, L,
+                         channels, dec, u, v);
+
+   return ps_sola_join(fade, shape, result, res_len, cut, grain, grain_len,
+                       channels);
+}
+
+
+int ps_stretch_init(PsStretch* st, double rate, int channels, int max_block) {
+   memset(st, 0, sizeof(PsStretch));
+   st->channels = channels;
+   st->ratio = 1.0;
+   st->sa = ps_sola_hop(rate);
+   st->grain = 4*st->sa;
+   st->l_max = (int)(st->sa*PS_STRETCH_MAX/2);
+   st->dec = MAX(1, (int)(rate/PS_SEARCH_RATE));
+   st->in_cap = 2*st->grain;
+   st->res_cap = (int)ceil((max_block + st->grain)*PS_STRETCH_MAX)
+                 + 2*st->grain + 2*st->l_max;
+
+   st->in = calloc(st->in_cap*channels, sizeof(float));
+   st->res = calloc(st->res_cap*channels, sizeof(float));
+   st->u = calloc(st->l_max, sizeof(float));
+   st->v = calloc(st->l_max, sizeof(float));
+
+   if (st->in == NULL || st->res == NULL || st->u == NULL || st->v == NULL ||
+       ps_align_init(&st->align, 2*st->l_max) != 0 ||
+       ps_fade_init(&st->fade, st->grain) != 0) {
+      ps_stretch_free(st);
+      return -1;
+   }
+
+   return 0;
+}
+
+
+void ps_stretch_free(PsStretch* st) {
+   ps_align_free(&st->align);
+   ps_fade_free(&st->fade);
+   free(st->in);
+   free(st->res);
+   free(st->u);
+   free(st->v);
+   memset(st, 0, sizeof(PsStretch));
+}
+
+
+void ps_stretch_reset(PsStretch* st) {
+   st->in_pos = 0;
+   st->in_fill = 0;
+   st->res_len = 0;
+   st->ready = 0;
+   st->pulled = 0;
+   st->syn = 0;
+   st->started = 0;
+}
+
+
+void ps_stretch_set_ratio(PsStretch* st, double ratio) {
+   st->ratio = MAX(PS_STRETCH_MIN, MIN(ratio, PS_STRETCH_MAX));
+}
+
+
+void ps_stretch_set_fade(PsStretch* st, int shape) {
+   st->shape = shape;
+}
+
+
+int ps_stretch_latency(const PsStretch* st) {
+   return st->grain + st->sa + (int)ceil(st->l_max / st->ratio);
+}
+
+
+/** Move the pulled output frames out of `res`. */
+static void
+compact_output(PsStretch* st)
+{
+   const int C = st->channels;
+
+   if (st->pulled == 0)
+      return;
+   memmove(st->res, st->res + st->pulled*C,
+           (st->res_len - st->pulled)*C*sizeof(float));
+   st->res_len -= st->pulled;
+   st->ready -= st->pulled;
+   st->syn -= st->pulled;
+   st->pulled = 0;
+}
+
+
+/**
+   Lay down the grain at in_pos.  Returns 0 if `res` has no room for it;
+   a grain never ends more than l_max + grain frames past `syn`.
+*/
+static int
+add_grain(PsStretch* st)
+{
+   int pos, L;
+   const int C = st->channels;
+   const int SA = st->sa;
+   const int GRAIN_LEN = st->grain;
+   const int L_MAX = st->l_max;
+   const float* grain = st->in + st->in_pos*C;
+
+   if ((int)st->syn + L_MAX + GRAIN_LEN + 1 > st->res_cap)
+      compact_output(st);
+   if ((int)st->syn + L_MAX + GRAIN_LEN + 1 > st->res_cap)
+      return 0;
+
+   if (!st->started) {
+      memcpy(st->res, grain, GRAIN_LEN*C*sizeof(float));
+      st->res_len = GRAIN_LEN;
+      st->started = 1;
+   }
+   else {
+      pos = (int)lround(st->syn);
+      L = (int)lround(SA * st->ratio / 2.0);
+      st->res_len = ps_sola_splice(&st->align, &st->fade, st->shape, st->res,
+                                   st->res_len, pos, grain, GRAIN_LEN, L, C,
+                                   st->dec, st->u, st->v);
+   }
+
+   /* The next grain is cut at least L_MAX frames before its position */
+   st->syn += SA * st->ratio;
+   st->ready = MAX(st->ready, MIN((int)lround(st->syn) - L_MAX, st->res_len));
+   st->in_pos += SA;
+
+   return 1;
+}
+
+
+int ps_stretch_push(PsStretch* st, const float* input, int n) {
+   int len, done = 0;
+   const int C = st->channels;
+
+   while (done < n) {
+      /* Drop the input consumed by the grains already laid down */
+      if (st->in_pos > 0) {
+         memmove(st->in, st->in + st->in_pos*C,
+                 (st->in_fill - st->in_pos)*C*sizeof(float));
+         st->in_fill -= st->in_pos;
+         st->in_pos = 0;
+      }
+
+      len = MIN(n - done, st->in_cap - st->in_fill);
+      memcpy(st->in + st->in_fill*C, input + done*C, len*C*sizeof(float));
+      st->in_fill += len;
+      done += len;
+
+      while (st->in_fill - st->in_pos >= st->grain) {
+         if (!add_grain(st))
+            return done;
+      }
+   }
+
+   return done;
+}
+
+
+int ps_stretch_pull(PsStretch* st, float* output, int n) {
+   const int C = st->channels;
+
+   n = MIN(n, st->ready - st->pulled);
+   if (n <= 0)
+      return 0;
+   memcpy(output, st->res + st->pulled*C, n*C*sizeof(float));
+   st->pulled += n;
+
+   return n;
+}
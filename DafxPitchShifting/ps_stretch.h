@@ -0,0 +1,146 @@
+#ifndef PS_STRETCH_H
+#define PS_STRETCH_H
+
+#include "ps_align.h"
+#include "ps_fade.h"
+
+/**
+   SOLA time stretching, the TimeScaleSOLA loop of the pitch shifter on its
+   own.  Grains of four analysis hops are taken from the input every hop
+   SA and laid down every SA * ratio frames of output; each one is moved to
+   the best match with the output so far (within L = SA * ratio / 2 frames)
+   and crossfaded in.
+*/
+#define PS_STRETCH_MIN    0.25
+#define PS_STRETCH_MAX    2.0
+
+/**
+   Analysis hop of the SOLA engine and the stretcher in milliseconds,
+   converted to frames for the sample rate by `ps_sola_hop()`.  At 44.1 kHz
+   it is the 128 samples of the original plugin (grains of 512), so the
+   grains span the same stretch of audio at any rate.
+*/
+#define PS_SOLA_SA_MS     (128/44.1)
+
+/**
+   Rate the splice searches run at.  Above twice this rate they run on a
+   copy of the signal decimated by rate / PS_SEARCH_RATE, so their cost per
+   second of audio stays about the same as at 44.1 kHz.
+*/
+#define PS_SEARCH_RATE    44100
+
+/** Shortest decimated splice search; shorter ones run at the full rate. */
+#define PS_SOLA_DEC_MIN   4
+
+/** SOLA analysis hop at `rate` Hz, PS_SOLA_SA_MS but at least 16 frames. */
+int ps_sola_hop(double rate);
+
+/**
+   Average the `channels` interleaved channels of frames [ini, ini + len) of
+   `source` into the mono `destination`.
+*/
+void ps_sola_mix_down(const float* source, int ini, float* destination,
+                      int len, int channels);
+
+/**
+   Average the channels and every `dec` frames of `source` from frame `ini`
+   on into `len` mono samples of `destination`: the box-filtered, decimated
+   copy the splice searches run on at high sample rates.
+*/
+void ps_sola_decimate(const float* source, int ini, float* destination,
+                      int len, int channels, int dec);
+
+/**
+   Splice one grain of `grain_len` interleaved frames into `result`, which
+   holds `res_len` frames: search lags (-L, L) around frame `pos` on the
+   average of the channels, crossfade with `shape` from the cut to `res_len`
+   and append the rest of the grain.  With `dec` > 1 the search runs on a
+   copy decimated by `dec` and finds the cut to within `dec` frames; it is
+   skipped for splices under PS_SOLA_DEC_MIN decimated samples.  `u` and `v`
+   are scratch for L floats each (mono input is searched in place), pos + L
+   must not exceed res_len and fade->max_len must be at least grain_len.
+   Returns the new length, cut + grain_len.
+*/
+int ps_sola_splice(PsAlign* align, PsFade* fade, int shape, float* result,
+                   int res_len, int pos, const float* grain, int grain_len,
+                   int L, int channels, int dec, float* u, float* v);
+
+/**
+   The two halves of `ps_sola_splice()`.  `ps_sola_cut()` only searches and
+   returns the frame of `result` the grain is cut in at; `ps_sola_join()`
+   crossfades and appends the grain there and returns the new length.
+*/
+int ps_sola_cut(PsAlign* align, const float* result, int res_len, int pos,
+                const float* grain, int grain_len, int L, int channels,
+                int dec, float* u, float* v);
+
+int ps_sola_join(PsFade* fade, int shape, float* result, int res_len,
+                 int cut, const float* grain, int grain_len, int channels);
+
+/**
+   Streaming time stretcher.  Input is pushed, output is pulled, and the
+   ratio (output length / input length) can be changed between calls.  All
+   memory is allocated by `ps_stretch_init()`; push and pull only copy,
+   splice and never allocate.
+*/
+typedef struct {
+   int     channels;
+   int     sa;         // analysis hop, `ps_sola_hop()`
+   int     grain;      // grain, four hops
+   int     l_max;      // longest splice search, L at PS_STRETCH_MAX
+   int     dec;        // decimation of the splice searches
+   int     in_cap;     // frames of `in`
+   int     res_cap;    // frames of `res`
+   double  ratio;
+   float*  in;         // interleaved input queue
+   int     in_pos;     // start of the next grain in `in`
+   int     in_fill;    // frames queued in `in`
+   float*  res;        // interleaved output under construction
+   int     res_len;    // frames of `res` written by the last grain
+   int     ready;      // frames of `res` that no later grain can change
+   int     pulled;     // frames of `res` already pulled
+   double  syn;        // output position of the next grain in `res`
+   int     started;    // the first grain has been laid down
+   int     shape;      // PsFadeShape of the splices
+   float*  u;          // mono scratch of the splice search
+   float*  v;
+   PsAlign align;
+   PsFade  fade;
+} PsStretch;
+
+/**
+   Allocate a stretcher for `channels` interleaved channels at `rate` Hz.
+   A push of up to `max_block` frames is always taken whole if the output
+   has been pulled after the previous push.  Returns 0 on success, -1 if
+   allocation failed.
+*/
+int ps_stretch_init(PsStretch* st, double rate, int channels, int max_block);
+
+void ps_stretch_free(PsStretch* st);
+
+/** Drop all queued input and output; the ratio is kept. */
+void ps_stretch_reset(PsStretch* st);
+
+/** Set the stretch ratio, clamped to [PS_STRETCH_MIN, PS_STRETCH_MAX]. */
+void ps_stretch_set_ratio(PsStretch* st, double ratio);
+
+/** Select the crossfade shape of the splices (PsFadeShape). */
+void ps_stretch_set_fade(PsStretch* st, int shape);
+
+/**
+   Input frames the output lags behind at the current ratio: after `n`
+   frames have been pushed, at least (n - latency) * ratio frames can be
+   pulled.  Push that much silence to flush the end of a stream.
+*/
+int ps_stretch_latency(const PsStretch* st);
+
+/**
+   Queue up to `n` interleaved frames and stretch every complete grain.
+   Returns the frames taken, fewer than `n` only if the output is full.
+*/
+int ps_stretch_push(PsStretch* st, const float* input, int n);
+
+/** Copy up to `n` finished frames to `output`; returns the frames copied. */
+int ps_stretch_pull(PsStretch* st, float* output, int n);
+
+#endif
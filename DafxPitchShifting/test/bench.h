@@ -0,0 +1,190 @@
+#ifndef PS_BENCH_H
+#define PS_BENCH_H
+
+/**
+   Helpers shared by the tests and benchmarks of test/: a clock, the test
+   signals and a timed run of the engine.  The figures in README.txt were
+   measured with the programs built by
+
+     CFLAGS=-O2 ./waf configure --test && ./waf
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "ps_engine.h"
+
+#define PI 3.14159265358979323846
+
+/** Report a failed check and count it. */
+#define CHECK(cond, ...)                                  \
+   do {                                                   \
+      if (!(cond)) {                                      \
+         fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);  \
+         fprintf(stderr, __VA_ARGS__);                    \
+         fprintf(stderr, "\n");                           \
+         failures++;                                      \
+      }                                                   \
+   } while (0)
+
+/** Seconds on a monotonic clock. */
+static inline double
+bench_now(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/**
+   Seconds of CPU used by the calling thread, which other processes on the
+   machine do not disturb as much as they do the clock.
+*/
+static inline double
+bench_cpu(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+   return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/** Uniform in [-1, 1), from a 32-bit LCG. */
+static inline float
+bench_rand(uint32_t* seed)
+{
+   *seed = *seed*1664525u + 1013904223u;
+   return (*seed >> 8)*(2.0f/16777216.0f) - 1.0f;
+}
+
+/**
+   The two-partial test tone: 220 Hz and a softer 331 Hz, whose beating
+   makes every grain different.
+*/
+static inline void
+bench_tone(float* x, int n, double rate)
+{
+   int i;
+
+   for (i = 0; i < n; i++)
+      x[i] = 0.5*sin(2*PI*220*i/rate) + 0.25*sin(2*PI*331*i/rate + 1);
+}
+
+/**
+   A sung vowel: 180 Hz with 5.5 Hz vibrato of +-3% and 15 harmonics
+   falling as 1/k, voiced for 0.7 s of every second, then 0.1 s of
+   breath noise and 0.2 s of silence.  f0[i], if not NULL, gets the pitch
+   of sample i, 0 where unvoiced.
+*/
+static inline void
+bench_voice(float* x, float* f0, int n, double rate)
+{
+   uint32_t seed = 5;
+   double phase = 0, f, t, s, env;
+   int i, k;
+
+   for (i = 0; i < n; i++) {
+      t = fmod(i/rate, 1.0);
+      f = 180*(1 + 0.03*sin(2*PI*5.5*i/rate));
+      phase = fmod(phase + 2*PI*f/rate, 2*PI);
+      if (t < 0.7) {
+         env = fmin(1, fmin(t, 0.7 - t)/0.02);
+         for (k = 1, s = 0; k <= 15; k++)
+            s += sin(k*phase)/k;
+         x[i] = 0.3*env*s;
+      }
+      else {
+         x[i] = t < 0.8 ? 0.05*bench_rand(&seed) : 0;
+      }
+      if (f0)
+         f0[i] = t < 0.7 ? f : 0;
+   }
+}
+
+/**
+   Plucked bass: G1, A1, D2 and G2 (49 - 98 Hz, within the periods PSOLA
+   tracks at 48 kHz), 0.5 s each in turn, 20 harmonics falling as 1/k and
+   decaying faster the higher they are.
+   f0[i], if not NULL, gets the pitch of sample i.
+*/
+static inline void
+bench_bass(float* x, float* f0, int n, double rate)
+{
+   static const double notes[] = {49.0, 55.0, 73.4, 98.0};
+   double t, f, s;
+   int i, k;
+
+   for (i = 0; i < n; i++) {
+      t = fmod(i/rate, 0.5);
+      f = notes[(int)(i/(0.5*rate)) % 4];
+      for (k = 1, s = 0; k <= 20; k++)
+         s += sin(2*PI*k*f*t)/k*exp(-t*(1.5 + 0.8*k));
+      x[i] = 0.6*fmin(1, t/0.002)*s;
+      if (f0)
+         f0[i] = f;
+   }
+}
+
+/**
+   Milliseconds of CPU per second of audio of `ps_engine_process()` on the
+   `n` samples of `x` in every channel, in `block`-frame blocks: the best
+   of `reps` runs, each from a reset engine.  Returns a negative value if
+   the output could not be allocated.
+*/
+static inline double
+bench_engine_ms_on(PsEngine* ps, const PsParams* params, const float* x,
+                   int n, int block, int reps)
+{
+   const int C = ps->channels;
+   float* mem = malloc((size_t)n*C*sizeof(float));
+   const float* ip[PS_MAX_CHANNELS];
+   float* op[PS_MAX_CHANNELS];
+   double t, best = -1;
+   int c, r, pos, len;
+
+   if (mem == NULL)
+      return -1;
+   for (r = 0; r < reps; r++) {
+      ps_engine_reset(ps);
+      t = bench_cpu();
+      for (pos = 0; pos < n; pos += len) {
+         len = (n - pos < block) ? n - pos : block;
+         for (c = 0; c < C; c++) {
+            ip[c] = x + pos;
+            op[c] = mem + (size_t)c*n + pos;
+         }
+         ps_engine_process(ps, ip, op, len, params);
+      }
+      t = 1e3*(bench_cpu() - t)/(n/ps->rate);
+      if (best < 0 || t < best)
+         best = t;
+   }
+
+   free(mem);
+   return best;
+}
+
+/**
+   `bench_engine_ms_on()` on `seconds` of the test tone.  Returns a
+   negative value if the buffers could not be allocated.
+*/
+static inline double
+bench_engine_ms(PsEngine* ps, const PsParams* params, double seconds,
+                int block, int reps)
+{
+   const int n = (int)(seconds*ps->rate);
+   float* x = malloc((size_t)n*sizeof(float));
+   double ms;
+
+   if (x == NULL)
+      return -1;
+   bench_tone(x, n, ps->rate);
+   ms = bench_engine_ms_on(ps, params, x, n, block, reps);
+   free(x);
+   return ms;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/**
+   Cost of the SOLA engine across alpha, in ms per second of audio (48 kHz,
+   512-frame blocks, 10 s of the test tone, quality 2).  The wscript builds
+   it twice: test/bench_align with the FFT splice search and
+   test/bench_align_brute with -DPS_BRUTE_FORCE_SEARCH, the book's
+   maxSimIndex() and maxSimIndex2().
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+int main(void) {
+   static const float alphas[] = {0.5, 0.75, 1.0, 1.5, 2.0};
+   PsEngine ps;
+   PsParams params;
+   int a;
+
+   if (ps_engine_init(&ps, 48000, 1, 1) != 0) {
+      fprintf(stderr, "bench_align: out of memory\n");
+      return 1;
+   }
+   memset(&params, 0, sizeof(params));
+   params.mode = PS_MODE_SOLA;
+   params.quality = PS_RS_MEDIUM;
+   params.gain[0] = 1.0;
+
+#ifdef PS_BRUTE_FORCE_SEARCH
+   printf("splice search: brute force\n");
+#else
+   printf("splice search: FFT\n");
+#endif
+   for (a = 0; a < (int)(sizeof(alphas)/sizeof(alphas[0])); a++) {
+      params.alpha[0] = alphas[a];
+      printf("  alpha %.2f  %5.1f ms/s\n", alphas[a],
+             bench_engine_ms(&ps, &params, 10, 512, 3));
+   }
+
+   ps_engine_free(&ps);
+   return 0;
+}
@@ -0,0 +1,82 @@
+/**
+   The crossfade stage of the grain splices on its own: spliceBook() (a
+   division per frame, test/ps_ref.c) against ps_sola_join() (table weights
+   and the SSE mix), in ns per crossfaded frame for fades of 64, 256 and 448
+   frames of a 512-frame grain, mono and stereo.  Both append the rest of the
+   grain.  The last column is ps_fade_mix() alone.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "ps_fade.h"
+#include "ps_ref.h"
+#include "ps_stretch.h"
+
+#define GRAIN   512
+#define RES_LEN 600
+#define CALLS   20000
+#define REPS    7
+
+static float result[2*GRAIN*2];
+static float grain[GRAIN*2];
+
+typedef enum { BOOK, TABLES, MIX } Stage;
+
+static double
+time_stage(PsFade* fade, Stage stage, int fade_len, int C)
+{
+   const int cut = RES_LEN - fade_len;
+   double t, best = -1;
+   int r, k;
+
+   for (r = 0; r < REPS; r++) {
+      t = bench_cpu();
+      for (k = 0; k < CALLS; k++) {
+         switch (stage) {
+         case BOOK:
+            spliceBook(result, RES_LEN, cut, grain, GRAIN, C);
+            break;
+         case TABLES:
+            ps_sola_join(fade, PS_FADE_LINEAR, result, RES_LEN, cut, grain,
+                         GRAIN, C);
+            break;
+         case MIX:
+            ps_fade_mix(result + cut*C, grain, fade->w_out, fade->w_in,
+                        fade_len, C);
+            break;
+         }
+      }
+      t = 1e9*(bench_cpu() - t)/((double)CALLS*fade_len);
+      best = (best < 0 || t < best) ? t : best;
+   }
+   return best;
+}
+
+int main(void) {
+   static const int lens[] = {64, 256, 448};
+   PsFade fade;
+   uint32_t seed = 1;
+   int i, C, f;
+
+   if (ps_fade_init(&fade, GRAIN) != 0) {
+      fprintf(stderr, "bench_fade: out of memory\n");
+      return 1;
+   }
+   for (i = 0; i < 2*GRAIN*2; i++)
+      result[i] = bench_rand(&seed);
+   for (i = 0; i < GRAIN*2; i++)
+      grain[i] = bench_rand(&seed);
+   ps_fade_weights(&fade, PS_FADE_LINEAR, GRAIN, GRAIN);
+
+   printf("ns/frame      fade  book   tables + SSE   SSE mix alone\n");
+   for (C = 1; C <= 2; C++)
+      for (f = 0; f < 3; f++)
+         printf("%-12s  %4d  %4.1f   %4.1f           %4.2f\n",
+                f ? "" : C == 1 ? "mono" : "stereo", lens[f],
+                time_stage(&fade, BOOK, lens[f], C),
+                time_stage(&fade, TABLES, lens[f], C),
+                time_stage(&fade, MIX, lens[f], C));
+
+   ps_fade_free(&fade);
+   return 0;
+}
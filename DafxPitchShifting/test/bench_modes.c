@@ -0,0 +1,63 @@
+/**
+   The mode table of README.txt.  For each engine of the "mode" port, the
+   latency reported by ps_engine_latency() in samples and ms, and the
+   lowest and highest ms of CPU per second of audio over alpha 0.5 - 2
+   (mono, quality 2, 256-frame blocks, 5 s of the test tone, best of
+   REPS), at 44.1, 48 and 96 kHz.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+#define BLOCK   256
+#define SECONDS 5
+#define REPS    3
+
+static const double rates[] = {44100, 48000, 96000};
+static const float alphas[] = {0.5, 0.75, 1.0, 1.26, 1.5, 2.0};
+static const int modes[] = {
+   PS_MODE_SOLA, PS_MODE_PVOC, PS_MODE_DELAY, PS_MODE_PSOLA
+};
+static const char* names[] = {
+   "SOLA", "Phase vocoder", "Delay line", "PSOLA"
+};
+
+#define RATES  ((int)(sizeof(rates)/sizeof(rates[0])))
+#define ALPHAS ((int)(sizeof(alphas)/sizeof(alphas[0])))
+#define MODES  ((int)(sizeof(modes)/sizeof(modes[0])))
+
+int main(void) {
+   PsEngine ps;
+   PsParams p;
+   double t, lo, hi;
+   int r, m, a, latency;
+
+   memset(&p, 0, sizeof(p));
+   p.quality = PS_RS_MEDIUM;
+   p.gain[0] = 1;
+   for (r = 0; r < RATES; r++) {
+      if (ps_engine_init(&ps, rates[r], 1, 1) != 0) {
+         fprintf(stderr, "bench_modes: allocation failed\n");
+         return 1;
+      }
+      printf("%.1f kHz        latency             ms per second of audio\n",
+             rates[r]/1000);
+      for (m = 0; m < MODES; m++) {
+         p.mode = modes[m];
+         latency = ps_engine_latency(&ps, &p);
+         for (a = 0, lo = hi = -1; a < ALPHAS; a++) {
+            p.alpha[0] = alphas[a];
+            t = bench_engine_ms(&ps, &p, SECONDS, BLOCK, REPS);
+            lo = lo < 0 || t < lo ? t : lo;
+            hi = t > hi ? t : hi;
+         }
+         printf("  %-14s %5d (%5.1f ms)   %5.1f - %5.1f\n", names[m],
+                latency, 1e3*latency/rates[r], lo, hi);
+      }
+      ps_engine_free(&ps);
+   }
+
+   return 0;
+}
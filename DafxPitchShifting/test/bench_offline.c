@@ -0,0 +1,69 @@
+/**
+   Thread-count sweep of the offline renderer: 60 s of the stereo test tone
+   at 44.1 kHz, alpha 1.26, rendered by ps_render_offline() with 1 to N
+   threads.  N is the first argument, twice the online cores by default.
+   Prints the wall-clock time (best of 3) and the speed-up over one thread.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "ps_offline.h"
+
+#define RATE     44100
+#define CHANNELS 2
+#define SECONDS  60
+
+int main(int argc, char** argv) {
+   const size_t frames = SECONDS*RATE;
+   const long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   const int max = argc > 1 ? atoi(argv[1]) : (cores > 0 ? 2*cores : 2);
+   float* mem = malloc(2*CHANNELS*frames*sizeof(float));
+   float* input[CHANNELS];
+   float* output[CHANNELS];
+   PsParams params;
+   double t, best, one[2];
+   int c, j, r, m;
+
+   if (mem == NULL) {
+      fprintf(stderr, "bench_offline: out of memory\n");
+      return 1;
+   }
+   for (c = 0; c < CHANNELS; c++) {
+      input[c] = mem + 2*c*frames;
+      output[c] = input[c] + frames;
+      bench_tone(input[c], frames, RATE);
+   }
+   memset(&params, 0, sizeof(params));
+   params.quality = PS_RS_MEDIUM;
+   params.alpha[0] = 1.26;
+   params.gain[0] = 1.0;
+
+   printf("%ld cores online, %d s of stereo at %d Hz\n", cores, SECONDS, RATE);
+   printf("threads   SOLA             Phase vocoder\n");
+   for (j = 1; j <= max; j++) {
+      printf("%4d    ", j);
+      for (m = PS_MODE_SOLA; m <= PS_MODE_PVOC; m++) {
+         params.mode = m;
+         for (r = 0, best = -1; r < 3; r++) {
+            t = bench_now();
+            if (ps_render_offline((const float* const*)input, output, frames,
+                                  RATE, CHANNELS, 1, &params, j) != 0) {
+               fprintf(stderr, "bench_offline: render failed\n");
+               return 1;
+            }
+            t = bench_now() - t;
+            best = (best < 0 || t < best) ? t : best;
+         }
+         if (j == 1)
+            one[m] = best;
+         printf("  %5.2f s %4.1fx", best, one[m]/best);
+      }
+      printf("\n");
+   }
+
+   free(mem);
+   return 0;
+}
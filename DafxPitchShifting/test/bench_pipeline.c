@@ -0,0 +1,100 @@
+/**
+   run() time per frame boundary, direct and pipelined: the SOLA engine at
+   44.1 kHz, alpha 1.31, in 512-sample blocks (one boundary per block),
+   mono and stereo.  The blocks are paced in real time, as a host would
+   call run(), so the helper thread gets the time between them; the CPU
+   time of the calling thread is measured per block.  Prints the median,
+   the 99th percentile and the largest block, and the frames the helper
+   had not finished in time and that were searched in run().
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+#define RATE    44100
+#define BLOCK   512
+#define SECONDS 4
+
+static int
+compare(const void* a, const void* b)
+{
+   const double x = *(const double*)a;
+   const double y = *(const double*)b;
+
+   return (x > y) - (x < y);
+}
+
+static void
+run(int channels, int pipelined)
+{
+   const int n = SECONDS*RATE/BLOCK;
+   const long period = 1000000000L*BLOCK/RATE;
+   const int len = n*BLOCK;
+   float* mem = malloc((size_t)channels*(len + BLOCK)*sizeof(float));
+   double* t = malloc(n*sizeof(double));
+   const float* x[PS_MAX_CHANNELS];
+   const float* in[PS_MAX_CHANNELS];
+   float* out[PS_MAX_CHANNELS];
+   struct timespec next;
+   PsEngine ps;
+   PsParams params;
+   double start;
+   int b, c;
+
+   if (mem == NULL || t == NULL ||
+       ps_engine_init(&ps, RATE, channels, 1) != 0) {
+      fprintf(stderr, "bench_pipeline: out of memory\n");
+      exit(1);
+   }
+   if (pipelined && ps_engine_start_helper(&ps) != 0) {
+      fprintf(stderr, "bench_pipeline: no helper thread\n");
+      exit(1);
+   }
+   memset(&params, 0, sizeof(params));
+   params.quality = PS_RS_MEDIUM;
+   params.alpha[0] = 1.31;
+   params.gain[0] = 1;
+   params.pipelined = pipelined;
+   for (c = 0; c < channels; c++) {
+      x[c] = mem + (size_t)c*len;
+      out[c] = mem + (size_t)channels*len + (size_t)c*BLOCK;
+      bench_tone((float*)x[c], len, RATE);
+   }
+
+   clock_gettime(CLOCK_MONOTONIC, &next);
+   for (b = 0; b < n; b++) {
+      for (c = 0; c < channels; c++)
+         in[c] = x[c] + (size_t)b*BLOCK;
+      start = bench_cpu();
+      ps_engine_process(&ps, in, out, BLOCK, &params);
+      t[b] = 1e6*(bench_cpu() - start);
+
+      next.tv_nsec += period;
+      if (next.tv_nsec >= 1000000000L) {
+         next.tv_nsec -= 1000000000L;
+         next.tv_sec++;
+      }
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+   }
+
+   qsort(t, n, sizeof(double), compare);
+   printf("%-7s %-10s %6.0f us %6.0f us %6.0f us %6u\n",
+          channels > 1 ? "stereo" : "mono",
+          pipelined ? "pipelined" : "direct", t[n/2], t[n*99/100], t[n - 1],
+          ps.pipe ? ps.pipe->late : 0u);
+
+   ps_engine_free(&ps);
+   free(t);
+   free(mem);
+}
+
+int main(void) {
+   printf("run() per boundary   median   99th pct   largest   searched in run()\n");
+   run(1, 0);
+   run(1, 1);
+   run(2, 0);
+   run(2, 1);
+   return 0;
+}
@@ -0,0 +1,161 @@
+/**
+   Cost of the pitch tracker (ps_pitch.c) in README.txt.  First
+   ps_pitch_process() on 10 s of the test tone at 48 kHz in 256-frame
+   blocks, in ms of CPU per second of audio, by estimates per second, with
+   the SOLA engine (mono, quality 2) at alpha 0.75 - 1.5 for comparison.
+   Then the YIN difference function of one estimate, a PS_PITCH_WIN-sample
+   window over PS_PITCH_LAGS lags of the decimated tone: the energies and
+   ps_align_correlate() as in the tracker, against the direct sum, in us,
+   best of REPS runs of CALLS calls.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_pitch.h"
+
+#define RATE    48000
+#define SECONDS 10
+#define N       (SECONDS*RATE)
+#define BLOCK   256
+#define REPS    5
+#define CALLS   2000
+
+#define WIN   PS_PITCH_WIN
+#define LAGS  PS_PITCH_LAGS
+#define X_LEN (WIN + LAGS - 1)
+
+static const float updates[] = {10, 20, 40, 50, 80, 160};
+static const float alphas[] = {0.75, 1.26, 1.5};
+
+#define UPDATES ((int)(sizeof(updates)/sizeof(updates[0])))
+#define ALPHAS  ((int)(sizeof(alphas)/sizeof(alphas[0])))
+
+/** Best ms per second of audio of the tracker at `rate` estimates/s. */
+static double
+tracker_ms(PsPitch* pt, const float* x, float rate)
+{
+   double t, best = -1;
+   int r, pos;
+
+   ps_pitch_set_updates(pt, rate);
+   for (r = 0; r < REPS; r++) {
+      ps_pitch_reset(pt);
+      t = bench_cpu();
+      for (pos = 0; pos + BLOCK <= N; pos += BLOCK)
+         ps_pitch_process(pt, x + pos, BLOCK);
+      t = 1e3*(bench_cpu() - t)/SECONDS;
+      best = best < 0 || t < best ? t : best;
+   }
+   return best;
+}
+
+/** d(tau) from the energies and one FFT cross-correlation. */
+static void
+difference_fft(PsAlign* align, const float* x, float* e, float* d)
+{
+   int j, tau;
+
+   for (j = 0, e[0] = 0; j < X_LEN; j++)
+      e[j + 1] = e[j] + x[j]*x[j];
+   ps_align_correlate(align, x, WIN, x, X_LEN, d, LAGS);
+   for (tau = 0; tau < LAGS; tau++)
+      d[tau] = e[WIN] + e[tau + WIN] - e[tau] - 2*d[tau];
+}
+
+/** d(tau) summed directly, O(WIN * LAGS). */
+static void
+difference_direct(const float* x, float* d)
+{
+   int j, tau;
+   float diff, sum;
+
+   for (tau = 0; tau < LAGS; tau++) {
+      for (j = 0, sum = 0; j < WIN; j++) {
+         diff = x[j] - x[j + tau];
+         sum += diff*diff;
+      }
+      d[tau] = sum;
+   }
+}
+
+/** Best us per call of the FFT (`fft` set) or direct difference. */
+static double
+difference_us(PsAlign* align, const float* x, int fft)
+{
+   static float e[X_LEN + 1], d[LAGS];
+   volatile float sink = 0;
+   double t, best = -1;
+   int r, k;
+
+   for (r = 0; r < REPS; r++) {
+      t = bench_cpu();
+      for (k = 0; k < CALLS; k++) {
+         if (fft)
+            difference_fft(align, x, e, d);
+         else
+            difference_direct(x, d);
+         sink += d[k % LAGS];
+      }
+      t = 1e6*(bench_cpu() - t)/CALLS;
+      best = best < 0 || t < best ? t : best;
+   }
+   (void)sink;
+   return best;
+}
+
+int main(void) {
+   static float dec[X_LEN];
+   float* x = malloc((size_t)N*sizeof(float));
+   PsEngine ps;
+   PsParams p;
+   PsPitch pt;
+   PsAlign align;
+   double ms, sola;
+   int u, a, j, k, step;
+
+   if (x == NULL || ps_pitch_init(&pt, RATE, 50) != 0 ||
+       ps_engine_init(&ps, RATE, 1, 1) != 0 ||
+       ps_align_init(&align, X_LEN) != 0) {
+      fprintf(stderr, "bench_pitch: allocation failed\n");
+      return 1;
+   }
+   bench_tone(x, N, RATE);
+
+   printf("estimates per second  ");
+   for (u = 0; u < UPDATES; u++)
+      printf(" %5.0f", updates[u]);
+   printf("\nms per second of audio");
+   for (u = 0; u < UPDATES; u++) {
+      ms = tracker_ms(&pt, x, updates[u]);
+      printf(" %5.2f", ms);
+   }
+
+   memset(&p, 0, sizeof(p));
+   p.mode = PS_MODE_SOLA;
+   p.quality = PS_RS_MEDIUM;
+   p.gain[0] = 1;
+   printf("\nSOLA, ms per second of audio, alpha");
+   for (a = 0; a < ALPHAS; a++) {
+      p.alpha[0] = alphas[a];
+      sola = bench_engine_ms_on(&ps, &p, x, N, BLOCK, REPS);
+      printf("  %.2f: %.1f", alphas[a], sola);
+   }
+
+   /* The window the tracker analyses: box averages of the tone */
+   step = pt.dec;
+   for (j = 0; j < X_LEN; j++) {
+      for (k = 0, dec[j] = 0; k < step; k++)
+         dec[j] += x[j*step + k];
+      dec[j] /= step;
+   }
+   printf("\ndifference function, us per estimate: FFT %.1f, direct %.1f\n",
+          difference_us(&align, dec, 1), difference_us(&align, dec, 0));
+
+   ps_align_free(&align);
+   ps_engine_free(&ps);
+   ps_pitch_free(&pt);
+   free(x);
+   return 0;
+}
@@ -0,0 +1,59 @@
+/**
+   PSOLA against SOLA on the monophonic signals PSOLA is meant for: the
+   voice and the bass of test/bench.h, 6 s each at 48 kHz, mono, alpha
+   0.75 and 1.5, in ms of CPU per second of audio (256-frame blocks, best
+   of REPS).
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+#define RATE    48000
+#define SECONDS 6
+#define N       (SECONDS*RATE)
+#define REPS    3
+
+static const float alphas[] = {0.75, 1.5};
+
+static void
+row(PsEngine* ps, const char* name, const float* x)
+{
+   PsParams p;
+   int mode, a;
+
+   memset(&p, 0, sizeof(p));
+   p.gain[0] = 1;
+   printf("%-38s", name);
+   for (mode = 0; mode < 2; mode++) {
+      p.mode = mode == 0 ? PS_MODE_SOLA : PS_MODE_PSOLA;
+      for (a = 0; a < 2; a++) {
+         p.alpha[0] = alphas[a];
+         printf("%s%4.1f", a == 0 ? "  " : " / ",
+                bench_engine_ms_on(ps, &p, x, N, 256, REPS));
+      }
+   }
+   printf("\n");
+}
+
+int main(void) {
+   float* x = malloc((size_t)N*sizeof(float));
+   PsEngine ps;
+
+   if (x == NULL || ps_engine_init(&ps, RATE, 1, 1) != 0) {
+      fprintf(stderr, "bench_psola: allocation failed\n");
+      free(x);
+      return 1;
+   }
+
+   printf("ms/s, alpha 0.75 / 1.5                  SOLA         PSOLA\n");
+   bench_voice(x, NULL, N, RATE);
+   row(&ps, "voice, 180 Hz with vibrato and gaps", x);
+   bench_bass(x, NULL, N, RATE);
+   row(&ps, "bass, 49 - 98 Hz plucked notes", x);
+
+   ps_engine_free(&ps);
+   free(x);
+   return 0;
+}
@@ -0,0 +1,96 @@
+/**
+   Cost across sample rates.  The SOLA engine (mono, quality 2, 256-frame
+   blocks) in ms of CPU per second of audio, the mean over alpha 0.5 - 2,
+   with the searches decimated from 88.2 kHz and at the full rate (-s of
+   ps-render); then the time stretcher, the mean over ratios 0.5 - 2.  The
+   searches are sized in milliseconds, but the resampling and crossfades
+   are per-sample work, so the cost grows with the rate.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_stretch.h"
+
+#define BLOCK 256
+#define REPS  3
+
+static const double rates[] = {44100, 48000, 88200, 96000, 176400, 192000};
+static const float alphas[] = {0.5, 0.75, 1.0, 1.26, 1.5, 2.0};
+
+#define RATES  ((int)(sizeof(rates)/sizeof(rates[0])))
+#define ALPHAS ((int)(sizeof(alphas)/sizeof(alphas[0])))
+
+/** Mean ms per second of audio of the engine over the alphas. */
+static double
+engine_ms(double rate, int full_search)
+{
+   PsEngine ps;
+   PsParams params;
+   double sum = 0;
+   int a;
+
+   if (ps_engine_init(&ps, rate, 1, 1) != 0)
+      return -1;
+   memset(&params, 0, sizeof(params));
+   params.mode = PS_MODE_SOLA;
+   params.quality = PS_RS_MEDIUM;
+   params.gain[0] = 1.0;
+   params.full_search = full_search;
+   for (a = 0; a < ALPHAS; a++) {
+      params.alpha[0] = alphas[a];
+      sum += bench_engine_ms(&ps, &params, 5, BLOCK, REPS);
+   }
+   ps_engine_free(&ps);
+
+   return sum/ALPHAS;
+}
+
+/** Mean ms per second of input of the stretcher over the ratios. */
+static double
+stretch_ms(double rate)
+{
+   const int n = (int)(5*rate);
+   float* in = malloc(n*sizeof(float));
+   float out[(int)(BLOCK*PS_STRETCH_MAX) + 1];
+   PsStretch st;
+   double t, best, sum = 0;
+   int a, r, pos;
+
+   if (in == NULL || ps_stretch_init(&st, rate, 1, BLOCK) != 0)
+      return -1;
+   bench_tone(in, n, rate);
+   for (a = 0; a < ALPHAS; a++) {
+      ps_stretch_set_ratio(&st, alphas[a]);
+      for (r = 0, best = -1; r < REPS; r++) {
+         ps_stretch_reset(&st);
+         t = bench_cpu();
+         for (pos = 0; pos + BLOCK <= n; pos += BLOCK) {
+            ps_stretch_push(&st, in + pos, BLOCK);
+            while (ps_stretch_pull(&st, out, sizeof(out)/sizeof(out[0])) > 0)
+               ;
+         }
+         t = 1e3*(bench_cpu() - t)*rate/n;
+         best = (best < 0 || t < best) ? t : best;
+      }
+      sum += best;
+   }
+   ps_stretch_free(&st);
+   free(in);
+
+   return sum/ALPHAS;
+}
+
+int main(void) {
+   int r;
+
+   printf("ms per second of audio\n");
+   printf("rate        hop   SOLA    full-rate search   stretcher\n");
+   for (r = 0; r < RATES; r++)
+      printf("%5.1f kHz  %4d   %5.1f   %5.1f              %5.1f\n",
+             rates[r]/1000, ps_sola_hop(rates[r]), engine_ms(rates[r], 0),
+             engine_ms(rates[r], 1), stretch_ms(rates[r]));
+
+   return 0;
+}
@@ -0,0 +1,96 @@
+/**
+   The resampling stage of the SOLA engine against the book's (resampleBook()
+   in test/ps_ref.c): ns per output sample of each quality tier over alpha
+   0.5 - 2, on the 1024-sample frames of the engine at 44.1 kHz, and the
+   level of a tone at 0.42 of the rate, folded back to 0.37 by alpha = 1.5.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "ps_ref.h"
+#include "ps_resample.h"
+
+#define FRAME  1024
+#define PAD    (PS_RS_MAX_TAPS/2)
+#define IN_LEN (2*FRAME + PS_RS_MAX_TAPS)
+#define CALLS  2000
+#define REPS   9
+
+static const float alphas[] = {0.5, 0.75, 1.0, 1.26, 1.5, 2.0};
+#define ALPHAS ((int)(sizeof(alphas)/sizeof(alphas[0])))
+
+static float in_mem[PAD + IN_LEN];
+static float out[FRAME];
+static float x[FRAME];
+
+/** Best ns per output sample of a tier (-1 for the book's version). */
+static double
+time_tier(const PsResampler* rs, int quality, float alpha)
+{
+   const float* in = in_mem + PAD;
+   const int lx = floor(FRAME * alpha);
+   double t, best = -1;
+   int r, k;
+
+   for (r = 0; r < REPS; r++) {
+      t = bench_now();
+      for (k = 0; k < CALLS; k++) {
+         if (quality < 0)
+            resampleBook(in, out, x, FRAME, alpha);
+         else
+            ps_resample_process(rs, quality, in, out, FRAME,
+                                lx/(double)FRAME, 1);
+      }
+      t = 1e9*(bench_now() - t)/((double)CALLS*FRAME);
+      if (best < 0 || t < best)
+         best = t;
+   }
+   return best;
+}
+
+/** Level in dB of what is left of a tone at 0.42 of the rate at alpha 1.5. */
+static double
+alias_level(const PsResampler* rs, int quality)
+{
+   const float* in = in_mem + PAD;
+   double sum = 0;
+   int i;
+
+   for (i = -PAD; i < IN_LEN; i++)
+      in_mem[PAD + i] = sin(2*PI*0.42*i);
+   ps_resample_process(rs, quality, in, out, FRAME, 1.5, 1);
+   for (i = PAD; i < FRAME; i++)
+      sum += out[i]*out[i];
+
+   return 10*log10(2*sum/(FRAME - PAD));
+}
+
+int main(void) {
+   static const char* names[] = {"linear", "8 taps", "16 taps", "32 taps"};
+   PsResampler rs;
+   double t, lo, hi;
+   int q, a;
+
+   if (ps_resample_init(&rs) != 0) {
+      fprintf(stderr, "bench_resample: out of memory\n");
+      return 1;
+   }
+
+   printf("quality   ns/sample     level of a tone folded back by 1.5\n");
+   for (q = -1; q < PS_RS_TIERS; q++) {
+      bench_tone(in_mem, PAD + IN_LEN, 44100);
+      for (a = 0, lo = hi = -1; a < ALPHAS; a++) {
+         t = time_tier(&rs, q, alphas[a]);
+         lo = (lo < 0 || t < lo) ? t : lo;
+         hi = (t > hi) ? t : hi;
+      }
+      if (q < 0)
+         printf("book      %.1f - %.1f\n", lo, hi);
+      else
+         printf("%-9s %.1f - %.1f     %.0f dB\n", names[q], lo, hi,
+                alias_level(&rs, q));
+   }
+
+   ps_resample_free(&rs);
+   return 0;
+}
@@ -0,0 +1,48 @@
+/**
+   Scaling of the harmonizer with its voices: the engine of
+   "Dafx Harmonizer" (four voices, mono, 44.1 kHz, 256-frame blocks) with
+   1 to 4 voices sounding, the others at gain 0, in SOLA and phase-vocoder
+   mode.  Prints ms per second of audio and the cost relative to one voice.
+   Only the phase vocoder shares its analysis; SOLA voices share the queue.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+int main(void) {
+   static const float alphas[PS_MAX_VOICES] = {1.26, 1.5, 0.75, 2.0};
+   static const int modes[] = {PS_MODE_SOLA, PS_MODE_PVOC};
+   static const char* names[] = {"SOLA", "Phase vocoder"};
+   PsEngine ps;
+   PsParams params;
+   double ms, one;
+   int m, v;
+
+   if (ps_engine_init(&ps, 44100, 1, PS_MAX_VOICES) != 0) {
+      fprintf(stderr, "bench_voices: out of memory\n");
+      return 1;
+   }
+   memset(&params, 0, sizeof(params));
+   params.quality = PS_RS_MEDIUM;
+   memcpy(params.alpha, alphas, sizeof(alphas));
+
+   printf("voices              1              2              3              4\n");
+   for (m = 0; m < 2; m++) {
+      params.mode = modes[m];
+      printf("%-14s", names[m]);
+      for (v = 0, one = 1; v < PS_MAX_VOICES; v++) {
+         params.gain[v] = 1.0/PS_MAX_VOICES;
+         ms = bench_engine_ms(&ps, &params, 10, 256, 3);
+         if (v == 0)
+            one = ms;
+         printf("  %5.1f ms %3.1fx", ms, ms/one);
+      }
+      printf("\n");
+      memset(params.gain, 0, sizeof(params.gain));
+   }
+
+   ps_engine_free(&ps);
+   return 0;
+}
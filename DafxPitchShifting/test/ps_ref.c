@@ -0,0 +1,92 @@
+#include <math.h>
+#include <string.h>
+
+#include "ps_ref.h"
+
+int maxSimIndex(const float* u, int uLen, const float* v, int vLen) {
+   int i, j, index = 0;
+   float min = 0, sum, term;
+
+   for (i = -uLen; i < vLen; i++) {
+      for (j = i, sum = 0; j < i + uLen; j++) {
+         if (j < 0) {
+            term = fabs(u[j - i] - 0);
+         }
+         else if (j <= vLen) {
+            term = fabs(u[j - i] - v[j]);
+         }
+         else {
+            term = fabs(u[j - i] - 0);
+         }
+
+         if (term == 0) sum += -1;
+         else sum += term;
+      }
+      if (i == -uLen || sum < min) {
+         min = sum;
+         index = i;
+      }
+   }
+
+   return index;
+}
+
+
+int maxSimIndex2(const float* u, int uLen, const float* v, int vLen) {
+   int i, j, index = 0;
+   float min = 0, sum;
+
+   for (i = 0; i < vLen; i++) {
+      for (j = i, sum = 0; j < i + uLen; j++) {
+         if (j < vLen) sum += fabs(u[j - i] - v[j]);
+         else sum += fabs(u[j - i] - 0);
+      }
+      if (i == 0 || sum < min) {
+         min = sum;
+         index = i;
+      }
+   }
+
+   return index;
+}
+
+
+void resampleBook(const float* result, float* tail, float* x, int lfen,
+                  float alpha) {
+   int i, lx;
+   float term;
+
+   lx = floor(lfen * alpha);
+
+   for (i = 0; i < lfen; i++) {
+      x[i] = i*lx/((float)lfen);
+   }
+
+   for (i = 0; i < lfen; i++) {
+      term = (x[i] - floor(x[i]));
+      tail[i] = result[(int)floor(x[i])] * (1.0 - term);
+      tail[i] += result[(int)floor(x[i]) + 1] * term;
+   }
+}
+
+
+int spliceBook(float* result, int res_len, int cut, const float* grain,
+               int grain_len, int channels) {
+   int j, c, fadeLen;
+   float term;
+   const int C = channels;
+
+   for (j = cut; j < res_len; j++) {
+      term = (j - cut)/((float)(res_len - cut));
+      for (c = 0; c < C; c++) {
+         result[j*C + c] *= 1.0 - term;
+         result[j*C + c] += grain[(j - cut)*C + c] * term;
+      }
+   }
+
+   fadeLen = res_len - cut;
+   memcpy(result + res_len*C, grain + fadeLen*C,
+          (grain_len - fadeLen)*C*sizeof(float));
+
+   return cut + grain_len;
+}
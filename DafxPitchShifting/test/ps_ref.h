@@ -0,0 +1,36 @@
+#ifndef PS_REF_H
+#define PS_REF_H
+
+/**
+   The book's versions of the stages the engine has replaced, kept as they
+   were (apart from const and initialised locals) as references for the
+   tests and benchmarks.
+*/
+
+/**
+   Brute-force splice search of the TimeScaleSOLA loop: the lag in
+   [-uLen, vLen) with the smallest sum of absolute differences.  It reads
+   v[vLen], as the book's version does.
+*/
+int maxSimIndex(const float* u, int uLen, const float* v, int vLen);
+
+/** Brute-force output splice search: the same over lags [0, vLen). */
+int maxSimIndex2(const float* u, int uLen, const float* v, int vLen);
+
+/**
+   Resampling of the time-scaled frames: the read positions x[i] =
+   i * lx / lfen in an index array, then linear interpolation with floor(),
+   for lfen output samples with lx = floor(lfen * alpha).
+*/
+void resampleBook(const float* result, float* tail, float* x, int lfen,
+                  float alpha);
+
+/**
+   Grain splice: crossfade the grain into `result` from frame `cut` to
+   `res_len` with a division per frame, then append the rest of the grain.
+   Returns the new length, cut + grain_len.
+*/
+int spliceBook(float* result, int res_len, int cut, const float* grain,
+               int grain_len, int channels);
+
+#endif
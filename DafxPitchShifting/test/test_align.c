@@ -0,0 +1,230 @@
+/**
+   The FFT splice search (ps_align.c) against the brute-force searches of the
+   book: it must find the lag of least squared difference exactly, and its
+   splice points must stay within the tolerance stated in ps_align.h, on
+   random grains and on the grains the TimeScaleSOLA loop sees at every
+   alpha.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_align.h"
+#include "ps_fade.h"
+#include "ps_ref.h"
+#include "ps_stretch.h"
+
+#define MAX_L   128
+#define N       512     // grain of the TimeScaleSOLA loop at 44.1 kHz
+#define SA      128
+#define FRAMES  40
+
+static int failures = 0;
+
+/** Sum of (u[j - k] - v[j])^2 over the lag k, v zero outside [0, vLen). */
+static double
+l2(const float* u, int uLen, const float* v, int vLen, int k)
+{
+   double d, sum = 0;
+   int j;
+
+   for (j = k; j < k + uLen; j++) {
+      d = u[j - k] - ((j >= 0 && j < vLen) ? v[j] : 0);
+      sum += d*d;
+   }
+   return sum;
+}
+
+/**
+   The criterion of the brute-force searches, without the bonus of
+   maxSimIndex() for exact matches.  maxSimIndex() also reads v[vLen],
+   maxSimIndex2() does not.
+*/
+static double
+l1(const float* u, int uLen, const float* v, int vLen, int k)
+{
+   double sum = 0;
+   int j;
+
+   for (j = k; j < k + uLen; j++)
+      sum += fabs(u[j - k] - ((j >= 0 && j < vLen) ? v[j] : 0));
+   return sum;
+}
+
+/** Tallies of the search against the reference. */
+typedef struct {
+   int calls;
+   int same;      // same lag
+   int within10;  // L1 distance within 10% of the reference's
+   int within50;
+} Tally;
+
+/** Tally the lag found by the search against the reference's. */
+static void
+tally(Tally* t, const float* u, int uLen, const float* v, int vLen,
+      int lag, int ref)
+{
+   const double d = l1(u, uLen, v, vLen, lag);
+   const double d_ref = l1(u, uLen, v, vLen, ref);
+
+   t->calls++;
+   t->same += lag == ref;
+   t->within10 += d <= 1.1*d_ref + 1e-6;
+   t->within50 += d <= 1.5*d_ref + 1e-6;
+}
+
+/** A grain and the stretch it is searched in, from two random partials. */
+static void
+random_grain(uint32_t* seed, float* u, float* v, int L, int V, int noise)
+{
+   float s[8*MAX_L + 1];
+   const double f1 = 40 + 980*(1 + bench_rand(seed));
+   const double f2 = f1*(1.5 + bench_rand(seed));
+   const double a2 = 0.5*(1 + bench_rand(seed));
+   const double p = PI*bench_rand(seed);
+   const int d = (int)((V + L)*0.5*(1 + bench_rand(seed)));
+   int i;
+
+   for (i = 0; i < 8*MAX_L + 1; i++) {
+      s[i] = sin(2*PI*f1*i/44100 + p) + a2*sin(2*PI*f2*i/44100);
+      if (noise)
+         s[i] += 0.1*bench_rand(seed);
+   }
+   memcpy(u, s + d, L*sizeof(float));
+   memcpy(v, s + 2*MAX_L, (V + 1)*sizeof(float));
+}
+
+/**
+   The figures of ps_align.h, in percent of the calls, as it rounds them:
+   the same lag as the brute-force search (negative when not stated), the
+   L1 distance within 10% of the brute-force minimum and within 50%.
+*/
+typedef struct {
+   double same;
+   double within10;
+   double within50;
+} Figures;
+
+/** The tally against the figures stated for `what`. */
+static void
+check_tally(const Tally* t, const char* what, const Figures* f)
+{
+   const double same = 100.0*t->same/t->calls;
+   const double within10 = 100.0*t->within10/t->calls;
+   const double within50 = 100.0*t->within50/t->calls;
+
+   printf("%-26s same lag %5.1f%%  L1 within 10%% %5.1f%%  within 50%% %5.1f%%\n",
+          what, same, within10, within50);
+   CHECK(f->same < 0 || same >= f->same - 0.5,
+         "%s: same lag in %.1f%% of the calls, not %g%%", what, same, f->same);
+   CHECK(within10 >= f->within10 - 0.5,
+         "%s: within 10%% in %.1f%% of the calls, not %g%%", what, within10,
+         f->within10);
+   CHECK(within50 >= f->within50 - 0.5,
+         "%s: within 50%% in %.1f%% of the calls, not %g%%", what, within50,
+         f->within50);
+}
+
+/**
+   4000 random grains, L = 16..128, half of them with noise, searched as
+   maxSimIndex() (lags -L..L) and as maxSimIndex2() (lags 0..V).  Each
+   result is checked against the exact least-squares lag.
+*/
+static void
+test_random(PsAlign* align)
+{
+   static const Figures grain_figures = {57, 92, 99};
+   static const Figures out_figures = {94, 99, 100};
+   float u[MAX_L], v[4*MAX_L + 1];
+   Tally grain = {0}, out = {0};
+   uint32_t seed = 1;
+   double best, found;
+   int n, k, L, V, lag, lo;
+
+   for (n = 0; n < 4000; n++) {
+      L = 16 + (int)(56*(1 + bench_rand(&seed)));
+      V = (n & 2) ? L : 4*MAX_L - L;
+      random_grain(&seed, u, v, L, V, n & 1);
+
+      lo = (V == L) ? -L : 0;
+      lag = ps_align_search(align, u, L, v, V, lo, V);
+      if (V == L)
+         tally(&grain, u, L, v, V + 1, lag, maxSimIndex(u, L, v, V));
+      else
+         tally(&out, u, L, v, V, lag, maxSimIndex2(u, L, v, V));
+
+      for (k = lo, best = -1; k < V; k++)
+         if (best < 0 || l2(u, L, v, V, k) < best)
+            best = l2(u, L, v, V, k);
+      found = l2(u, L, v, V, lag);
+      CHECK(found <= best + 1e-4*(l2(u, L, v, V, -L) + 1),
+            "L = %d, V = %d: lag %d is %g from the least squares (%g)",
+            L, V, lag, found, best);
+   }
+   check_tally(&grain, "random grains", &grain_figures);
+   check_tally(&out, "random output splices", &out_figures);
+}
+
+/**
+   The TimeScaleSOLA loop of the engine, on consecutive frames of the test
+   tone, at every alpha of the README tables.  Both searches see the same
+   result; the loop follows the FFT one.
+*/
+static void
+test_alpha(PsAlign* align, PsFade* fade)
+{
+   static const float alphas[] = {0.5, 0.75, 1.0, 1.26, 1.5, 2.0};
+   static const Figures figures[] = {
+      {-1, 99, 100}, {-1, 98, 100}, {-1, 100, 100}, {-1, 76, 98},
+      {-1, 82, 99}, {-1, 87, 100}
+   };
+   float in[(FRAMES + 2)*N];
+   float result[4*N + 2*MAX_L + 1];
+   float u[MAX_L], v[MAX_L];
+   char what[32];
+   int a, f, i, L, Ss, pos, cut, ref, resLen;
+
+   bench_tone(in, (FRAMES + 2)*N, 44100);
+
+   for (a = 0; a < (int)(sizeof(alphas)/sizeof(alphas[0])); a++) {
+      Tally t = {0};
+
+      Ss = round(SA*alphas[a]);
+      L = round(SA*alphas[a]/2.0);
+      for (f = 0; f < FRAMES; f++) {
+         memset(result, 0, sizeof(result));
+         memcpy(result, in + f*N, 2*N*sizeof(float));
+         resLen = N;
+         for (i = 1; i < 2*N/SA; i++) {
+            pos = i*Ss;
+            cut = ps_sola_cut(align, result, resLen, pos, in + f*N + i*SA,
+                              N, L, 1, 1, u, v);
+            ref = maxSimIndex(in + f*N + i*SA, L, result + pos, L);
+            tally(&t, in + f*N + i*SA, L, result + pos, L + 1, cut - pos,
+                  ref);
+            resLen = ps_sola_join(fade, PS_FADE_LINEAR, result, resLen, cut,
+                                  in + f*N + i*SA, N, 1);
+         }
+      }
+      snprintf(what, sizeof(what), "TimeScaleSOLA, alpha %.2f", alphas[a]);
+      check_tally(&t, what, &figures[a]);
+   }
+}
+
+int main(void) {
+   PsAlign align;
+   PsFade fade;
+
+   if (ps_align_init(&align, 5*MAX_L) != 0 || ps_fade_init(&fade, N) != 0) {
+      fprintf(stderr, "test_align: out of memory\n");
+      return 1;
+   }
+
+   test_random(&align);
+   test_alpha(&align, &fade);
+
+   ps_align_free(&align);
+   ps_fade_free(&fade);
+   return failures ? 1 : 0;
+}
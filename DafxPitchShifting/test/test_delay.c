@@ -0,0 +1,182 @@
+/**
+   The delay-line mode (ps_delay.c).  Its latency is half a window, 256
+   samples, at every rate: at alpha 1 the output is the input 256 samples
+   late, sample for sample, and at other alphas clicks come out with their
+   centroid within MAX_SKEW of 256 samples late on average, the middle of
+   the window the taps sweep.  Its cost per sample is the same for every
+   alpha and block size, within MAX_SPREAD of the cheapest case, where the
+   SOLA engine's varies threefold.  Switching modes in run() without
+   allocating is checked by test/test_rt.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_delay.h"
+
+#define LATENCY    (PS_DELAY_WINDOW/2)
+#define CLICKS     1500
+#define GAP        1499      // samples between clicks, odd against the sweep
+#define MAX_SKEW   4
+#define MAX_SPREAD 2.0
+#define REPS       3
+#define ROUNDS     3
+
+static int failures = 0;
+
+static void
+render(PsEngine* ps, const PsParams* p, const float* x, float* y, int n,
+       int block)
+{
+   const float* in[1];
+   float* out[1];
+   int pos, len;
+
+   ps_engine_reset(ps);
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      in[0] = x + pos;
+      out[0] = y + pos;
+      ps_engine_process(ps, in, out, len, p);
+   }
+}
+
+static void
+test_latency(double rate)
+{
+   static const float alphas[] = {0.5, 0.75, 1.26, 1.5, 2};
+   const int n = CLICKS*GAP;
+   float* x = calloc(2*(size_t)n, sizeof(float));
+   float* y = x + n;
+   double sum, moment, skew;
+   PsEngine ps;
+   PsParams p;
+   int a, k, i, same, heard;
+
+   memset(&p, 0, sizeof(p));
+   p.mode = PS_MODE_DELAY;
+   p.gain[0] = 1;
+   if (x == NULL || ps_engine_init(&ps, rate, 1, 1) != 0) {
+      CHECK(0, "allocation failed");
+      free(x);
+      return;
+   }
+
+   p.alpha[0] = 1;
+   CHECK(ps_engine_latency(&ps, &p) == LATENCY, "%.0f Hz: latency %d",
+         rate, ps_engine_latency(&ps, &p));
+   bench_tone(x, n, rate);
+   render(&ps, &p, x, y, n, 256);
+   for (i = 0, same = 1; i < n; i++)
+      same &= y[i] == (i < LATENCY ? 0 : x[i - LATENCY]);
+   CHECK(same, "%.0f Hz, alpha 1: not the input %d samples late", rate,
+         LATENCY);
+
+   memset(x, 0, (size_t)n*sizeof(float));
+   for (k = 0; k < CLICKS; k++)
+      x[k*GAP] = 1;
+   for (a = 0; a < (int)(sizeof(alphas)/sizeof(alphas[0])); a++) {
+      p.alpha[0] = alphas[a];
+      CHECK(ps_engine_latency(&ps, &p) == LATENCY, "%.0f Hz, alpha %.2f: "
+            "latency %d", rate, alphas[a], ps_engine_latency(&ps, &p));
+      render(&ps, &p, x, y, n, 256);
+      /* At alpha 2 the taps read every other sample and can skip a click */
+      for (k = 0, skew = 0, heard = 0; k + 1 < CLICKS; k++) {
+         for (i = 0, sum = moment = 0; i < GAP; i++) {
+            sum += fabs(y[k*GAP + i]);
+            moment += i*fabs(y[k*GAP + i]);
+         }
+         if (sum > 0) {
+            skew += moment/sum - LATENCY;
+            heard++;
+         }
+      }
+      skew = heard > 0 ? skew/heard : LATENCY;
+      printf("%6.0f Hz, alpha %.2f: %4d clicks, %+.2f samples from the "
+             "latency\n", rate, alphas[a], heard, skew);
+      CHECK(fabs(skew) <= MAX_SKEW, "%.0f Hz, alpha %.2f: clicks %.1f "
+            "samples from the latency", rate, alphas[a], skew);
+   }
+
+   ps_engine_free(&ps);
+   free(x);
+}
+
+/** Best ns per sample of `mode` on one second of the tone. */
+static double
+ns_per_sample(PsEngine* ps, int mode, float alpha, int block)
+{
+   PsParams p;
+
+   memset(&p, 0, sizeof(p));
+   p.mode = mode;
+   p.gain[0] = 1;
+   p.alpha[0] = alpha;
+   return 1e6*bench_engine_ms(ps, &p, 1, block, REPS)/ps->rate;
+}
+
+/** Alphas and block sizes of the cost grid. */
+#define A 4
+#define B 3
+
+/**
+   The grid is timed ROUNDS times over and each case keeps its best, so a
+   slow spell of the machine does not land on one case only.
+*/
+static void
+test_cost(void)
+{
+   static const float alphas[A] = {0.5, 0.75, 1.26, 2};
+   static const int blocks[B] = {64, 256, 4096};
+   double t, best[A][B], sola[A], lo = -1, hi = 0, sola_lo = -1, sola_hi = 0;
+   PsEngine ps;
+   int a, b, r;
+
+   if (ps_engine_init(&ps, 48000, 1, 1) != 0) {
+      CHECK(0, "allocation failed");
+      return;
+   }
+   for (r = 0; r < ROUNDS; r++) {
+      for (a = 0; a < A; a++) {
+         for (b = 0; b < B; b++) {
+            t = ns_per_sample(&ps, PS_MODE_DELAY, alphas[a], blocks[b]);
+            best[a][b] = r == 0 || t < best[a][b] ? t : best[a][b];
+         }
+         t = ns_per_sample(&ps, PS_MODE_SOLA, alphas[a], 256);
+         sola[a] = r == 0 || t < sola[a] ? t : sola[a];
+      }
+   }
+
+   printf("delay line, ns/sample   ");
+   for (b = 0; b < B; b++)
+      printf("  %4d frames", blocks[b]);
+   printf("\n");
+   for (a = 0; a < A; a++) {
+      printf("  alpha %.2f            ", alphas[a]);
+      for (b = 0; b < B; b++) {
+         lo = lo < 0 || best[a][b] < lo ? best[a][b] : lo;
+         hi = best[a][b] > hi ? best[a][b] : hi;
+         printf("  %8.1f   ", best[a][b]);
+      }
+      sola_lo = sola_lo < 0 || sola[a] < sola_lo ? sola[a] : sola_lo;
+      sola_hi = sola[a] > sola_hi ? sola[a] : sola_hi;
+      printf("\n");
+   }
+   printf("delay line %.1f - %.1f ns/sample, SOLA at 256 frames "
+          "%.0f - %.0f\n", lo, hi, sola_lo, sola_hi);
+   CHECK(hi <= MAX_SPREAD*lo, "delay line from %.1f to %.1f ns/sample",
+         lo, hi);
+   ps_engine_free(&ps);
+}
+
+int
+main(void)
+{
+   test_latency(44100);
+   test_latency(48000);
+   test_latency(96000);
+   test_cost();
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,88 @@
+/**
+   The tabulated crossfades (ps_fade.c) against the book's splice: the
+   linear table is within 1e-5 of the division per frame, and with the same
+   weights ps_fade_mix() gives the book's samples to 1 ulp (of samples in
+   [-1, 1)) for any number of channels.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_fade.h"
+#include "ps_ref.h"
+
+#define GRAIN 512
+
+static int failures = 0;
+
+static void
+test_table(PsFade* fade)
+{
+   double err, worst = 0;
+   int den, j;
+
+   for (den = 1; den <= GRAIN; den++) {
+      ps_fade_weights(fade, PS_FADE_LINEAR, den, den);
+      for (j = 0; j < den; j++) {
+         err = fabs(fade->w_in[j] - j/(double)den);
+         worst = err > worst ? err : worst;
+         err = fabs(fade->w_out[j] - (1 - j/(double)den));
+         worst = err > worst ? err : worst;
+      }
+   }
+   printf("linear table, largest error %.2g\n", worst);
+   CHECK(worst <= 1e-5, "linear table off by %g", worst);
+}
+
+/** The splice of ps_sola_join() with exact weights against spliceBook(). */
+static void
+test_mix(PsFade* fade, int C)
+{
+   float grain[GRAIN*3];
+   float ref[3*GRAIN*3], out[3*GRAIN*3];
+   uint32_t seed = C;
+   double err, worst = 0;
+   int i, j, len, cut, res_len = GRAIN + GRAIN/4;
+
+   for (i = 0; i < GRAIN*C; i++)
+      grain[i] = bench_rand(&seed);
+   for (cut = res_len - 1; cut > res_len - GRAIN; cut -= 37) {
+      for (i = 0; i < 3*GRAIN*C; i++)
+         ref[i] = out[i] = bench_rand(&seed);
+
+      len = spliceBook(ref, res_len, cut, grain, GRAIN, C);
+      for (j = 0; j < res_len - cut; j++) {
+         fade->w_in[j] = j/((float)(res_len - cut));
+         fade->w_out[j] = 1.0 - fade->w_in[j];
+      }
+      ps_fade_mix(out + cut*C, grain, fade->w_out, fade->w_in, res_len - cut,
+                  C);
+      memcpy(out + res_len*C, grain + (res_len - cut)*C,
+             (GRAIN - (res_len - cut))*C*sizeof(float));
+
+      for (i = 0; i < len*C; i++) {
+         err = fabs(out[i] - ref[i]);
+         worst = err > worst ? err : worst;
+      }
+   }
+   printf("%d channel(s), largest difference %.2g\n", C, worst);
+   CHECK(worst <= 1.2e-7, "%d channels: difference %g", C, worst);
+}
+
+int main(void) {
+   PsFade fade;
+   int C;
+
+   if (ps_fade_init(&fade, GRAIN) != 0) {
+      fprintf(stderr, "test_fade: out of memory\n");
+      return 1;
+   }
+
+   test_table(&fade);
+   for (C = 1; C <= 3; C++)
+      test_mix(&fade, C);
+
+   ps_fade_free(&fade);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,248 @@
+/**
+   Delay of the SOLA engine against ps_engine_latency().  Noise under a
+   stepped envelope, after 0, 300 or 5000 samples of silence, is shifted at
+   44.1, 48 and 96 kHz; the delay that best lines up the envelope of the
+   output with that of the input is measured in the first and the last
+   1.5 s.  Both must be within three quarters of a hop of the reported
+   latency: half the output splice window, plus the spread of the delay of
+   the resampled grains around its table in ps_engine.c.  The output is
+   also compared bit for bit across block sizes.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+#define SECONDS 5.0
+#define WINDOW  1.5
+#define COARSE  8
+
+static int failures = 0;
+
+/**
+   `n` samples: `silence` zeros, then noise whose level steps every 10 to
+   60 ms, so the envelope has edges at every scale.
+*/
+static void
+make_input(float* x, int n, int silence, double rate)
+{
+   uint32_t seed = 11;
+   float level = 0;
+   int i, next = silence;
+
+   for (i = 0; i < n; i++) {
+      if (i == next) {
+         level = 0.05 + 0.75*(0.5 + 0.5*bench_rand(&seed));
+         next += (int)(rate*(0.035 + 0.025*bench_rand(&seed)));
+      }
+      x[i] = i < silence ? 0 : level*bench_rand(&seed);
+   }
+}
+
+/** Squares of `x` smoothed over `w` samples, centred. */
+static void
+envelope(const float* x, float* e, int n, int w)
+{
+   double sum = 0;
+   int i;
+
+   for (i = 0; i < n + w/2; i++) {
+      if (i < n)
+         sum += x[i]*x[i];
+      if (i >= w)
+         sum -= x[i - w]*x[i - w];
+      if (i >= w/2)
+         e[i - w/2] = sum;
+   }
+}
+
+/** Covariance of e_out[i] and e_in[i - d], i in [from, to) by `step`. */
+static double
+score(const float* e_in, const float* e_out, int from, int to, int d,
+      int step)
+{
+   double si = 0, so = 0, sio = 0;
+   int i, k = 0;
+
+   for (i = from; i < to; i += step, k++) {
+      si += e_in[i - d];
+      so += e_out[i];
+      sio += (double)e_in[i - d]*e_out[i];
+   }
+   return sio/k - (si/k)*(so/k);
+}
+
+/**
+   The delay in [0, max_lag] that lines up the envelopes best over the
+   output samples [from, to): a search on every COARSE-th lag and sample,
+   refined around its best lag.
+*/
+static int
+measure(const float* e_in, const float* e_out, int from, int to, int max_lag)
+{
+   double s, best = 0;
+   int d, lo, hi, lag = 0;
+
+   for (d = 0; d <= max_lag; d += COARSE) {
+      s = score(e_in, e_out, from, to, d, COARSE);
+      if (d == 0 || s > best) {
+         best = s;
+         lag = d;
+      }
+   }
+   lo = lag - COARSE > 0 ? lag - COARSE : 0;
+   hi = lag + COARSE < max_lag ? lag + COARSE : max_lag;
+   for (d = lo; d <= hi; d++) {
+      s = score(e_in, e_out, from, to, d, 1);
+      if (d == lo || s > best) {
+         best = s;
+         lag = d;
+      }
+   }
+   return lag;
+}
+
+static void
+render(PsEngine* ps, const PsParams* p, const float* x, float* y, int n,
+       int block)
+{
+   const float* in[1];
+   float* out[1];
+   int pos, len;
+
+   ps_engine_reset(ps);
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      in[0] = x + pos;
+      out[0] = y + pos;
+      ps_engine_process(ps, in, out, len, p);
+   }
+}
+
+static void
+test_delay(double rate, int pipelined)
+{
+   static const float alphas[] = { 0.5, 0.75, 1, 1.5, 2 };
+   static const int silences[] = { 0, 300, 5000 };
+   const int n = (int)(SECONDS*rate) + 5000;
+   const int win = (int)(WINDOW*rate);
+   float* x = malloc(4*(size_t)n*sizeof(float));
+   float* y = x + n;
+   float* e_in = x + 2*n;
+   float* e_out = x + 3*n;
+   PsEngine ps;
+   PsParams p;
+   int a, s, latency, max_lag, early, late, reach, w;
+
+   memset(&p, 0, sizeof(p));
+   p.pipelined = pipelined;
+   p.gain[0] = 1;
+   if (x == NULL || ps_engine_init(&ps, rate, 1, 1) != 0) {
+      CHECK(0, "allocation failed");
+      free(x);
+      return;
+   }
+   if (pipelined && ps_engine_start_helper(&ps) != 0) {
+      CHECK(0, "no helper thread");
+      ps_engine_free(&ps);
+      free(x);
+      return;
+   }
+   w = ps.sa;
+   reach = 3*ps.sa/4;
+   max_lag = 2*ps_engine_latency(&ps, &p);
+
+   for (a = 0; a < (int)(sizeof(alphas)/sizeof(alphas[0])); a++) {
+      p.alpha[0] = alphas[a];
+      latency = ps_engine_latency(&ps, &p);
+      for (s = 0; s < (int)(sizeof(silences)/sizeof(silences[0])); s++) {
+         make_input(x, n, silences[s], rate);
+         render(&ps, &p, x, y, n, 512);
+         envelope(x, e_in, n, w);
+         envelope(y, e_out, n, w);
+         early = measure(e_in, e_out, max_lag, max_lag + win, max_lag);
+         late = measure(e_in, e_out, n - win, n, max_lag);
+         printf("%6.0f Hz %s alpha %.2f silence %4d: latency %4d, "
+                "measured %4d then %4d\n", rate,
+                pipelined ? "pipelined" : "direct   ", alphas[a],
+                silences[s], latency, early, late);
+         CHECK(abs(early - latency) <= reach && abs(late - latency) <= reach,
+               "%.0f Hz alpha %.2f silence %d: delay %d, %d for %d",
+               rate, alphas[a], silences[s], early, late, latency);
+      }
+   }
+
+   ps_engine_free(&ps);
+   free(x);
+}
+
+/** Stereo, two voices: any block size gives the same samples. */
+static void
+test_blocks(void)
+{
+   static const int blocks[] = { 1, 64, 333, 4096, 20000 };
+   const double rate = 44100;
+   const int n = (int)(2*rate);
+   float* mem = malloc(6*(size_t)n*sizeof(float));
+   const float* in[2];
+   float* out[2];
+   const float* ip[2];
+   float* op[2];
+   float* ref = mem + 4*(size_t)n;
+   PsEngine ps;
+   PsParams p;
+   int b, c, pos, len, same = 1;
+
+   memset(&p, 0, sizeof(p));
+   p.alpha[0] = 1.26;
+   p.alpha[1] = 0.75;
+   p.gain[0] = p.gain[1] = 0.5;
+   p.dry = 0.25;
+   if (mem == NULL || ps_engine_init(&ps, rate, 2, 2) != 0) {
+      CHECK(0, "allocation failed");
+      free(mem);
+      return;
+   }
+   for (c = 0; c < 2; c++) {
+      in[c] = mem + (size_t)c*n;
+      out[c] = mem + (2 + (size_t)c)*n;
+   }
+   make_input((float*)in[0], n, 0, rate);
+   bench_tone((float*)in[1], n, rate);
+
+   for (b = 0; b < (int)(sizeof(blocks)/sizeof(blocks[0])); b++) {
+      ps_engine_reset(&ps);
+      for (pos = 0; pos < n; pos += len) {
+         len = n - pos < blocks[b] ? n - pos : blocks[b];
+         for (c = 0; c < 2; c++) {
+            ip[c] = in[c] + pos;
+            op[c] = out[c] + pos;
+         }
+         ps_engine_process(&ps, ip, op, len, &p);
+      }
+      if (b == 0)
+         memcpy(ref, out[0], 2*(size_t)n*sizeof(float));
+      else if (memcmp(ref, out[0], 2*(size_t)n*sizeof(float)) != 0)
+         same = 0;
+      CHECK(same, "blocks of %d differ from blocks of 1", blocks[b]);
+   }
+   printf("blocks of 1, 64, 333, 4096 and 20000 frames, %s\n",
+          same ? "identical" : "different");
+
+   ps_engine_free(&ps);
+   free(mem);
+}
+
+int
+main(void)
+{
+   test_delay(44100, 0);
+   test_delay(48000, 0);
+   test_delay(96000, 0);
+   test_delay(44100, 1);
+   test_delay(48000, 1);
+   test_blocks();
+
+   return failures ? 1 : 0;
+}
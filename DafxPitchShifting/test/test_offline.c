@@ -0,0 +1,86 @@
+/**
+   The offline renderer (ps_offline.c): its output must not depend on the
+   number of threads, and its first segment must be the streaming output of
+   the engine, latency compensated.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_offline.h"
+
+#define RATE     44100
+#define CHANNELS 2
+#define SECONDS  12
+
+static int failures = 0;
+
+int main(void) {
+   static const int threads[] = {2, 3, 0};
+   const size_t frames = SECONDS*RATE;
+   float* mem = malloc(4*CHANNELS*frames*sizeof(float));
+   float* input[CHANNELS];
+   float* ref[CHANNELS];
+   float* out[CHANNELS];
+   float* stream[CHANNELS];
+   size_t i, first, latency, pos, len;
+   PsEngine ps;
+   PsParams params;
+   int c, k;
+
+   if (mem == NULL || ps_engine_init(&ps, RATE, CHANNELS, 1) != 0) {
+      fprintf(stderr, "test_offline: out of memory\n");
+      return 1;
+   }
+   for (c = 0; c < CHANNELS; c++) {
+      input[c] = mem + (4*c)*frames;
+      ref[c] = mem + (4*c + 1)*frames;
+      out[c] = mem + (4*c + 2)*frames;
+      stream[c] = mem + (4*c + 3)*frames;
+      bench_tone(input[c], frames, RATE*(1 + 0.1*c));
+   }
+   memset(&params, 0, sizeof(params));
+   params.mode = PS_MODE_SOLA;
+   params.quality = PS_RS_MEDIUM;
+   params.alpha[0] = 1.26;
+   params.gain[0] = 1.0;
+
+   /* The same output with 1, 2, 3 and one thread per core */
+   CHECK(ps_render_offline((const float* const*)input, ref, frames, RATE,
+                           CHANNELS, 1, &params, 1) == 0, "render failed");
+   for (k = 0; k < (int)(sizeof(threads)/sizeof(threads[0])); k++) {
+      CHECK(ps_render_offline((const float* const*)input, out, frames, RATE,
+                              CHANNELS, 1, &params, threads[k]) == 0,
+            "render with %d threads failed", threads[k]);
+      for (c = 0; c < CHANNELS; c++)
+         CHECK(memcmp(ref[c], out[c], frames*sizeof(float)) == 0,
+               "channel %d differs with %d threads", c, threads[k]);
+   }
+
+   /* The first segment, up to the stitch with the second, is streamed */
+   for (pos = 0; pos < frames; pos += len) {
+      const float* in[CHANNELS];
+      float* o[CHANNELS];
+
+      len = frames - pos < 256 ? frames - pos : 256;
+      for (c = 0; c < CHANNELS; c++) {
+         in[c] = input[c] + pos;
+         o[c] = stream[c] + pos;
+      }
+      ps_engine_process(&ps, in, o, len, &params);
+   }
+   latency = ps_engine_latency(&ps, &params);
+   first = (PS_OFFLINE_SEGMENT - PS_OFFLINE_SEARCH)*ps_engine_frame(RATE);
+   for (c = 0; c < CHANNELS; c++)
+      for (i = 0; i < first; i++)
+         if (ref[c][i] != stream[c][i + latency]) {
+            CHECK(0, "channel %d: frame %zu of the first segment is %g, "
+                  "streamed %g", c, i, ref[c][i], stream[c][i + latency]);
+            break;
+         }
+
+   ps_engine_free(&ps);
+   free(mem);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,229 @@
+/**
+   The pitch tracker (ps_pitch.c) and the "snap" port of the pitch
+   shifter.  On harmonic tones band-limited to HARMONICS_MAX Hz, from
+   FREQ_LO to FREQ_HI at 44.1 - 192 kHz, every estimate after the first
+   SETTLE seconds is within MAX_CENTS of the tone with a confidence of at
+   least SNAP_CONFIDENCE; on white noise the confidence stays under
+   MAX_NOISE_CONFIDENCE, so alpha is never snapped.
+
+   A 452 Hz sine is run through the plugin in every mode, its output
+   frequency taken from the upward zero crossings.  With "snap" on at
+   alpha 1 the output is within MAX_SNAP_HZ of the output at alpha
+   440/452, and in the phase vocoder within MAX_HZ of 440 Hz; the other
+   modes move a pure tone by their own splices.  At alpha 1 every mode
+   gives 452 Hz within MAX_HZ.  The plugin is included whole to run it.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "dafx-ps-sola.c"
+
+#define FREQ_LO       50.0
+#define FREQ_HI       1450.0
+#define FREQS         25
+#define HARMONICS_MAX 5000.0
+#define SETTLE        0.1
+#define BLOCK         256
+#define PORTS         32
+
+#define MAX_CENTS            1.0
+#define MAX_NOISE_CONFIDENCE 0.5
+#define MAX_SNAP_HZ          0.05
+#define MAX_HZ               0.005
+
+static int failures = 0;
+
+/** Harmonics of `freq` falling as 1/k, those under HARMONICS_MAX. */
+static void
+harmonic_tone(float* x, int n, double freq, double rate)
+{
+   int i, k;
+
+   for (i = 0; i < n; i++)
+      for (k = 1, x[i] = 0; k*freq < HARMONICS_MAX; k++)
+         x[i] += 0.5/k*sin(2*PI*k*freq*i/rate + k);
+}
+
+static void
+test_tones(double rate)
+{
+   const int n = (int)(rate/2);
+   float* x = malloc((size_t)n*sizeof(float));
+   double freq, cents, worst = 0, low = 1;
+   PsPitch pt;
+   int f, pos;
+
+   if (x == NULL || ps_pitch_init(&pt, rate, TRACK_RATE) != 0) {
+      CHECK(0, "allocation failed");
+      free(x);
+      return;
+   }
+   for (f = 0; f < FREQS; f++) {
+      freq = FREQ_LO*pow(FREQ_HI/FREQ_LO, (double)f/(FREQS - 1));
+      harmonic_tone(x, n, freq, rate);
+      ps_pitch_reset(&pt);
+      for (pos = 0; pos + BLOCK <= n; pos += BLOCK) {
+         ps_pitch_process(&pt, x + pos, BLOCK);
+         if (pos < SETTLE*rate)
+            continue;
+         cents = pt.freq > 0 ? fabs(1200*log2(pt.freq/freq)) : 1200;
+         worst = cents > worst ? cents : worst;
+         low = pt.confidence < low ? pt.confidence : low;
+         CHECK(cents <= MAX_CENTS, "%.0f Hz, %.1f Hz: %.0f Hz, %.2f cents "
+               "off", rate, freq, pt.freq, cents);
+         CHECK(pt.confidence >= SNAP_CONFIDENCE, "%.0f Hz, %.1f Hz: "
+               "confidence %.2f", rate, freq, pt.confidence);
+         if (cents > MAX_CENTS || pt.confidence < SNAP_CONFIDENCE)
+            break;
+      }
+   }
+   printf("%6.0f Hz: %.0f - %.0f Hz within %.3f cents, confidence at least "
+          "%.3f\n", rate, FREQ_LO, FREQ_HI, worst, low);
+
+   ps_pitch_free(&pt);
+   free(x);
+}
+
+static void
+test_noise(void)
+{
+   const int n = 2*48000;
+   float* x = malloc((size_t)n*sizeof(float));
+   double sum = 0, high = 0;
+   uint32_t seed = 1;
+   PsPitch pt;
+   int i, pos, estimates = 0;
+
+   if (x == NULL || ps_pitch_init(&pt, 48000, TRACK_RATE) != 0) {
+      CHECK(0, "allocation failed");
+      free(x);
+      return;
+   }
+   for (i = 0; i < n; i++)
+      x[i] = 0.5*bench_rand(&seed);
+   for (pos = 0; pos + BLOCK <= n; pos += BLOCK) {
+      ps_pitch_process(&pt, x + pos, BLOCK);
+      if (pos < SETTLE*48000)
+         continue;
+      sum += pt.confidence;
+      high = pt.confidence > high ? pt.confidence : high;
+      estimates++;
+   }
+   printf("white noise: confidence %.2f on average, at most %.2f\n",
+          sum/estimates, high);
+   CHECK(high < MAX_NOISE_CONFIDENCE, "white noise: confidence %.2f", high);
+
+   ps_pitch_free(&pt);
+   free(x);
+}
+
+/**
+   Frequency of `y` from the least-squares slope of its upward zero
+   crossings, each placed between samples by linear interpolation.
+*/
+static double
+crossing_freq(const float* y, int n, double rate)
+{
+   double t, sx = 0, sy = 0, sxx = 0, sxy = 0;
+   int i, k = 0;
+
+   for (i = 1; i < n; i++) {
+      if (y[i - 1] < 0 && y[i] >= 0) {
+         t = i - 1 + y[i - 1]/(y[i - 1] - y[i]);
+         sx += k;
+         sy += t;
+         sxx += (double)k*k;
+         sxy += k*t;
+         k++;
+      }
+   }
+   if (k < 2)
+      return 0;
+   return rate*(k*sxx - sx*sx)/(k*sxy - sx*sy);
+}
+
+/** Output frequency of the pitch shifter for a 452 Hz sine. */
+static double
+output_freq(int mode, float alpha, float snap)
+{
+   const double rate = 48000;
+   const int n = 600*BLOCK;   // 3.2 s
+   const LV2_Descriptor* desc = lv2_descriptor(0);
+   float* x = malloc(2*(size_t)n*sizeof(float));
+   float* y = x + n;
+   float ctl[PORTS];
+   LV2_Handle h = desc->instantiate(desc, rate, "", NULL);
+   double freq;
+   uint32_t p;
+   int i, pos;
+
+   if (x == NULL || h == NULL) {
+      CHECK(0, "allocation failed");
+      free(x);
+      if (h)
+         desc->cleanup(h);
+      return 0;
+   }
+   for (p = 0; p < PORTS; p++)
+      ctl[p] = 0;
+   for (p = ALPHA; p <= PIPELINE; p++)
+      desc->connect_port(h, p, &ctl[p]);
+   ctl[ALPHA] = alpha;
+   ctl[MODE] = mode;
+   ctl[QUALITY] = PS_RS_MEDIUM;
+   ctl[TRACK] = TRACK_RATE;
+   ctl[SNAP] = snap;
+   desc->activate(h);
+   for (i = 0; i < n; i++)
+      x[i] = 0.5*sin(2*PI*452*i/rate);
+   for (pos = 0; pos < n; pos += BLOCK) {
+      desc->connect_port(h, INPUT, x + pos);
+      desc->connect_port(h, OUTPUT, y + pos);
+      desc->run(h, BLOCK);
+   }
+   /* Past the first second: the latency and the first estimates */
+   freq = crossing_freq(y + 48000, n - 48000, rate);
+   if (snap > 0.5)
+      CHECK(fabs(ctl[PITCH] - 452) < 0.01 &&
+            ctl[CONFIDENCE] >= SNAP_CONFIDENCE, "mode %d: pitch port %.2f "
+            "Hz, confidence %.2f", mode, ctl[PITCH], ctl[CONFIDENCE]);
+
+   desc->cleanup(h);
+   free(x);
+   return freq;
+}
+
+int
+main(void)
+{
+   static const double rates[] = {44100, 48000, 88200, 96000, 176400,
+                                  192000};
+   static const int modes[] = {PS_MODE_SOLA, PS_MODE_PVOC, PS_MODE_DELAY,
+                               PS_MODE_PSOLA};
+   static const char* names[] = {
+      "SOLA:", "phase vocoder:", "delay line:", "PSOLA:"
+   };
+   double on, fixed, off;
+   int r, m;
+
+   for (r = 0; r < (int)(sizeof(rates)/sizeof(rates[0])); r++)
+      test_tones(rates[r]);
+   test_noise();
+
+   for (m = 0; m < 4; m++) {
+      on = output_freq(modes[m], 1, 1);
+      fixed = output_freq(modes[m], 440/452.0, 0);
+      off = output_freq(modes[m], 1, 0);
+      printf("452 Hz, %-15s snap %.3f Hz, alpha 440/452 %.3f Hz, "
+             "alpha 1 %.3f Hz\n", names[m], on, fixed, off);
+      CHECK(fabs(on - fixed) <= MAX_SNAP_HZ, "%s snap %.3f Hz, alpha "
+            "440/452 %.3f Hz", names[m], on, fixed);
+      CHECK(fabs(off - 452) <= MAX_HZ, "%s alpha 1 %.3f Hz", names[m],
+            off);
+      if (modes[m] == PS_MODE_PVOC)
+         CHECK(fabs(on - 440) <= MAX_HZ, "%s snap %.3f Hz, not 440",
+               names[m], on);
+   }
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,177 @@
+/**
+   The PSOLA mode (ps_psola.c) on the voice and bass of test/bench.h at
+   48 kHz: at alpha 0.5 - 2 the local period of the output, measured by
+   normalized correlation over windows of WINDOW samples, is within
+   MAX_PERIOD_ERROR of the input's period divided by alpha, taken
+   ps_engine_latency() samples earlier, give or take half a period.
+   Windows are only measured where the input is voiced throughout, MARGIN
+   samples clear of note and vowel edges.  The latency is 2752 samples,
+   and blocks of 1 and 1000 frames give the same output.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+
+#define RATE    48000
+#define SECONDS 6
+#define N       (SECONDS*RATE)
+#define WINDOW  2048
+#define STEP    1024
+#define MARGIN  2400
+#define LATENCY 2752
+
+#define MAX_PERIOD_ERROR 0.006
+
+static int failures = 0;
+
+static void
+render(PsEngine* ps, const PsParams* p, const float* x, float* y, int n,
+       int block)
+{
+   const float* in[1];
+   float* out[1];
+   int pos, len;
+
+   ps_engine_reset(ps);
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      in[0] = x + pos;
+      out[0] = y + pos;
+      ps_engine_process(ps, in, out, len, p);
+   }
+}
+
+/**
+   The lag within 15% of `period` at which y[t..t+WINDOW) correlates best
+   with itself, refined by a parabola through the neighbouring lags.
+*/
+static double
+local_period(const float* y, int t, double period)
+{
+   const int lo = (int)(0.85*period), hi = (int)(1.15*period) + 1;
+   double r, e0, e1, xy, best = -2, prev = 0, next = 0, before = -2;
+   int d, i, lag = lo;
+
+   for (i = 0, e0 = 0; i < WINDOW; i++)
+      e0 += (double)y[t + i]*y[t + i];
+   for (d = lo; d <= hi; d++) {
+      for (i = 0, e1 = 0, xy = 0; i < WINDOW; i++) {
+         e1 += (double)y[t + i + d]*y[t + i + d];
+         xy += (double)y[t + i]*y[t + i + d];
+      }
+      r = e0*e1 > 0 ? xy/sqrt(e0*e1) : 0;
+      if (r > best) {
+         prev = before;
+         best = r;
+         lag = d;
+         next = -2;
+      }
+      else if (d == lag + 1) {
+         next = r;
+      }
+      before = r;
+   }
+   if (lag == lo || lag == hi || prev < -1 || next < -1)
+      return lag;
+   return lag + 0.5*(prev - next)/(prev - 2*best + next);
+}
+
+/**
+   Worst relative period error of `y` against f0/alpha of the input, over
+   the windows whose input span is voiced and has no note change.  Grains
+   come from the mark nearest to their place, up to half a period from
+   the latency, so the target is the mean period over the input window
+   moved by the offset within half a period that fits best: the vibrato
+   changes the period by up to 0.5% in half a period of 90 Hz.
+*/
+static double
+period_error(const float* y, const float* f0, float alpha, int* windows)
+{
+   double target, measured, err, best, worst = 0;
+   int t, i, d, half, steady;
+   const float* f;
+
+   *windows = 0;
+   for (t = LATENCY + MARGIN; t + WINDOW + 2*WINDOW < N; t += STEP) {
+      f = f0 + t - LATENCY;
+      for (i = -MARGIN, steady = 1; i < WINDOW + MARGIN; i++)
+         steady &= f[i] > 0 && fabs(f[i] - f[i - 1]) < 1;
+      if (!steady)
+         continue;
+      half = (int)(RATE/f[0]/2);
+      for (i = 0, target = 0; i < WINDOW; i++)
+         target += RATE/(f[i]*alpha);
+      measured = local_period(y, t, target/WINDOW);
+      for (d = -half, best = 1; d <= half; d += 8) {
+         for (i = 0, target = 0; i < WINDOW; i++)
+            target += RATE/(f[i + d]*alpha);
+         target /= WINDOW;
+         err = fabs(measured/target - 1);
+         best = err < best ? err : best;
+      }
+      worst = best > worst ? best : worst;
+      (*windows)++;
+   }
+   return worst;
+}
+
+static void
+test_periods(PsEngine* ps, PsParams* p, const char* name, const float* x,
+             const float* f0, float* y)
+{
+   static const float alphas[] = {0.5, 0.75, 1, 1.26, 1.5, 2};
+   double err;
+   int a, windows;
+
+   for (a = 0; a < (int)(sizeof(alphas)/sizeof(alphas[0])); a++) {
+      p->alpha[0] = alphas[a];
+      render(ps, p, x, y, N, 256);
+      err = period_error(y, f0, alphas[a], &windows);
+      printf("%s, alpha %.2f: %d windows, period within %.2f%%\n", name,
+             alphas[a], windows, 100*err);
+      CHECK(windows > 0, "%s, alpha %.2f: nothing measured", name,
+            alphas[a]);
+      CHECK(err <= MAX_PERIOD_ERROR, "%s, alpha %.2f: period %.2f%% off",
+            name, alphas[a], 100*err);
+   }
+}
+
+int
+main(void)
+{
+   float* mem = malloc(4*(size_t)N*sizeof(float));
+   float* x = mem;
+   float* f0 = mem + N;
+   float* y = mem + 2*N;
+   float* ref = mem + 3*N;
+   PsEngine ps;
+   PsParams p;
+
+   memset(&p, 0, sizeof(p));
+   p.mode = PS_MODE_PSOLA;
+   p.gain[0] = 1;
+   if (mem == NULL || ps_engine_init(&ps, RATE, 1, 1) != 0) {
+      fprintf(stderr, "test_psola: allocation failed\n");
+      free(mem);
+      return 1;
+   }
+   CHECK(ps_engine_latency(&ps, &p) == LATENCY, "latency %d, not %d",
+         ps_engine_latency(&ps, &p), LATENCY);
+
+   bench_voice(x, f0, N, RATE);
+   test_periods(&ps, &p, "voice", x, f0, y);
+   bench_bass(x, f0, N, RATE);
+   test_periods(&ps, &p, "bass ", x, f0, y);
+
+   p.alpha[0] = 1.5;
+   render(&ps, &p, x, ref, N, 1);
+   render(&ps, &p, x, y, N, 1000);
+   CHECK(memcmp(y, ref, (size_t)N*sizeof(float)) == 0,
+         "blocks of 1000 differ from blocks of 1");
+
+   ps_engine_free(&ps);
+   free(mem);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,312 @@
+/**
+   Real-time safety of `run()` with the helper thread.  The three plugins
+   are run as a host would, with malloc(), calloc(), realloc(), free(),
+   pthread_mutex_lock() and sem_wait() interposed (linked with
+   -Wl,--wrap) and counted on the audio thread while it is in `run()`.
+   "pipeline" is switched on after a while; the host's worker thread then
+   starts the helper while `run()` keeps going, and the helper plans the
+   frames from there on.  Checks that no instance has a helper before the
+   port is on, that none of those functions is called from `run()` before,
+   during or after the start, and that the helper did the searches.  Then
+   the "mode" port is switched in and out of the delay line while `run()`
+   goes, which must not call them either.  The
+   plugin is included whole to look at its engine.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <semaphore.h>
+
+#include "bench.h"
+#include "dafx-ps-sola.c"
+
+#define BLOCK  256
+#define BLOCKS 400
+#define PORTS  32
+
+static int failures = 0;
+
+static pthread_t audio;
+static volatile int in_run = 0;
+static volatile int rt_calls = 0;
+
+/** Count a call made from `run()` on the audio thread. */
+static void
+count_call(void)
+{
+   if (in_run && pthread_equal(pthread_self(), audio))
+      __atomic_add_fetch(&rt_calls, 1, __ATOMIC_RELAXED);
+}
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* p, size_t size);
+void  __real_free(void* p);
+int   __real_pthread_mutex_lock(pthread_mutex_t* m);
+int   __real_sem_wait(sem_t* s);
+
+void* __wrap_malloc(size_t size) { count_call(); return __real_malloc(size); }
+void* __wrap_calloc(size_t n, size_t size) {
+   count_call();
+   return __real_calloc(n, size);
+}
+void* __wrap_realloc(void* p, size_t size) {
+   count_call();
+   return __real_realloc(p, size);
+}
+void __wrap_free(void* p) { count_call(); __real_free(p); }
+int __wrap_pthread_mutex_lock(pthread_mutex_t* m) {
+   count_call();
+   return __real_pthread_mutex_lock(m);
+}
+int __wrap_sem_wait(sem_t* s) { count_call(); return __real_sem_wait(s); }
+
+/** The host side of the worker extension: one request, run on a thread. */
+typedef struct {
+   LV2_Handle  instance;
+   const LV2_Worker_Interface* iface;
+   int         requests;
+   pthread_t   thread;
+} Host;
+
+static LV2_Worker_Status
+respond(LV2_Worker_Respond_Handle handle, uint32_t size, const void* data)
+{
+   return LV2_WORKER_SUCCESS;
+}
+
+static void*
+worker_thread(void* arg)
+{
+   Host* host = (Host*)arg;
+
+   host->iface->work(host->instance, respond, NULL, 0, NULL);
+   return NULL;
+}
+
+static LV2_Worker_Status
+schedule_work(LV2_Worker_Schedule_Handle handle, uint32_t size,
+              const void* data)
+{
+   Host* host = (Host*)handle;
+
+   if (host->requests++ == 0 &&
+       pthread_create(&host->thread, NULL, worker_thread, host) != 0)
+      return LV2_WORKER_ERR_UNKNOWN;
+   return LV2_WORKER_SUCCESS;
+}
+
+/** Run plugin `index` with the helper started halfway. */
+static void
+run_plugin(uint32_t index)
+{
+   static float in[2][BLOCK], out[2][BLOCK];
+   const LV2_Descriptor* desc = lv2_descriptor(index);
+   Host host;
+   LV2_Worker_Schedule schedule = { &host, schedule_work };
+   const LV2_Feature feature = { LV2_WORKER__schedule, &schedule };
+   const LV2_Feature* features[] = { &feature, NULL };
+   const struct timespec gap = { 0, 2000000 };
+   float ctl[PORTS];
+   uint32_t p, seed = 1;
+   int b, i, v, pipeline, latency, direct = 0;
+   float direct_latency = 0;
+   unsigned frames = 0;
+   Ps* ps;
+
+   memset(&host, 0, sizeof(host));
+   host.iface = desc->extension_data(LV2_WORKER__interface);
+   host.instance = desc->instantiate(desc, 44100, "", features);
+   ps = (Ps*)host.instance;
+   CHECK(ps != NULL && host.iface != NULL, "%s: no instance", desc->URI);
+   if (ps == NULL || host.iface == NULL)
+      return;
+
+   for (p = 0; p < PORTS; p++)
+      ctl[p] = 0;
+   if (index == 0) {
+      desc->connect_port(ps, INPUT, in[0]);
+      desc->connect_port(ps, OUTPUT, out[0]);
+      for (p = ALPHA; p <= PIPELINE; p++)
+         desc->connect_port(ps, p, &ctl[p]);
+      ctl[ALPHA] = 1.26;
+      ctl[TRACK] = TRACK_RATE;
+      pipeline = PIPELINE;
+      latency = LATENCY_OUT;
+   }
+   else if (index == 1) {
+      desc->connect_port(ps, H_INPUT, in[0]);
+      desc->connect_port(ps, H_OUTPUT, out[0]);
+      for (p = H_LATENCY; p <= H_PIPELINE; p++)
+         desc->connect_port(ps, p, &ctl[p]);
+      for (v = 0; v < MAX_VOICES; v++) {
+         ctl[H_ALPHA + v] = 0.75 + 0.25*v;
+         ctl[H_GAIN + v] = 0.25;
+      }
+      pipeline = H_PIPELINE;
+      latency = H_LATENCY;
+   }
+   else {
+      desc->connect_port(ps, S_INPUT_L, in[0]);
+      desc->connect_port(ps, S_INPUT_R, in[1]);
+      desc->connect_port(ps, S_OUTPUT_L, out[0]);
+      desc->connect_port(ps, S_OUTPUT_R, out[1]);
+      for (p = S_ALPHA; p <= S_PIPELINE; p++)
+         desc->connect_port(ps, p, &ctl[p]);
+      ctl[S_ALPHA] = 1.26;
+      pipeline = S_PIPELINE;
+      latency = S_LATENCY;
+   }
+   ctl[index == 0 ? QUALITY : index == 1 ? H_QUALITY : S_QUALITY] =
+      PS_RS_MEDIUM;
+   desc->activate(ps);
+
+   audio = pthread_self();
+   rt_calls = 0;
+   for (b = 0; b < BLOCKS; b++) {
+      for (i = 0; i < BLOCK; i++) {
+         in[0][i] = 0.5*sin(2*PI*220*(b*BLOCK + i)/44100.0);
+         in[1][i] = 0.1*bench_rand(&seed);
+      }
+      if (b == BLOCKS/4) {
+         CHECK(ps->engine.pipe == NULL && host.requests == 0,
+               "%s: helper started with the port off", desc->URI);
+         direct_latency = ctl[latency];
+         ctl[pipeline] = 1;
+      }
+      in_run = 1;
+      desc->run(ps, BLOCK);
+      in_run = 0;
+      if (__atomic_load_n(&ps->engine.pipe, __ATOMIC_ACQUIRE))
+         frames += BLOCK;
+      else if (b >= BLOCKS/4)
+         direct++;
+      nanosleep(&gap, NULL);
+   }
+   if (host.requests)
+      pthread_join(host.thread, NULL);
+
+   CHECK(rt_calls == 0, "%s: %d calls to malloc/free/locks in run()",
+         desc->URI, rt_calls);
+   CHECK(host.requests == 1, "%s: %d helper starts scheduled",
+         desc->URI, host.requests);
+   CHECK(ps->engine.pipe != NULL, "%s: no helper", desc->URI);
+   if (ps->engine.pipe) {
+      frames /= ps->engine.grain;
+      CHECK(ps->engine.pipe->late < frames/2,
+            "%s: %u of %u frames not planned by the helper", desc->URI,
+            ps->engine.pipe->late, frames);
+      CHECK(ctl[latency] == direct_latency + ps->engine.grain,
+            "%s: latency %g without the pipelined frame", desc->URI,
+            ctl[latency]);
+   }
+   printf("%-60s  helper after %d blocks, %u of %u frames late\n",
+          desc->URI, direct, ps->engine.pipe ? ps->engine.pipe->late : 0,
+          frames);
+
+   desc->deactivate(ps);
+   desc->cleanup(ps);
+}
+
+/** Without the worker feature the port has no effect and no thread starts. */
+static void
+run_without_worker(void)
+{
+   static float in[BLOCK], out[BLOCK];
+   const LV2_Descriptor* desc = lv2_descriptor(0);
+   LV2_Handle ps = desc->instantiate(desc, 44100, "", NULL);
+   float ctl[PORTS];
+   uint32_t p;
+   int b;
+
+   CHECK(ps != NULL, "no instance without features");
+   if (ps == NULL)
+      return;
+   memset(in, 0, sizeof(in));
+   desc->connect_port(ps, INPUT, in);
+   desc->connect_port(ps, OUTPUT, out);
+   for (p = ALPHA; p <= PIPELINE; p++) {
+      ctl[p] = 0;
+      desc->connect_port(ps, p, &ctl[p]);
+   }
+   ctl[ALPHA] = 1.5;
+   ctl[PIPELINE] = 1;
+   desc->activate(ps);
+   for (b = 0; b < 50; b++)
+      desc->run(ps, BLOCK);
+   CHECK(((Ps*)ps)->engine.pipe == NULL, "helper started without a worker");
+   desc->cleanup(ps);
+}
+
+/**
+   The "mode" port stepped through the engines while `run()` goes, into the
+   delay line and out of it again: no allocation or lock in `run()`, the
+   delay line keeps the buffer it was given at instantiation, and the
+   latency port follows the engine.
+*/
+static void
+switch_modes(void)
+{
+   static const int modes[] = {
+      PS_MODE_SOLA, PS_MODE_DELAY, PS_MODE_SOLA, PS_MODE_DELAY,
+      PS_MODE_PSOLA, PS_MODE_DELAY, PS_MODE_PVOC, PS_MODE_DELAY
+   };
+   static float in[BLOCK], out[BLOCK];
+   const LV2_Descriptor* desc = lv2_descriptor(0);
+   LV2_Handle h = desc->instantiate(desc, 44100, "", NULL);
+   Ps* ps = (Ps*)h;
+   const float* line;
+   float ctl[PORTS];
+   uint32_t p, seed = 1;
+   int m, b, i, moved = 0;
+
+   CHECK(ps != NULL, "no instance");
+   if (ps == NULL)
+      return;
+   desc->connect_port(h, INPUT, in);
+   desc->connect_port(h, OUTPUT, out);
+   for (p = ALPHA; p <= PIPELINE; p++) {
+      ctl[p] = 0;
+      desc->connect_port(h, p, &ctl[p]);
+   }
+   ctl[ALPHA] = 0.75;
+   ctl[QUALITY] = PS_RS_MEDIUM;
+   desc->activate(h);
+   line = ps->engine.delay.line;
+
+   audio = pthread_self();
+   rt_calls = 0;
+   for (m = 0; m < (int)(sizeof(modes)/sizeof(modes[0])); m++) {
+      ctl[MODE] = modes[m];
+      for (b = 0; b < 20; b++) {
+         for (i = 0; i < BLOCK; i++)
+            in[i] = 0.5*sin(2*PI*220*(b*BLOCK + i)/44100.0) +
+                    0.05*bench_rand(&seed);
+         in_run = 1;
+         desc->run(h, BLOCK);
+         in_run = 0;
+      }
+      moved |= ps->engine.delay.line != line;
+      if (modes[m] == PS_MODE_DELAY)
+         CHECK(ctl[LATENCY_OUT] == PS_DELAY_WINDOW/2, "delay line: latency "
+               "%g", ctl[LATENCY_OUT]);
+   }
+   CHECK(rt_calls == 0, "%d calls to malloc/free/locks in run() while "
+         "switching modes", rt_calls);
+   CHECK(!moved, "the delay line was reallocated");
+   printf("%d mode switches, %d calls to malloc/free/locks in run()\n",
+          m - 1, rt_calls);
+
+   desc->cleanup(h);
+}
+
+int main(void) {
+   uint32_t index;
+
+   for (index = 0; lv2_descriptor(index) != NULL; index++)
+      run_plugin(index);
+   run_without_worker();
+   switch_modes();
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,230 @@
+/**
+   The streaming time stretcher (ps_stretch.c) through its API only, at
+   44.1, 48 and 96 kHz, mono and stereo, ratios 0.25 - 2, pushed in blocks
+   of 1 to `max_block` frames with everything pulled after each push:
+
+   - the latency contract: after n frames have been pushed, at least
+     (n - ps_stretch_latency()) * ratio frames have been pulled, and never
+     more than n * ratio;
+   - so the output of a stream of n frames followed by
+     ps_stretch_latency() frames of silence is n * ratio to
+     (n + ps_stretch_latency()) * ratio frames long;
+   - with the ratio set to another value halfway, the contract holds from
+     there on at the new ratio, counted from the frames pushed and pulled
+     at the change;
+   - a push of up to `max_block` frames is taken whole, and
+     ps_stretch_reset() gives the same output again, bit for bit.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <string.h>
+
+#include "bench.h"
+#include "ps_stretch.h"
+
+#define SECONDS   2
+#define MAX_BLOCK 4096
+
+static int failures = 0;
+
+static const double rates[] = {44100, 48000, 96000};
+static const double ratios[] = {0.25, 0.5, 0.75, 1.0, 1.26, 1.5, 2.0};
+static const int blocks[] = {1, 256, 777, MAX_BLOCK};
+
+#define RATES  ((int)(sizeof(rates)/sizeof(rates[0])))
+#define RATIOS ((int)(sizeof(ratios)/sizeof(ratios[0])))
+#define BLOCKS ((int)(sizeof(blocks)/sizeof(blocks[0])))
+
+typedef struct {
+   PsStretch st;
+   int       channels;
+   double    rate;
+   float*    out;        // all output pulled so far
+   int       out_cap;
+   long      pushed;     // input frames pushed
+   long      pulled;     // output frames pulled
+   long      mark;       // frames pushed when the ratio was last set
+   long      base;       // frames pulled by then
+   double    slack;      // least (pulled - owed) seen, in frames
+   double    ahead;      // most (pulled - pushed * ratio) seen, in frames
+   int       short_push; // a push of at most MAX_BLOCK frames was cut
+} Run;
+
+/**
+   Push `n` frames of `x` in `block`-frame blocks, pulling after each, and
+   track the output against the contract since the ratio was set.
+*/
+static void
+feed(Run* r, const float* x, int n, int block)
+{
+   const int C = r->channels;
+   const double ratio = r->st.ratio;
+   const int latency = ps_stretch_latency(&r->st);
+   long since;
+   int pos, len, got;
+
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      got = ps_stretch_push(&r->st, x + (size_t)pos*C, len);
+      r->short_push |= got != len;
+      len = got > 0 ? got : 1;
+      r->pushed += got;
+      while ((got = ps_stretch_pull(&r->st, r->out + (size_t)r->pulled*C,
+                                    r->out_cap - (int)r->pulled)) > 0)
+         r->pulled += got;
+
+      since = r->pushed - r->mark;
+      if (since >= latency)
+         r->slack = fmin(r->slack, r->pulled - r->base -
+                                   (since - latency)*ratio);
+      if (r->mark == 0)
+         r->ahead = fmax(r->ahead, r->pulled - since*ratio);
+   }
+}
+
+/** Change the ratio: the contract starts again from here. */
+static void
+set_ratio(Run* r, double ratio)
+{
+   r->mark = r->pushed;
+   r->base = r->pulled;
+   ps_stretch_set_ratio(&r->st, ratio);
+}
+
+static int
+run_init(Run* r, double rate, int channels, double max_ratio, int n)
+{
+   memset(r, 0, sizeof(Run));
+   r->channels = channels;
+   r->rate = rate;
+   r->out_cap = (int)(2*n*max_ratio) + 4*MAX_BLOCK;
+   r->out = malloc((size_t)r->out_cap*channels*sizeof(float));
+   if (r->out == NULL || ps_stretch_init(&r->st, rate, channels,
+                                         MAX_BLOCK) != 0) {
+      free(r->out);
+      return -1;
+   }
+   return 0;
+}
+
+static void
+run_start(Run* r)
+{
+   ps_stretch_reset(&r->st);
+   r->pushed = r->pulled = r->mark = 0;
+   r->base = 0;
+   r->slack = 1e9;
+   r->ahead = -1e9;
+   r->short_push = 0;
+}
+
+/** Push `n` frames of `x` and the flush, at `ratio` then `ratio2`. */
+static void
+stream(Run* r, const float* x, const float* zeros, int n, int block,
+       double ratio, double ratio2)
+{
+   run_start(r);
+   ps_stretch_set_ratio(&r->st, ratio);
+   feed(r, x, n/2, block);
+   if (ratio2 != ratio)
+      set_ratio(r, ratio2);
+   feed(r, x + (size_t)(n/2)*r->channels, n - n/2, block);
+   feed(r, zeros, ps_stretch_latency(&r->st), block);
+}
+
+static void
+test_rate(double rate, int channels, const float* x, const float* zeros,
+          int n)
+{
+   const int C = channels;
+   double r1, r2, lo, hi, least = 1e9, most = -1e9;
+   float* first;
+   Run r;
+   int q, b, k, latency, cut = 0;
+
+   if (run_init(&r, rate, C, PS_STRETCH_MAX, n) != 0) {
+      CHECK(0, "allocation failed");
+      return;
+   }
+   for (q = 0; q < RATIOS; q++) {
+      for (b = 0; b < BLOCKS; b++) {
+         /* The same ratio throughout, then another from halfway */
+         for (k = 0; k < 2; k++) {
+            r1 = ratios[q];
+            r2 = k == 0 ? r1 : ratios[RATIOS - 1 - q];
+            ps_stretch_set_ratio(&r.st, r2);
+            latency = ps_stretch_latency(&r.st);
+            stream(&r, x, zeros, n, blocks[b], r1, r2);
+            least = fmin(least, r.slack);
+            cut |= r.short_push;
+            CHECK(r.slack >= 0, "%.0f Hz, %d ch, ratio %.2f then %.2f, %d "
+                  "frames: %.1f frames short of the latency contract",
+                  rate, C, r1, r2, blocks[b], -r.slack);
+            if (k == 1)
+               continue;
+            most = fmax(most, r.ahead);
+            lo = n*r1;
+            hi = (n + latency)*r1;
+            CHECK(r.ahead <= 0, "%.0f Hz, %d ch, ratio %.2f, %d frames: "
+                  "%.1f frames ahead of the input", rate, C, r1, blocks[b],
+                  r.ahead);
+            CHECK(r.pulled >= lo && r.pulled <= hi, "%.0f Hz, %d ch, ratio "
+                  "%.2f, %d frames: %ld frames out, not %.0f - %.0f", rate,
+                  C, r1, blocks[b], r.pulled, lo, hi);
+         }
+      }
+   }
+   CHECK(!cut, "%.0f Hz, %d ch: a push of at most %d frames was cut", rate,
+         C, MAX_BLOCK);
+
+   /* Reset gives the same stream */
+   stream(&r, x, zeros, n, 777, 1.26, 0.75);
+   first = malloc((size_t)r.pulled*C*sizeof(float));
+   if (first != NULL) {
+      long len = r.pulled;
+
+      memcpy(first, r.out, (size_t)len*C*sizeof(float));
+      stream(&r, x, zeros, n, 777, 1.26, 0.75);
+      CHECK(r.pulled == len &&
+            memcmp(first, r.out, (size_t)len*C*sizeof(float)) == 0,
+            "%.0f Hz, %d ch: not the same output after a reset", rate, C);
+      free(first);
+   }
+
+   printf("%6.0f Hz, %d ch: at least %.0f frames more out than the "
+          "contract, at least %.0f fewer than the input times the ratio\n",
+          rate, C, least, -most);
+   ps_stretch_free(&r.st);
+   free(r.out);
+}
+
+int
+main(void)
+{
+   const int n = SECONDS*96000;
+   float* x = malloc(2*(size_t)n*sizeof(float));
+   float* zeros = calloc(2*(size_t)n, sizeof(float));
+   int i, c, k;
+
+   if (x == NULL || zeros == NULL) {
+      fprintf(stderr, "test_stretch: allocation failed\n");
+      return 1;
+   }
+   for (k = 0; k < RATES; k++) {
+      const int len = (int)(SECONDS*rates[k]);
+
+      for (c = 1; c <= 2; c++) {
+         for (i = 0; i < len; i++) {
+            x[i*c] = 0.5*sin(2*PI*220*i/rates[k]) +
+                     0.25*sin(2*PI*331*i/rates[k] + 1);
+            if (c == 2)
+               x[i*c + 1] = 0.5*sin(2*PI*147*i/rates[k]);
+         }
+         test_rate(rates[k], c, x, zeros, len);
+      }
+   }
+
+   free(x);
+   free(zeros);
+   return failures ? 1 : 0;
+}
@@ -13,6 +13,16 @@
 */
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 
+#include "tube_env.h"
+#include "tube_os.h"
+#include "tube_shaper.h"
+
+#define MAX(x, y) (((x) > (y)) ? (x) : (y))
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+/** Samples shaped at a time into the scratch of `run()`. */
+#define TUBE_CHUNK 64
+
 /**
    The URI is the identifier for a plugin, and how the host associates this
    implementation in code with its description in data. If this URI does not
@@ -33,9 +43,24 @@ typedef enum {
    DIST = 4,
    RH = 5,
    RL = 6,
-   MIX = 7
+   MIX = 7,
+   NORM = 8,
+   DETECTOR = 9,
+   ATTACK = 10,
+   RELEASE = 11,
+   LOOKAHEAD = 12,
+   LATENCY = 13,
+   OVERSAMPLE = 14,
+   SAG = 15,
+   SAG_TIME = 16
 } PortIndex;
 
+/** Normalization modes. */
+typedef enum {
+   NORM_BLOCK    = 0,   // peaks of each host block, as in the book
+   NORM_ENVELOPE = 1    // envelope follower, block-size invariant
+} NormMode;
+
 /**
    Define a private structure for the plugin instance.  All data
    associated with a plugin instance is stored here, and is available to
@@ -50,11 +75,31 @@ typedef struct {
    const float* rh;     // lv2 control port
    const float* rl;     // lv2 control port
    const float* mix;     // lv2 control port
+   const float* norm;     // lv2 control port
+   const float* detector; // lv2 control port
+   const float* attack;   // lv2 control port
+   const float* release;  // lv2 control port
+   const float* lookahead; // lv2 control port
+   float*       latency;  // lv2 control port (output)
+   const float* oversample; // lv2 control port
+   const float* sag;      // lv2 control port
+   const float* sag_time; // lv2 control port
    float* lastX;
    float* lastX2;
    float* lastY;
    float* lastY2;
    float* lastY_LP;
+   TubeShaper shaper;     // transfer curve for the current dist and q
+   TubeEnv env;           // envelope of the streaming normalization
+   TubeOs os;             // oversampling around the curve
+   TubeDelay dry;         // dry signal, delayed by the oversampling
+   TubeDelay env_delay;   // envelope, delayed by the oversampling
+   TubeShaper bias;       // curve for q = 0, shifted per sample by the sag
+   TubeDelay bias_delay;  // bias, delayed by the oversampling
+   double rate;
+   float sag_state;       // smoothed |x|/peak, in [0, 1]
+   float sag_coef;        // smoothing per sample for `sag_ms`
+   float sag_ms;          // NAN before the first run()
 } Tube;
 
 // /**
@@ -101,10 +146,76 @@ connect_port(LV2_Handle instance,
    case MIX:
       tube->mix = (const float*)data;
       break;
+   case NORM:
+      tube->norm = (const float*)data;
+      break;
+   case DETECTOR:
+      tube->detector = (const float*)data;
+      break;
+   case ATTACK:
+      tube->attack = (const float*)data;
+      break;
+   case RELEASE:
+      tube->release = (const float*)data;
+      break;
+   case LOOKAHEAD:
+      tube->lookahead = (const float*)data;
+      break;
+   case LATENCY:
+      tube->latency = (float*)data;
+      break;
+   case OVERSAMPLE:
+      tube->oversample = (const float*)data;
+      break;
+   case SAG:
+      tube->sag = (const float*)data;
+      break;
+   case SAG_TIME:
+      tube->sag_time = (const float*)data;
+      break;
 	}
 
 }
 
+/**
+   z[i] = f(scale v[i]) with the bias moved by the sag: q(n) = q + sag s(n),
+   where s follows |v|/peak = norm |v| with the time constant of the "sag
+   time" port.  The curve is separable,
+
+      f(x; q) = g(x - q) - g(-q),   g(u) = u/(1 - exp(-dist u)),
+
+   so the tables of g (the curve for q = 0) give f for every bias with two
+   lookups.  The first goes through the oversampling, q with it; the
+   second, which only depends on q, is taken at the base rate from q
+   delayed to match.
+*/
+static void
+sag_shape(Tube* tube, const float* v, float* z, uint32_t n, float norm,
+          float scale, float q, float sag)
+{
+   uint32_t j;
+   float d, s = tube->sag_state;
+   const float c = tube->sag_coef;
+   const float c1 = 1 - c;
+   float u[TUBE_CHUNK];
+   float qv[TUBE_CHUNK];
+
+   for (j = 0; j < n; j++) {
+      d = MIN(fabsf(v[j])*norm, 1);
+      s = c*s + c1*d;   // two dependent operations per sample, not three
+      qv[j] = q + sag*s;
+      u[j] = scale*v[j] - qv[j];
+   }
+   /* No denormals in silence; from 1e-30 a chunk decays 1e-8 at most */
+   tube->sag_state = s < 1e-30f ? 0 : s;
+
+   tube_os_process(&tube->os, &tube->bias, u, z, n, 1);
+   tube_delay_process(&tube->bias_delay, qv, qv, n);
+   tube_shaper_process(&tube->bias, qv, u, n, -1);
+   for (j = 0; j < n; j++)
+      z[j] -= u[j];
+}
+
 /**
    The `run()` method is the main process function of the plugin.  It processes
    a block of audio in the audio context.  Since this plugin is
@@ -114,8 +225,8 @@ connect_port(LV2_Handle instance,
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
-	uint32_t pos;
-	const Tube* tube = (Tube*)instance;
+	uint32_t pos, j, len;
+	Tube* tube = (Tube*)instance;
 	const float* const input  = tube->input;
 	float* const       output = tube->output;
    float gain = *(tube->gain);
@@ -124,93 +235,172 @@ run(LV2_Handle instance, uint32_t n_samples)
    float rh = *(tube->rh);
    float rl = *(tube->rl);
    float mix = *(tube->mix);
-   float extra[5000];
-   float extra2[5000];
-
-   float max = 0, maxZ = 0, maxY = 0, y;
+   int streaming = tube->norm && *(tube->norm) > 0.5;
+   float sag = tube->sag ? *(tube->sag) : 0;
+   float sag_ms = tube->sag_time ? *(tube->sag_time) : 50;
+   float z[TUBE_CHUNK];
+   float xd[TUBE_CHUNK];
+   float e[TUBE_CHUNK];
+   const float* x;
+
+   uint32_t latency;
+   int c, corners;
+   float max = 1, maxZ, maxY, lo = -1, hi = 1, y, qc;
+   float xc[4], zc[4];
+   float scale = 0, a = 0, b = 0, k = 0;
+   float x1, x2, y1, y2, hp, yLP;
 
 	if (tube == NULL) {
 		fprintf(stderr, "DAFX_TUBE: run() called with NULL instance parameter.\n");
 		return;
 	}
 
-	for (pos = 0; pos < n_samples; pos++) {
-      if (fabs(input[pos]) > max)
-         max = fabs(input[pos]);
-   }
-
-   for (pos = 0; pos < n_samples; pos++) {
-      if (max > 0) extra[pos] = input[pos]*gain/max; /*Nomalização (y no livro)*/
-      else extra[pos] = 0;
-   }
-
-   if (q == 0) {
-      for (pos = 0; pos < n_samples; pos++) {
-         extra2[pos] = extra[pos]/(1 - exp(-dist*extra[pos])); /*z no livro*/
-      }
-      for (pos = 0; pos < n_samples; pos++) {
-         if (extra[pos] == q)
-            extra2[pos] = 1/dist;
-      }
+   /*
+      The signal is normalized by its peak, the peak of the block in the
+      book and the envelope e(n) when streaming, where it lies in [-1, 1].
+      z = f(gain x/peak) (z no livro) and y = mix z peak/maxZ + (1 - mix) x
+      never decrease with x, so maxZ and maxY are reached at the lowest or
+      the highest sample and need no pass of their own.  The output is
+      k y with k = peak/maxY, and k = 0 silences it when a peak is zero.
+      When streaming these are computed for a peak of 1 and the envelope
+      scales the curve per sample.
+      When oversampling, z comes out tube_os_latency() samples late, and the
+      dry signal and the envelope are delayed to match.  In block mode the
+      first samples of a block are then scaled with its factors but shaped
+      with the previous block's peak, one more of the book's block effects.
+      With sag the bias spans [q, q + sag] and f is monotonic in q too, so
+      maxZ and maxY are taken at the four corners of x and q.
+   */
+   if (streaming) {
+      tube_env_set(&tube->env, tube->detector ? (int)*(tube->detector) : 0,
+                   tube->attack ? *(tube->attack) : 0,
+                   tube->release ? *(tube->release) : 0,
+                   tube->lookahead ? *(tube->lookahead) : 0);
    }
    else {
-      for (pos = 0; pos < n_samples; pos++) {
-         extra2[pos] = (extra[pos] - q)/(1 - exp(-dist*(extra[pos]-q))) + q/(1 - exp(dist*q));
-      }
-      for (pos = 0; pos < n_samples; pos++) {
-         if (extra[pos] == q)
-            extra2[pos] = 1/dist + Q/(1-exp(dist*q));
+      /* Not from 0: at q = 0, f(0) = 1/dist is no sample's value */
+      lo = hi = n_samples > 0 ? input[0] : 0;
+      for (pos = 1; pos < n_samples; pos++) {
+         if (input[pos] < lo)
+            lo = input[pos];
+         if (input[pos] > hi)
+            hi = input[pos];
       }
+      max = MAX(-lo, hi);
    }
 
-   //MAXZ
-   for (pos = 0; pos < n_samples; pos++) {
-      if (fabs(extra2[pos]) > maxZ)
-         maxZ = fabs(extra2[pos]);
+   tube_shaper_set(&tube->shaper, dist, q);
+   tube_os_set_factor(&tube->os,
+                      tube->oversample ? (int)*(tube->oversample) : 1);
+   latency = tube_os_latency(&tube->os);
+   if (tube->dry.len != latency) {
+      tube_delay_set(&tube->dry, latency);
+      tube_delay_set(&tube->env_delay, latency);
    }
-
-   for (pos = 0; pos < n_samples; pos++) {
-      if (max > 0 && maxZ > 0) y = mix*extra2[pos]*max/maxZ + (1-mix)*input[pos];
-      else y = 0;
-      extra[pos] = y;
-   }
-
-   //MAXY
-   for (pos = 0; pos < n_samples; pos++) {
-      if (fabs(extra[pos]) > maxY)
-         maxY = fabs(extra[pos]);
+   if (sag != 0) {
+      tube_shaper_set(&tube->bias, dist, 0);
+      if (tube->bias_delay.len != latency)
+         tube_delay_set(&tube->bias_delay, latency);
+      if (sag_ms != tube->sag_ms) {
+         tube->sag_coef = sag_ms > 0 ? exp(-1000/(sag_ms*tube->rate)) : 0;
+         tube->sag_ms = sag_ms;
+      }
    }
-
-   for (pos = 0; pos < n_samples; pos++) {
-      if (max > 0 && maxY > 0) extra[pos] = extra[pos]*max/maxY;
-      else extra[pos] = 0;
+   if (max > 0) {
+      scale = gain/max;
+      xc[0] = xc[2] = lo;
+      xc[1] = xc[3] = hi;
+      if (sag == 0) {
+         zc[0] = tube_shaper_eval(&tube->shaper, scale*lo);
+         zc[1] = tube_shaper_eval(&tube->shaper, scale*hi);
+         corners = 2;
+      }
+      else {
+         for (c = 0; c < 4; c++) {
+            qc = c < 2 ? q : q + sag;
+            zc[c] = tube_shaper_eval(&tube->bias, scale*xc[c] - qc) -
+                    tube_shaper_eval(&tube->bias, -qc);
+         }
+         corners = 4;
+      }
+      maxZ = 0;
+      for (c = 0; c < corners; c++)
+         maxZ = MAX(maxZ, fabsf(zc[c]));
+      if (maxZ > 0) {
+         a = mix*max/maxZ;
+         b = 1 - mix;
+         maxY = 0;
+         for (c = 0; c < corners; c++)
+            maxY = MAX(maxY, fabsf(a*zc[c] + b*xc[c]));
+         if (maxY > 0)
+            k = max/maxY;
+      }
    }
 
    /* FILTERING:
       HP: y(n) = x(n) - 2*x(n-1) + x(n-2) + 2*rh*y(n-1) - rh*rh*y(n-2)
       LP: y(n) = (1-rl)*x(n) + rl*y(n-1) 
+      The curve, mix, normalization and both filters run in one pass over
+      chunks of TUBE_CHUNK samples.  Each input sample is read before its
+      output is written, so the host may run the plugin in place.
    */
-   //HP:
-   for (pos = 0; pos < n_samples; pos++) {
-      y = extra[pos] - 2*(*(tube->lastX)) + *(tube->lastX2) + 2*rh*(*(tube->lastY))- rh*rh*(*(tube->lastY2));
-      *(tube->lastX2) = *(tube->lastX);
-      *(tube->lastX)= extra[pos];
-      *(tube->lastY2) = *(tube->lastY);
-      *(tube->lastY)= y;
-      extra[pos] = y;
-   }
-   //LP:
-   for (pos = 0; pos < n_samples; pos++) {
-      y = (1-rl)*extra[pos] + rl*(*(tube->lastY_LP));
-      *(tube->lastY_LP) = y;
-      extra[pos] = y;
-   }
-
-   //OUT:
-   for (pos = 0; pos < n_samples; pos++) {
-      output[pos] = extra[pos];
+   x1 = *(tube->lastX);
+   x2 = *(tube->lastX2);
+   y1 = *(tube->lastY);
+   y2 = *(tube->lastY2);
+   yLP = *(tube->lastY_LP);
+   for (pos = 0; pos < n_samples; pos += len) {
+      len = MIN(n_samples - pos, TUBE_CHUNK);
+      if (streaming) {
+         tube_env_process(&tube->env, input + pos, xd, e, len);
+         for (j = 0; j < len; j++)
+            z[j] = xd[j]/e[j];
+         if (sag != 0)
+            sag_shape(tube, z, z, len, 1, gain, q, sag);
+         else
+            tube_os_process(&tube->os, &tube->shaper, z, z, len, gain);
+         tube_delay_process(&tube->env_delay, e, e, len);
+         for (j = 0; j < len; j++)
+            z[j] *= e[j];
+         tube_delay_process(&tube->dry, xd, xd, len);
+         x = xd;
+      }
+      else if (sag != 0) {
+         sag_shape(tube, input + pos, z, len, max > 0 ? 1/max : 0, scale, q,
+                   sag);
+         tube_delay_process(&tube->dry, input + pos, xd, len);
+         x = xd;
+      }
+      else if (latency > 0) {
+         tube_os_process(&tube->os, &tube->shaper, input + pos, z, len,
+                         scale);
+         tube_delay_process(&tube->dry, input + pos, xd, len);
+         x = xd;
+      }
+      else {
+         tube_shaper_process(&tube->shaper, input + pos, z, len, scale);
+         x = input + pos;
+      }
+      for (j = 0; j < len; j++) {
+         y = k*(a*z[j] + b*x[j]);
+         hp = y - 2*x1 + x2 + 2*rh*y1 - rh*rh*y2;
+         x2 = x1;
+         x1 = y;
+         y2 = y1;
+         y1 = hp;
+         yLP = (1-rl)*hp + rl*yLP;
+         output[pos + j] = yLP;
+      }
    }
-
+   *(tube->lastX) = x1;
+   *(tube->lastX2) = x2;
+   *(tube->lastY) = y1;
+   *(tube->lastY2) = y2;
+   *(tube->lastY_LP) = yLP;
+
+   if (tube->latency)
+      *(tube->latency) = latency +
+                         (streaming ? tube_env_latency(&tube->env) : 0);
 }
 
 /**
@@ -232,6 +422,52 @@ instantiate(const LV2_Descriptor*     descriptor,
 {
 	Tube* tube = (Tube*)malloc(sizeof(Tube));
 
+   if (tube == NULL)
+      return NULL;
+
+   if (tube_shaper_init(&tube->shaper) != 0) {
+      fprintf(stderr, "DAFX_TUBE: could not allocate the transfer curve.\n");
+      free(tube);
+      return NULL;
+   }
+   if (tube_env_init(&tube->env, rate) != 0) {
+      fprintf(stderr, "DAFX_TUBE: could not allocate the lookahead line.\n");
+      tube_shaper_free(&tube->shaper);
+      free(tube);
+      return NULL;
+   }
+   if (tube_os_init(&tube->os, TUBE_CHUNK) != 0) {
+      fprintf(stderr, "DAFX_TUBE: could not allocate the oversampling.\n");
+      tube_env_free(&tube->env);
+      tube_shaper_free(&tube->shaper);
+      free(tube);
+      return NULL;
+   }
+   if (tube_shaper_init(&tube->bias) != 0) {
+      fprintf(stderr, "DAFX_TUBE: could not allocate the bias curve.\n");
+      tube_os_free(&tube->os);
+      tube_env_free(&tube->env);
+      tube_shaper_free(&tube->shaper);
+      free(tube);
+      return NULL;
+   }
+   tube_delay_set(&tube->bias_delay, 0);
+   tube->rate = rate;
+   tube->sag_state = 0;
+   tube->sag_coef = 0;
+   tube->sag_ms = NAN;
+   tube_delay_set(&tube->dry, 0);
+   tube_delay_set(&tube->env_delay, 0);
+   tube->norm = NULL;
+   tube->detector = NULL;
+   tube->attack = NULL;
+   tube->release = NULL;
+   tube->lookahead = NULL;
+   tube->latency = NULL;
+   tube->oversample = NULL;
+   tube->sag = NULL;
+   tube->sag_time = NULL;
+
    tube->lastX = malloc(sizeof(float));
    tube->lastX2 = malloc(sizeof(float));
    tube->lastY = malloc(sizeof(float));
@@ -250,8 +486,9 @@ instantiate(const LV2_Descriptor*     descriptor,
 /**
    The `activate()` method is called by the host to initialise and prepare the
    plugin instance for running.  The plugin must reset all internal state
-   except for buffer locations set by `connect_port()`.  Since this plugin has
-   no other internal state, this method does nothing.
+   except for buffer locations set by `connect_port()`.  Here the filter
+   memories, the envelope, the lookahead line, the oversampling filters
+   and delays and the sag are cleared.
 
    This method is in the ``instantiation'' threading class, so no other
    methods on this instance will be called concurrently with it.
@@ -265,6 +502,12 @@ activate(LV2_Handle instance)
    *(tube->lastY) = 0;
    *(tube->lastY2) = 0;
    *(tube->lastY_LP) = 0;
+   tube_env_reset(&tube->env);
+   tube_os_reset(&tube->os);
+   tube_delay_set(&tube->dry, tube->dry.len);
+   tube_delay_set(&tube->env_delay, tube->env_delay.len);
+   tube_delay_set(&tube->bias_delay, tube->bias_delay.len);
+   tube->sag_state = 0;
 }
 
 /**
@@ -293,6 +536,12 @@ deactivate(LV2_Handle instance)
 static void
 cleanup(LV2_Handle instance)
 {
+   Tube* tube = (Tube*)instance;
+
+   tube_shaper_free(&tube->shaper);
+   tube_env_free(&tube->env);
+   tube_os_free(&tube->os);
+   tube_shaper_free(&tube->bias);
 	free(instance);
 }
 
@@ -0,0 +1,128 @@
+/**
+   Cost of the moving bias.  The curve stage on 64-sample chunks, in ns per
+   sample: the fixed-bias table, the two lookups of a per-sample bias, the
+   formula with two expf() per sample and the table rebuilt for each chunk
+   instead; then run() with sag 0 and 0.8 in block and envelope mode
+   (256 frames, gain 4, q -0.2, dist 2).
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "tube_shaper.h"
+
+#define M     4096
+#define CHUNK 64
+
+static float x[M], qv[M], y[M];
+
+/** Best ns per sample of `stage`, run `reps` times on `n` samples. */
+#define TIME(best, reps, n, stage)                   \
+   do {                                              \
+      int r_;                                        \
+      double t_;                                     \
+      for (r_ = 0, best = -1; r_ < (reps); r_++) {   \
+         t_ = bench_cpu();                           \
+         stage;                                      \
+         t_ = 1e9*(bench_cpu() - t_)/(n);            \
+         best = (best < 0 || t_ < best) ? t_ : best; \
+      }                                              \
+   } while (0)
+
+static void
+curve_stages(void)
+{
+   TubeShaper fixed, bias;
+   float u[CHUNK], t[CHUNK], v;
+   double best;
+   int p, j, i;
+
+   if (tube_shaper_init(&fixed) != 0 || tube_shaper_init(&bias) != 0) {
+      fprintf(stderr, "bench_bias: out of memory\n");
+      exit(1);
+   }
+   for (i = 0; i < M; i++) {
+      x[i] = 0.9*sin(i*0.05);
+      qv[i] = -0.2 + 0.4*(0.5 + 0.5*sin(i*0.001));
+   }
+   tube_shaper_set(&fixed, 2, -0.2);
+   tube_shaper_set(&bias, 2, 0);
+
+   printf("curve, ns/sample\n");
+   TIME(best, 200, M,
+        for (p = 0; p < M; p += CHUNK)
+           tube_shaper_process(&fixed, x + p, y + p, CHUNK, 4));
+   printf("table, fixed q                  %5.1f\n", best);
+   TIME(best, 200, M,
+        for (p = 0; p < M; p += CHUNK) {
+           for (j = 0; j < CHUNK; j++)
+              u[j] = 4*x[p + j] - qv[p + j];
+           tube_shaper_process(&bias, u, y + p, CHUNK, 1);
+           tube_shaper_process(&bias, qv + p, t, CHUNK, -1);
+           for (j = 0; j < CHUNK; j++)
+              y[p + j] -= t[j];
+        });
+   printf("table, moving q                 %5.1f\n", best);
+   TIME(best, 50, M,
+        for (i = 0; i < M; i++) {
+           v = 4*x[i] - qv[i];
+           y[i] = v/(1 - expf(-2*v)) + qv[i]/(1 - expf(2*qv[i]));
+        });
+   printf("two expf() per sample           %5.1f\n", best);
+   TIME(best, 5, M,
+        for (p = 0; p < M; p += CHUNK) {
+           tube_shaper_set(&fixed, 2, qv[p]);
+           tube_shaper_process(&fixed, x + p, y + p, CHUNK, 4);
+        });
+   printf("table rebuilt every %d samples  %5.1f\n", CHUNK, best);
+
+   tube_shaper_free(&fixed);
+   tube_shaper_free(&bias);
+}
+
+static void
+run_sag(void)
+{
+   const int n = 2*BENCH_RATE;
+   float* in = malloc(n*sizeof(float));
+   float* out = malloc(n*sizeof(float));
+   float ctl[BENCH_PORTS], latency;
+   double best;
+   LV2_Handle h;
+   int norm, sag;
+
+   if (in == NULL || out == NULL) {
+      fprintf(stderr, "bench_bias: out of memory\n");
+      exit(1);
+   }
+   bench_signal(in, n);
+
+   printf("\nrun(), ns/sample (256 frames)   sag 0   sag 0.8\n");
+   for (norm = 0; norm < 2; norm++) {
+      printf("%-30s", norm ? "envelope" : "block peak");
+      for (sag = 0; sag < 2; sag++) {
+         h = bench_instance(ctl, BENCH_PORTS, &latency);
+         if (h == NULL) {
+            fprintf(stderr, "bench_bias: no instance\n");
+            exit(1);
+         }
+         ctl[2] = 4;
+         ctl[3] = -0.2;
+         ctl[4] = 2;
+         ctl[8] = norm;
+         ctl[15] = sag ? 0.8 : 0;
+         TIME(best, 5, n, bench_render(h, in, out, n, 256));
+         printf("  %5.1f  ", best);
+         lv2_descriptor(0)->cleanup(h);
+      }
+      printf("\n");
+   }
+
+   free(in);
+   free(out);
+}
+
+int main(void) {
+   curve_stages();
+   run_sag();
+   return 0;
+}
@@ -0,0 +1,176 @@
+/**
+   run() against the book's (tubeBook() in test/tube_ref.c) at 64, 256 and
+   4096-frame blocks: ns per sample (mix 1 and 0.5, default ports, 20 s at
+   48 kHz, best of 3) and the stack each uses in one call.  The stack is
+   measured on a thread whose stack is filled with a pattern beforehand:
+   the depth it reached and the bytes it overwrote, less those of an empty
+   call.  The bytes written to the stack are the block-sized scratch of
+   each version, its memory traffic beyond the input and output.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <limits.h>
+#include <pthread.h>
+
+#include "bench.h"
+#include "tube_ref.h"
+
+#define SECONDS 20
+#define REPS    3
+#define STACK   (1 << 20)
+#define PATTERN 0xa5
+
+static const int blocks[] = {64, 256, 4096};
+#define BLOCKS ((int)(sizeof(blocks)/sizeof(blocks[0])))
+
+static float ctl[BENCH_PORTS];
+static float latency;
+
+/** One call of either version, for the stack probe. */
+typedef struct {
+   int    book;        // tubeBook() instead of the plugin, -1 for nothing
+   int    block;
+   float* in;
+   float* out;
+   LV2_Handle h;       // instance of the plugin
+} Call;
+
+static void*
+call(void* arg)
+{
+   const Call* c = (const Call*)arg;
+   TubeBook st;
+
+   if (c->book > 0) {
+      memset(&st, 0, sizeof(st));
+      tubeBook(&st, c->in, c->out, c->block, ctl[2], ctl[3], ctl[4], ctl[5],
+               ctl[6], ctl[7]);
+   }
+   else if (c->book == 0) {
+      bench_render(c->h, c->in, c->out, c->block, c->block);
+   }
+   return NULL;
+}
+
+/**
+   Depth of stack the thread running `c` reached and the bytes it
+   overwrote.  Returns -1 on failure.
+*/
+static int
+stack_used(Call* c, long* depth, long* written)
+{
+   unsigned char* mem;
+   pthread_attr_t attr;
+   pthread_t tid;
+   long i;
+
+   if (posix_memalign((void**)&mem, 4096, STACK) != 0)
+      return -1;
+   memset(mem, PATTERN, STACK);
+   pthread_attr_init(&attr);
+   if (pthread_attr_setstack(&attr, mem, STACK) != 0 ||
+       pthread_create(&tid, &attr, call, c) != 0) {
+      pthread_attr_destroy(&attr);
+      free(mem);
+      return -1;
+   }
+   pthread_join(tid, NULL);
+   pthread_attr_destroy(&attr);
+
+   for (i = 0; i < STACK && mem[i] == PATTERN; i++)
+      ;
+   *depth = STACK - i;
+   for (*written = 0; i < STACK; i++)
+      *written += mem[i] != PATTERN;
+   free(mem);
+   return 0;
+}
+
+/** Best ns per sample of the book's run() or the plugin's (`h`). */
+static double
+time_run(int book, LV2_Handle h, const float* in, float* out, int n,
+         int block)
+{
+   TubeBook st;
+   double t, best = -1;
+   int r, pos, len;
+
+   for (r = 0; r < REPS; r++) {
+      memset(&st, 0, sizeof(st));
+      t = bench_cpu();
+      if (book) {
+         for (pos = 0; pos < n; pos += len) {
+            len = n - pos < block ? n - pos : block;
+            tubeBook(&st, in + pos, out + pos, len, ctl[2], ctl[3], ctl[4],
+                     ctl[5], ctl[6], ctl[7]);
+         }
+      }
+      else {
+         lv2_descriptor(0)->activate(h);
+         bench_render(h, in, out, n, block);
+      }
+      t = 1e9*(bench_cpu() - t)/n;
+      if (best < 0 || t < best)
+         best = t;
+   }
+   return best;
+}
+
+int main(void) {
+   static const char* names[] = {"run()", "book"};
+   const int n = SECONDS*BENCH_RATE;
+   float* in = malloc(n*sizeof(float));
+   float* out = malloc(n*sizeof(float));
+   Call c;
+   long base_depth, base_written, depth, written;
+   int b, book;
+   LV2_Handle h = bench_instance(ctl, 8, &latency);
+
+   if (in == NULL || out == NULL || h == NULL) {
+      fprintf(stderr, "bench_blocks: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, n);
+
+   printf("ns/sample          64 frames   256 frames   4096 frames\n");
+   for (book = 1; book >= 0; book--) {
+      ctl[7] = 1;
+      printf("%-6s mix 1   ", names[book]);
+      for (b = 0; b < BLOCKS; b++)
+         printf("   %6.1f    ", time_run(book, h, in, out, n, blocks[b]));
+      ctl[7] = 0.5;
+      printf("\n%-6s mix 0.5 ", names[book]);
+      for (b = 0; b < BLOCKS; b++)
+         printf("   %6.1f    ", time_run(book, h, in, out, n, blocks[b]));
+      printf("\n");
+   }
+   ctl[7] = 1;
+
+   c.in = in;
+   c.out = out;
+   c.h = h;
+   c.book = -1;
+   c.block = 0;
+   if (stack_used(&c, &base_depth, &base_written) != 0) {
+      fprintf(stderr, "bench_blocks: no thread\n");
+      return 1;
+   }
+   printf("\nstack of one call,  64, 256 and 4096 frames, bytes deep / written\n");
+   for (book = 1; book >= 0; book--) {
+      c.book = book;
+      printf("%-15s", names[book]);
+      for (b = 0; b < BLOCKS; b++) {
+         c.block = blocks[b];
+         lv2_descriptor(0)->activate(h);
+         if (stack_used(&c, &depth, &written) != 0)
+            depth = written = base_depth = base_written = -1;
+         printf("  %5ld / %5ld", depth - base_depth, written - base_written);
+      }
+      printf("\n");
+   }
+
+   lv2_descriptor(0)->cleanup(h);
+   free(in);
+   free(out);
+   return 0;
+}
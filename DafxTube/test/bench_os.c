@@ -0,0 +1,145 @@
+/**
+   The tables of the oversampling in README.txt.  First the energy off the
+   harmonics of a sine through the curve (dist 8, q -0.2) by tone, gain and
+   factor, in dB below the harmonics: the tones fall on bins of an N-point
+   DFT of an odd index m, so the harmonics are the bins h m and the
+   aliases, folded from h m > N/2, land between them.  The harmonics are
+   taken with Goertzel, the rest is the energy of the signal less its mean
+   and those.  Then run() at each factor in ns per sample, block peak and
+   envelope mode, 256-frame blocks, 10 s at 48 kHz, best of REPS.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "tube_os.h"
+#include "tube_shaper.h"
+
+#define N       (1 << 16)
+#define SETTLE  4096
+#define CHUNK   256
+#define SECONDS 10
+#define REPS    3
+
+static const int factors[] = {1, 2, 4, 8};
+
+/** |X[k]|^2 of x[0..N), by Goertzel in double. */
+static double
+bin_power(const float* x, int k)
+{
+   const double c = 2*cos(2*PI*k/N);
+   double s0, s1 = 0, s2 = 0;
+   int i;
+
+   for (i = 0; i < N; i++) {
+      s0 = x[i] + c*s1 - s2;
+      s2 = s1;
+      s1 = s0;
+   }
+   return s1*s1 + s2*s2 - c*s1*s2;
+}
+
+/** Energy off the harmonics of bin m, in dB below them. */
+static double
+alias_db(const float* z, int m)
+{
+   double mean = 0, total = 0, harm = 0;
+   int i, h;
+
+   for (i = 0; i < N; i++)
+      mean += z[i];
+   mean /= N;
+   for (i = 0; i < N; i++)
+      total += (z[i] - mean)*(z[i] - mean);
+   for (h = 1; h*m < N/2; h++)
+      harm += 2*bin_power(z, h*m)/N;
+   return 10*log10(harm/(total - harm));
+}
+
+static void
+aliases(void)
+{
+   static const int bins[] = {3959, 12015, 19933};   // 2.9, 8.8, 14.6 kHz
+   static const float gains[] = {2, 5};
+   static float u[SETTLE + N], z[SETTLE + N];
+   TubeShaper ts;
+   TubeOs os;
+   int b, g, f, i;
+
+   if (tube_shaper_init(&ts) != 0 || tube_os_init(&os, CHUNK) != 0) {
+      fprintf(stderr, "bench_os: out of memory\n");
+      exit(1);
+   }
+   tube_shaper_set(&ts, 8, -0.2);
+
+   printf("energy off the harmonics, dB below them\n"
+          "  tone (48 kHz)   gain    off     2x     4x     8x\n");
+   for (b = 0; b < 3; b++) {
+      for (i = 0; i < SETTLE + N; i++)
+         u[i] = sin(2*PI*bins[b]*(double)i/N);
+      for (g = 0; g < 2; g++) {
+         printf("  %4.1f kHz        %g   ", 48.0*bins[b]/N, gains[g]);
+         for (f = 0; f < 4; f++) {
+            tube_os_set_factor(&os, factors[f]);
+            tube_os_reset(&os);
+            for (i = 0; i < SETTLE + N; i += CHUNK)
+               tube_os_process(&os, &ts, u + i, z + i, CHUNK, gains[g]);
+            printf("  %5.1f", alias_db(z + SETTLE, bins[b]));
+         }
+         printf("\n");
+      }
+   }
+   tube_os_free(&os);
+   tube_shaper_free(&ts);
+}
+
+/** Best ns per sample of run() at each factor, block peak and envelope. */
+static void
+cost(void)
+{
+   static const char* modes[] = {"block peak", "envelope"};
+   const int n = SECONDS*BENCH_RATE;
+   float* in = malloc(n*sizeof(float));
+   float* out = malloc(n*sizeof(float));
+   float ctl[BENCH_PORTS], latency;
+   double t, best;
+   LV2_Handle h;
+   int norm, f, r;
+
+   if (in == NULL || out == NULL) {
+      fprintf(stderr, "bench_os: out of memory\n");
+      exit(1);
+   }
+   bench_signal(in, n);
+
+   printf("\n  ns/sample (%d frames)   off    2x    4x    8x\n", CHUNK);
+   for (norm = 0; norm < 2; norm++) {
+      printf("  %-22s", modes[norm]);
+      for (f = 0; f < 4; f++) {
+         h = bench_instance(ctl, BENCH_PORTS, &latency);
+         if (h == NULL) {
+            fprintf(stderr, "bench_os: no instance\n");
+            exit(1);
+         }
+         ctl[8] = norm;
+         ctl[14] = factors[f];
+         for (r = 0, best = -1; r < REPS; r++) {
+            t = bench_cpu();
+            bench_render(h, in, out, n, CHUNK);
+            t = 1e9*(bench_cpu() - t)/n;
+            best = best < 0 || t < best ? t : best;
+         }
+         lv2_descriptor(0)->cleanup(h);
+         printf(" %5.1f", best);
+      }
+      printf("\n");
+   }
+   free(in);
+   free(out);
+}
+
+int main(void) {
+   aliases();
+   cost();
+
+   return 0;
+}
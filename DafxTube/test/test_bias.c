@@ -0,0 +1,204 @@
+/**
+   The moving bias of "sag" against the formula in double precision.  The
+   two lookups of the q = 0 tables, g(u - q) - g(-q), against the curve of
+   the book over the ranges of dafx_tube.ttl: gain and dist 0.01 - 10,
+   q and sag -2 - 2 and the sag follower anywhere in [0, 1], so the bias
+   spans -4 - 4; then run() in block mode with sag against a double
+   precision run() with the formula.  The error is also printed relative
+   to the peak of |f| over [-gain, gain], which run() normalizes by; the
+   tables are spaced evenly in x, so that grows as the gain falls.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "tube_shaper.h"
+
+#define STEPS 9      // of q, sag and the follower
+#define XS    2001   // samples of x over [-gain, gain]
+#define N     (2*BENCH_RATE)
+
+/* Largest error of the lookups */
+#define MAX_ERROR 1.5e-5
+
+/* Largest difference of run() from the double precision run() */
+#define MAX_RUN_ERROR 2e-5
+
+static int failures = 0;
+
+static double
+g(double u, double dist)
+{
+   return fabs(u) < 1e-12 ? 1/dist : u/(-expm1(-dist*u));
+}
+
+/** f(x; q) of the book, continuous at q = 0. */
+static double
+f(double x, double q, double dist)
+{
+   return g(x - q, dist) - g(-q, dist);
+}
+
+/** The lookups over the ranges of the ports, by dist and gain. */
+static void
+check_lookups(void)
+{
+   static const double dists[] = {0.01, 0.03, 0.1, 0.3, 1, 3, 10};
+   static const double gains[] = {0.01, 0.1, 1, 4, 10};
+   const int D = sizeof(dists)/sizeof(dists[0]);
+   const int G = sizeof(gains)/sizeof(gains[0]);
+   TubeShaper bias;
+   double x, q, qn, r, z, e, peak, worst, worst_rel, err, rel;
+   int d, k, iq, is, s, i;
+
+   if (tube_shaper_init(&bias) != 0) {
+      CHECK(0, "out of memory");
+      return;
+   }
+   printf("g(u - q) - g(-q), largest error (of the peak)\n  dist  ");
+   for (k = 0; k < G; k++)
+      printf("   gain %-5g       ", gains[k]);
+   printf("\n");
+
+   for (d = 0; d < D; d++) {
+      tube_shaper_set(&bias, dists[d], 0);
+      printf("%6g", dists[d]);
+      for (k = 0; k < G; k++) {
+         worst = worst_rel = 0;
+         for (iq = 0; iq < STEPS; iq++)
+         for (is = 0; is < STEPS; is++)
+         for (s = 0; s < STEPS; s++) {
+            q = -2 + 4.0*iq/(STEPS - 1);
+            qn = q + (-2 + 4.0*is/(STEPS - 1))*s/(STEPS - 1.0);
+            err = peak = 0;
+            for (i = 0; i < XS; i++) {
+               x = gains[k]*(2.0*i/(XS - 1) - 1);
+               r = f(x, qn, dists[d]);
+               z = tube_shaper_eval(&bias, (float)x - (float)qn) -
+                   tube_shaper_eval(&bias, -(float)qn);
+               e = fabs(z - r);
+               err = e > err ? e : err;
+               peak = fabs(r) > peak ? fabs(r) : peak;
+            }
+            rel = peak > 0 ? err/peak : 0;
+            worst = err > worst ? err : worst;
+            worst_rel = rel > worst_rel ? rel : worst_rel;
+         }
+         printf("   %.1e (%.1e)", worst, worst_rel);
+         CHECK(worst <= MAX_ERROR, "dist %g, gain %g: error %.2g",
+               dists[d], gains[k], worst);
+      }
+      printf("\n");
+   }
+   tube_shaper_free(&bias);
+}
+
+/** run() in block mode, double precision and with the formula. */
+static void
+reference(const float* in, double* out, int block, const float* ctl)
+{
+   const double gain = ctl[2], q = ctl[3], dist = ctl[4], rh = ctl[5];
+   const double rl = ctl[6], mix = ctl[7], sag = ctl[15];
+   const double c = exp(-1000/(ctl[16]*BENCH_RATE));
+   double s = 0, x1 = 0, x2 = 0, y1 = 0, y2 = 0, yl = 0;
+   double lo, hi, mx, sc, a, b, k, mz, my, x, dd, y, hp, xc[4], zc[4];
+   int pos, n, i, j;
+
+   for (pos = 0; pos < N; pos += block) {
+      n = block < N - pos ? block : N - pos;
+      lo = hi = 0;
+      for (j = 0; j < n; j++) {
+         lo = in[pos + j] < lo ? in[pos + j] : lo;
+         hi = in[pos + j] > hi ? in[pos + j] : hi;
+      }
+      mx = fmax(-lo, hi);
+      sc = gain/mx;
+      mz = my = 0;
+      for (i = 0; i < 4; i++) {
+         xc[i] = i & 1 ? hi : lo;
+         zc[i] = f(sc*xc[i], i < 2 ? q : q + sag, dist);
+         mz = fmax(mz, fabs(zc[i]));
+      }
+      a = mix*mx/mz;
+      b = 1 - mix;
+      for (i = 0; i < 4; i++)
+         my = fmax(my, fabs(a*zc[i] + b*xc[i]));
+      k = mx/my;
+      for (j = 0; j < n; j++) {
+         x = in[pos + j];
+         dd = fmin(fabs(x)/mx, 1);
+         s = c*s + (1 - c)*dd;
+         y = k*(a*f(sc*x, q + sag*s, dist) + b*x);
+         hp = y - 2*x1 + x2 + 2*rh*y1 - rh*rh*y2;
+         x2 = x1;
+         x1 = y;
+         y2 = y1;
+         y1 = hp;
+         yl = (1 - rl)*hp + rl*yl;
+         out[pos + j] = yl;
+      }
+   }
+}
+
+/** run() with sag at a few corners of the ports. */
+static void
+check_run(void)
+{
+   /* gain, q, dist, sag */
+   static const float cases[][4] = {
+      {4, 0.2, 2, 0.8}, {10, -2, 0.01, 2}, {10, 2, 10, -2}, {0.5, 0, 0.5, 2},
+      {1, -1, 5, -0.5}
+   };
+   const int C = sizeof(cases)/sizeof(cases[0]);
+   float* in = malloc(N*sizeof(float));
+   float* out = malloc(N*sizeof(float));
+   double* ref = malloc(N*sizeof(double));
+   float ctl[BENCH_PORTS], latency;
+   double err, peak;
+   LV2_Handle h;
+   int c, i;
+
+   if (in == NULL || out == NULL || ref == NULL) {
+      CHECK(0, "out of memory");
+      free(in);
+      free(out);
+      free(ref);
+      return;
+   }
+   bench_signal(in, N);
+
+   printf("\nrun() with sag against double precision, 256 frames\n");
+   for (c = 0; c < C; c++) {
+      h = bench_instance(ctl, BENCH_PORTS, &latency);
+      if (h == NULL) {
+         CHECK(0, "no instance");
+         break;
+      }
+      ctl[2] = cases[c][0];
+      ctl[3] = cases[c][1];
+      ctl[4] = cases[c][2];
+      ctl[15] = cases[c][3];
+      ctl[7] = 0.8;
+      bench_render(h, in, out, N, 256);
+      lv2_descriptor(0)->cleanup(h);
+      reference(in, ref, 256, ctl);
+
+      for (i = 0, err = peak = 0; i < N; i++) {
+         err = fmax(err, fabs(out[i] - ref[i]));
+         peak = fmax(peak, fabs(ref[i]));
+      }
+      printf("gain %-4g q %-4g dist %-4g sag %-4g  %.1e (peak %.2f)\n",
+             cases[c][0], cases[c][1], cases[c][2], cases[c][3], err, peak);
+      CHECK(err <= MAX_RUN_ERROR, "run() differs by %.2g", err);
+   }
+
+   free(in);
+   free(out);
+   free(ref);
+}
+
+int main(void) {
+   check_lookups();
+   check_run();
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,96 @@
+/**
+   The envelope mode does not depend on the block size: its output must be
+   the same floats for blocks of 1, 64, 256, 777 and 4096 frames, with
+   either detector, lookahead 0 - 10 ms, every oversampling factor and
+   with and without sag.  The "latency" port must report the lookahead in
+   samples plus the delay of the oversampling, 0, 23, 29 and 31 frames for
+   1x - 8x; in block mode there is no lookahead.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#define N (BENCH_RATE/2)
+
+static int failures = 0;
+
+static const int os_latency[] = {0, 23, 29, 31};
+
+int main(void) {
+   static const int blocks[] = {1, 64, 256, 777, 4096};
+   static const float lookaheads[] = {0, 2.5, 10};
+   static const float sags[] = {0, 0.8};
+   const int B = sizeof(blocks)/sizeof(blocks[0]);
+   const int L = sizeof(lookaheads)/sizeof(lookaheads[0]);
+   const int S = sizeof(sags)/sizeof(sags[0]);
+   float* in = malloc(N*sizeof(float));
+   float* out = malloc(N*sizeof(float));
+   float* ref = malloc(N*sizeof(float));
+   float ctl[BENCH_PORTS], latency;
+   long expected;
+   LV2_Handle h;
+   int det, l, f, s, b, norm, configs = 0;
+
+   if (in == NULL || out == NULL || ref == NULL) {
+      fprintf(stderr, "test_blocks: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, N);
+
+   for (det = 0; det < 2; det++)
+   for (l = 0; l < L; l++)
+   for (f = 0; f < 4; f++)
+   for (s = 0; s < S; s++) {
+      for (b = 0; b < B; b++) {
+         h = bench_instance(ctl, BENCH_PORTS, &latency);
+         if (h == NULL) {
+            CHECK(0, "no instance");
+            return 1;
+         }
+         ctl[2] = 4;
+         ctl[3] = 0.2;
+         ctl[4] = 8;
+         ctl[8] = 1;
+         ctl[9] = det;
+         ctl[12] = lookaheads[l];
+         ctl[14] = 1 << f;
+         ctl[15] = sags[s];
+         latency = -1;
+         bench_render(h, in, b == 0 ? ref : out, N, blocks[b]);
+         lv2_descriptor(0)->cleanup(h);
+
+         expected = lrint(lookaheads[l]*BENCH_RATE/1000) + os_latency[f];
+         CHECK(latency == expected, "lookahead %g ms, %dx: latency %g, "
+               "not %ld", lookaheads[l], 1 << f, latency, expected);
+         CHECK(b == 0 || memcmp(out, ref, N*sizeof(float)) == 0,
+               "detector %d, lookahead %g ms, %dx, sag %g: blocks of %d "
+               "frames differ from blocks of 1", det, lookaheads[l], 1 << f,
+               sags[s], blocks[b]);
+      }
+      configs++;
+   }
+   printf("envelope mode, %d settings, blocks of 1 - 4096 frames compared\n",
+          configs);
+
+   /* Block mode: the oversampling only, whatever the lookahead port says */
+   for (norm = 0, f = 0; f < 4; f++) {
+      h = bench_instance(ctl, BENCH_PORTS, &latency);
+      if (h == NULL) {
+         CHECK(0, "no instance");
+         return 1;
+      }
+      ctl[8] = norm;
+      ctl[12] = 10;
+      ctl[14] = 1 << f;
+      latency = -1;
+      bench_render(h, in, out, 256, 256);
+      lv2_descriptor(0)->cleanup(h);
+      CHECK(latency == os_latency[f], "block mode, %dx: latency %g, not %d",
+            1 << f, latency, os_latency[f]);
+   }
+
+   free(in);
+   free(out);
+   free(ref);
+   return failures ? 1 : 0;
+}
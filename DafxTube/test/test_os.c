@@ -0,0 +1,113 @@
+/**
+   The oversampling (tube_os.c): tube_os_latency() is 0, 23, 29 and 31
+   base-rate samples for 1x - 8x, and is the delay the filters actually
+   have: a 200 Hz sine through the curve matches f(u[i - L]) best at lag L
+   = tube_os_latency(), within MAX_ERROR.  With the port at 1x the plugin
+   gives the floats of an instance whose oversampling and sag ports are not
+   connected, in block and envelope mode.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "tube_os.h"
+#include "tube_shaper.h"
+
+#define N       (BENCH_RATE/4)
+#define CHUNK   256
+#define MAX_LAG 40
+
+#define MAX_ERROR 1e-5
+
+static int failures = 0;
+
+static void
+check_delay(void)
+{
+   static const int factors[] = {1, 2, 4, 8};
+   static const int expected[] = {0, 23, 29, 31};
+   static float u[N], z[N];
+   TubeShaper ts;
+   TubeOs os;
+   double e, err[MAX_LAG + 1];
+   int f, lag, best, i;
+
+   if (tube_shaper_init(&ts) != 0 || tube_os_init(&os, CHUNK) != 0) {
+      CHECK(0, "out of memory");
+      return;
+   }
+   tube_shaper_set(&ts, 8, -0.2);
+   for (i = 0; i < N; i++)
+      u[i] = 0.8*sin(2*PI*200*i/BENCH_RATE);
+
+   for (f = 0; f < 4; f++) {
+      tube_os_set_factor(&os, factors[f]);
+      tube_os_reset(&os);
+      CHECK(tube_os_latency(&os) == (uint32_t)expected[f],
+            "%dx: tube_os_latency() %u, not %d", factors[f],
+            tube_os_latency(&os), expected[f]);
+      for (i = 0; i < N; i += CHUNK)
+         tube_os_process(&os, &ts, u + i, z + i, CHUNK, 1);
+
+      /* From past the start of every lag, where the filters have settled */
+      for (lag = 0, best = 0; lag <= MAX_LAG; lag++) {
+         for (i = 4*MAX_LAG, err[lag] = 0; i < N; i++) {
+            e = fabs(z[i] - tube_shaper_eval(&ts, u[i - lag]));
+            err[lag] = e > err[lag] ? e : err[lag];
+         }
+         best = err[lag] < err[best] ? lag : best;
+      }
+      printf("%dx: delay %d samples, %.2g from the curve (%.2g one off)\n",
+             factors[f], best, err[best],
+             fmin(err[best > 0 ? best - 1 : 1], err[best + 1]));
+      CHECK(best == (int)tube_os_latency(&os), "%dx: delay %d, "
+            "tube_os_latency() %u", factors[f], best, tube_os_latency(&os));
+      CHECK(err[best] <= MAX_ERROR, "%dx: %.2g from the curve", factors[f],
+            err[best]);
+   }
+   tube_os_free(&os);
+   tube_shaper_free(&ts);
+}
+
+/** Factor 1 against an instance with ports from 14 on unconnected. */
+static void
+check_off(void)
+{
+   static const float lookaheads[] = {0, 2.5};
+   static float in[N], ref[N], out[N];
+   float ctl[BENCH_PORTS], old[BENCH_PORTS], latency, old_latency;
+   LV2_Handle h, g;
+   int norm, l;
+
+   bench_signal(in, N);
+   for (norm = 0; norm < 2; norm++)
+   for (l = 0; l < 2; l++) {
+      h = bench_instance(ctl, BENCH_PORTS, &latency);
+      g = bench_instance(old, 14, &old_latency);
+      if (h == NULL || g == NULL) {
+         CHECK(0, "no instance");
+         return;
+      }
+      ctl[2] = old[2] = 4;
+      ctl[3] = old[3] = -0.2;
+      ctl[4] = old[4] = 8;
+      ctl[8] = old[8] = norm;
+      ctl[12] = old[12] = lookaheads[l];
+      ctl[14] = 1;
+      bench_render(g, in, ref, N, 777);
+      bench_render(h, in, out, N, 777);
+      lv2_descriptor(0)->cleanup(h);
+      lv2_descriptor(0)->cleanup(g);
+      CHECK(memcmp(out, ref, sizeof(out)) == 0, "norm %d, lookahead %g ms: "
+            "1x differs from the plugin without the port", norm,
+            lookaheads[l]);
+      CHECK(latency == old_latency, "norm %d, lookahead %g ms: latency %g "
+            "against %g", norm, lookaheads[l], latency, old_latency);
+   }
+}
+
+int main(void) {
+   check_delay();
+   check_off();
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,123 @@
+/**
+   run() in block mode, the single pass of dafx_tube.c, against the book's
+   nine passes (tubeBook() in test/tube_ref.c): gain and dist 0.01 - 10, q
+   -2 - 2, mix 1 and 0.5, blocks of 1 - 4096 frames, out of place and in
+   place.  They differ by the error of the table, scaled by the
+   normalization, within the bound of each gain and dist in `bounds`:
+
+   - 2e-5 at moderate gains and dists;
+   - at gain 0.01 the block spans 0.02 of x, so the table's error grows
+     against the range of the curve, as README.txt says of its peak;
+   - at dist 10 a block that stays below the knee only sees the tail
+     exp(dist x), where linear interpolation between points h apart is
+     (dist h)^2/8 = 3e-4 off relative to the curve, and the block is
+     normalized by that curve.
+
+   Blocks of 1 frame run with mix 1 only.  With mix 0.5 and q = 0, the
+   mix of a single sample can cancel, and both versions then scale
+   rounding noise up to the peak.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+#include "tube_ref.h"
+
+#define N (2*BENCH_RATE)
+
+static int failures = 0;
+
+/** The book's run() over `n` samples in `block`-frame blocks. */
+static void
+render_book(const float* in, float* out, int n, int block, const float* ctl)
+{
+   TubeBook st;
+   int pos, len;
+
+   memset(&st, 0, sizeof(st));
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      tubeBook(&st, in + pos, out + pos, len, ctl[2], ctl[3], ctl[4], ctl[5],
+               ctl[6], ctl[7]);
+   }
+}
+
+int main(void) {
+   static const float gains[] = {0.01, 0.5, 4, 10};
+   static const float dists[] = {0.01, 0.5, 10};
+   static const float qs[] = {-2, 0, 0.3, 2};
+   static const float mixes[] = {1, 0.5};
+   static const int blocks[] = {1, 64, 777, 4096};
+   enum { G = sizeof(gains)/sizeof(gains[0]) };
+   enum { D = sizeof(dists)/sizeof(dists[0]) };
+   static const double bounds[G][D] = {
+      {1e-3, 1e-4, 3e-3}, {4e-5, 2e-5, 4e-4}, {2e-5, 2e-5, 4e-4},
+      {2e-5, 2e-5, 4e-4}
+   };
+   const int Q = sizeof(qs)/sizeof(qs[0]);
+   const int X = sizeof(mixes)/sizeof(mixes[0]);
+   const int B = sizeof(blocks)/sizeof(blocks[0]);
+   float* in = malloc(N*sizeof(float));
+   float* out = malloc(N*sizeof(float));
+   float* ref = malloc(N*sizeof(float));
+   float ctl[BENCH_PORTS], latency;
+   double err, worst[G][D];
+   LV2_Handle h;
+   int g, d, q, x, b, inplace, i;
+
+   if (in == NULL || out == NULL || ref == NULL) {
+      fprintf(stderr, "test_run: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, N);
+   for (i = 5000; i < 5300; i++)
+      in[i] = 0;
+
+   for (g = 0; g < G; g++)
+   for (d = 0; d < D; d++) {
+      worst[g][d] = 0;
+      for (q = 0; q < Q; q++)
+      for (x = 0; x < X; x++)
+      for (b = 0; b < B; b++)
+      for (inplace = 0; inplace < (blocks[b] == 777 ? 2 : 1); inplace++) {
+         if (blocks[b] == 1 && mixes[x] != 1)
+            continue;
+         h = bench_instance(ctl, BENCH_PORTS, &latency);
+         if (h == NULL) {
+            CHECK(0, "no instance");
+            return 1;
+         }
+         ctl[2] = gains[g];
+         ctl[3] = qs[q];
+         ctl[4] = dists[d];
+         ctl[7] = mixes[x];
+         render_book(in, ref, N, blocks[b], ctl);
+         if (inplace)
+            memcpy(out, in, N*sizeof(float));
+         bench_render(h, inplace ? out : in, out, N, blocks[b]);
+         lv2_descriptor(0)->cleanup(h);
+
+         for (i = 0, err = 0; i < N; i++)
+            err = fmax(err, fabs(out[i] - ref[i]));
+         worst[g][d] = fmax(worst[g][d], err);
+         CHECK(err <= bounds[g][d], "gain %g, dist %g, q %g, mix %g, "
+               "%d frames%s: %.2g", gains[g], dists[d], qs[q], mixes[x],
+               blocks[b], inplace ? ", in place" : "", err);
+      }
+   }
+
+   printf("run() against the book, largest difference\n  gain ");
+   for (d = 0; d < D; d++)
+      printf("  dist %-5g", dists[d]);
+   printf("\n");
+   for (g = 0; g < G; g++) {
+      printf("  %-5g", gains[g]);
+      for (d = 0; d < D; d++)
+         printf("  %.1e   ", worst[g][d]);
+      printf("\n");
+   }
+
+   free(in);
+   free(out);
+   free(ref);
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+/**
+   The fixed-bias table (tube_shaper.c) against the formula in double
+   precision over the ranges of dafx_tube.ttl: dist 0.01 - 10, q -2 - 2
+   and x = gain u for gains up to 10, so x -10 - 10.  Each point must be
+   within MAX_ERROR, plus one float rounding of f where that is larger:
+   at dist 0.01 f is near 1/dist = 100, whose float spacing is 7.6e-6.
+   The largest error must also be within MAX_RELATIVE of the peak of |f|
+   over the range, and x = q must give the limit of the curve.  The SSE path
+   of tube_shaper_process() must give the floats of tube_shaper_eval().
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <float.h>
+
+#include "bench.h"
+#include "tube_shaper.h"
+
+#define QS  33       // steps of q over [-2, 2], 0 among them
+#define XS  40001    // samples of x over [-10, 10]
+
+#define MAX_ERROR    5.4e-6
+#define MAX_RELATIVE 6.5e-7
+
+static int failures = 0;
+
+/** The curve of the book, its limit at x = q. */
+static double
+f(double x, double q, double dist)
+{
+   const double u = x - q;
+   const double c = q == 0 ? 0 : q/(-expm1(dist*q));
+
+   return (fabs(u) < 1e-12 ? 1/dist : u/(-expm1(-dist*u))) + c;
+}
+
+static void
+check_table(void)
+{
+   static const double dists[] = {0.01, 0.03, 0.1, 0.3, 1, 3, 10};
+   const int D = sizeof(dists)/sizeof(dists[0]);
+   static float x[XS], y[XS];
+   TubeShaper ts;
+   double q, r, e, err, peak, worst = 0, worst_rel = 0;
+   int d, k, i, within, same = 1;
+
+   if (tube_shaper_init(&ts) != 0) {
+      CHECK(0, "out of memory");
+      return;
+   }
+   for (i = 0; i < XS; i++)
+      x[i] = -10 + 20.0*i/(XS - 1);
+
+   printf("table against the formula, largest error (of the peak)\n");
+   for (d = 0; d < D; d++) {
+      err = peak = 0;
+      within = 1;
+      for (k = 0; k < QS; k++) {
+         q = -2 + 4.0*k/(QS - 1);
+         tube_shaper_set(&ts, dists[d], q);
+         tube_shaper_process(&ts, x, y, XS, 1);
+         for (i = 0; i < XS; i++) {
+            r = f(x[i], (float)q, dists[d]);
+            e = fabs(y[i] - r);
+            err = e > err ? e : err;
+            peak = fabs(r) > peak ? fabs(r) : peak;
+            within &= e <= MAX_ERROR + FLT_EPSILON*fabs(r);
+            same &= y[i] == tube_shaper_eval(&ts, x[i]);
+         }
+         e = fabs(tube_shaper_eval(&ts, (float)q) -
+                  f((float)q, (float)q, dists[d]));
+         CHECK(e <= MAX_ERROR, "dist %g, q %g: %.2g off at x = q",
+               dists[d], q, e);
+      }
+      printf("  dist %-5g  %.3e (%.1e)\n", dists[d], err, err/peak);
+      worst = err > worst ? err : worst;
+      worst_rel = err/peak > worst_rel ? err/peak : worst_rel;
+      CHECK(within, "dist %g: error %.3g", dists[d], err);
+      CHECK(err/peak <= MAX_RELATIVE, "dist %g: %.2g of the peak",
+            dists[d], err/peak);
+   }
+   printf("largest error %.2g, %.2g of the peak\n", worst, worst_rel);
+   CHECK(same, "tube_shaper_process() differs from tube_shaper_eval()");
+   tube_shaper_free(&ts);
+}
+
+int main(void) {
+   check_table();
+
+   return failures ? 1 : 0;
+}
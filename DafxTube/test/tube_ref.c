@@ -0,0 +1,91 @@
+#include <math.h>
+
+#include "tube_ref.h"
+
+void tubeBook(TubeBook* tube, const float* input, float* output,
+              uint32_t n_samples, float gain, float q, float dist, float rh,
+              float rl, float mix) {
+	uint32_t pos;
+   float extra[5000];
+   float extra2[5000];
+
+   float max = 0, maxZ = 0, maxY = 0, y;
+
+	for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(input[pos]) > max)
+         max = fabs(input[pos]);
+   }
+
+   for (pos = 0; pos < n_samples; pos++) {
+      if (max > 0) extra[pos] = input[pos]*gain/max; /*Nomalização (y no livro)*/
+      else extra[pos] = 0;
+   }
+
+   if (q == 0) {
+      for (pos = 0; pos < n_samples; pos++) {
+         extra2[pos] = extra[pos]/(1 - exp(-dist*extra[pos])); /*z no livro*/
+      }
+      for (pos = 0; pos < n_samples; pos++) {
+         if (extra[pos] == q)
+            extra2[pos] = 1/dist;
+      }
+   }
+   else {
+      for (pos = 0; pos < n_samples; pos++) {
+         extra2[pos] = (extra[pos] - q)/(1 - exp(-dist*(extra[pos]-q))) + q/(1 - exp(dist*q));
+      }
+      for (pos = 0; pos < n_samples; pos++) {
+         if (extra[pos] == q)
+            extra2[pos] = 1/dist + q/(1-exp(dist*q));
+      }
+   }
+
+   //MAXZ
+   for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(extra2[pos]) > maxZ)
+         maxZ = fabs(extra2[pos]);
+   }
+
+   for (pos = 0; pos < n_samples; pos++) {
+      if (max > 0 && maxZ > 0) y = mix*extra2[pos]*max/maxZ + (1-mix)*input[pos];
+      else y = 0;
+      extra[pos] = y;
+   }
+
+   //MAXY
+   for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(extra[pos]) > maxY)
+         maxY = fabs(extra[pos]);
+   }
+
+   for (pos = 0; pos < n_samples; pos++) {
+      if (max > 0 && maxY > 0) extra[pos] = extra[pos]*max/maxY;
+      else extra[pos] = 0;
+   }
+
+   /* FILTERING:
+      HP: y(n) = x(n) - 2*x(n-1) + x(n-2) + 2*rh*y(n-1) - rh*rh*y(n-2)
+      LP: y(n) = (1-rl)*x(n) + rl*y(n-1) 
+   */
+   //HP:
+   for (pos = 0; pos < n_samples; pos++) {
+      y = extra[pos] - 2*(tube->lastX) + tube->lastX2 + 2*rh*(tube->lastY)- rh*rh*(tube->lastY2);
+      tube->lastX2 = tube->lastX;
+      tube->lastX= extra[pos];
+      tube->lastY2 = tube->lastY;
+      tube->lastY= y;
+      extra[pos] = y;
+   }
+   //LP:
+   for (pos = 0; pos < n_samples; pos++) {
+      y = (1-rl)*extra[pos] + rl*(tube->lastY_LP);
+      tube->lastY_LP = y;
+      extra[pos] = y;
+   }
+
+   //OUT:
+   for (pos = 0; pos < n_samples; pos++) {
+      output[pos] = extra[pos];
+   }
+
+}
@@ -0,0 +1,20 @@
+#ifndef TUBE_REF_H
+#define TUBE_REF_H
+
+#include <stdint.h>
+
+/**
+   The book's run(), kept as it was apart from the state and ports becoming
+   arguments (and q where it read the port index Q at x == q), as the
+   reference of the benchmarks: nine passes over the block through two
+   float[5000] arrays on the stack, so `n_samples` must not exceed 5000.
+*/
+typedef struct {
+   float lastX, lastX2, lastY, lastY2, lastY_LP;
+} TubeBook;
+
+void tubeBook(TubeBook* tube, const float* input, float* output,
+              uint32_t n_samples, float gain, float q, float dist, float rh,
+              float rl, float mix);
+
+#endif
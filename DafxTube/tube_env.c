@@ -0,0 +1,103 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "tube_env.h"
+
+int tube_env_init(TubeEnv* env, double rate) {
+   memset(env, 0, sizeof(TubeEnv));
+   env->rate = rate;
+   env->size = (uint32_t)ceil(TUBE_ENV_LOOKAHEAD_MAX_MS*rate/1000) + 1;
+   env->delay = calloc(env->size, sizeof(float));
+   if (env->delay == NULL)
+      return -1;
+   env->attack_ms = NAN;
+   env->release_ms = NAN;
+
+   return 0;
+}
+
+
+void tube_env_free(TubeEnv* env) {
+   free(env->delay);
+   env->delay = NULL;
+}
+
+
+void tube_env_reset(TubeEnv* env) {
+   memset(env->delay, 0, env->size*sizeof(float));
+   env->pos = 0;
+   env->state = 0;
+}
+
+
+/** One-pole coefficient for a time constant of `ms`; 0 follows at once. */
+static float
+coefficient(float ms, double rate)
+{
+   return ms > 0 ? exp(-1000/(ms*rate)) : 0;
+}
+
+
+void tube_env_set(TubeEnv* env, int detector, float attack_ms,
+                  float release_ms, float lookahead_ms) {
+   uint32_t lookahead;
+
+   env->detector = detector == TUBE_ENV_RMS ? TUBE_ENV_RMS : TUBE_ENV_PEAK;
+   if (attack_ms != env->attack_ms) {
+      env->attack = coefficient(attack_ms, env->rate);
+      env->attack_ms = attack_ms;
+   }
+   if (release_ms != env->release_ms) {
+      env->release = coefficient(release_ms, env->rate);
+      env->release_ms = release_ms;
+   }
+
+   if (!(lookahead_ms > 0))
+      lookahead_ms = 0;
+   if (lookahead_ms > TUBE_ENV_LOOKAHEAD_MAX_MS)
+      lookahead_ms = TUBE_ENV_LOOKAHEAD_MAX_MS;
+   lookahead = (uint32_t)lrint(lookahead_ms*env->rate/1000);
+   if (lookahead > env->size - 1)
+      lookahead = env->size - 1;
+   if (lookahead != env->lookahead) {
+      memset(env->delay, 0, env->size*sizeof(float));
+      env->lookahead = lookahead;
+   }
+}
+
+
+uint32_t tube_env_latency(const TubeEnv* env) {
+   return env->lookahead;
+}
+
+
+void tube_env_process(TubeEnv* env, const float* x, float* xd, float* e,
+                      uint32_t n) {
+   uint32_t i, pos = env->pos, read;
+   float d, c, s = env->state;
+   float* const delay = env->delay;
+   const uint32_t size = env->size;
+   const uint32_t lookahead = env->lookahead;
+   const int rms = env->detector == TUBE_ENV_RMS;
+
+   for (i = 0; i < n; i++) {
+      delay[pos] = x[i];
+      read = pos >= lookahead ? pos - lookahead : pos + size - lookahead;
+      xd[i] = delay[read];
+      if (++pos == size)
+         pos = 0;
+
+      /* The detector sees the input undelayed, ahead of xd */
+      d = rms ? x[i]*x[i] : fabsf(x[i]);
+      c = d > s ? env->attack : env->release;
+      s = d + c*(s - d);
+      if (s < 1e-30f)
+         s = 0;   // no denormals in silence
+      e[i] = rms ? sqrtf(2*s) : s;
+      if (!(e[i] > TUBE_ENV_FLOOR))
+         e[i] = TUBE_ENV_FLOOR;
+   }
+   env->pos = pos;
+   env->state = s;
+}
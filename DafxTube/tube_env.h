@@ -0,0 +1,71 @@
+#ifndef TUBE_ENV_H
+#define TUBE_ENV_H
+
+#include <stdint.h>
+
+/**
+   Envelope follower for the streaming normalization of DafxTube.
+
+   The book normalizes each host block by its peak, so the gain jumps at
+   block boundaries and depends on the block size.  This follower replaces
+   that peak with an envelope updated every sample: a one-pole smoother with
+   separate attack and release times, on |x| (peak) or on x^2 (RMS, scaled
+   by sqrt(2) so that a sine reads its peak).  The signal can be delayed by
+   a short lookahead, which lets the envelope rise before a transient is
+   output; the delay is the latency of the mode.
+*/
+#define TUBE_ENV_LOOKAHEAD_MAX_MS 10.0
+
+/** Smallest envelope, -120 dB: silence is not blown up to full scale. */
+#define TUBE_ENV_FLOOR 1e-6f
+
+/** Detectors. */
+typedef enum {
+   TUBE_ENV_PEAK = 0,
+   TUBE_ENV_RMS  = 1
+} TubeEnvDetector;
+
+typedef struct {
+   double rate;
+   float* delay;         // lookahead line, `size` samples
+   uint32_t size;
+   uint32_t pos;         // next write position in `delay`
+   uint32_t lookahead;   // current delay in samples
+   int    detector;      // TubeEnvDetector
+   float  attack;        // smoothing coefficients per sample
+   float  release;
+   float  state;         // smoothed |x| or x^2
+   float  attack_ms;     // parameters of the coefficients, NAN before set
+   float  release_ms;
+} TubeEnv;
+
+/**
+   Allocate the lookahead line for `rate` Hz.  Returns 0 on success, -1 if
+   allocation failed.
+*/
+int tube_env_init(TubeEnv* env, double rate);
+
+void tube_env_free(TubeEnv* env);
+
+/** Clear the envelope and the lookahead line. */
+void tube_env_reset(TubeEnv* env);
+
+/**
+   Set the times in milliseconds, the lookahead clamped to
+   TUBE_ENV_LOOKAHEAD_MAX_MS.  The coefficients are recomputed only when a
+   time changed; a new lookahead clears the line.
+*/
+void tube_env_set(TubeEnv* env, int detector, float attack_ms,
+                  float release_ms, float lookahead_ms);
+
+/** Latency of the lookahead in samples. */
+uint32_t tube_env_latency(const TubeEnv* env);
+
+/**
+   For i < n: push x[i], write the sample `lookahead` samples older to
+   xd[i] and the envelope to e[i], at least TUBE_ENV_FLOOR.
+*/
+void tube_env_process(TubeEnv* env, const float* x, float* xd, float* e,
+                      uint32_t n);
+
+#endif
@@ -0,0 +1,295 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+#include "tube_os.h"
+
+#define PI 3.14159265358979323846
+
+/**
+   Filter lengths N = 4K - 1 of the stages, from the base rate up, and the
+   Kaiser window parameter: about 70 dB of stopband.  The first stage
+   passes up to 0.41 of the base rate (19.5 kHz at 48 kHz); the others pass
+   far more than the base band and stop well before its first image.
+*/
+static const int stage_len[TUBE_OS_STAGES] = { 47, 23, 15 };
+#define KAISER_BETA 6.76
+
+/** Modified Bessel function of the first kind, order 0. */
+static double
+bessel_i0(double x)
+{
+   double sum = 1, term = 1;
+   int k;
+
+   for (k = 1; k < 50; k++) {
+      term *= (x/(2*k))*(x/(2*k));
+      sum += term;
+      if (term < 1e-12*sum)
+         break;
+   }
+
+   return sum;
+}
+
+
+void tube_delay_set(TubeDelay* d, uint32_t len) {
+   d->len = len < TUBE_OS_MAX_LATENCY ? len : TUBE_OS_MAX_LATENCY;
+   memset(d->line, 0, sizeof(d->line));
+}
+
+
+void tube_delay_process(TubeDelay* d, const float* x, float* y, uint32_t n) {
+   uint32_t i;
+   const uint32_t len = d->len;
+   float tail[TUBE_OS_MAX_LATENCY];
+
+   if (len == 0) {
+      if (y != x)
+         memmove(y, x, n*sizeof(float));
+      return;
+   }
+
+   /* The last `len` inputs become the line; keep them before y overwrites */
+   for (i = 0; i < len; i++)
+      tail[i] = i + n >= len ? x[i + n - len] : d->line[i + n];
+   memmove(y + (n < len ? 0 : len), x, (n < len ? 0 : n - len)*sizeof(float));
+   for (i = 0; i < len && i < n; i++)
+      y[i] = d->line[i];
+   memcpy(d->line, tail, len*sizeof(float));
+}
+
+
+/** Odd taps of a half-band filter of 2 taps - 1 points, summing to 1/2. */
+static void
+design(float* g, int taps)
+{
+   int m, t;
+   const int len = 2*taps - 1;
+   const int c = (len - 1)/2;
+   double r, sum = 0;
+
+   for (m = 0; m < taps; m++) {
+      t = 2*m - c;     // odd offset from the centre
+      r = 2.0*(2*m)/(len - 1) - 1;   // position in the window, -1 - 1
+      g[m] = sin(PI*t/2)/(PI*t) *
+             bessel_i0(KAISER_BETA*sqrt(1 - r*r))/bessel_i0(KAISER_BETA);
+      sum += g[m];
+   }
+   for (m = 0; m < taps; m++)
+      g[m] *= 0.5/sum;
+}
+
+
+int tube_os_init(TubeOs* os, int max_n) {
+   int s, taps, n;
+
+   memset(os, 0, sizeof(TubeOs));
+   os->max_n = max_n;
+   os->factor = 1;
+   for (s = 0; s < TUBE_OS_STAGES; s++) {
+      TubeHalfband* hb = &os->stage[s];
+
+      taps = (stage_len[s] + 1)/2;
+      n = max_n << s;           // input samples of the interpolator
+      hb->taps = taps;
+      hb->g = malloc(taps*sizeof(float));
+      hb->up = calloc(taps - 1 + n, sizeof(float));
+      hb->even = calloc(taps - 1 + n, sizeof(float));
+      hb->odd = calloc(taps - 1 + n, sizeof(float));
+      if (hb->g == NULL || hb->up == NULL || hb->even == NULL ||
+          hb->odd == NULL) {
+         tube_os_free(os);
+         return -1;
+      }
+      design(hb->g, taps);
+   }
+   os->buf[0] = malloc(max_n*TUBE_OS_MAX_FACTOR*sizeof(float));
+   os->buf[1] = malloc(max_n*TUBE_OS_MAX_FACTOR*sizeof(float));
+   if (os->buf[0] == NULL || os->buf[1] == NULL) {
+      tube_os_free(os);
+      return -1;
+   }
+
+   return 0;
+}
+
+
+void tube_os_free(TubeOs* os) {
+   int s;
+
+   for (s = 0; s < TUBE_OS_STAGES; s++) {
+      free(os->stage[s].g);
+      free(os->stage[s].up);
+      free(os->stage[s].even);
+      free(os->stage[s].odd);
+   }
+   free(os->buf[0]);
+   free(os->buf[1]);
+   memset(os, 0, sizeof(TubeOs));
+}
+
+
+void tube_os_reset(TubeOs* os) {
+   int s, len;
+
+   for (s = 0; s < TUBE_OS_STAGES; s++) {
+      len = os->stage[s].taps - 1;
+      memset(os->stage[s].up, 0, len*sizeof(float));
+      memset(os->stage[s].even, 0, len*sizeof(float));
+      memset(os->stage[s].odd, 0, len*sizeof(float));
+   }
+   tube_delay_set(&os->pad, os->pad.len);
+}
+
+
+void tube_os_set_factor(TubeOs* os, int factor) {
+   int s, stages;
+   uint32_t top = 0;
+
+   factor = factor >= 8 ? 8 : factor >= 4 ? 4 : factor >= 2 ? 2 : 1;
+   if (factor == os->factor)
+      return;
+   os->factor = factor;
+
+   /*
+      A stage of N taps delays by N - 1 samples of its own upper rate, up
+      and down together.  The pad brings the sum to a multiple of the
+      factor at the top rate.
+   */
+   for (stages = 0; (1 << stages) < factor; stages++)
+      ;
+   for (s = 0; s < stages; s++)
+      top += (stage_len[s] - 1) << (stages - 1 - s);
+   os->latency = (top + factor - 1)/factor;
+   tube_delay_set(&os->pad, os->latency*factor - top);
+   tube_os_reset(os);
+}
+
+
+uint32_t tube_os_latency(const TubeOs* os) {
+   return os->factor > 1 ? os->latency : 0;
+}
+
+
+/**
+   out[0..2n) from in[0..n) at twice the rate.  The SSE path computes four
+   outputs side by side, each summed in the same order as the scalar one.
+*/
+static void
+interpolate(TubeHalfband* hb, const float* in, float* out, uint32_t n)
+{
+   uint32_t j = 0;
+   int m;
+   float acc;
+   const int taps = hb->taps;
+   const int H = taps - 1;
+   const int K = (taps + 1)/2;    // centre tap lag
+   const float* const g = hb->g;
+   float* const w = hb->up;
+
+   memcpy(w + H, in, n*sizeof(float));
+#if defined(__SSE__)
+   for (; j + 4 <= n; j += 4) {
+      __m128 a = _mm_setzero_ps();
+      __m128 c = _mm_loadu_ps(w + j + K);
+      float even[4], odd[4];
+
+      for (m = 0; m < taps; m++)
+         a = _mm_add_ps(a, _mm_mul_ps(_mm_set1_ps(g[m]),
+                                      _mm_loadu_ps(w + j + H - m)));
+      _mm_storeu_ps(even, _mm_mul_ps(_mm_set1_ps(2), a));
+      _mm_storeu_ps(odd, c);
+      for (m = 0; m < 4; m++) {
+         out[2*(j + m)] = even[m];
+         out[2*(j + m) + 1] = odd[m];
+      }
+   }
+#endif
+   for (; j < n; j++) {
+      acc = 0;
+      for (m = 0; m < taps; m++)
+         acc += g[m]*w[j + H - m];
+      out[2*j] = 2*acc;
+      out[2*j + 1] = w[j + K];
+   }
+   memmove(w, w + n, H*sizeof(float));
+}
+
+
+/** out[0..n) from in[0..2n) at half the rate. */
+static void
+decimate(TubeHalfband* hb, const float* in, float* out, uint32_t n)
+{
+   uint32_t j;
+   int m;
+   float acc;
+   const int taps = hb->taps;
+   const int H = taps - 1;
+   const int K = (taps + 1)/2;
+   const float* const g = hb->g;
+   float* const we = hb->even;
+   float* const wo = hb->odd;
+
+   for (j = 0; j < n; j++) {
+      we[H + j] = in[2*j];
+      wo[H + j] = in[2*j + 1];
+   }
+   j = 0;
+#if defined(__SSE__)
+   for (; j + 4 <= n; j += 4) {
+      __m128 a = _mm_mul_ps(_mm_set1_ps(0.5f), _mm_loadu_ps(wo + j + K - 1));
+
+      for (m = 0; m < taps; m++)
+         a = _mm_add_ps(a, _mm_mul_ps(_mm_set1_ps(g[m]),
+                                      _mm_loadu_ps(we + j + H - m)));
+      _mm_storeu_ps(out + j, a);
+   }
+#endif
+   for (; j < n; j++) {
+      acc = 0.5f*wo[j + K - 1];
+      for (m = 0; m < taps; m++)
+         acc += g[m]*we[j + H - m];
+      out[j] = acc;
+   }
+   memmove(we, we + n, H*sizeof(float));
+   memmove(wo, wo + n, H*sizeof(float));
+}
+
+
+void tube_os_process(TubeOs* os, const TubeShaper* ts, const float* u,
+                     float* z, uint32_t n, float scale) {
+   int s, stages;
+   uint32_t len = n;
+   const float* src = u;
+   float* dst;
+
+   if (os->factor == 1) {
+      tube_shaper_process(ts, u, z, n, scale);
+      return;
+   }
+
+   for (stages = 0; (1 << stages) < os->factor; stages++)
+      ;
+   for (s = 0; s < stages; s++) {
+      dst = os->buf[s & 1];
+      interpolate(&os->stage[s], src, dst, len);
+      src = dst;
+      len *= 2;
+   }
+
+   dst = os->buf[(stages - 1) & 1];
+   tube_delay_process(&os->pad, dst, dst, len);
+   tube_shaper_process(ts, dst, dst, len, scale);
+
+   for (s = stages - 1; s >= 0; s--) {
+      len /= 2;
+      dst = s > 0 ? os->buf[s & 1] : z;
+      decimate(&os->stage[s], src, dst, len);
+      src = dst;
+   }
+}
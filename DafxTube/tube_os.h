@@ -0,0 +1,89 @@
+#ifndef TUBE_OS_H
+#define TUBE_OS_H
+
+#include <stdint.h>
+
+#include "tube_shaper.h"
+
+/**
+   Oversampling around the tube curve.
+
+   The curve adds harmonics far above the input band, and at the base rate
+   those above Nyquist fold back as aliases.  `tube_os_process()` raises
+   the rate by 2, 4 or 8 with a cascade of half-band stages, applies the
+   curve there and comes back down through the same stages, so the
+   harmonics above the base band are filtered out before decimation.
+
+   A half-band filter has every other tap zero except the centre one (1/2),
+   so each stage runs polyphase: going up, the odd output samples are the
+   input delayed and only the even ones are filtered; going down, only the
+   even input samples meet the filter and the odd ones add the centre tap.
+   The first stage (base rate and 2x) has the sharpest filter, the later
+   ones work far from their cutoff and are shorter.  A few samples of delay
+   at the top rate round the latency to whole base-rate samples.
+*/
+#define TUBE_OS_MAX_FACTOR 8
+#define TUBE_OS_STAGES     3
+
+/** Longest latency, in base-rate samples (8x). */
+#define TUBE_OS_MAX_LATENCY 32
+
+/** Plain delay of up to TUBE_OS_MAX_LATENCY samples, no allocation. */
+typedef struct {
+   float    line[TUBE_OS_MAX_LATENCY];
+   uint32_t len;
+} TubeDelay;
+
+/** y[i] = x[i - len].  May run in place. */
+void tube_delay_process(TubeDelay* d, const float* x, float* y, uint32_t n);
+
+/** Set the delay and clear the line. */
+void tube_delay_set(TubeDelay* d, uint32_t len);
+
+/** One half-band stage: interpolator and decimator with their histories. */
+typedef struct {
+   int    taps;        // odd taps g[m] = h[2m] of the N = 2 taps - 1 filter
+   float* g;
+   float* up;          // input history followed by the input
+   float* even;        // even and odd samples of the decimator input
+   float* odd;
+} TubeHalfband;
+
+typedef struct {
+   int       factor;            // 1, 2, 4 or 8
+   int       max_n;             // largest base-rate block
+   TubeHalfband stage[TUBE_OS_STAGES];
+   TubeDelay pad;               // top-rate delay rounding the latency
+   uint32_t  latency;           // base-rate samples
+   float*    buf[2];            // top-rate scratch, max_n * 8
+} TubeOs;
+
+/**
+   Allocate the filters and scratch for blocks of up to `max_n` base-rate
+   samples.  The factor starts at 1.  Returns 0 on success, -1 if
+   allocation failed.
+*/
+int tube_os_init(TubeOs* os, int max_n);
+
+void tube_os_free(TubeOs* os);
+
+/**
+   Select the factor (1, 2, 4 or 8; others are rounded down to one of them).
+   A new factor clears the filters.
+*/
+void tube_os_set_factor(TubeOs* os, int factor);
+
+/** Clear the filter histories. */
+void tube_os_reset(TubeOs* os);
+
+/** Delay of `tube_os_process()` in base-rate samples. */
+uint32_t tube_os_latency(const TubeOs* os);
+
+/**
+   z[i] = f(scale * u[i]) for i < n <= max_n, evaluated at factor times the
+   rate and `tube_os_latency()` samples late.  May run in place.
+*/
+void tube_os_process(TubeOs* os, const TubeShaper* ts, const float* u,
+                     float* z, uint32_t n, float scale);
+
+#endif
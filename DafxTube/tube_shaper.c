@@ -0,0 +1,111 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "tube_shaper.h"
+
+#define N TUBE_SHAPER_POINTS
+
+/* Table position of x = 0 and points per unit of x */
+#define ORIGIN ((N - 1)/2.0)
+#define SCALE  ((N - 1)/(2*TUBE_SHAPER_RANGE))
+
+#define ANCHOR 64
+
+int tube_shaper_init(TubeShaper* ts) {
+   memset(ts, 0, sizeof(TubeShaper));
+   ts->value = malloc(N*sizeof(float));
+   ts->slope = malloc(N*sizeof(float));
+   if (ts->value == NULL || ts->slope == NULL) {
+      tube_shaper_free(ts);
+      return -1;
+   }
+   ts->dist = NAN;
+   ts->q = NAN;
+
+   return 0;
+}
+
+
+void tube_shaper_free(TubeShaper* ts) {
+   free(ts->value);
+   free(ts->slope);
+   ts->value = NULL;
+   ts->slope = NULL;
+}
+
+
+void tube_shaper_set(TubeShaper* ts, float dist, float q) {
+   int i;
+   double u, e, c, r;
+
+   if (dist == ts->dist && q == ts->q)
+      return;
+
+   /*
+      u/(1 - exp(-dist u)) at u = x - q, in double precision.  exp(-dist u)
+      is stepped by the ratio r between points and recomputed every
+      ANCHOR points, so a rebuild costs N/ANCHOR exp() calls instead of N.
+      At u = 0 the curve takes its limit 1/dist.
+   */
+   c = (q == 0) ? 0 : q/(-expm1(dist*(double)q));
+   r = exp(-dist/SCALE);
+   for (i = 0, e = 0; i < N; i++) {
+      u = (i - ORIGIN)/SCALE - q;
+      e = (i % ANCHOR == 0) ? exp(-dist*u) : e*r;
+      ts->value[i] = (fabs(u) < 1e-9 ? 1/(double)dist : u/(1 - e)) + c;
+   }
+   for (i = 0; i < N - 1; i++)
+      ts->slope[i] = ts->value[i + 1] - ts->value[i];
+   ts->slope[N - 1] = ts->slope[N - 2];
+
+   ts->dist = dist;
+   ts->q = q;
+}
+
+
+float tube_shaper_eval(const TubeShaper* ts, float x) {
+   const float t = x*(float)SCALE + (float)ORIGIN;
+   const int i = (int)(t < 0 ? 0 : (t > N - 2 ? N - 2 : t));
+
+   return ts->value[i] + (t - i)*ts->slope[i];
+}
+
+
+void tube_shaper_process(const TubeShaper* ts, const float* x, float* y,
+                         uint32_t n, float scale) {
+   uint32_t j = 0;
+   const float* const value = ts->value;
+   const float* const slope = ts->slope;
+
+   /*
+      The index is clamped to the table but the fraction is not, so the end
+      segments extend past it.  Clamped at or above 0, truncation is floor.
+   */
+#if defined(__SSE2__)
+   const __m128 sc = _mm_set1_ps(scale);
+   const __m128 tscale = _mm_set1_ps(SCALE);
+   const __m128 origin = _mm_set1_ps(ORIGIN);
+   const __m128 lo = _mm_setzero_ps();
+   const __m128 hi = _mm_set1_ps(N - 2);
+
+   for (; j + 4 <= n; j += 4) {
+      __m128 xv = _mm_mul_ps(_mm_loadu_ps(x + j), sc);
+      __m128 tv = _mm_add_ps(_mm_mul_ps(xv, tscale), origin);
+      __m128i iv = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(tv, lo), hi));
+      __m128 fv = _mm_sub_ps(tv, _mm_cvtepi32_ps(iv));
+      int k[4];
+
+      _mm_storeu_si128((__m128i*)k, iv);
+      __m128 v = _mm_set_ps(value[k[3]], value[k[2]], value[k[1]], value[k[0]]);
+      __m128 s = _mm_set_ps(slope[k[3]], slope[k[2]], slope[k[1]], slope[k[0]]);
+      _mm_storeu_ps(y + j, _mm_add_ps(v, _mm_mul_ps(fv, s)));
+   }
+#endif
+   for (; j < n; j++)
+      y[j] = tube_shaper_eval(ts, scale*x[j]);
+}
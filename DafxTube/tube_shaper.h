@@ -0,0 +1,68 @@
+#ifndef TUBE_SHAPER_H
+#define TUBE_SHAPER_H
+
+#include <stdint.h>
+
+/**
+   Tube transfer curve of the book, tabulated.
+
+      f(x) = (x - q)/(1 - exp(-dist (x - q))) + q/(1 - exp(dist q))   q != 0
+      f(x) = x/(1 - exp(-dist x))                                     q == 0
+
+   with f(q) = 1/dist + q/(1 - exp(dist q)), its limit.  `tube_shaper_set()`
+   samples f at TUBE_SHAPER_POINTS points over [-TUBE_SHAPER_RANGE,
+   TUBE_SHAPER_RANGE] and only does so when dist or q changed.  Between the
+   points f is interpolated linearly, and outside the range the end segments
+   are extended, which follows the asymptotes of f (slope 1 above, 0 below).
+   The input of the curve is the signal normalized to 1 times the gain, so
+   the range covers the largest gain (10) and the largest bias, |q| + |sag|
+   = 4 when the bias moves.  f never
+   decreases, nor does the interpolated curve, so over a block it peaks at
+   the block's extremes.
+
+   For q != 0, f(x) = g(x - q) - g(-q) with g the curve for q = 0, so the
+   tables for q = 0 give the curve for any bias with two lookups; `run()`
+   uses them when the bias moves per sample.
+
+   Error against the formula in double precision, over dist 0.01 - 10,
+   q -2 - 2 and x -10 - 10 (test/test_shaper.c): at most 5.4e-6, or one
+   float rounding of f where that is larger (1e-5 at dist 0.01, where f is
+   near 100), and 5.3e-7 of the largest |f| over the range, which is what
+   `run()` normalizes by.  g(x - q) - g(-q) is within 1.4e-5 over the
+   ranges of the ports (test/test_bias.c).  The points are spaced evenly,
+   so relative to the peak the error grows as the gain falls, to 3e-3 at
+   gain 0.01.  The interpolation error peaks at x = q, where
+   f'' = dist/6; the rest is float rounding.
+*/
+#define TUBE_SHAPER_RANGE  14.0
+#define TUBE_SHAPER_POINTS 5737
+
+typedef struct {
+   float* value;   // f at each point
+   float* slope;   // f[i + 1] - f[i], the last one repeated
+   float  dist;    // parameters of the tables, NAN before the first set
+   float  q;
+} TubeShaper;
+
+/** Allocate the tables.  Returns 0 on success, -1 if allocation failed. */
+int tube_shaper_init(TubeShaper* ts);
+
+void tube_shaper_free(TubeShaper* ts);
+
+/**
+   Tabulate f for `dist` and `q`, unless the tables already hold them.  Does
+   not allocate, so it can be called from `run()`.
+*/
+void tube_shaper_set(TubeShaper* ts, float dist, float q);
+
+/**
+   y[i] = f(scale * x[i]) for i < n, four samples per SSE step.  May run in
+   place.
+*/
+void tube_shaper_process(const TubeShaper* ts, const float* x, float* y,
+                         uint32_t n, float scale);
+
+/** f(x) from the tables, as `tube_shaper_process()` computes it. */
+float tube_shaper_eval(const TubeShaper* ts, float x);
+
+#endif
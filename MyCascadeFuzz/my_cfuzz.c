@@ -0,0 +1,415 @@
+
+/** Include standard C headers */
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+   LV2 headers are based on the URI of the specification they come from, so a
+   consistent convention can be used even for unofficial extensions.  The URI
+   of the core LV2 specification is <http://lv2plug.in/ns/lv2core>, by
+   replacing `http:/` with `lv2` any header in the specification bundle can be
+   included, in this case `lv2.h`.
+*/
+#include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+
+#define PI 3.14159265358979323846
+
+/** Gain stages, and so STAGES - 1 filters between them. */
+#define STAGES 3
+
+/** Samples processed at a time into the scratch of `run()`. */
+#define CFUZZ_CHUNK 64
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+/**
+   exp(-v) is tabulated at v = i/EXP_STEP up to EXP_RANGE, where it falls
+   below the precision of 1 - exp(-v), and refined by the series of the
+   remainder r to r^3: within 7e-7, with no call to exp() per sample.
+*/
+#define EXP_STEP 16
+#define EXP_RANGE 18
+#define EXP_POINTS (EXP_STEP*EXP_RANGE + 1)
+
+/**
+   The URI is the identifier for a plugin, and how the host associates this
+   implementation in code with its description in data. If this URI does not
+   match that used in the data files, the host will fail to load the plugin.
+*/
+#define CFUZZ_URI "www.linux.ime.usp.br/~vitorsamora/mac0499/my-cascade-fuzz.lv2"
+
+/**
+   In the code, ports are referred to by index.  An enumeration of port indices
+   should be defined for readability. They need to match the definitions in the
+   *.ttl file.
+*/
+typedef enum {
+	INPUT  = 0,
+	OUTPUT = 1,
+   N_STAGES = 2,
+   GAIN1 = 3,
+   GAIN2 = 4,
+   GAIN3 = 5,
+   HP = 6,
+   LP = 7,
+   MIX = 8
+} PortIndex;
+
+/**
+   Define a private structure for the plugin instance.  All data
+   associated with a plugin instance is stored here, and is available to
+   every instance method, being passed back through the 'instance' parameter.
+**/
+typedef struct {
+   const float* input;    // lv2 audio port;
+   float*       output;   // lv2 audio port;
+   const float* stages;   // lv2 control port
+   const float* gain[STAGES];  // lv2 control ports
+   const float* hp;       // lv2 control port
+   const float* lp;       // lv2 control port
+   const float* mix;      // lv2 control port
+   double rate;
+   float hp_state[STAGES - 1];   // one-pole low-pass subtracted by the high-pass
+   float lp_state[STAGES - 1];
+   float exp_table[EXP_POINTS];  // exp(-i/EXP_STEP)
+} CFuzz;
+
+// /**
+//    The `connect_port()` method is called by the host to connect a particular
+//    port to a buffer.  The plugin must store the data location, but data may not
+//    be accessed except in run().
+
+//    This method is in the ``audio'' threading class, and is called in the same
+//    context as run().
+// */
+static void
+connect_port(LV2_Handle instance,
+             uint32_t   port,
+             void*      data)
+{
+	CFuzz* cfuzz = (CFuzz*)instance;
+
+	if (cfuzz == NULL ) {
+		return;
+	}
+
+	switch ((PortIndex)port) {
+   case INPUT:
+      cfuzz->input = (const float*)data;
+      break;
+   case OUTPUT:
+      cfuzz->output = (float*)data;
+      break;
+   case N_STAGES:
+      cfuzz->stages = (const float*)data;
+      break;
+   case GAIN1:
+   case GAIN2:
+   case GAIN3:
+      cfuzz->gain[port - GAIN1] = (const float*)data;
+      break;
+   case HP:
+      cfuzz->hp = (const float*)data;
+      break;
+   case LP:
+      cfuzz->lp = (const float*)data;
+      break;
+   case MIX:
+      cfuzz->mix = (const float*)data;
+      break;
+	}
+}
+
+/**
+   One gain stage: the DAFX fuzz curve c f(g u), f(v) = sign(v)(1 - exp(-|v|)),
+   with c = 1/f(g) so that u = +-1 comes out at +-1.
+*/
+static inline float
+stage(const float* table, float u, float g, float c)
+{
+   const float v = g*u;
+   float a, r;
+   int i;
+
+   a = fabsf(v)*EXP_STEP;
+   a = a < EXP_STEP*EXP_RANGE ? a : EXP_STEP*EXP_RANGE;
+   i = (int)a;
+   r = (a - i)*(1.0f/EXP_STEP);
+
+   return copysignf(c*(1 - table[i]*(1 - r*(1 - r*(0.5f - r*(1.0f/6))))), v);
+}
+
+/**
+   z[j] = c f(g scale u[j]), j < n; may run in place.  The SSE path shapes
+   four samples at a time with the same operations as `stage()`, so the
+   two give the same output.
+*/
+static void
+shape(const CFuzz* cfuzz, const float* u, float* z, uint32_t n, float scale,
+      float g, float c)
+{
+   uint32_t j = 0;
+   const float* const table = cfuzz->exp_table;
+
+#if defined(__SSE2__)
+   const __m128 gs = _mm_set1_ps(g);
+   const __m128 cs = _mm_set1_ps(c);
+   const __m128 sc = _mm_set1_ps(scale);
+   const __m128 sign = _mm_set1_ps(-0.0f);
+   const __m128 step = _mm_set1_ps(EXP_STEP);
+   const __m128 inv_step = _mm_set1_ps(1.0f/EXP_STEP);
+   const __m128 top = _mm_set1_ps(EXP_STEP*EXP_RANGE);
+   const __m128 one = _mm_set1_ps(1);
+   const __m128 half = _mm_set1_ps(0.5f);
+   const __m128 sixth = _mm_set1_ps(1.0f/6);
+
+   for (; j + 4 <= n; j += 4) {
+      __m128 v = _mm_mul_ps(gs, _mm_mul_ps(_mm_loadu_ps(u + j), sc));
+      __m128 a = _mm_min_ps(_mm_mul_ps(_mm_andnot_ps(sign, v), step), top);
+      __m128i iv = _mm_cvttps_epi32(a);
+      __m128 r = _mm_mul_ps(_mm_sub_ps(a, _mm_cvtepi32_ps(iv)), inv_step);
+      __m128 p = _mm_sub_ps(half, _mm_mul_ps(r, sixth));
+      __m128 e;
+      int k[4];
+
+      _mm_storeu_si128((__m128i*)k, iv);
+      e = _mm_set_ps(table[k[3]], table[k[2]], table[k[1]], table[k[0]]);
+      p = _mm_sub_ps(one, _mm_mul_ps(r, _mm_sub_ps(one, _mm_mul_ps(r, p))));
+      p = _mm_mul_ps(cs, _mm_sub_ps(one, _mm_mul_ps(e, p)));
+      _mm_storeu_ps(z + j, _mm_or_ps(p, _mm_and_ps(sign, v)));
+   }
+#endif
+   for (; j < n; j++)
+      z[j] = stage(table, u[j]*scale, g, c);
+}
+
+/** The high-pass and low-pass between stage i and i + 1, in place. */
+static void
+filter(CFuzz* cfuzz, int i, float* z, uint32_t n, float ah, float al)
+{
+   uint32_t j;
+   float h = cfuzz->hp_state[i], l = cfuzz->lp_state[i];
+
+   for (j = 0; j < n; j++) {
+      h += ah*(z[j] - h);
+      l += al*(z[j] - h - l);
+      z[j] = l;
+   }
+
+   /* The states decay through denormals in silence */
+   cfuzz->hp_state[i] = fabsf(h) < 1e-20f ? 0 : h;
+   cfuzz->lp_state[i] = fabsf(l) < 1e-20f ? 0 : l;
+}
+
+/**
+   The `run()` method is the main process function of the plugin.  It processes
+   a block of audio in the audio context.  Since this plugin is
+   `lv2:hardRTCapable`, `run()` must be real-time safe, so blocking (e.g. with
+   a mutex) or memory allocation are not allowed.
+*/
+static void
+run(LV2_Handle instance, uint32_t n_samples)
+{
+	uint32_t pos, j, len;
+   int i, stages;
+	CFuzz* cfuzz = (CFuzz*)instance;
+	const float* const input  = cfuzz->input;
+	float* const       output = cfuzz->output;
+   float mix = *(cfuzz->mix);
+   float maxX = 0, maxZ;
+   float g[STAGES], c[STAGES], z[CFUZZ_CHUNK];
+   float ah, al, s, a, b;
+
+	if (cfuzz == NULL) {
+		fprintf(stderr, "MY_CFUZZ: run() called with NULL instance parameter.\n");
+		return;
+	}
+
+	for (pos = 0; pos < n_samples; pos++) {
+      if (fabs(input[pos]) > maxX)
+         maxX = fabs(input[pos]);
+   }
+
+   /*
+      As in DafxFuzz the block is normalized by its peak maxX, but only
+      once, instead of before and after every stage: f is odd and never
+      decreases, so each stage maps [-1, 1] onto itself with no scan.  The
+      wet signal is scaled back by maxX and mixed with the dry one; with
+      one stage this is DafxFuzz without antialiasing.  The high-pass may
+      overshoot a step, so a later stage can be driven past 1 and exceed
+      the peak by at most f(2g)/f(g): twice at low gains, barely at high
+      ones.
+   */
+   stages = (int)*(cfuzz->stages);
+   stages = stages < 1 ? 1 : stages > STAGES ? STAGES : stages;
+   for (i = 0; i < STAGES; i++) {
+      g[i] = *(cfuzz->gain[i]);
+      maxZ = 1 - exp(-fabs(g[i]));
+      c[i] = maxZ > 0 ? 1/maxZ : 0;
+   }
+   ah = 1 - exp(-2*PI*(*(cfuzz->hp))/cfuzz->rate);
+   al = 1 - exp(-2*PI*(*(cfuzz->lp))/cfuzz->rate);
+   s = maxX > 0 ? 1/maxX : 0;
+   a = mix*maxX;
+   b = 1 - mix;
+
+   /*
+      The stages and filters run over chunks of CFUZZ_CHUNK samples, which
+      stay in the cache between them: the block is read and written once.
+      Each input sample is read before its output is written, so the host
+      may run the plugin in place.
+   */
+   for (pos = 0; pos < n_samples; pos += len) {
+      len = MIN(n_samples - pos, CFUZZ_CHUNK);
+      shape(cfuzz, input + pos, z, len, s, g[0], c[0]);
+      for (i = 1; i < stages; i++) {
+         filter(cfuzz, i - 1, z, len, ah, al);
+         shape(cfuzz, z, z, len, 1, g[i], c[i]);
+      }
+      for (j = 0; j < len; j++)
+         output[pos + j] = a*z[j] + b*input[pos + j];
+   }
+}
+
+/**
+   The `instantiate()` function is called by the host to create a new plugin
+   instance.  The host passes the plugin descriptor, sample rate, and bundle
+   path for plugins that need to load additional resources (e.g. waveforms).
+   The features parameter contains host-provided features defined in LV2
+   extensions, but this simple plugin does not use any.
+
+   This function is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static LV2_Handle
+instantiate(const LV2_Descriptor*     descriptor,
+            double                    rate,
+            const char*               bundle_path,
+            const LV2_Feature* const* features
+	    )
+{
+   int i;
+	CFuzz* cfuzz = (CFuzz*)malloc(sizeof(CFuzz));
+
+   if (cfuzz == NULL) {
+      fprintf(stderr, "MY_CFUZZ: out of memory.\n");
+      return NULL;
+   }
+
+   cfuzz->rate = rate;
+   for (i = 0; i < EXP_POINTS; i++)
+      cfuzz->exp_table[i] = exp(-(double)i/EXP_STEP);
+   for (i = 0; i < STAGES - 1; i++) {
+      cfuzz->hp_state[i] = 0;
+      cfuzz->lp_state[i] = 0;
+   }
+
+	return (LV2_Handle)cfuzz;
+}
+
+/**
+   The `activate()` method is called by the host to initialise and prepare the
+   plugin instance for running.  The plugin must reset all internal state
+   except for buffer locations set by `connect_port()`.  Here the states of
+   the filters between the stages are cleared.
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+activate(LV2_Handle instance)
+{
+   int i;
+   CFuzz* cfuzz = (CFuzz*)instance;
+
+   for (i = 0; i < STAGES - 1; i++) {
+      cfuzz->hp_state[i] = 0;
+      cfuzz->lp_state[i] = 0;
+   }
+}
+
+/**
+   The `deactivate()` method is the counterpart to `activate()`, and is called by
+   the host after running the plugin.  It indicates that the host will not call
+   `run()` again until another call to `activate()` and is mainly useful for more
+   advanced plugins with ``live'' characteristics such as those with auxiliary
+   processing threads.  As with `activate()`, this plugin has no use for this
+   information so this method does nothing.
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+deactivate(LV2_Handle instance)
+{
+}
+
+
+/**
+   Destroy a plugin instance (counterpart to `instantiate()`).
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+cleanup(LV2_Handle instance)
+{
+	free(instance);
+}
+
+/**
+   The `extension_data()` function returns any extension data supported by the
+   plugin.  Note that this is not an instance method, but a function on the
+   plugin descriptor.  It is usually used by plugins to implement additional
+   interfaces.  This plugin does not have any extension data, so this function
+   returns NULL.
+
+   This method is in the ``discovery'' threading class, so no other functions
+   or methods in this plugin library will be called concurrently with it.
+*/
+static const void*
+extension_data(const char* uri)
+{
+	return NULL;
+}
+
+/**
+   Every plugin must define an `LV2_Descriptor`.  It is best to define
+   descriptors statically to avoid leaking memory and non-portable shared
+   library constructors and destructors to clean up properly.
+*/
+static const LV2_Descriptor descriptor = {
+	CFUZZ_URI,
+	instantiate,
+	connect_port,
+	activate,
+	run,
+	deactivate,
+	cleanup,
+	extension_data
+};
+
+/**
+   The `lv2_descriptor()` function is the entry point to the plugin library.  The
+   host will load the library and call this function repeatedly with increasing
+   indices to find all the plugins defined in the library.  The index is not an
+   indentifier, the URI of the returned descriptor is used to determine the
+   identify of the plugin.
+
+   This method is in the ``discovery'' threading class, so no other functions
+   or methods in this plugin library will be called concurrently with it.
+*/
+LV2_SYMBOL_EXPORT
+const LV2_Descriptor*
+lv2_descriptor(uint32_t index)
+{
+	switch (index) {
+	case 0:  return &descriptor;
+	default: return NULL;
+	}
+}
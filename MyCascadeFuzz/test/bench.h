@@ -0,0 +1,130 @@
+#ifndef CFUZZ_BENCH_H
+#define CFUZZ_BENCH_H
+
+/**
+   Helpers shared by the test and benchmark of test/: a clock, the test
+   signal, and this plugin and DafxFuzz driven as a host would.  DafxFuzz
+   is built into each program with its entry point renamed to
+   `dafx_fuzz_descriptor()`.  The figures in README.txt were measured with
+   the programs built by
+
+     CFLAGS=-O2 ./waf configure --test && ./waf
+*/
+#include <math.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+
+#define PI 3.14159265358979323846
+
+/** Sample rate of the tests. */
+#define BENCH_RATE 48000
+
+/** Control ports of the plugin, 2 ("stages") to 8 ("mix"). */
+#define BENCH_PORTS 9
+
+/** Report a failed check and count it. */
+#define CHECK(cond, ...)                                  \
+   do {                                                   \
+      if (!(cond)) {                                      \
+         fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);  \
+         fprintf(stderr, __VA_ARGS__);                    \
+         fprintf(stderr, "\n");                           \
+         failures++;                                      \
+      }                                                   \
+   } while (0)
+
+/**
+   Seconds of CPU used by the calling thread, which other processes on the
+   machine do not disturb as much as they do the clock.
+*/
+static inline double
+bench_cpu(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+   return t.tv_sec + 1e-9*t.tv_nsec;
+}
+
+/**
+   The test signal of DafxFuzz: two partials with a slow swell, so the
+   block peaks change, and a little noise.
+*/
+static inline void
+bench_signal(float* x, int n)
+{
+   uint32_t seed = 1;
+   int i;
+
+   for (i = 0; i < n; i++) {
+      seed = seed*1664525u + 1013904223u;
+      x[i] = (0.6*sin(i*0.05) + 0.3*sin(i*0.0123))*(0.55 + 0.45*sin(i*0.0002))
+             + 0.05*((seed >> 8)*(2.0/16777216.0) - 1);
+   }
+}
+
+/** This plugin (my_cfuzz.c) and DafxFuzz, linked into each program. */
+const LV2_Descriptor* lv2_descriptor(uint32_t index);
+const LV2_Descriptor* dafx_fuzz_descriptor(uint32_t index);
+
+/**
+   An instance of `d` with control ports 2 to `ports` - 1 connected to
+   `ctl` and set to `defaults`.
+*/
+static inline LV2_Handle
+bench_instance(const LV2_Descriptor* d, float* ctl, const float* defaults,
+               int ports)
+{
+   LV2_Handle h = d->instantiate(d, BENCH_RATE, "", NULL);
+   int p;
+
+   if (h == NULL)
+      return NULL;
+   for (p = 2; p < ports; p++) {
+      ctl[p] = defaults[p];
+      d->connect_port(h, p, &ctl[p]);
+   }
+   d->activate(h);
+   return h;
+}
+
+/** An instance of this plugin, at the defaults of my_cfuzz.ttl. */
+static inline LV2_Handle
+bench_cfuzz(float* ctl)
+{
+   static const float defaults[BENCH_PORTS] = {0, 0, 2, 5, 5, 5, 100, 5000,
+                                               1};
+
+   return bench_instance(lv2_descriptor(0), ctl, defaults, BENCH_PORTS);
+}
+
+/** An instance of DafxFuzz with "gain", "mix" and "aa" (off) in `ctl`. */
+static inline LV2_Handle
+bench_dafx_fuzz(float* ctl)
+{
+   static const float defaults[5] = {0, 0, 0.5, 1, 0};
+
+   return bench_instance(dafx_fuzz_descriptor(0), ctl, defaults, 5);
+}
+
+/** Run `n` samples through `h` of `d` in `block`-frame blocks. */
+static inline void
+bench_render(const LV2_Descriptor* d, LV2_Handle h, const float* in,
+             float* out, int n, int block)
+{
+   int pos, len;
+
+   for (pos = 0; pos < n; pos += len) {
+      len = n - pos < block ? n - pos : block;
+      d->connect_port(h, 0, (void*)(in + pos));
+      d->connect_port(h, 1, out + pos);
+      d->run(h, len);
+   }
+}
+
+#endif
@@ -0,0 +1,134 @@
+/**
+   run() with 1, 2 and 3 stages against as many chained DafxFuzz
+   instances ("aa" off) with the same one-pole high-pass and low-pass
+   between them, in ns per sample: gain 5, mix 0.5, hp 100 Hz, lp 5 kHz,
+   20 s at 48 kHz in 64, 256 and 4096-frame blocks, best of 3.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#define SECONDS 20
+#define REPS    3
+#define STAGES  3
+
+static const int blocks[] = {64, 256, 4096};
+#define BLOCKS ((int)(sizeof(blocks)/sizeof(blocks[0])))
+
+/** The filters of my_cfuzz.c between two instances, in place. */
+static void
+filter(float* z, int n, float ah, float al, float* h, float* l)
+{
+   int j;
+
+   for (j = 0; j < n; j++) {
+      *h += ah*(z[j] - *h);
+      *l += al*(z[j] - *h - *l);
+      z[j] = *l;
+   }
+}
+
+/** `stages` DafxFuzz instances in a row, the last one mixing. */
+static double
+time_chain(int stages, const float* in, float* out, float* tmp, int n,
+           int block)
+{
+   const LV2_Descriptor* d = dafx_fuzz_descriptor(0);
+   const float ah = 1 - exp(-2*PI*100/BENCH_RATE);
+   const float al = 1 - exp(-2*PI*5000/BENCH_RATE);
+   float ctl[STAGES][5], h[STAGES], l[STAGES];
+   LV2_Handle inst[STAGES];
+   double t, best = -1;
+   int r, i, pos, len;
+
+   for (i = 0; i < stages; i++) {
+      inst[i] = bench_dafx_fuzz(ctl[i]);
+      if (inst[i] == NULL)
+         return -1;
+      ctl[i][2] = 5;
+      ctl[i][3] = i == stages - 1 ? 0.5 : 1;
+   }
+
+   for (r = 0; r < REPS; r++) {
+      for (i = 0; i < stages; i++) {
+         d->activate(inst[i]);
+         h[i] = l[i] = 0;
+      }
+      t = bench_cpu();
+      for (pos = 0; pos < n; pos += len) {
+         len = n - pos < block ? n - pos : block;
+         d->connect_port(inst[0], 0, (void*)(in + pos));
+         d->connect_port(inst[0], 1, stages > 1 ? tmp : out + pos);
+         d->run(inst[0], len);
+         for (i = 1; i < stages; i++) {
+            filter(tmp, len, ah, al, &h[i], &l[i]);
+            d->connect_port(inst[i], 0, tmp);
+            d->connect_port(inst[i], 1, i == stages - 1 ? out + pos : tmp);
+            d->run(inst[i], len);
+         }
+      }
+      t = 1e9*(bench_cpu() - t)/n;
+      if (best < 0 || t < best)
+         best = t;
+   }
+
+   for (i = 0; i < stages; i++)
+      d->cleanup(inst[i]);
+   return best;
+}
+
+/** This plugin with `stages` stages. */
+static double
+time_cfuzz(int stages, const float* in, float* out, int n, int block)
+{
+   float ctl[BENCH_PORTS];
+   LV2_Handle h = bench_cfuzz(ctl);
+   double t, best = -1;
+   int r;
+
+   if (h == NULL)
+      return -1;
+   ctl[2] = stages;
+   ctl[8] = 0.5;
+   for (r = 0; r < REPS; r++) {
+      lv2_descriptor(0)->activate(h);
+      t = bench_cpu();
+      bench_render(lv2_descriptor(0), h, in, out, n, block);
+      t = 1e9*(bench_cpu() - t)/n;
+      if (best < 0 || t < best)
+         best = t;
+   }
+
+   lv2_descriptor(0)->cleanup(h);
+   return best;
+}
+
+int main(void) {
+   const int n = SECONDS*BENCH_RATE;
+   float* in = malloc(n*sizeof(float));
+   float* out = malloc(n*sizeof(float));
+   float* tmp = malloc(blocks[BLOCKS - 1]*sizeof(float));
+   int b, s;
+
+   if (in == NULL || out == NULL || tmp == NULL) {
+      fprintf(stderr, "bench_run: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, n);
+
+   printf("ns/sample                 64 frames   256 frames   4096 frames\n");
+   for (s = 1; s <= STAGES; s++) {
+      printf("%d stage%s, this plugin  ", s, s > 1 ? "s" : " ");
+      for (b = 0; b < BLOCKS; b++)
+         printf("   %6.1f    ", time_cfuzz(s, in, out, n, blocks[b]));
+      printf("\n%d DafxFuzz + filters   ", s);
+      for (b = 0; b < BLOCKS; b++)
+         printf("   %6.1f    ", time_chain(s, in, out, tmp, n, blocks[b]));
+      printf("\n");
+   }
+
+   free(in);
+   free(out);
+   free(tmp);
+   return 0;
+}
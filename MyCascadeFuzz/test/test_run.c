@@ -0,0 +1,193 @@
+/**
+   run() with one stage against DafxFuzz with "aa" off: the same output
+   within MAX_ERROR_ONE at gains 0.01 - 100, mix 0 - 1 and blocks of 1 -
+   4096 frames, with a few silent blocks, out of place and in place.  Then
+   two and three stages against the cascade computed in double with exp()
+   (cfuzzRef() below), within MAX_ERROR_CASCADE: a stage at gain 0.01
+   scales the rounding of 1 - exp(-v) by 1/f(0.01), about 100, and the
+   stages after it keep that error.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "bench.h"
+
+#define N (5*BENCH_RATE)
+
+/* Largest difference from DafxFuzz, and from the cascade in double */
+#define MAX_ERROR_ONE     3e-6
+#define MAX_ERROR_CASCADE 1e-4
+
+static int failures = 0;
+
+/** DAFX fuzz curve scaled so that u = +-1 comes out at +-1. */
+static double
+stage(double u, double g)
+{
+   const double v = g*u;
+
+   return copysign(1 - exp(-fabs(v)), v)/(1 - exp(-fabs(g)));
+}
+
+/**
+   The cascade as README.txt states it, sample by sample in double: the
+   block normalized by its peak, `stages` stages with the high-pass and
+   low-pass between them, scaled back and mixed.  `h` and `l` hold the
+   states of the filters across blocks.
+*/
+static void
+cfuzzRef(const float* x, float* y, int n, int stages, const float* g,
+         double ah, double al, double mix, double* h, double* l)
+{
+   double maxX = 0, z;
+   int i, j;
+
+   for (j = 0; j < n; j++)
+      maxX = fmax(maxX, fabs(x[j]));
+   for (j = 0; j < n; j++) {
+      z = maxX > 0 ? stage(x[j]/maxX, g[0]) : 0;
+      for (i = 1; i < stages; i++) {
+         h[i - 1] += ah*(z - h[i - 1]);
+         l[i - 1] += al*(z - h[i - 1] - l[i - 1]);
+         z = stage(l[i - 1], g[i]);
+      }
+      y[j] = mix*maxX*z + (1 - mix)*x[j];
+   }
+}
+
+static double
+largest(const float* a, const float* b, int n)
+{
+   double err = 0;
+   int i;
+
+   for (i = 0; i < n; i++)
+      err = fmax(err, fabs(a[i] - b[i]));
+   return err;
+}
+
+/** One stage against DafxFuzz. */
+static void
+test_one(const float* in, float* out, float* ref)
+{
+   static const float gains[] = {0.01, 0.5, 5, 100};
+   static const float mixes[] = {1, 0.5, 0};
+   static const int blocks[] = {1, 64, 256, 777, 4096};
+   const int G = sizeof(gains)/sizeof(gains[0]);
+   const int X = sizeof(mixes)/sizeof(mixes[0]);
+   const int B = sizeof(blocks)/sizeof(blocks[0]);
+   float ctl[BENCH_PORTS], dctl[5];
+   double err, worst = 0;
+   LV2_Handle h, d;
+   int g, x, b, inplace;
+
+   for (g = 0; g < G; g++)
+   for (x = 0; x < X; x++)
+   for (b = 0; b < B; b++) {
+      d = bench_dafx_fuzz(dctl);
+      if (d == NULL) {
+         CHECK(0, "no DafxFuzz instance");
+         return;
+      }
+      dctl[2] = gains[g];
+      dctl[3] = mixes[x];
+      bench_render(dafx_fuzz_descriptor(0), d, in, ref, N, blocks[b]);
+      dafx_fuzz_descriptor(0)->cleanup(d);
+
+      for (inplace = 0; inplace < 2; inplace++) {
+         h = bench_cfuzz(ctl);
+         if (h == NULL) {
+            CHECK(0, "no instance");
+            return;
+         }
+         ctl[2] = 1;
+         ctl[3] = gains[g];
+         ctl[8] = mixes[x];
+         if (inplace)
+            memcpy(out, in, N*sizeof(float));
+         bench_render(lv2_descriptor(0), h, inplace ? out : in, out, N,
+                      blocks[b]);
+         lv2_descriptor(0)->cleanup(h);
+
+         err = largest(out, ref, N);
+         worst = fmax(worst, err);
+         CHECK(err <= MAX_ERROR_ONE, "gain %g, mix %g, %d frames%s: %.2g",
+               gains[g], mixes[x], blocks[b], inplace ? ", in place" : "",
+               err);
+      }
+   }
+   printf("one stage, largest difference from DafxFuzz %.2g\n", worst);
+}
+
+/** Two and three stages against cfuzzRef(). */
+static void
+test_cascade(const float* in, float* out, float* ref)
+{
+   static const float gains[][3] = {{5, 5, 5}, {0.5, 20, 2}, {100, 0.01, 50}};
+   static const float filters[][2] = {{100, 5000}, {10, 20000}, {1000, 500}};
+   static const int blocks[] = {64, 777};
+   const int G = sizeof(gains)/sizeof(gains[0]);
+   const int F = sizeof(filters)/sizeof(filters[0]);
+   const int B = sizeof(blocks)/sizeof(blocks[0]);
+   float ctl[BENCH_PORTS];
+   double err, worst = 0, h[2], l[2], ah, al;
+   LV2_Handle p;
+   int s, g, f, b, pos, len;
+
+   for (s = 2; s <= 3; s++)
+   for (g = 0; g < G; g++)
+   for (f = 0; f < F; f++)
+   for (b = 0; b < B; b++) {
+      ah = 1 - exp(-2*PI*filters[f][0]/BENCH_RATE);
+      al = 1 - exp(-2*PI*filters[f][1]/BENCH_RATE);
+      h[0] = h[1] = l[0] = l[1] = 0;
+      for (pos = 0; pos < N; pos += len) {
+         len = N - pos < blocks[b] ? N - pos : blocks[b];
+         cfuzzRef(in + pos, ref + pos, len, s, gains[g], ah, al, 0.5, h, l);
+      }
+
+      p = bench_cfuzz(ctl);
+      if (p == NULL) {
+         CHECK(0, "no instance");
+         return;
+      }
+      ctl[2] = s;
+      memcpy(ctl + 3, gains[g], sizeof(gains[g]));
+      ctl[6] = filters[f][0];
+      ctl[7] = filters[f][1];
+      ctl[8] = 0.5;
+      bench_render(lv2_descriptor(0), p, in, out, N, blocks[b]);
+      lv2_descriptor(0)->cleanup(p);
+
+      err = largest(out, ref, N);
+      worst = fmax(worst, err);
+      CHECK(err <= MAX_ERROR_CASCADE,
+            "%d stages, gains %g %g %g, hp %g, lp %g, %d frames: %.2g",
+            s, gains[g][0], gains[g][1], gains[g][2], filters[f][0],
+            filters[f][1], blocks[b], err);
+   }
+   printf("two and three stages, largest difference from double %.2g\n",
+          worst);
+}
+
+int main(void) {
+   float* in = malloc(N*sizeof(float));
+   float* out = malloc(N*sizeof(float));
+   float* ref = malloc(N*sizeof(float));
+   int i;
+
+   if (in == NULL || out == NULL || ref == NULL) {
+      fprintf(stderr, "test_run: out of memory\n");
+      return 1;
+   }
+   bench_signal(in, N);
+   for (i = 1000; i < 1300; i++)
+      in[i] = 0;
+
+   test_one(in, out, ref);
+   test_cascade(in, out, ref);
+
+   free(in);
+   free(out);
+   free(ref);
+   return failures ? 1 : 0;
+}
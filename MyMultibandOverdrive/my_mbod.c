@@ -0,0 +1,322 @@
+
+/** Include standard C headers */
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/**
+   LV2 headers are based on the URI of the specification they come from, so a
+   consistent convention can be used even for unofficial extensions.  The URI
+   of the core LV2 specification is <http://lv2plug.in/ns/lv2core>, by
+   replacing `http:/` with `lv2` any header in the specification bundle can be
+   included, in this case `lv2.h`.
+*/
+#include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+
+#include "od_clip.h"
+#include "xover.h"
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+/**
+   The URI is the identifier for a plugin, and how the host associates this
+   implementation in code with its description in data. If this URI does not
+   match that used in the data files, the host will fail to load the plugin.
+*/
+#define MBOD_URI "www.linux.ime.usp.br/~vitorsamora/mac0499/my-multiband-overdrive.lv2"
+
+/**
+   In the code, ports are referred to by index.  An enumeration of port indices
+   should be defined for readability. They need to match the definitions in the
+   *.ttl file.
+*/
+typedef enum {
+	INPUT  = 0,
+	OUTPUT = 1,
+   BANDS = 2,
+   XOVER1 = 3,
+   XOVER2 = 4,
+   XOVER3 = 5,
+   TH1 = 6,
+   TH2 = 7,
+   TH3 = 8,
+   TH4 = 9,
+   LEVEL = 10
+} PortIndex;
+
+/**
+   Define a private structure for the plugin instance.  All data
+   associated with a plugin instance is stored here, and is available to
+   every instance method, being passed back through the 'instance' parameter.
+**/
+typedef struct {
+   const float* input;    // lv2 audio port;
+   float*       output;   // lv2 audio port;
+   const float* bands;    // lv2 control port
+   const float* xover[XOVER_SPLITS];   // lv2 control ports
+   const float* th[XOVER_BANDS];       // lv2 control ports
+   const float* level;    // lv2 control port
+   Xover xo;
+   OdClip clip[XOVER_BANDS];          // curve of each band, for last_th
+   float last_th[XOVER_BANDS];
+   float last_level;
+} Mbod;
+
+// /**
+//    The `connect_port()` method is called by the host to connect a particular
+//    port to a buffer.  The plugin must store the data location, but data may not
+//    be accessed except in run().
+
+//    This method is in the ``audio'' threading class, and is called in the same
+//    context as run().
+// */
+static void
+connect_port(LV2_Handle instance,
+             uint32_t   port,
+             void*      data)
+{
+	Mbod* mbod = (Mbod*)instance;
+	if (mbod == NULL ) {
+		return;
+	}
+
+	switch ((PortIndex)port) {
+   case INPUT:
+      mbod->input = (const float*)data;
+      break;
+   case OUTPUT:
+      mbod->output = (float*)data;
+      break;
+   case BANDS:
+      mbod->bands = (const float*)data;
+      break;
+   case XOVER1:
+   case XOVER2:
+   case XOVER3:
+      mbod->xover[port - XOVER1] = (const float*)data;
+      break;
+   case TH1:
+   case TH2:
+   case TH3:
+   case TH4:
+      mbod->th[port - TH1] = (const float*)data;
+      break;
+   case LEVEL:
+      mbod->level = (const float*)data;
+      break;
+   }
+}
+
+/** The curve of MyOverdrive for its port value th, times level. */
+static void
+set_curve(OdClip* clip, float th_port, float level)
+{
+   const float th = 1.0 - th_port;
+   const float a = 2/((2 + th) * th);
+   const float c = -1/((2 + th) * th);
+   const float d = 4/(2 + th);
+   const float e = (2 - 3*th)/(2 + th);
+
+   od_clip_set(clip, th, 2*th, a, c, d, e, level);
+}
+
+/**
+   The `run()` method is the main process function of the plugin.  It processes
+   a block of audio in the audio context.  Since this plugin is
+   `lv2:hardRTCapable`, `run()` must be real-time safe, so blocking (e.g. with
+   a mutex) or memory allocation are not allowed.
+*/
+static void
+run(LV2_Handle instance, uint32_t n_samples)
+{
+	uint32_t pos, j, len;
+   int b;
+	Mbod* mbod = (Mbod*)instance;
+   float freq[XOVER_SPLITS];
+   float z[XOVER_BANDS*XOVER_CHUNK];
+
+	if (mbod == NULL) {
+		fprintf(stderr, "MY_MBOD: run() called with NULL instance parameter.\n");
+		return;
+	}
+
+   for (b = 0; b < XOVER_SPLITS; b++)
+      freq[b] = *(mbod->xover[b]);
+   xover_set(&mbod->xo, (int)*(mbod->bands), freq);
+
+   for (b = 0; b < XOVER_BANDS; b++) {
+      if (*(mbod->th[b]) != mbod->last_th[b] ||
+          *(mbod->level) != mbod->last_level) {
+         set_curve(&mbod->clip[b], *(mbod->th[b]), *(mbod->level));
+         mbod->last_th[b] = *(mbod->th[b]);
+      }
+   }
+   mbod->last_level = *(mbod->level);
+
+   /*
+      The crossover writes the bands of a chunk side by side, and each
+      band is clipped by its own curve in its own lane and summed.  Bands
+      not in use are 0, which every curve keeps at 0.  Each input sample
+      is read before its output is written, so the host may run the plugin
+      in place.
+   */
+#if defined(__SSE2__)
+   OdClip4 clip4;
+
+   od_clip4_set(&clip4, mbod->clip);
+#endif
+   for (pos = 0; pos < n_samples; pos += len) {
+      len = MIN(n_samples - pos, XOVER_CHUNK);
+      xover_process(&mbod->xo, mbod->input + pos, z, len);
+      for (j = 0; j < len; j++) {
+#if defined(__SSE2__)
+         __m128 v = od_clip4_eval(&clip4, _mm_loadu_ps(z + XOVER_BANDS*j));
+         v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+         v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+         mbod->output[pos + j] = _mm_cvtss_f32(v);
+#else
+         const float* zj = z + XOVER_BANDS*j;
+         mbod->output[pos + j] =
+            (od_clip_eval(&mbod->clip[0], zj[0]) +
+             od_clip_eval(&mbod->clip[2], zj[2])) +
+            (od_clip_eval(&mbod->clip[1], zj[1]) +
+             od_clip_eval(&mbod->clip[3], zj[3]));
+#endif
+      }
+   }
+}
+
+/**
+   The `instantiate()` function is called by the host to create a new plugin
+   instance.  The host passes the plugin descriptor, sample rate, and bundle
+   path for plugins that need to load additional resources (e.g. waveforms).
+   The features parameter contains host-provided features defined in LV2
+   extensions, but this simple plugin does not use any.
+
+   This function is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static LV2_Handle
+instantiate(const LV2_Descriptor*     descriptor,
+            double                    rate,
+            const char*               bundle_path,
+            const LV2_Feature* const* features
+	    )
+{
+   int b;
+	Mbod* mbod = (Mbod*)malloc(sizeof(Mbod));
+
+   if (mbod == NULL) {
+      fprintf(stderr, "MY_MBOD: out of memory.\n");
+      return NULL;
+   }
+
+   xover_init(&mbod->xo, rate);
+   for (b = 0; b < XOVER_BANDS; b++)
+      mbod->last_th[b] = NAN;
+   mbod->last_level = NAN;
+
+	return (LV2_Handle)mbod;
+}
+
+/**
+   The `activate()` method is called by the host to initialise and prepare the
+   plugin instance for running.  The plugin must reset all internal state
+   except for buffer locations set by `connect_port()`.  Here the states of
+   the crossover filters are cleared.
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+activate(LV2_Handle instance)
+{
+   Mbod* mbod = (Mbod*)instance;
+
+   xover_reset(&mbod->xo);
+}
+
+/**
+   The `deactivate()` method is the counterpart to `activate()`, and is called by
+   the host after running the plugin.  It indicates that the host will not call
+   `run()` again until another call to `activate()` and is mainly useful for more
+   advanced plugins with ``live'' characteristics such as those with auxiliary
+   processing threads.  As with `activate()`, this plugin has no use for this
+   information so this method does nothing.
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+deactivate(LV2_Handle instance)
+{
+}
+
+
+/**
+   Destroy a plugin instance (counterpart to `instantiate()`).
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+cleanup(LV2_Handle instance)
+{
+	free(instance);
+}
+
+/**
+   The `extension_data()` function returns any extension data supported by the
+   plugin.  Note that this is not an instance method, but a function on the
+   plugin descriptor.  It is usually used by plugins to implement additional
+   interfaces.  This plugin does not have any extension data, so this function
+   returns NULL.
+
+   This method is in the ``discovery'' threading class, so no other functions
+   or methods in this plugin library will be called concurrently with it.
+*/
+static const void*
+extension_data(const char* uri)
+{
+	return NULL;
+}
+
+/**
+   Every plugin must define an `LV2_Descriptor`.  It is best to define
+   descriptors statically to avoid leaking memory and non-portable shared
+   library constructors and destructors to clean up properly.
+*/
+static const LV2_Descriptor descriptor = {
+	MBOD_URI,
+	instantiate,
+	connect_port,
+	activate,
+	run,
+	deactivate,
+	cleanup,
+	extension_data
+};
+
+/**
+   The `lv2_descriptor()` function is the entry point to the plugin library.  The
+   host will load the library and call this function repeatedly with increasing
+   indices to find all the plugins defined in the library.  The index is not an
+   indentifier, the URI of the returned descriptor is used to determine the
+   identify of the plugin.
+
+   This method is in the ``discovery'' threading class, so no other functions
+   or methods in this plugin library will be called concurrently with it.
+*/
+LV2_SYMBOL_EXPORT
+const LV2_Descriptor*
+lv2_descriptor(uint32_t index)
+{
+	switch (index) {
+	case 0:  return &descriptor;
+	default: return NULL;
+	}
+}
@@ -0,0 +1,110 @@
+/**
+   The rows of the table in README.txt, in ns per sample: run() with 2 and
+   4 bands, the crossover alone with 4 bands, and one band's row of six
+   biquads computed scalar.  Splits at 200, 2000 and 8000 Hz, thresholds
+   0.5, 48 kHz, 256-frame blocks, best of REPS.  Built twice, as
+   test/bench_mbod and as test/bench_mbod_scalar with __SSE2__ undefined,
+   which times the band by band paths of my_mbod.c and xover.c.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "od_bench.h"
+#include "xover.h"
+
+#define BLOCK 256
+#define REPS  60
+
+static float in[OD_BENCH_N], out[OD_BENCH_N], z[XOVER_BANDS*BLOCK];
+
+/** The ports of my_mbod.ttl from 2 on: bands, splits, thresholds, level. */
+static float ctl[11] = {0, 0, 4, 200, 2000, 8000, 0.5, 0.5, 0.5, 0.5, 1};
+
+static double
+time_plugin(int bands)
+{
+   LV2_Handle h = od_bench_instance(ctl, 11);
+   double t, best = -1;
+   int r;
+
+   if (h == NULL)
+      return -1;
+   ctl[2] = bands;
+   for (r = 0; r < REPS; r++) {
+      t = od_bench_cpu();
+      od_bench_render(h, ctl, in, out, OD_BENCH_N, BLOCK);
+      t = 1e9*(od_bench_cpu() - t)/OD_BENCH_N;
+      best = best < 0 || t < best ? t : best;
+   }
+   lv2_descriptor(0)->cleanup(h);
+   return best;
+}
+
+/** xover_process() alone, 4 bands. */
+static double
+time_xover(void)
+{
+   Xover xo;
+   double t, best = -1;
+   int r, pos;
+
+   xover_init(&xo, 48000);
+   xover_set(&xo, 4, ctl + 3);
+   for (r = 0; r < REPS; r++) {
+      t = od_bench_cpu();
+      for (pos = 0; pos < OD_BENCH_N; pos += BLOCK)
+         xover_process(&xo, in + pos, z, BLOCK);
+      t = 1e9*(od_bench_cpu() - t)/OD_BENCH_N;
+      best = best < 0 || t < best ? t : best;
+   }
+   return best;
+}
+
+/** The six biquads of band 1 in a row, as xover.c does without SSE. */
+static double
+time_row(void)
+{
+   Xover xo;
+   double t, best = -1;
+   double v, w;
+   int r, i, k;
+
+   xover_init(&xo, 48000);
+   xover_set(&xo, 4, ctl + 3);
+   for (r = 0; r < REPS; r++) {
+      t = od_bench_cpu();
+      for (i = 0; i < OD_BENCH_N; i++) {
+         v = in[i];
+         for (k = 0; k < XOVER_STAGES; k++) {
+            XoverStage* st = &xo.stage[k];
+            w = st->b0[1]*v + st->s1[1];
+            st->s1[1] = (st->b1[1]*v + st->s2[1]) - st->a1[1]*w;
+            st->s2[1] = st->b2[1]*v - st->a2[1]*w;
+            v = w;
+         }
+         out[i] = v;
+      }
+      t = 1e9*(od_bench_cpu() - t)/OD_BENCH_N;
+      best = best < 0 || t < best ? t : best;
+   }
+   return best;
+}
+
+int main(void) {
+   int i;
+
+   for (i = 0; i < OD_BENCH_N; i++)
+      in[i] = 0.9*sin(i*0.031)*sin(i*0.00011) + 0.02*sin(i*0.9);
+
+#if defined(__SSE2__)
+   printf("ns/sample, %d frames, best of %d       2 bands   4 bands\n",
+          BLOCK, REPS);
+   printf("this plugin                            %5.1f     %5.1f\n",
+          time_plugin(2), time_plugin(4));
+   printf("crossover alone, 4 bands with SSE      %5.1f\n", time_xover());
+   printf("one band's row of six biquads, scalar  %5.1f\n", time_row());
+#else
+   printf("without SSE, band by band              %5.1f     %5.1f\n",
+          time_plugin(2), time_plugin(4));
+#endif
+   return 0;
+}
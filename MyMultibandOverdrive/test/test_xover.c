@@ -0,0 +1,253 @@
+/**
+   The crossover (xover.c): the bands of 2, 3 and 4-band splits sum to a
+   flat magnitude within MAX_RIPPLE from 10 Hz to 0.45 of the rate; each
+   split passes -6.02 dB to the band on either side at its frequency; the
+   bands follow the crossover tree computed in double within MAX_ERROR;
+   and bands not in use are 0.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "xover.h"
+
+#define PI 3.14159265358979323846
+
+/** Length of the impulse responses, and of the noise against the tree */
+#define N (1 << 15)
+
+#define MAX_RIPPLE 1e-6
+#define MAX_DB     0.005
+#define MAX_ERROR  1e-7
+
+/** Report a failed check and count it. */
+#define CHECK(cond, ...)                                  \
+   do {                                                   \
+      if (!(cond)) {                                      \
+         fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);  \
+         fprintf(stderr, __VA_ARGS__);                    \
+         fprintf(stderr, "\n");                           \
+         failures++;                                      \
+      }                                                   \
+   } while (0)
+
+static int failures = 0;
+
+static const double rates[] = {44100, 48000, 96000};
+static const float splits[][XOVER_SPLITS] = {
+   {200, 2000, 8000}, {60, 600, 16000}, {100, 1000, 10000}, {500, 700, 900},
+   {20, 100, 500}
+};
+#define RATES  ((int)(sizeof(rates)/sizeof(rates[0])))
+#define SPLITS ((int)(sizeof(splits)/sizeof(splits[0])))
+
+static float x[N], y[XOVER_BANDS*N];
+
+/** |H(f)| of the impulse response h[k*stride], k < N. */
+static double
+magnitude(const float* h, int stride, double f, double rate)
+{
+   const double c = cos(2*PI*f/rate), s = sin(2*PI*f/rate);
+   double re = 0, im = 0, pr = 1, pi = 0, t;
+   int k;
+
+   for (k = 0; k < N; k++) {
+      re += h[k*stride]*pr;
+      im -= h[k*stride]*pi;
+      t = pr*c - pi*s;
+      pi = pr*s + pi*c;
+      pr = t;
+   }
+   return sqrt(re*re + im*im);
+}
+
+/** The impulse response of `bands` bands into y. */
+static void
+impulse(Xover* xo, int bands, const float* freq)
+{
+   xover_set(xo, bands, freq);
+   xover_reset(xo);
+   memset(x, 0, sizeof(x));
+   x[0] = 1;
+   xover_process(xo, x, y, N);
+}
+
+static void
+test_flat(void)
+{
+   static float sum[N];
+   Xover xo;
+   double f, m, worst = 0;
+   int r, s, bands, i, b;
+
+   for (r = 0; r < RATES; r++)
+   for (s = 0; s < SPLITS; s++)
+   for (bands = 2; bands <= XOVER_BANDS; bands++) {
+      xover_init(&xo, rates[r]);
+      impulse(&xo, bands, splits[s]);
+      for (i = 0; i < N; i++)
+         for (b = 0, sum[i] = 0; b < XOVER_BANDS; b++)
+            sum[i] += y[XOVER_BANDS*i + b];
+      for (f = 10; f < 0.45*rates[r]; f *= 1.05) {
+         m = magnitude(sum, 1, f, rates[r]);
+         worst = fmax(worst, fabs(m - 1));
+         CHECK(fabs(m - 1) <= MAX_RIPPLE, "%.0f Hz, %d bands at %g %g %g: "
+               "|sum| %.6f at %.0f Hz", rates[r], bands, splits[s][0],
+               splits[s][1], splits[s][2], m, f);
+      }
+      for (i = 0; i < N; i++)
+         for (b = bands; b < XOVER_BANDS; b++)
+            CHECK(y[XOVER_BANDS*i + b] == 0, "%d bands: band %d not 0",
+                  bands, b);
+   }
+   printf("sum of the bands, largest ripple %.2g\n", worst);
+}
+
+/**
+   Each split alone, as two bands, and the splits of four bands a decade
+   apart, where the other splits lower the level by about 2e-3 dB.
+*/
+static void
+test_points(void)
+{
+   static const float alone[] = {20, 200, 1000, 5000, 16000};
+   Xover xo;
+   float freq[XOVER_SPLITS];
+   double db, worst = 0;
+   int r, s, k, b;
+
+   for (r = 0; r < RATES; r++) {
+      xover_init(&xo, rates[r]);
+      for (s = 0; s < (int)(sizeof(alone)/sizeof(alone[0])); s++) {
+         freq[0] = freq[1] = freq[2] = alone[s];
+         impulse(&xo, 2, freq);
+         for (b = 0; b < 2; b++) {
+            db = 20*log10(magnitude(y + b, XOVER_BANDS, alone[s], rates[r]));
+            worst = fmax(worst, fabs(db + 6.0206));
+            CHECK(fabs(db + 6.0206) <= MAX_DB, "%.0f Hz, split at %g: "
+                  "band %d at %.4f dB", rates[r], alone[s], b, db);
+         }
+      }
+
+      impulse(&xo, 4, splits[2]);
+      for (k = 0; k < XOVER_SPLITS; k++)
+         for (b = k; b <= k + 1; b++) {
+            db = 20*log10(magnitude(y + b, XOVER_BANDS, splits[2][k],
+                                    rates[r]));
+            worst = fmax(worst, fabs(db + 6.0206));
+            CHECK(fabs(db + 6.0206) <= MAX_DB, "%.0f Hz, 4 bands: band %d "
+                  "at %.4f dB at %g Hz", rates[r], b, db, splits[2][k]);
+         }
+   }
+   printf("bands at the splits, largest error from -6.02 dB %.2g dB\n",
+          worst);
+}
+
+/** A biquad in double, transposed direct form II. */
+typedef struct {
+   double b0, b1, b2, a1, a2, s1, s2;
+} Biquad;
+
+static void
+biquad_set(Biquad* q, int kind, double w0)
+{
+   const double cw = cos(w0), alpha = sin(w0)/sqrt(2.0), a0 = 1 + alpha;
+
+   q->b0 = (kind == 0 ? (1 - cw)/2 : kind == 1 ? (1 + cw)/2 : 1 - alpha)/a0;
+   q->b1 = (kind == 0 ? 1 - cw : kind == 1 ? -(1 + cw) : -2*cw)/a0;
+   q->b2 = (kind == 0 ? (1 - cw)/2 : kind == 1 ? (1 + cw)/2 : 1 + alpha)/a0;
+   q->a1 = -2*cw/a0;
+   q->a2 = (1 - alpha)/a0;
+   q->s1 = q->s2 = 0;
+}
+
+static double
+biquad(Biquad* q, double v)
+{
+   const double w = q->b0*v + q->s1;
+
+   q->s1 = q->b1*v + q->s2 - q->a1*w;
+   q->s2 = q->b2*v - q->a2*w;
+   return w;
+}
+
+/**
+   The usual tree: split k takes what is above split k - 1, passes its
+   low-pass (two Butterworth biquads) to band k and its high-pass on; the
+   bands below go through the allpass of split k, to keep their phase in
+   line.  `bands` bands of noise, against xover_process().
+*/
+static double
+tree_error(double rate, int bands, const float* freq)
+{
+   /* per split: low-pass x2, high-pass x2, allpass for each lower band */
+   Biquad lp[XOVER_SPLITS][2], hp[XOVER_SPLITS][2];
+   Biquad ap[XOVER_SPLITS][XOVER_BANDS];
+   double band[XOVER_BANDS], upper, w0, err = 0;
+   uint32_t seed = 1;
+   Xover xo;
+   int i, k, b;
+
+   for (i = 0; i < N; i++) {
+      seed = seed*1664525 + 1013904223;
+      x[i] = 0.5*((int32_t)seed/2147483648.0);
+   }
+   xover_init(&xo, rate);
+   xover_set(&xo, bands, freq);
+   xover_process(&xo, x, y, N);
+
+   for (k = 0; k < bands - 1; k++) {
+      w0 = 2*PI*freq[k]/rate;
+      biquad_set(&lp[k][0], 0, w0);
+      biquad_set(&lp[k][1], 0, w0);
+      biquad_set(&hp[k][0], 1, w0);
+      biquad_set(&hp[k][1], 1, w0);
+      for (b = 0; b < k; b++)
+         biquad_set(&ap[k][b], 2, w0);
+   }
+   for (i = 0; i < N; i++) {
+      upper = x[i];
+      for (k = 0; k < bands - 1; k++) {
+         for (b = 0; b < k; b++)
+            band[b] = biquad(&ap[k][b], band[b]);
+         band[k] = biquad(&lp[k][1], biquad(&lp[k][0], upper));
+         upper = biquad(&hp[k][1], biquad(&hp[k][0], upper));
+      }
+      band[bands - 1] = upper;
+      for (b = 0; b < bands; b++)
+         err = fmax(err, fabs(y[XOVER_BANDS*i + b] - band[b]));
+   }
+   return err;
+}
+
+static void
+test_tree(void)
+{
+   double err, worst = 0;
+   int r, s, bands;
+
+   for (r = 0; r < RATES; r++)
+   for (s = 0; s < SPLITS; s++)
+   for (bands = 2; bands <= XOVER_BANDS; bands++) {
+      err = tree_error(rates[r], bands, splits[s]);
+      worst = fmax(worst, err);
+      CHECK(err <= MAX_ERROR, "%.0f Hz, %d bands at %g %g %g: %.2g from "
+            "the tree", rates[r], bands, splits[s][0], splits[s][1],
+            splits[s][2], err);
+   }
+   printf("bands against the tree in double, largest difference %.2g\n",
+          worst);
+}
+
+int
+main(void)
+{
+   test_flat();
+   test_points();
+   test_tree();
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,243 @@
+#include <math.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "xover.h"
+
+#define PI 3.14159265358979323846
+
+#define MIN(x, y) (((x) < (y)) ? (x) : (y))
+
+typedef enum {
+   PASS,       // y = x
+   ZERO,       // y = 0
+   LOWPASS,
+   HIGHPASS,
+   ALLPASS
+} Kind;
+
+/**
+   Coefficients of one biquad of lane b, from the bilinear transform of a
+   second order section with Q = 1/sqrt(2) (Butterworth) at w0 radians per
+   sample, normalized by a0.
+*/
+static void
+set_biquad(XoverStage* st, int b, Kind kind, double w0)
+{
+   const double cw = cos(w0);
+   const double alpha = sin(w0)/sqrt(2.0);
+   const double a0 = 1 + alpha;
+   double b0 = 0, b1 = 0, b2 = 0, a1 = 0, a2 = 0;
+
+   switch (kind) {
+   case PASS:
+      b0 = a0;
+      break;
+   case ZERO:
+      break;
+   case LOWPASS:
+      b0 = (1 - cw)/2;
+      b1 = 1 - cw;
+      b2 = (1 - cw)/2;
+      break;
+   case HIGHPASS:
+      b0 = (1 + cw)/2;
+      b1 = -(1 + cw);
+      b2 = (1 + cw)/2;
+      break;
+   case ALLPASS:
+      b0 = 1 - alpha;
+      b1 = -2*cw;
+      b2 = 1 + alpha;
+      break;
+   }
+   if (kind == LOWPASS || kind == HIGHPASS || kind == ALLPASS) {
+      a1 = -2*cw;
+      a2 = 1 - alpha;
+   }
+
+   st->b0[b] = b0/a0;
+   st->b1[b] = b1/a0;
+   st->b2[b] = b2/a0;
+   st->a1[b] = a1/a0;
+   st->a2[b] = a2/a0;
+}
+
+
+void xover_init(Xover* xo, double rate) {
+   int k;
+
+   memset(xo, 0, sizeof(Xover));
+   xo->rate = rate;
+   xo->bands = 0;
+   for (k = 0; k < XOVER_SPLITS; k++)
+      xo->freq[k] = NAN;
+}
+
+
+void xover_reset(Xover* xo) {
+   int k;
+
+   for (k = 0; k < XOVER_STAGES; k++) {
+      memset(xo->stage[k].s1, 0, sizeof(xo->stage[k].s1));
+      memset(xo->stage[k].s2, 0, sizeof(xo->stage[k].s2));
+   }
+}
+
+
+void xover_set(Xover* xo, int bands, const float* freq) {
+   int k, b, same;
+   float f[XOVER_SPLITS];
+   double w0;
+   Kind first, second;
+
+   bands = bands < 2 ? 2 : bands > XOVER_BANDS ? XOVER_BANDS : bands;
+   same = bands == xo->bands;
+   for (k = 0; k < XOVER_SPLITS; k++) {
+      f[k] = MIN(freq[k], 0.45*xo->rate);
+      if (k > 0 && f[k] < f[k - 1])
+         f[k] = f[k - 1];
+      if (f[k] < 1)
+         f[k] = 1;
+      same = same && f[k] == xo->freq[k];
+   }
+   if (same)
+      return;
+
+   for (k = 0; k < XOVER_SPLITS; k++) {
+      w0 = 2*PI*f[k]/xo->rate;
+      for (b = 0; b < XOVER_BANDS; b++) {
+         if (b >= bands) {
+            first = k == 0 ? ZERO : PASS;
+            second = PASS;
+         }
+         else if (k >= bands - 1) {
+            first = PASS;
+            second = PASS;
+         }
+         else if (b < k) {
+            first = ALLPASS;
+            second = PASS;
+         }
+         else {
+            first = (b == k) ? LOWPASS : HIGHPASS;
+            second = first;
+         }
+         set_biquad(&xo->stage[2*k], b, first, w0);
+         set_biquad(&xo->stage[2*k + 1], b, second, w0);
+      }
+      xo->freq[k] = f[k];
+   }
+
+   /* A band that changes its filters would ring from the old states */
+   if (bands != xo->bands)
+      xover_reset(xo);
+   xo->bands = bands;
+}
+
+
+#if defined(__SSE2__)
+/**
+   One biquad of two bands, lanes `l` and `l` + 1, its states in registers.
+*/
+static inline __m128d
+biquad2(const XoverStage* st, int l, __m128d* s1, __m128d* s2, __m128d xv)
+{
+   const __m128d yv = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(st->b0 + l), xv),
+                                 *s1);
+
+   *s1 = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(_mm_loadu_pd(st->b1 + l), xv), *s2),
+                    _mm_mul_pd(_mm_loadu_pd(st->a1 + l), yv));
+   *s2 = _mm_sub_pd(_mm_mul_pd(_mm_loadu_pd(st->b2 + l), xv),
+                    _mm_mul_pd(_mm_loadu_pd(st->a2 + l), yv));
+   return yv;
+}
+#endif
+
+
+static void
+process_chunk(Xover* xo, const float* x, float* y, uint32_t n)
+{
+   uint32_t i;
+   int k;
+
+#if defined(__SSE2__)
+   /*
+      Two bands at a time, so that the states of the row fit in the
+      registers: bands 0 and 1 over the chunk, then bands 2 and 3 if they
+      are in use.
+   */
+   __m128d s1[XOVER_STAGES], s2[XOVER_STAGES];
+   __m128d xv;
+   int l;
+
+   for (l = 0; l < XOVER_BANDS; l += 2) {
+      if (l >= xo->bands) {
+         for (i = 0; i < n; i++)
+            _mm_storel_pi((__m64*)(y + XOVER_BANDS*i + l), _mm_setzero_ps());
+         continue;
+      }
+      for (k = 0; k < XOVER_STAGES; k++) {
+         s1[k] = _mm_loadu_pd(xo->stage[k].s1 + l);
+         s2[k] = _mm_loadu_pd(xo->stage[k].s2 + l);
+      }
+      for (i = 0; i < n; i++) {
+         xv = _mm_set1_pd(x[i]);
+         xv = biquad2(&xo->stage[0], l, &s1[0], &s2[0], xv);
+         xv = biquad2(&xo->stage[1], l, &s1[1], &s2[1], xv);
+         xv = biquad2(&xo->stage[2], l, &s1[2], &s2[2], xv);
+         xv = biquad2(&xo->stage[3], l, &s1[3], &s2[3], xv);
+         xv = biquad2(&xo->stage[4], l, &s1[4], &s2[4], xv);
+         xv = biquad2(&xo->stage[5], l, &s1[5], &s2[5], xv);
+         _mm_storel_pi((__m64*)(y + XOVER_BANDS*i + l), _mm_cvtpd_ps(xv));
+      }
+      for (k = 0; k < XOVER_STAGES; k++) {
+         _mm_storeu_pd(xo->stage[k].s1 + l, s1[k]);
+         _mm_storeu_pd(xo->stage[k].s2 + l, s2[k]);
+      }
+   }
+#else
+   int b;
+   double v, w;
+
+   for (i = 0; i < n; i++) {
+      for (b = 0; b < XOVER_BANDS; b++) {
+         if (b >= xo->bands) {
+            y[XOVER_BANDS*i + b] = 0;
+            continue;
+         }
+         v = x[i];
+         for (k = 0; k < XOVER_STAGES; k++) {
+            XoverStage* st = &xo->stage[k];
+            w = st->b0[b]*v + st->s1[b];
+            st->s1[b] = (st->b1[b]*v + st->s2[b]) - st->a1[b]*w;
+            st->s2[b] = st->b2[b]*v - st->a2[b]*w;
+            v = w;
+         }
+         y[XOVER_BANDS*i + b] = v;
+      }
+   }
+#endif
+
+   /* The states decay through denormals in silence */
+   for (k = 0; k < XOVER_STAGES; k++) {
+      XoverStage* st = &xo->stage[k];
+      for (i = 0; i < XOVER_BANDS; i++) {
+         st->s1[i] = fabs(st->s1[i]) < 1e-20 ? 0 : st->s1[i];
+         st->s2[i] = fabs(st->s2[i]) < 1e-20 ? 0 : st->s2[i];
+      }
+   }
+}
+
+
+void xover_process(Xover* xo, const float* x, float* y, uint32_t n) {
+   uint32_t pos, len;
+
+   for (pos = 0; pos < n; pos += len) {
+      len = MIN(n - pos, XOVER_CHUNK);
+      process_chunk(xo, x + pos, y + XOVER_BANDS*pos, len);
+   }
+}
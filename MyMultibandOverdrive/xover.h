@@ -0,0 +1,72 @@
+#ifndef XOVER_H
+#define XOVER_H
+
+#include <stdint.h>
+
+#define XOVER_BANDS 4
+#define XOVER_SPLITS (XOVER_BANDS - 1)
+
+/** Biquads in a row per band: two for each split. */
+#define XOVER_STAGES (2*XOVER_SPLITS)
+
+/** Samples processed at a time with the states in registers. */
+#define XOVER_CHUNK 64
+
+/**
+   A Linkwitz-Riley crossover of 24 dB/octave into up to XOVER_BANDS bands,
+   all computed at once, one band per lane of four floats.
+
+   The usual tree splits the signal at the first frequency and splits the
+   upper part again, so each band sees a different number of filters.
+   Here every band is a row of XOVER_STAGES biquads with coefficients of
+   its own.  At split k, band b < k takes the allpass of split k, b = k the
+   low-pass and b > k the high-pass, and the biquads of unused splits pass
+   the signal through.  The low-pass and high-pass of a split are squared
+   Butterworth filters, which sum to that allpass, so the bands sum to the
+   input through the allpasses of all splits: flat in magnitude, with the
+   phase of the splits, as in the tree.  The row is the same for every
+   band, so with SSE2 two bands take the arithmetic of one.
+
+   The filters run in double.  At a low split the poles sit near z = 1 and
+   1 + a1 + a2, the gain at DC, is of the order of w0^2, so in float the
+   rounding of a1 and a2 alone moves the Q: the sum of the bands dipped
+   3e-3 around a 100 Hz split at 96 kHz, and more at lower splits.  A register
+   holds two lanes of double, so bands 2 and 3 cost a second pass, which
+   is skipped when they are not in use.
+*/
+typedef struct {
+   double b0[XOVER_BANDS];
+   double b1[XOVER_BANDS];
+   double b2[XOVER_BANDS];
+   double a1[XOVER_BANDS];
+   double a2[XOVER_BANDS];
+   double s1[XOVER_BANDS];    // transposed direct form II states
+   double s2[XOVER_BANDS];
+} XoverStage;
+
+typedef struct {
+   XoverStage stage[XOVER_STAGES];
+   int   bands;
+   float freq[XOVER_SPLITS];
+   double rate;
+} Xover;
+
+void xover_init(Xover* xo, double rate);
+
+/** Clear the filter states. */
+void xover_reset(Xover* xo);
+
+/**
+   Use 2 - XOVER_BANDS bands split at freq[0] < freq[1] ... (Hz): only
+   recomputes the coefficients when these change.  Frequencies are kept
+   below 0.45 of the rate and each at least the one before it.
+*/
+void xover_set(Xover* xo, int bands, const float* freq);
+
+/**
+   Band b of x[i] in y[XOVER_BANDS*i + b], i < n, zero for the bands not
+   in use.
+*/
+void xover_process(Xover* xo, const float* x, float* y, uint32_t n);
+
+#endif
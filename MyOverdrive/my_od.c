@@ -13,6 +13,8 @@
 */
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 
+#include "od_clip.h"
+
 /**
    The URI is the identifier for a plugin, and how the host associates this
    implementation in code with its description in data. If this URI does not
@@ -40,6 +42,8 @@ typedef struct {
    const float* input;    // lv2 audio port;
    float*       output;   // lv2 audio port;
    const float* th;     // lv2 control port
+   OdClip clip;         // curve for last_th
+   float last_th;
 } Od;
 
 // /**
@@ -83,10 +87,9 @@ connect_port(LV2_Handle instance,
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
-	uint32_t pos;
    float th;
    float a, c, d, e;
-	const Od* od = (Od*)instance;
+	Od* od = (Od*)instance;
 	const float* const input  = od->input;
 	float* const       output = od->output;
 
@@ -97,35 +100,19 @@ run(LV2_Handle instance, uint32_t n_samples)
 		return;
 	}
 
-   th = 1.0 - *(od->th);
-
-   a = 2/((2 + th) * th);
-   c = -1/((2 + th) * th);
-   d = 4/(2 + th);
-   e = (2 - 3*th)/(2 + th);
-
-	for (pos = 0; pos < n_samples; pos++) {
-		if (fabs(input[pos]) > 2*th) {
-			if (input[pos] > 0) {
-				output[pos] = 1;
-         }
-			if (input[pos] < 0) {
-				output[pos] = -1;
-         }
-      }
-      else if (fabs(input[pos]) < th) {
-         output[pos] = a*input[pos];
-      }
-      else /*(fabs(input[pos]) >= th)*/ {
-         if (input[pos] > 0) {
-            output[pos] = e + (d * input[pos]) + (c * pow(input[pos], 2));
-         }
-         if (input[pos] < 0) {
-            output[pos] = (-1 * (e - (d * input[pos]) + (c * pow(input[pos], 2))));
-         }
-      }
-	}
+   if (*(od->th) != od->last_th) {
+      th = 1.0 - *(od->th);
+
+      a = 2/((2 + th) * th);
+      c = -1/((2 + th) * th);
+      d = 4/(2 + th);
+      e = (2 - 3*th)/(2 + th);
 
+      od_clip_set(&od->clip, th, 2*th, a, c, d, e, 1);
+      od->last_th = *(od->th);
+   }
+
+   od_clip_process(&od->clip, input, output, n_samples);
 }
 
 /**
@@ -147,6 +134,11 @@ instantiate(const LV2_Descriptor*     descriptor,
 {
 	Od* od = (Od*)malloc(sizeof(Od));
 
+   if (od == NULL)
+      return NULL;
+
+   od->last_th = NAN;
+
 	return (LV2_Handle)od;
 }
 
@@ -0,0 +1,14 @@
+/**
+   run() against the loop it replaced (od_ref() in test/od_ref.c) at 64,
+   512 and 4096-frame blocks, ports at 0.5: the rows of the table in
+   ../Common/README.txt.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "od_bench.h"
+
+int main(void) {
+   float ctl[4] = {0, 0, 0.5, 0.5};
+
+   return od_bench_table("MyOverdrive", ctl, 3);
+}
@@ -0,0 +1,43 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+
+#include "od_bench.h"
+
+/** run() before od_clip.h, "th" at ctl[2]. */
+void od_ref(const float* input, float* output, uint32_t n_samples,
+            const float* ctl) {
+	uint32_t pos;
+   float th;
+   float a, c, d, e;
+
+   th = 1.0 - ctl[2];
+
+   a = 2/((2 + th) * th);
+   c = -1/((2 + th) * th);
+   d = 4/(2 + th);
+   e = (2 - 3*th)/(2 + th);
+
+	for (pos = 0; pos < n_samples; pos++) {
+		if (fabs(input[pos]) > 2*th) {
+			if (input[pos] > 0) {
+				output[pos] = 1;
+         }
+			if (input[pos] < 0) {
+				output[pos] = -1;
+         }
+      }
+      else if (fabs(input[pos]) < th) {
+         output[pos] = a*input[pos];
+      }
+      else /*(fabs(input[pos]) >= th)*/ {
+         if (input[pos] > 0) {
+            output[pos] = e + (d * input[pos]) + (c * pow(input[pos], 2));
+         }
+         if (input[pos] < 0) {
+            output[pos] = (-1 * (e - (d * input[pos]) + (c * pow(input[pos], 2))));
+         }
+      }
+	}
+
+}
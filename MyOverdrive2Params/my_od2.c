@@ -13,6 +13,8 @@
 */
 #include "lv2/lv2plug.in/ns/lv2core/lv2.h"
 
+#include "od_clip.h"
+
 /**
    The URI is the identifier for a plugin, and how the host associates this
    implementation in code with its description in data. If this URI does not
@@ -43,6 +45,9 @@ typedef struct {
    float*       output;   // lv2 audio port;
    const float* th;     // lv2 control port
    const float* th2;     // lv2 control port
+   OdClip clip;          // curve for last_th and last_th2
+   float last_th;
+   float last_th2;
 } Od2;
 
 // /**
@@ -89,10 +94,9 @@ connect_port(LV2_Handle instance,
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
-	uint32_t pos;
    float th, th2, percentage;
    float a, b, c, d, e;
-	const Od2* od2 = (Od2*)instance;
+	Od2* od2 = (Od2*)instance;
 	const float* const input  = od2->input;
 	float* const       output = od2->output;
 
@@ -103,44 +107,29 @@ run(LV2_Handle instance, uint32_t n_samples)
 		return;
 	}
 
-   th = 1.0 - *(od2->th);
-   /*if (th == 0.0) th = nextafterf(th, 1.0);
-   if (th == 1.0) th = nextafterf(th, 0.0);*/
-
-   percentage = 1.0 - *(od2->th2);
-   th2 = th + percentage*(1.0 - th);
-   if (th2 == (1.0 - sqrt(1.0 - pow(th, 2))))
-      th2 = nextafterf(th2, nextafterf(1.0, 0.0)); //nextafterf(1.0, 0.0) returns the largest representable number less than 1.0;
-
-   b = 0;
-
-   e = (pow(th, 2) - 2*b*(th2 - pow(th2, 2)/2)) / (pow(th, 2) - 2*(th2 - pow(th2, 2)/2));
-   d = 2*(b - e)/pow(th, 2);
-   c = -d/2;
-   a = d + 2*th*c;
-
-	for (pos = 0; pos < n_samples; pos++) {
-		if (fabs(input[pos]) > th2) {
-			if (input[pos] > 0) {
-				output[pos] = 1;
-         }
-			if (input[pos] < 0) {
-				output[pos] = -1;
-         }
-      }
-      else if (fabs(input[pos]) < th) {
-         output[pos] = a*input[pos];
-      }
-      else /*th <= fabs(input[pos]) <= th2*/ {
-         if (input[pos] > 0) {
-            output[pos] = e + (d * input[pos]) + (c * pow(input[pos], 2));
-         }
-         if (input[pos] < 0) {
-            output[pos] = (-1 * (e - (d * input[pos]) + (c * pow(input[pos], 2))));
-         }
-      }
-	}
+   if (*(od2->th) != od2->last_th || *(od2->th2) != od2->last_th2) {
+      th = 1.0 - *(od2->th);
+      /*if (th == 0.0) th = nextafterf(th, 1.0);
+      if (th == 1.0) th = nextafterf(th, 0.0);*/
+
+      percentage = 1.0 - *(od2->th2);
+      th2 = th + percentage*(1.0 - th);
+      if (th2 == (1.0 - sqrt(1.0 - pow(th, 2))))
+         th2 = nextafterf(th2, nextafterf(1.0, 0.0)); //nextafterf(1.0, 0.0) returns the largest representable number less than 1.0;
+
+      b = 0;
 
+      e = (pow(th, 2) - 2*b*(th2 - pow(th2, 2)/2)) / (pow(th, 2) - 2*(th2 - pow(th2, 2)/2));
+      d = 2*(b - e)/pow(th, 2);
+      c = -d/2;
+      a = d + 2*th*c;
+
+      od_clip_set(&od2->clip, th, th2, a, c, d, e, 1);
+      od2->last_th = *(od2->th);
+      od2->last_th2 = *(od2->th2);
+   }
+
+   od_clip_process(&od2->clip, input, output, n_samples);
 }
 
 /**
@@ -162,6 +151,12 @@ instantiate(const LV2_Descriptor*     descriptor,
 {
 	Od2* od2 = (Od2*)malloc(sizeof(Od2));
 
+   if (od2 == NULL)
+      return NULL;
+
+   od2->last_th = NAN;
+   od2->last_th2 = NAN;
+
 	return (LV2_Handle)od2;
 }
 
@@ -0,0 +1,50 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+
+#include "od_bench.h"
+
+/** run() before od_clip.h, "th" and "th2" at ctl[2] and ctl[3]. */
+void od_ref(const float* input, float* output, uint32_t n_samples,
+            const float* ctl) {
+	uint32_t pos;
+   float th, th2, percentage;
+   float a, b, c, d, e;
+
+   th = 1.0 - ctl[2];
+
+   percentage = 1.0 - ctl[3];
+   th2 = th + percentage*(1.0 - th);
+   if (th2 == (1.0 - sqrt(1.0 - pow(th, 2))))
+      th2 = nextafterf(th2, nextafterf(1.0, 0.0)); //nextafterf(1.0, 0.0) returns the largest representable number less than 1.0;
+
+   b = 0;
+
+   e = (pow(th, 2) - 2*b*(th2 - pow(th2, 2)/2)) / (pow(th, 2) - 2*(th2 - pow(th2, 2)/2));
+   d = 2*(b - e)/pow(th, 2);
+   c = -d/2;
+   a = d + 2*th*c;
+
+	for (pos = 0; pos < n_samples; pos++) {
+		if (fabs(input[pos]) > th2) {
+			if (input[pos] > 0) {
+				output[pos] = 1;
+         }
+			if (input[pos] < 0) {
+				output[pos] = -1;
+         }
+      }
+      else if (fabs(input[pos]) < th) {
+         output[pos] = a*input[pos];
+      }
+      else /*th <= fabs(input[pos]) <= th2*/ {
+         if (input[pos] > 0) {
+            output[pos] = e + (d * input[pos]) + (c * pow(input[pos], 2));
+         }
+         if (input[pos] < 0) {
+            output[pos] = (-1 * (e - (d * input[pos]) + (c * pow(input[pos], 2))));
+         }
+      }
+	}
+
+}
@@ -0,0 +1,46 @@
+/**
+   run() against the loop it replaced (od_ref() in test/od_ref.c) over
+   "th" 0.001 - 0.999 and "th2" 0 - 1, on inputs from -1.25 to 1.25.  The
+   curve's th is 1 - "th", and as it approaches 1 the quadratic piece
+   spans 1 - th of input with coefficients near 1/(1 - th), so the
+   rounding of either loop grows: within MAX_ERROR for "th" above 0.05
+   (th below 0.95) and MAX_ERROR_STEEP up to th = 0.999.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include "od_bench.h"
+
+/* Largest difference from the old loop, for th below 0.95 and up to 0.999 */
+#define MAX_ERROR       1e-6
+#define MAX_ERROR_STEEP 6e-5
+
+static int failures = 0;
+
+int main(void) {
+   static const float ths[] = {0.001, 0.01, 0.05, 0.1, 0.37, 0.63, 0.9,
+                               0.99, 0.999};
+   static const float th2s[] = {0, 0.01, 0.25, 0.5, 0.9, 1};
+   float ctl[4];
+   double err, bound;
+   int t, u;
+
+   printf("largest difference from the old loop\n  th      ");
+   for (u = 0; u < (int)(sizeof(th2s)/sizeof(th2s[0])); u++)
+      printf("th2 %-5g", th2s[u]);
+   printf("\n");
+   for (t = 0; t < (int)(sizeof(ths)/sizeof(ths[0])); t++) {
+      ctl[2] = ths[t];
+      bound = ctl[2] > 0.05f ? MAX_ERROR : MAX_ERROR_STEEP;
+      printf("  %-6g", ctl[2]);
+      for (u = 0; u < (int)(sizeof(th2s)/sizeof(th2s[0])); u++) {
+         ctl[3] = th2s[u];
+         err = od_bench_diff(ctl, 4);
+         printf("  %.1e", err);
+         CHECK(err >= 0 && err <= bound, "th %g, th2 %g: %.2g", ctl[2],
+               ctl[3], err);
+      }
+      printf("\n");
+   }
+
+   return failures ? 1 : 0;
+}
@@ -0,0 +1,380 @@
+
+/** Include standard C headers */
+#include <math.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+   LV2 headers are based on the URI of the specification they come from, so a
+   consistent convention can be used even for unofficial extensions.  The URI
+   of the core LV2 specification is <http://lv2plug.in/ns/lv2core>, by
+   replacing `http:/` with `lv2` any header in the specification bundle can be
+   included, in this case `lv2.h`.  The state extension lets the host save
+   the curve with a session or preset, and give it back.
+*/
+#include "lv2/lv2plug.in/ns/lv2core/lv2.h"
+#include "lv2/lv2plug.in/ns/ext/atom/atom.h"
+#include "lv2/lv2plug.in/ns/ext/state/state.h"
+#include "lv2/lv2plug.in/ns/ext/urid/urid.h"
+
+#include "ws_curve.h"
+
+/**
+   The URI is the identifier for a plugin, and how the host associates this
+   implementation in code with its description in data. If this URI does not
+   match that used in the data files, the host will fail to load the plugin.
+*/
+#define WS_URI "www.linux.ime.usp.br/~vitorsamora/mac0499/my-waveshaper.lv2"
+
+/** The state property holding the text of the curve, an atom:String. */
+#define WS__curve WS_URI "#curve"
+
+/** The curve loaded when there is no state, in the bundle directory. */
+#define WS_CURVE_FILE "curve.txt"
+
+/**
+   In the code, ports are referred to by index.  An enumeration of port indices
+   should be defined for readability. They need to match the definitions in the
+   *.ttl file.
+*/
+typedef enum {
+	INPUT  = 0,
+	OUTPUT = 1,
+   GAIN = 2,
+   LEVEL = 3
+} PortIndex;
+
+/**
+   Define a private structure for the plugin instance.  All data
+   associated with a plugin instance is stored here, and is available to
+   every instance method, being passed back through the 'instance' parameter.
+**/
+typedef struct {
+   const float* input;    // lv2 audio port;
+   float*       output;   // lv2 audio port;
+   const float* gain;     // lv2 control port
+   const float* level;    // lv2 control port
+   WsCurve curve;
+   LV2_URID curve_key;    // 0 without urid:map, and then no state
+   LV2_URID atom_string;
+} Waveshaper;
+
+// /**
+//    The `connect_port()` method is called by the host to connect a particular
+//    port to a buffer.  The plugin must store the data location, but data may not
+//    be accessed except in run().
+
+//    This method is in the ``audio'' threading class, and is called in the same
+//    context as run().
+// */
+static void
+connect_port(LV2_Handle instance,
+             uint32_t   port,
+             void*      data)
+{
+	Waveshaper* ws = (Waveshaper*)instance;
+	if (ws == NULL ) {
+		return;
+	}
+
+	switch ((PortIndex)port) {
+   case INPUT:
+      ws->input = (const float*)data;
+      break;
+   case OUTPUT:
+      ws->output = (float*)data;
+      break;
+   case GAIN:
+      ws->gain = (const float*)data;
+      break;
+   case LEVEL:
+      ws->level = (const float*)data;
+      break;
+   }
+}
+
+/**
+   The `run()` method is the main process function of the plugin.  It processes
+   a block of audio in the audio context.  Since this plugin is
+   `lv2:hardRTCapable`, `run()` must be real-time safe, so blocking (e.g. with
+   a mutex) or memory allocation are not allowed.
+
+   The curve was compiled into a table before, so any curve costs the same
+   here: a clamp, a lookup and a linear interpolation per sample.
+*/
+static void
+run(LV2_Handle instance, uint32_t n_samples)
+{
+	Waveshaper* ws = (Waveshaper*)instance;
+
+	if (ws == NULL) {
+		fprintf(stderr, "MY_WS: run() called with NULL instance parameter.\n");
+		return;
+	}
+
+   ws_curve_process(&ws->curve, ws->input, ws->output, n_samples,
+                    *(ws->gain), *(ws->level));
+}
+
+/** Read a whole file into a string, NULL if it cannot. */
+static char*
+read_file(const char* path)
+{
+   FILE* f = fopen(path, "rb");
+   char* text = NULL;
+   long size;
+
+   if (f == NULL)
+      return NULL;
+   if (fseek(f, 0, SEEK_END) == 0 && (size = ftell(f)) >= 0 &&
+       fseek(f, 0, SEEK_SET) == 0) {
+      text = malloc(size + 1);
+      if (text != NULL && fread(text, 1, size, f) == (size_t)size) {
+         text[size] = '\0';
+      }
+      else {
+         free(text);
+         text = NULL;
+      }
+   }
+   fclose(f);
+   return text;
+}
+
+/** Compile `text` into the instance's curve, reporting errors as `name`. */
+static int
+load_curve(Waveshaper* ws, const char* text, const char* name)
+{
+   int line;
+   WsCurveStatus status = ws_curve_compile(&ws->curve, text, &line);
+
+   if (status == WS_CURVE_OK)
+      return 0;
+   if (line > 0)
+      fprintf(stderr, "MY_WS: %s:%d: %s.\n", name, line,
+              ws_curve_strerror(status));
+   else
+      fprintf(stderr, "MY_WS: %s: %s.\n", name, ws_curve_strerror(status));
+   return -1;
+}
+
+/**
+   The `instantiate()` function is called by the host to create a new plugin
+   instance.  The host passes the plugin descriptor, sample rate, and bundle
+   path for plugins that need to load additional resources (e.g. waveforms).
+   The features parameter contains host-provided features defined in LV2
+   extensions; urid:map is needed only to save and restore the curve.
+
+   Here the curve in the bundle is read and compiled, so the instance can
+   run before, or without, any state being restored.
+
+   This function is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static LV2_Handle
+instantiate(const LV2_Descriptor*     descriptor,
+            double                    rate,
+            const char*               bundle_path,
+            const LV2_Feature* const* features
+	    )
+{
+   int i, err;
+   char* path;
+   char* text;
+   LV2_URID_Map* map = NULL;
+	Waveshaper* ws = (Waveshaper*)calloc(1, sizeof(Waveshaper));
+
+   if (ws == NULL) {
+      fprintf(stderr, "MY_WS: out of memory.\n");
+      return NULL;
+   }
+
+   for (i = 0; features != NULL && features[i] != NULL; i++) {
+      if (strcmp(features[i]->URI, LV2_URID__map) == 0)
+         map = (LV2_URID_Map*)features[i]->data;
+   }
+   if (map != NULL) {
+      ws->curve_key = map->map(map->handle, WS__curve);
+      ws->atom_string = map->map(map->handle, LV2_ATOM__String);
+   }
+
+   /* The bundle path ends with a directory separator */
+   path = malloc(strlen(bundle_path) + strlen(WS_CURVE_FILE) + 1);
+   if (path == NULL) {
+      fprintf(stderr, "MY_WS: out of memory.\n");
+      free(ws);
+      return NULL;
+   }
+   strcpy(path, bundle_path);
+   strcat(path, WS_CURVE_FILE);
+   text = read_file(path);
+   if (text == NULL) {
+      fprintf(stderr, "MY_WS: cannot read %s.\n", path);
+      free(path);
+      free(ws);
+      return NULL;
+   }
+   err = load_curve(ws, text, path);
+   free(text);
+   free(path);
+   if (err != 0) {
+      free(ws);
+      return NULL;
+   }
+
+	return (LV2_Handle)ws;
+}
+
+/**
+   The `activate()` method is called by the host to initialise and prepare the
+   plugin instance for running.  The plugin must reset all internal state
+   except for buffer locations set by `connect_port()`.  Since this plugin has
+   no other internal state, this method does nothing.
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+activate(LV2_Handle instance)
+{
+}
+
+/**
+   The `deactivate()` method is the counterpart to `activate()`, and is called by
+   the host after running the plugin.  It indicates that the host will not call
+   `run()` again until another call to `activate()` and is mainly useful for more
+   advanced plugins with ``live'' characteristics such as those with auxiliary
+   processing threads.  As with `activate()`, this plugin has no use for this
+   information so this method does nothing.
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+deactivate(LV2_Handle instance)
+{
+}
+
+
+/**
+   Destroy a plugin instance (counterpart to `instantiate()`).
+
+   This method is in the ``instantiation'' threading class, so no other
+   methods on this instance will be called concurrently with it.
+*/
+static void
+cleanup(LV2_Handle instance)
+{
+   Waveshaper* ws = (Waveshaper*)instance;
+
+   ws_curve_free(&ws->curve);
+	free(instance);
+}
+
+/**
+   Save the text of the curve.  This may be called concurrently with `run()`,
+   which only reads the table; the text is not changed but by `restore()`.
+*/
+static LV2_State_Status
+save(LV2_Handle                instance,
+     LV2_State_Store_Function  store,
+     LV2_State_Handle          handle,
+     uint32_t                  flags,
+     const LV2_Feature* const* features)
+{
+   Waveshaper* ws = (Waveshaper*)instance;
+
+   if (ws->curve_key == 0)
+      return LV2_STATE_ERR_NO_FEATURE;
+
+   return store(handle, ws->curve_key, ws->curve.text,
+                strlen(ws->curve.text) + 1, ws->atom_string,
+                LV2_STATE_IS_POD | LV2_STATE_IS_PORTABLE);
+}
+
+/**
+   Compile the curve given back by the host.  This is in the
+   ``instantiation'' threading class, not concurrent with `run()`, so the
+   table is replaced in place; a curve that does not compile leaves the
+   current one.
+*/
+static LV2_State_Status
+restore(LV2_Handle                  instance,
+        LV2_State_Retrieve_Function retrieve,
+        LV2_State_Handle            handle,
+        uint32_t                    flags,
+        const LV2_Feature* const*   features)
+{
+   Waveshaper* ws = (Waveshaper*)instance;
+   const char* value;
+   size_t size;
+   uint32_t type, vflags;
+
+   if (ws->curve_key == 0)
+      return LV2_STATE_ERR_NO_FEATURE;
+
+   value = retrieve(handle, ws->curve_key, &size, &type, &vflags);
+   if (value == NULL)
+      return LV2_STATE_ERR_NO_PROPERTY;
+   if (type != ws->atom_string || size == 0 || value[size - 1] != '\0')
+      return LV2_STATE_ERR_BAD_TYPE;
+
+   return load_curve(ws, value, "state") == 0 ? LV2_STATE_SUCCESS
+                                              : LV2_STATE_ERR_UNKNOWN;
+}
+
+/**
+   The `extension_data()` function returns any extension data supported by the
+   plugin.  Note that this is not an instance method, but a function on the
+   plugin descriptor.  It is usually used by plugins to implement additional
+   interfaces.  This plugin implements the state interface.
+
+   This method is in the ``discovery'' threading class, so no other functions
+   or methods in this plugin library will be called concurrently with it.
+*/
+static const void*
+extension_data(const char* uri)
+{
+   static const LV2_State_Interface state = { save, restore };
+
+   if (strcmp(uri, LV2_STATE__interface) == 0)
+      return &state;
+	return NULL;
+}
+
+/**
+   Every plugin must define an `LV2_Descriptor`.  It is best to define
+   descriptors statically to avoid leaking memory and non-portable shared
+   library constructors and destructors to clean up properly.
+*/
+static const LV2_Descriptor descriptor = {
+	WS_URI,
+	instantiate,
+	connect_port,
+	activate,
+	run,
+	deactivate,
+	cleanup,
+	extension_data
+};
+
+/**
+   The `lv2_descriptor()` function is the entry point to the plugin library.  The
+   host will load the library and call this function repeatedly with increasing
+   indices to find all the plugins defined in the library.  The index is not an
+   indentifier, the URI of the returned descriptor is used to determine the
+   identify of the plugin.
+
+   This method is in the ``discovery'' threading class, so no other functions
+   or methods in this plugin library will be called concurrently with it.
+*/
+LV2_SYMBOL_EXPORT
+const LV2_Descriptor*
+lv2_descriptor(uint32_t index)
+{
+	switch (index) {
+	case 0:  return &descriptor;
+	default: return NULL;
+	}
+}
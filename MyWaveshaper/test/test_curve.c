@@ -0,0 +1,212 @@
+/**
+   The curve compiler (ws_curve.c): the numbers it reads, in any locale;
+   the lines it rejects, with their line numbers, among them points and
+   pieces that break "odd"; the shipped DAFX curve against its formula
+   within the 3e-7 of README.txt; and the SSE and scalar paths of
+   ws_curve_process() against each other.
+*/
+#define _POSIX_C_SOURCE 200809L
+
+#include <locale.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ws_curve.h"
+
+#define N WS_CURVE_POINTS
+
+/** Report a failed check and count it. */
+#define CHECK(cond, ...)                                  \
+   do {                                                   \
+      if (!(cond)) {                                      \
+         fprintf(stderr, "%s:%d: ", __FILE__, __LINE__);  \
+         fprintf(stderr, __VA_ARGS__);                    \
+         fprintf(stderr, "\n");                           \
+         failures++;                                      \
+      }                                                   \
+   } while (0)
+
+static int failures = 0;
+
+static const char dafx[] =
+   "odd\n"
+   "poly 0          0.33333333 0 2\n"
+   "poly 0.33333333 0.66666667 -0.33333333 4 -3\n"
+   "poly 0.66666667 1          1\n";
+
+/** The constant curve `number`, read back from the table. */
+static void
+check_number(const char* number, double value)
+{
+   WsCurve curve = {NULL, NULL};
+   char text[64];
+   int line;
+
+   snprintf(text, sizeof(text), "poly -1 1 %s", number);
+   CHECK(ws_curve_compile(&curve, text, &line) == WS_CURVE_OK,
+         "\"%s\" rejected", number);
+   if (curve.table)
+      CHECK(curve.table[0] == (float)value, "\"%s\" read as %.9g",
+            number, curve.table[0]);
+   ws_curve_free(&curve);
+}
+
+static void
+test_numbers(void)
+{
+   static const char* bad[] = {
+      "1,5", "0x10", "1.5.2", "1e", "e5", ".", "-", "+-1", "nan", "inf",
+      "1.5x", "1.5-2", "1e999"
+   };
+   static const char* commas[] = {
+      "de_DE.UTF-8", "de_DE.utf8", "de_DE", "fr_FR.UTF-8", "fr_FR", "French"
+   };
+   WsCurve curve = {NULL, NULL};
+   char text[64];
+   int i, line;
+
+   check_number("0.25", 0.25);
+   check_number("+.5", 0.5);
+   check_number("-1.", -1);
+   check_number("2.5e-1", 0.25);
+   check_number("25E-2", 0.25);
+   check_number("0.000125e3", 0.125);
+   check_number("-0.33333333", -0.33333333);
+   check_number("12345678901234567890e-20", 0.12345678901234567890);
+
+   for (i = 0; i < (int)(sizeof(bad)/sizeof(bad[0])); i++) {
+      snprintf(text, sizeof(text), "# a number\npoly -1 1 %s", bad[i]);
+      CHECK(ws_curve_compile(&curve, text, &line) == WS_CURVE_SYNTAX &&
+            line == 2, "\"%s\" not rejected at line 2", bad[i]);
+   }
+
+   /* The decimal point of the C format, whatever LC_NUMERIC says */
+   for (i = 0; i < (int)(sizeof(commas)/sizeof(commas[0])); i++)
+      if (setlocale(LC_NUMERIC, commas[i]) != NULL)
+         break;
+   if (i < (int)(sizeof(commas)/sizeof(commas[0]))) {
+      printf("numbers under LC_NUMERIC=%s\n", commas[i]);
+      check_number("0.25", 0.25);
+      check_number("-1.5e-1", -0.15);
+      setlocale(LC_NUMERIC, "C");
+   }
+   else {
+      printf("no locale with a decimal comma installed\n");
+   }
+   ws_curve_free(&curve);
+}
+
+/** `text` fails with `status` at `line` and leaves the curve as it was. */
+static void
+check_error(const char* text, WsCurveStatus status, int line)
+{
+   WsCurve curve = {NULL, NULL};
+   const float* table;
+   WsCurveStatus got;
+   int at;
+
+   ws_curve_compile(&curve, dafx, &at);
+   table = curve.table;
+   got = ws_curve_compile(&curve, text, &at);
+   CHECK(got == status && at == line, "\"%s\": %s at line %d, not at %d",
+         text, ws_curve_strerror(got), at, line);
+   CHECK(curve.table == table, "\"%s\" changed the curve", text);
+   ws_curve_free(&curve);
+}
+
+static void
+test_errors(void)
+{
+   check_error("odd\npoint 0.5 0.5\npoint 0 0.1\npoint 1 1",
+               WS_CURVE_SYNTAX, 3);
+   check_error("point -0.5 -0.4\npoint 1 1\nodd", WS_CURVE_SYNTAX, 1);
+   check_error("odd\n\npoly -1 1 0 1", WS_CURVE_SYNTAX, 3);
+   check_error("odd\npoly 0 1 0.1 1", WS_CURVE_SYNTAX, 2);
+   check_error("poly 0 1 0.1 1\nodd", WS_CURVE_SYNTAX, 1);
+   check_error("poly 1 0 0", WS_CURVE_SYNTAX, 1);
+   check_error("pole 0 1 0", WS_CURVE_SYNTAX, 1);
+   check_error("odd 1", WS_CURVE_SYNTAX, 1);
+   check_error("point 0 0\npoint 1 1", WS_CURVE_GAP, 0);
+}
+
+/** Odd curves that pass through 0, and a monotone cubic through steps. */
+static void
+test_shapes(void)
+{
+   static const char* odd[] = {
+      "odd\npoint 0 0\npoint 0.3 0.8\npoint 1 1",
+      "odd\npoint 0.3 0.8\npoint 1 1",
+      "odd\npoly 0 1 0 1.5 0 -0.5",
+      "odd\npoly 0.5 1 1\npoint 0.25 0.7\npoint 0.5 1"
+   };
+   WsCurve curve = {NULL, NULL};
+   int i, k, line, rising = 1;
+
+   for (k = 0; k < (int)(sizeof(odd)/sizeof(odd[0])); k++) {
+      CHECK(ws_curve_compile(&curve, odd[k], &line) == WS_CURVE_OK,
+            "\"%s\" rejected at line %d", odd[k], line);
+      for (i = 0; curve.table && i < N; i++)
+         if (curve.table[2*i] != -curve.table[2*(N - 1 - i)])
+            break;
+      CHECK(i == N, "\"%s\" is not odd at point %d", odd[k], i);
+   }
+
+   CHECK(ws_curve_compile(&curve, "point -1 -1\npoint -0.2 -0.9\n"
+                          "point 0 0\npoint 0.1 0.95\npoint 1 1", &line) ==
+         WS_CURVE_OK, "steps rejected at line %d", line);
+   for (i = 1; curve.table && i < N; i++)
+      rising &= curve.table[2*i] >= curve.table[2*(i - 1)];
+   CHECK(rising, "the cubic through rising points falls");
+   ws_curve_free(&curve);
+}
+
+static double
+dafx_f(double x)
+{
+   const double a = fabs(x);
+   const double y = a < 1/3.0 ? 2*a
+                  : a < 2/3.0 ? (3 - (2 - 3*a)*(2 - 3*a))/3 : 1;
+
+   return x < 0 ? -y : y;
+}
+
+/** The shipped curve against its formula, SSE against scalar. */
+static void
+test_dafx(void)
+{
+   enum { M = 1 << 16 };
+   static float x[M], y[M], s[M];
+   WsCurve curve = {NULL, NULL};
+   double err, worst = 0;
+   int i, line;
+
+   CHECK(ws_curve_compile(&curve, dafx, &line) == WS_CURVE_OK,
+         "the DAFX curve rejected at line %d", line);
+   if (curve.table == NULL)
+      return;
+   for (i = 0; i < M; i++)
+      x[i] = -1.25 + 2.5*i/(M - 1);
+   ws_curve_process(&curve, x, y, M, 1, 1);
+   for (i = 0; i < M; i++) {
+      ws_curve_process(&curve, x + i, s + i, 1, 1, 1);
+      err = fabs(y[i] - dafx_f(x[i] < -1 ? -1 : x[i] > 1 ? 1 : x[i]));
+      worst = err > worst ? err : worst;
+   }
+   printf("DAFX curve, largest error %.2g\n", worst);
+   CHECK(worst <= 3e-7, "DAFX curve off by %g", worst);
+   CHECK(memcmp(y, s, sizeof(y)) == 0, "SSE and scalar paths differ");
+   ws_curve_free(&curve);
+}
+
+int
+main(void)
+{
+   test_numbers();
+   test_errors();
+   test_shapes();
+   test_dafx();
+
+   return failures ? 1 : 0;
+}
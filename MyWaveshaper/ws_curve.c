@@ -0,0 +1,447 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "ws_curve.h"
+
+#define N WS_CURVE_POINTS
+
+/* Table position of x = 0, and points per unit of x */
+#define ORIGIN ((N - 1)/2.0)
+#define SCALE  ((N - 1)/2.0)
+
+typedef struct {
+   double x;
+   double y;
+   double m;      // slope of the cubic at x
+   int    line;
+} Point;
+
+typedef struct {
+   double x0;
+   double x1;
+   double c[WS_CURVE_MAX_ORDER + 1];
+   int    order;
+   int    line;
+} Piece;
+
+typedef struct {
+   Point points[2*WS_CURVE_MAX_POINTS + 1];   // room for the mirror images
+   Piece pieces[WS_CURVE_MAX_PIECES];
+   int   n_points;
+   int   n_pieces;
+   int   odd;
+} Spec;
+
+
+/**
+   Read a number in the C format, whatever the locale: an optional sign,
+   digits with an optional '.', and an optional exponent.  Returns the end
+   of the number, or NULL if `s` does not start with one.  Digits past the
+   17th only scale the result.
+*/
+static const char*
+parse_number(const char* s, double* v)
+{
+   double m = 0;
+   int e = 0, x = 0, digits = 0, neg = 0, eneg = 0;
+
+   if (*s == '+' || *s == '-')
+      neg = *s++ == '-';
+   for (; *s >= '0' && *s <= '9'; s++, digits++) {
+      if (m < 1e16)
+         m = 10*m + (*s - '0');
+      else
+         e++;
+   }
+   if (*s == '.') {
+      for (s++; *s >= '0' && *s <= '9'; s++, digits++) {
+         if (m < 1e16) {
+            m = 10*m + (*s - '0');
+            e--;
+         }
+      }
+   }
+   if (digits == 0)
+      return NULL;
+
+   if (*s == 'e' || *s == 'E') {
+      s++;
+      if (*s == '+' || *s == '-')
+         eneg = *s++ == '-';
+      if (*s < '0' || *s > '9')
+         return NULL;
+      for (; *s >= '0' && *s <= '9'; s++)
+         if (x < 10000)
+            x = 10*x + (*s - '0');
+      e += eneg ? -x : x;
+   }
+
+   *v = (e < 0) ? m/pow(10, -e) : m*pow(10, e);
+   *v = neg ? -*v : *v;
+   return s;
+}
+
+
+/** Read up to `max` numbers from `s` into `v`; -1 if anything else is left. */
+static int
+parse_numbers(const char* s, double* v, int max)
+{
+   int n = 0;
+   const char* end;
+
+   for (;;) {
+      while (*s == ' ' || *s == '\t' || *s == '\r')
+         s++;
+      if (*s == '\0' || *s == '#')
+         return n;
+      if (n == max)
+         return -1;
+      end = parse_number(s, &v[n]);
+      if (end == NULL || !isfinite(v[n]) ||
+          (*end != '\0' && strchr(" \t\r#", *end) == NULL))
+         return -1;
+      n++;
+      s = end;
+   }
+}
+
+
+/** Parse one line, NUL terminated, into `spec`; -1 on an error. */
+static int
+parse_line(Spec* spec, const char* s, int line)
+{
+   double v[WS_CURVE_MAX_ORDER + 3];
+   size_t len;
+   int n, i;
+
+   while (*s == ' ' || *s == '\t')
+      s++;
+   len = strcspn(s, " \t\r#");
+   if (len == 0)
+      return 0;
+
+   if (len == 3 && strncmp(s, "odd", 3) == 0) {
+      spec->odd = 1;
+      return parse_numbers(s + len, v, 0) == 0 ? 0 : -1;
+   }
+   if (len == 5 && strncmp(s, "point", 5) == 0) {
+      if (spec->n_points == WS_CURVE_MAX_POINTS ||
+          parse_numbers(s + len, v, 2) != 2)
+         return -1;
+      spec->points[spec->n_points].x = v[0];
+      spec->points[spec->n_points].y = v[1];
+      spec->points[spec->n_points].line = line;
+      spec->n_points++;
+      return 0;
+   }
+   if (len == 4 && strncmp(s, "poly", 4) == 0) {
+      n = parse_numbers(s + len, v, WS_CURVE_MAX_ORDER + 3);
+      if (spec->n_pieces == WS_CURVE_MAX_PIECES || n < 3 || v[0] > v[1])
+         return -1;
+      spec->pieces[spec->n_pieces].x0 = v[0];
+      spec->pieces[spec->n_pieces].x1 = v[1];
+      spec->pieces[spec->n_pieces].order = n - 3;
+      for (i = 2; i < n; i++)
+         spec->pieces[spec->n_pieces].c[i - 2] = v[i];
+      spec->pieces[spec->n_pieces].line = line;
+      spec->n_pieces++;
+      return 0;
+   }
+   return -1;
+}
+
+
+static int
+compare_points(const void* a, const void* b)
+{
+   const double xa = ((const Point*)a)->x;
+   const double xb = ((const Point*)b)->x;
+
+   return (xa > xb) - (xa < xb);
+}
+
+
+/**
+   Sort the points, mirror them if the curve is odd, and give each one the
+   slope of the monotone cubic: 0 at a local extremum of the points, else
+   the weighted harmonic mean of the secants beside it (Fritsch-Butland), and
+   the secant beside the end points.  Returns the line of a point repeated,
+   or in an odd curve at x < 0 or at 0 with y != 0, and 0 if none.
+*/
+static int
+prepare_points(Spec* spec)
+{
+   Point* p = spec->points;
+   int n = spec->n_points;
+   int i, zero = 0;
+   double h0, h1, d0, d1;
+
+   for (i = 0; i < n; i++) {
+      if (spec->odd && (p[i].x < 0 || (p[i].x == 0 && p[i].y != 0)))
+         return p[i].line;
+      zero |= p[i].x == 0;
+   }
+   if (spec->odd && n > 0) {
+      for (i = 0; i < spec->n_points; i++) {
+         if (p[i].x > 0) {
+            p[n] = p[i];
+            p[n].x = -p[i].x;
+            p[n].y = -p[i].y;
+            n++;
+         }
+      }
+      if (!zero) {
+         p[n].x = 0;
+         p[n].y = 0;
+         p[n].line = 0;
+         n++;
+      }
+   }
+   qsort(p, n, sizeof(Point), compare_points);
+   for (i = 1; i < n; i++)
+      if (p[i].x == p[i - 1].x)
+         return p[i].line > 0 ? p[i].line : p[i - 1].line;
+   spec->n_points = n;
+
+   if (n == 1)
+      p[0].m = 0;
+   for (i = 0; i + 1 < n; i++) {
+      d1 = (p[i + 1].y - p[i].y)/(p[i + 1].x - p[i].x);
+      if (i == 0) {
+         p[0].m = d1;
+      }
+      else {
+         h0 = p[i].x - p[i - 1].x;
+         h1 = p[i + 1].x - p[i].x;
+         d0 = (p[i].y - p[i - 1].y)/h0;
+         p[i].m = (d0*d1 <= 0) ? 0 :
+            3*(h0 + h1)/((2*h1 + h0)/d0 + (h1 + 2*h0)/d1);
+      }
+      p[i + 1].m = d1;
+   }
+   return 0;
+}
+
+
+/**
+   The line of the first piece of an odd curve that reaches below x = 0, or
+   starts at 0 with f(0) != 0; 0 if none.
+*/
+static int
+check_pieces(const Spec* spec)
+{
+   int i;
+
+   for (i = 0; spec->odd && i < spec->n_pieces; i++) {
+      if (spec->pieces[i].x0 < 0 ||
+          (spec->pieces[i].x0 == 0 && spec->pieces[i].c[0] != 0))
+         return spec->pieces[i].line;
+   }
+   return 0;
+}
+
+
+/** f(x) in `*y`; -1 if x is not covered. */
+static int
+eval_spec(const Spec* spec, double x, double* y)
+{
+   const Point* p = spec->points;
+   int i, k, lo, hi;
+   double t, h, s;
+
+   if (spec->odd && x < 0) {
+      i = eval_spec(spec, -x, y);
+      *y = -*y;
+      return i;
+   }
+
+   for (i = 0; i < spec->n_pieces; i++) {
+      const Piece* piece = &spec->pieces[i];
+      if (x >= piece->x0 && x <= piece->x1) {
+         s = piece->c[piece->order];
+         for (k = piece->order - 1; k >= 0; k--)
+            s = s*x + piece->c[k];
+         *y = s;
+         return 0;
+      }
+   }
+
+   if (spec->n_points == 0 || x < p[0].x || x > p[spec->n_points - 1].x)
+      return -1;
+   if (spec->n_points == 1) {
+      *y = p[0].y;
+      return 0;
+   }
+
+   /* The segment [p[lo].x, p[lo + 1].x] holding x */
+   lo = 0;
+   hi = spec->n_points - 1;
+   while (hi - lo > 1) {
+      k = (lo + hi)/2;
+      if (p[k].x <= x)
+         lo = k;
+      else
+         hi = k;
+   }
+   h = p[hi].x - p[lo].x;
+   t = (x - p[lo].x)/h;
+   *y = (2*t*t*t - 3*t*t + 1)*p[lo].y + (t*t*t - 2*t*t + t)*h*p[lo].m +
+        (-2*t*t*t + 3*t*t)*p[hi].y + (t*t*t - t*t)*h*p[hi].m;
+   return 0;
+}
+
+
+WsCurveStatus ws_curve_compile(WsCurve* curve, const char* text, int* line) {
+   Spec* spec;
+   float* table = NULL;
+   char* copy = NULL;
+   char* s;
+   char* next;
+   double y;
+   int i, err, n_line = 0;
+   WsCurveStatus status = WS_CURVE_NO_MEMORY;
+
+   *line = 0;
+   spec = calloc(1, sizeof(Spec));
+   copy = malloc(strlen(text) + 1);
+   table = malloc(2*N*sizeof(float));
+   if (spec == NULL || copy == NULL || table == NULL)
+      goto fail;
+
+   /* Parse a copy, its lines cut where they end */
+   strcpy(copy, text);
+   for (s = copy; s != NULL; s = next) {
+      next = strchr(s, '\n');
+      if (next != NULL)
+         *next++ = '\0';
+      n_line++;
+      if (parse_line(spec, s, n_line) != 0) {
+         *line = n_line;
+         status = WS_CURVE_SYNTAX;
+         goto fail;
+      }
+   }
+   err = prepare_points(spec);
+   if (err == 0)
+      err = check_pieces(spec);
+   if (err != 0) {
+      *line = err;
+      status = WS_CURVE_SYNTAX;
+      goto fail;
+   }
+
+   for (i = 0; i < N; i++) {
+      if (eval_spec(spec, (i - ORIGIN)/SCALE, &y) != 0) {
+         status = WS_CURVE_GAP;
+         goto fail;
+      }
+      table[2*i] = y;
+   }
+   for (i = 0; i < N - 1; i++)
+      table[2*i + 1] = table[2*i + 2] - table[2*i];
+   table[2*N - 1] = 0;
+
+   /* The copy was cut into lines: keep the text as given */
+   strcpy(copy, text);
+   ws_curve_free(curve);
+   curve->table = table;
+   curve->text = copy;
+   free(spec);
+   return WS_CURVE_OK;
+
+fail:
+   free(spec);
+   free(copy);
+   free(table);
+   return status;
+}
+
+
+void ws_curve_free(WsCurve* curve) {
+   free(curve->table);
+   free(curve->text);
+   curve->table = NULL;
+   curve->text = NULL;
+}
+
+
+const char* ws_curve_strerror(WsCurveStatus status) {
+   switch (status) {
+   case WS_CURVE_OK:
+      return "no error";
+   case WS_CURVE_NO_MEMORY:
+      return "out of memory";
+   case WS_CURVE_SYNTAX:
+      return "bad line";
+   case WS_CURVE_GAP:
+      return "part of [-1, 1] is not covered";
+   }
+   return "unknown error";
+}
+
+
+static inline float
+eval_table(const float* table, float x, float gain)
+{
+   float t = gain*x;
+   int i;
+
+   /* As the SSE path: NaN goes to -1 */
+   t = t > -1 ? t : -1;
+   t = t < 1 ? t : 1;
+   t = t*(float)SCALE + (float)ORIGIN;
+   i = (int)t;
+   return table[2*i] + (t - i)*table[2*i + 1];
+}
+
+
+void ws_curve_process(const WsCurve* curve, const float* x, float* y,
+                      uint32_t n, float gain, float level) {
+   uint32_t j = 0;
+   const float* const table = curve->table;
+
+   /*
+      x is clamped to [-1, 1] and so the index to [0, N - 1], at or above 0
+      where truncation is floor.  Only x = 1 reaches N - 1, at a fraction
+      of 0, so the last point needs no segment after it and the index no
+      clamp of its own.  SSE2 has no gather: each lane loads
+      its value and slope, side by side in the table, with one 64-bit move,
+      and two shuffles split the four pairs into values and slopes.
+   */
+#if defined(__SSE2__)
+   const __m128 g = _mm_set1_ps(gain);
+   const __m128 lv = _mm_set1_ps(level);
+   const __m128 lo = _mm_set1_ps(-1);
+   const __m128 hi = _mm_set1_ps(1);
+   const __m128 tscale = _mm_set1_ps(SCALE);
+   const __m128 origin = _mm_set1_ps(ORIGIN);
+
+   for (; j + 4 <= n; j += 4) {
+      __m128 xv = _mm_mul_ps(_mm_loadu_ps(x + j), g);
+      __m128 tv = _mm_min_ps(_mm_max_ps(xv, lo), hi);
+      __m128i iv;
+      __m128 fv, p01, p23, v, s;
+      int k[4];
+
+      tv = _mm_add_ps(_mm_mul_ps(tv, tscale), origin);
+      iv = _mm_cvttps_epi32(tv);
+      fv = _mm_sub_ps(tv, _mm_cvtepi32_ps(iv));
+
+      _mm_storeu_si128((__m128i*)k, iv);
+      p01 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(table + 2*k[0]));
+      p01 = _mm_loadh_pi(p01, (const __m64*)(table + 2*k[1]));
+      p23 = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(table + 2*k[2]));
+      p23 = _mm_loadh_pi(p23, (const __m64*)(table + 2*k[3]));
+      v = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(2, 0, 2, 0));
+      s = _mm_shuffle_ps(p01, p23, _MM_SHUFFLE(3, 1, 3, 1));
+      _mm_storeu_ps(y + j, _mm_mul_ps(lv, _mm_add_ps(v, _mm_mul_ps(fv, s))));
+   }
+#endif
+   for (; j < n; j++)
+      y[j] = level*eval_table(table, x[j], gain);
+}
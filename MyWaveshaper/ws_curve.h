@@ -0,0 +1,61 @@
+#ifndef WS_CURVE_H
+#define WS_CURVE_H
+
+#include <stdint.h>
+
+/**
+   A transfer curve y = f(x) described in text and compiled into a table.
+   One directive per line; `#` starts a comment:
+
+      odd                       f(-x) = -f(x): only x >= 0 is described
+      point <x> <y>             a control point
+      poly <x0> <x1> <c0> ...   f(x) = c0 + c1 x + c2 x^2 ... on [x0, x1],
+                                up to WS_CURVE_MAX_ORDER + 1 coefficients
+
+   At each x a polynomial piece covering it is used, the first one in the
+   text; elsewhere a monotone cubic (Fritsch-Butland) through the points,
+   which keeps a curve through rising points rising.  Every x in [-1, 1]
+   must be covered by one or the other.  An odd curve must pass through 0:
+   a point at x < 0 or at 0 with y != 0, or a piece reaching below 0 or
+   starting at 0 with c0 != 0, is an error at its line.  Numbers are read
+   in the C format whatever the locale.
+*/
+
+/** Points of the table over [-1, 1]: linear interpolation between them is
+    within 3e-8 max |f''| of a smooth curve, plus float rounding. */
+#define WS_CURVE_POINTS 4097
+#define WS_CURVE_MAX_ORDER 7
+#define WS_CURVE_MAX_POINTS 256
+#define WS_CURVE_MAX_PIECES 64
+
+typedef enum {
+   WS_CURVE_OK = 0,
+   WS_CURVE_NO_MEMORY,
+   WS_CURVE_SYNTAX,      // unknown directive, bad number, too many items
+                         // or a point or piece breaking `odd`
+   WS_CURVE_GAP          // part of [-1, 1] is not covered
+} WsCurveStatus;
+
+typedef struct {
+   float* table;   // value and slope of each point, interleaved
+   char*  text;    // the text compiled
+} WsCurve;
+
+/**
+   Compile `text` into `curve`, which must be zeroed or compiled before.
+   On failure `curve` is left as it was and `*line` is set to the line at
+   fault (0 for WS_CURVE_NO_MEMORY and WS_CURVE_GAP).  Allocates: call it
+   outside `run()`.
+*/
+WsCurveStatus ws_curve_compile(WsCurve* curve, const char* text, int* line);
+
+void ws_curve_free(WsCurve* curve);
+
+/** A description of `status`. */
+const char* ws_curve_strerror(WsCurveStatus status);
+
+/** y[i] = level f(gain x[i]), i < n, with x clamped to [-1, 1]. */
+void ws_curve_process(const WsCurve* curve, const float* x, float* y,
+                      uint32_t n, float gain, float level);
+
+#endif